@@ -0,0 +1,313 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "aroon.hh"
+#include <click/appmsgs.hh>
+#include "synapseelement.hh"
+
+using Synapse::SynapseElement;
+
+Aroon::Aroon()
+  : _periods    (25)
+  , _output     (AROON_OSC)
+  , _next_index (0)
+{
+  CacheStruct one;
+
+  _local_cache.push_back (one);
+}
+
+Aroon::~Aroon()
+{
+}
+
+int
+Aroon::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String  output      = "OSC";
+  int     buffer_size = 10;
+
+  if (Args(conf, errh)
+        .read_m ("PERIOD",   _periods)
+        .read   ("OUTPUT",   output)
+        .read   ("BUF_SIZE", buffer_size)
+        .execute() < 0)
+  {
+    return -1;
+  }
+
+  if (_periods < 1)
+  {
+    return errh->error ("PERIOD must be positive");
+  }
+
+  if (output == "UP")
+  {
+    _output = AROON_UP;
+  }
+  else if (output == "DOWN")
+  {
+    _output = AROON_DOWN;
+  }
+  else if (output == "OSC")
+  {
+    _output = AROON_OSC;
+  }
+  else
+  {
+    return errh->error ("OUTPUT must be UP, DOWN or OSC");
+  }
+
+  if (buffer_size < _periods + 1)
+  {
+    errh->warning ("BUF_SIZE %d is less than PERIOD + 1, OP_MODE 1 will use a shorter window",
+                   buffer_size);
+  }
+
+  IndicatorBase::configure (conf, errh);
+
+  // the window has PERIOD + 1 values
+  _max_deque.set_capacity (_periods + 1);
+  _min_deque.set_capacity (_periods + 1);
+
+  click_chatter ("Aroon: PERIOD is %d, OUTPUT is %s", _periods, output.c_str ());
+
+  return 0;
+}
+
+FixedPt Aroon::calculate_result (
+  const int since_max,
+  const int since_min)
+{
+  const FixedPt periods = FixedPt::fromInt (_periods);
+
+  const FixedPt up      = FixedPt::fromInt (100 * (_periods - since_max)) / periods;
+  const FixedPt down    = FixedPt::fromInt (100 * (_periods - since_min)) / periods;
+
+  switch (_output)
+  {
+    case AROON_UP:
+      return up;
+    case AROON_DOWN:
+      return down;
+    default:
+      return up - down;
+  }
+}
+
+int Aroon::get_window_len (
+  RingBuffer& highs,
+  RingBuffer& lows)
+{
+  size_t len = _periods + 1;
+
+  if (highs.occupancy () < len)
+  {
+    len = highs.occupancy ();
+  }
+  if (lows.occupancy () < len)
+  {
+    len = lows.occupancy ();
+  }
+
+  return len;
+}
+
+FixedPt Aroon::initialize_element (Buffers& buffers)
+{
+  return process_naive (buffers);
+}
+
+FixedPt Aroon::process_naive (
+  Buffers&  buffers)
+{
+  // the front of the buffer is the newest value. Of two equal values
+  // the newer one is the extreme, so only a strictly better one counts
+  RingBuffer& highs = buffers[0];
+  RingBuffer& lows  = buffers[low_port ()];
+
+  const int window_len = get_window_len (highs, lows);
+
+  int     since_max = 0;
+  int     since_min = 0;
+  FixedPt max_value = highs[0];
+  FixedPt min_value = lows[0];
+
+  for (int i = 1; i < window_len; ++i)
+  {
+    if (highs[i] > max_value)
+    {
+      max_value = highs[i];
+      since_max = i;
+    }
+    if (lows[i] < min_value)
+    {
+      min_value = lows[i];
+      since_min = i;
+    }
+  }
+
+  return calculate_result (since_max, since_min);
+}
+
+VectorCache& Aroon::process_ext (Buffers& buffers)
+{
+  _local_cache[0]._value = process_naive (buffers);
+
+  // rebuild the deques from the window. This is only done until
+  // the first ADD, from then on commit_opt_ext keeps them up to date
+  RingBuffer& highs = buffers[0];
+  RingBuffer& lows  = buffers[low_port ()];
+
+  const int window_len = get_window_len (highs, lows);
+
+  _max_deque.clear ();
+  _min_deque.clear ();
+
+  for (int i = window_len - 1; i >= 0; --i)
+  {
+    const uint64_t index = window_len - 1 - i;
+    _max_deque.push (highs[i], index);
+    _min_deque.push (lows[i],  index);
+  }
+
+  _next_index = window_len;
+
+  return _local_cache;
+}
+
+VectorCache& Aroon::process_opt_ext(Vector<FixedPt>& increments,
+                                    VectorCache&     cache)
+{
+  // this may be an update, so the new value is not pushed here. Its
+  // index would be _next_index, which gives the start of its window
+  const FixedPt& high = increments[0];
+  const FixedPt& low  = increments[low_port ()];
+
+  if (_next_index >= (uint64_t)_periods)
+  {
+    _max_deque.expire (_next_index - _periods);
+    _min_deque.expire (_next_index - _periods);
+  }
+
+  int since_max = 0;
+  int since_min = 0;
+
+  if (!_max_deque.empty () && (_max_deque.front_value () > high))
+  {
+    since_max = _next_index - _max_deque.front_index ();
+  }
+  if (!_min_deque.empty () && (_min_deque.front_value () < low))
+  {
+    since_min = _next_index - _min_deque.front_index ();
+  }
+
+  _local_cache[0]._value = calculate_result (since_max, since_min);
+
+  return _local_cache;
+}
+
+void Aroon::commit_opt_ext (Vector<FixedPt>& increments)
+{
+  _max_deque.push (increments[0],            _next_index);
+  _min_deque.push (increments[low_port ()],  _next_index);
+
+  ++_next_index;
+}
+
+template <typename Deque>
+static void save_deque (StateWriter& writer, const Deque& deque)
+{
+  writer.write_u32 (deque.size ());
+  for (size_t i = 0; i < deque.size (); ++i)
+  {
+    writer.write_fixedpt  (deque.value_at (i));
+    writer.write_u64      (deque.index_at (i));
+  }
+}
+
+template <typename Deque>
+static bool restore_deque (StateReader& reader, Deque& deque, const size_t max_size)
+{
+  const uint32_t size = reader.read_u32 ();
+  if (size > max_size)
+  {
+    return false;
+  }
+
+  deque.clear ();
+  for (uint32_t i = 0; i < size; ++i)
+  {
+    const FixedPt   value = reader.read_fixedpt ();
+    const uint64_t  index = reader.read_u64 ();
+    deque.push (value, index);
+  }
+
+  return reader.ok ();
+}
+
+void Aroon::save_element_state (StateWriter& writer)
+{
+  writer.write_u32 (_periods);
+  writer.write_u64 (_next_index);
+  save_deque (writer, _max_deque);
+  save_deque (writer, _min_deque);
+}
+
+bool Aroon::restore_element_state (StateReader& reader)
+{
+  if (reader.read_u32 () != (uint32_t) _periods)
+  {
+    click_chatter ("Aroon: saved state has a different PERIOD, not restoring");
+    return false;
+  }
+
+  // pushing the saved entries in order gives the same deques
+  MonotonicDeque<FixedPt, true>   max_deque (_max_deque);
+  MonotonicDeque<FixedPt, false>  min_deque (_min_deque);
+
+  const uint64_t next_index = reader.read_u64 ();
+  if (!restore_deque (reader, max_deque, _periods + 1) ||
+      !restore_deque (reader, min_deque, _periods + 1))
+  {
+    return false;
+  }
+
+  _next_index = next_index;
+  _max_deque  = max_deque;
+  _min_deque  = min_deque;
+
+  return true;
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(Aroon)
@@ -0,0 +1,80 @@
+#ifndef CLICK_AROON_HH
+#define CLICK_AROON_HH
+#include <click/element.hh>
+#include <click/string.hh>
+
+#include <click/global_sizes.hh>
+#include <click/monotonic_deque.hpp>
+#include "indicator_base.hh"
+#include "synapseelement.hh"
+
+CLICK_DECLS
+
+/*
+ * Aroon(PERIOD 25, [OUTPUT UP|DOWN|OSC, BUF_SIZE, OP_MODE, DEBUG])
+ *
+ * Aroon up/down/oscillator over the last PERIOD+1 values. With one input
+ * port both the highs and the lows are taken from it (e.g. the close),
+ * with two inputs port 0 gives the highs and port 1 the lows.
+ *
+ * In OP_MODE 2 the positions of the window maximum and minimum are kept
+ * in monotonic deques, so an update does not depend on PERIOD. An UPDATE
+ * only looks at the deques, an ADD pushes the value into them (see
+ * commit_opt_ext).
+ */
+class Aroon : public IndicatorBase
+{
+  public:
+    Aroon();
+    ~Aroon();
+
+    const char *class_name() const		{ return "Aroon"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+
+    // takes in a buffer, returns 1 value
+    virtual FixedPt       process_naive       (Buffers&         buffers);
+    // takes in a buffer, returns 1 value + cache
+    virtual VectorCache&  process_ext         (Buffers&         buffers);
+    // takes in an increment + cache, returnes 1 value + cache
+    virtual VectorCache&  process_opt_ext     (Vector<FixedPt>& increments,
+                                               VectorCache&     cache);
+
+    virtual void          commit_opt_ext      (Vector<FixedPt>& increments);
+
+    virtual void          save_element_state    (StateWriter&     writer);
+    virtual bool          restore_element_state (StateReader&     reader);
+
+    virtual FixedPt     initialize_element    (Buffers&         buffers);
+
+  private:
+    enum AroonOutput
+    {
+      AROON_UP,
+      AROON_DOWN,
+      AROON_OSC
+    };
+
+    FixedPt   calculate_result  (const int since_max,
+                                 const int since_min);
+
+    int       get_window_len    (RingBuffer&    highs,
+                                 RingBuffer&    lows);
+
+    int       low_port          () { return (ninputs () > 1) ? 1 : 0; }
+
+  private:
+    int                             _periods;
+    AroonOutput                     _output;
+
+    MonotonicDeque<FixedPt, true>   _max_deque;
+    MonotonicDeque<FixedPt, false>  _min_deque;
+    // the index the next added value will get
+    uint64_t                        _next_index;
+
+    VectorCache                     _local_cache;
+
+}; // class Aroon
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,430 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "basket_correlation.hh"
+#include <click/appmsgs.hh>
+#include "synapseelement.hh"
+#include <math.h>
+
+using Synapse::SynapseElement;
+using Synapse::MsgSource;
+using Synapse::MsgValue;
+
+BasketCorrelation::BasketCorrelation()
+  : _interval_sec (1)
+  , _window       (0)
+  , _alpha        (0.05)
+  , _output_beta  (false)
+  , _debug        (false)
+  , _num_symbols  (0)
+  , _timer        (this)
+  , _means        (NULL)
+  , _sums         (NULL)
+  , _comoments    (NULL)
+  , _deltas       (NULL)
+  , _history      (NULL)
+  , _history_pos  (0)
+  , _samples      (0)
+{
+}
+
+BasketCorrelation::~BasketCorrelation()
+{
+}
+
+int
+BasketCorrelation::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String pairs;
+  String output = "CORR";
+  if (Args(conf, errh)
+        .read ("INTERVAL_SEC",  _interval_sec)
+        .read ("WINDOW",        _window)
+        .read ("ALPHA",         _alpha)
+        .read ("PAIRS",         pairs)
+        .read ("OUTPUT",        WordArg(), output)
+        .read ("DEBUG",         _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if (output == "BETA")
+  {
+    _output_beta = true;
+  }
+  else if (output != "CORR")
+  {
+    return errh->error ("OUTPUT must be CORR or BETA");
+  }
+
+  if ((_window == 1) || ((_window == 0) && ((_alpha <= 0) || (_alpha >= 1))))
+  {
+    return errh->error ("WINDOW must be at least 2, or ALPHA between 0 and 1");
+  }
+
+  Vector<String> words;
+  cp_spacevec (pairs, words);
+  if (words.size () % 2 != 0)
+  {
+    return errh->error ("PAIRS needs two input ports per pair");
+  }
+  for (int i = 0; i < words.size (); ++i)
+  {
+    int port = -1;
+    if (!IntArg ().parse (words[i], port) || (port < 0) || (port >= ninputs ()))
+    {
+      return errh->error ("PAIRS: no input port %s", words[i].c_str ());
+    }
+    _pairs.push_back (port);
+  }
+  if (_pairs.size () / 2 < noutputs ())
+  {
+    return errh->error ("%d outputs, but only %d PAIRS", noutputs (), _pairs.size () / 2);
+  }
+
+  return 0;
+}
+
+int
+BasketCorrelation::initialize(ErrorHandler* errh)
+{
+  _num_symbols = ninputs ();
+  const int triangle = _num_symbols * (_num_symbols + 1) / 2;
+
+  _last_close.resize (_num_symbols, 0);
+  _prev_close.resize (_num_symbols, 0);
+
+  _means      = new double [_num_symbols];
+  _sums       = new double [_num_symbols];
+  _deltas     = new double [_num_symbols];
+  _comoments  = new double [triangle];
+  memset (_means,     '\0', sizeof (double) * _num_symbols);
+  memset (_sums,      '\0', sizeof (double) * _num_symbols);
+  memset (_comoments, '\0', sizeof (double) * triangle);
+
+  if (_window > 0)
+  {
+    _history = new double [(size_t) _window * _num_symbols];
+  }
+
+  _timer.initialize (this);
+  if (_interval_sec > 0)
+  {
+    _timer.schedule_after_sec (_interval_sec);
+  }
+
+  return 0;
+}
+
+void
+BasketCorrelation::cleanup(CleanupStage)
+{
+  delete [] _means;
+  delete [] _sums;
+  delete [] _deltas;
+  delete [] _comoments;
+  delete [] _history;
+  _means = _sums = _deltas = _comoments = _history = NULL;
+}
+
+void
+BasketCorrelation::push(int port, Packet* p)
+{
+  const PacketAppType type = p->get_packet_app_type ();
+  if ((type == Synapse::MSG_ADD_SOURCE) ||
+        (type == Synapse::MSG_UPDATE_SOURCE) ||
+          (type == Synapse::MSG_INIT_SOURCE))
+  {
+    const MsgSource* msg = reinterpret_cast<const MsgSource*>(p->data());
+    // the timer reads it from another thread
+    __atomic_store_n (&_last_close[port], (int64_t) msg->_close, __ATOMIC_RELAXED);
+  }
+
+  SynapseElement::discard_packet (*p);
+}
+
+// false until every symbol has a price
+bool
+BasketCorrelation::take_returns (double* returns)
+{
+  for (int i = 0; i < _num_symbols; ++i)
+  {
+    if (__atomic_load_n (&_last_close[i], __ATOMIC_RELAXED) == 0)
+    {
+      return false;
+    }
+  }
+
+  const bool first = (_prev_close[0] == 0);
+  for (int i = 0; i < _num_symbols; ++i)
+  {
+    const double close = (double) __atomic_load_n (&_last_close[i], __ATOMIC_RELAXED) / FIXEDPT_ONE;
+    returns[i]     = first ? 0 : (close / _prev_close[i] - 1.0);
+    _prev_close[i] = close;
+  }
+
+  return !first;
+}
+
+void
+BasketCorrelation::update_ewma (const double* returns)
+{
+  const int     n     = _num_symbols;
+  const double  a     = _alpha;
+  const double  b     = 1.0 - _alpha;
+  double*       d     = _deltas;
+
+  for (int i = 0; i < n; ++i)
+  {
+    d[i]       = returns[i] - _means[i];
+    _means[i] += a * d[i];
+  }
+
+  // C(i,j) = (1 - a) * (C(i,j) + a * d(i) * d(j)), row by row
+  for (int i = 0; i < n; ++i)
+  {
+    double*       row = _comoments + index (i, i);
+    const double* dj  = d + i;
+    const double  adi = a * d[i];
+    const int     len = n - i;
+
+    for (int k = 0; k < len; ++k)
+    {
+      row[k] = b * (row[k] + adi * dj[k]);
+    }
+  }
+}
+
+void
+BasketCorrelation::update_window (const double* returns)
+{
+  const int     n     = _num_symbols;
+  double*       slot  = _history + (size_t) (_history_pos % _window) * n;
+  const bool    full  = (_samples >= _window);
+
+  if (!full)
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      _deltas[i] = 0;
+    }
+  }
+  else
+  {
+    memcpy (_deltas, slot, sizeof (double) * n);
+  }
+  const double* old = _deltas;
+
+  for (int i = 0; i < n; ++i)
+  {
+    _sums[i] += returns[i] - old[i];
+  }
+
+  for (int i = 0; i < n; ++i)
+  {
+    double*       row = _comoments + index (i, i);
+    const double* nj  = returns + i;
+    const double* oj  = old + i;
+    const double  ni  = returns[i];
+    const double  oi  = old[i];
+    const int     len = n - i;
+
+    for (int k = 0; k < len; ++k)
+    {
+      row[k] += ni * nj[k] - oi * oj[k];
+    }
+  }
+
+  memcpy (slot, returns, sizeof (double) * n);
+  ++_history_pos;
+
+  if (full && (_history_pos % _window == 0))
+  {
+    recompute_window ();
+  }
+}
+
+void
+BasketCorrelation::recompute_window ()
+{
+  const int n         = _num_symbols;
+  const int triangle  = n * (n + 1) / 2;
+
+  memset (_sums,      '\0', sizeof (double) * n);
+  memset (_comoments, '\0', sizeof (double) * triangle);
+
+  for (uint32_t s = 0; s < _window; ++s)
+  {
+    const double* r = _history + (size_t) s * n;
+    for (int i = 0; i < n; ++i)
+    {
+      _sums[i] += r[i];
+
+      double*       row = _comoments + index (i, i);
+      const double* rj  = r + i;
+      const double  ri  = r[i];
+      const int     len = n - i;
+
+      for (int k = 0; k < len; ++k)
+      {
+        row[k] += ri * rj[k];
+      }
+    }
+  }
+}
+
+double
+BasketCorrelation::covariance (const int a, const int b) const
+{
+  const int i = (a < b) ? a : b;
+  const int j = (a < b) ? b : a;
+
+  if (_window == 0)
+  {
+    return _comoments[index (i, j)];
+  }
+
+  const double n = (_samples < _window) ? _samples : _window;
+  if (n < 2)
+  {
+    return 0;
+  }
+  return (_comoments[index (i, j)] - _sums[i] * _sums[j] / n) / (n - 1);
+}
+
+double
+BasketCorrelation::correlation (const int i, const int j) const
+{
+  const double var = covariance (i, i) * covariance (j, j);
+  return (var > 0) ? covariance (i, j) / sqrt (var) : 0;
+}
+
+double
+BasketCorrelation::beta (const int i, const int j) const
+{
+  const double var = covariance (j, j);
+  return (var > 0) ? covariance (i, j) / var : 0;
+}
+
+void
+BasketCorrelation::send_value (
+  const int       port,
+  const double    value,
+  const uint64_t  timestamp)
+{
+  MsgValue msg_value;
+  msg_value._value      = FixedPt::fromC (fixedpt_rconst (value));
+  msg_value._timestamp  = timestamp;
+
+  WritablePacket* p = Packet::make (Packet::default_headroom, 0, sizeof (MsgValue) + 1, 0);
+  if (!p)
+  {
+    return;
+  }
+  memcpy (p->data (), reinterpret_cast<char*>(&msg_value), sizeof (msg_value));
+  p->set_packet_app_type (Synapse::MSG_ADD);
+
+  output (port).push (p);
+}
+
+void
+BasketCorrelation::run_timer(Timer*)
+{
+  double returns [_num_symbols];
+  if (take_returns (returns))
+  {
+    if (_window > 0)
+    {
+      update_window (returns);
+    }
+    else
+    {
+      update_ewma (returns);
+    }
+    ++_samples;
+
+    const uint64_t timestamp = Synapse::gcc_rdtsc ();
+    for (int k = 0; k < noutputs (); ++k)
+    {
+      const int i = _pairs[2 * k];
+      const int j = _pairs[2 * k + 1];
+      send_value (k, _output_beta ? beta (i, j) : correlation (i, j), timestamp);
+    }
+
+    if (_debug)
+    {
+      click_chatter ("BasketCorrelation: sample %llu", (unsigned long long) _samples);
+    }
+  }
+
+  _timer.reschedule_after_sec (_interval_sec);
+}
+
+enum { H_CORRELATION, H_BETA, H_SAMPLES };
+
+String
+BasketCorrelation::read_handler(Element* e, void* thunk)
+{
+  BasketCorrelation* bc = static_cast<BasketCorrelation*>(e);
+  if ((intptr_t) thunk == H_SAMPLES)
+  {
+    return String (bc->_samples);
+  }
+
+  StringAccum sa;
+  char        buffer [32];
+  for (int i = 0; i < bc->_num_symbols; ++i)
+  {
+    for (int j = 0; j < bc->_num_symbols; ++j)
+    {
+      const double value = ((intptr_t) thunk == H_BETA) ? bc->beta (i, j)
+                                                        : bc->correlation (i, j);
+      snprintf (buffer, sizeof (buffer), (j == 0) ? "%.4f" : " %.4f", value);
+      sa << buffer;
+    }
+    sa << '\n';
+  }
+  return sa.take_string ();
+}
+
+void
+BasketCorrelation::add_handlers()
+{
+  add_read_handler ("correlation",  read_handler, H_CORRELATION);
+  add_read_handler ("beta",         read_handler, H_BETA);
+  add_read_handler ("samples",      read_handler, H_SAMPLES);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(BasketCorrelation)
@@ -0,0 +1,105 @@
+#ifndef CLICK_BASKET_CORRELATION_HH
+#define CLICK_BASKET_CORRELATION_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/*
+ * BasketCorrelation([INTERVAL_SEC 1, WINDOW 0, ALPHA 0.05, PAIRS "0 1 0 2",
+ *                    OUTPUT CORR|BETA, DEBUG false])
+ *
+ * Rolling covariances of the returns of a basket of symbols, one symbol
+ * per input port (the TradeProcessor outputs, teed), from which the
+ * correlation and beta of every pair are derived.
+ *
+ * Every INTERVAL_SEC seconds the last close of every symbol is sampled
+ * and the returns since the previous sample update the co-moments:
+ *   - WINDOW > 0: over the last WINDOW samples, the oldest sample is
+ *     taken out as the new one goes in; everything is recomputed from
+ *     the window once per WINDOW samples so the rounding errors do not
+ *     add up
+ *   - otherwise:  exponentially weighted with ALPHA
+ * Only the upper triangle is kept, packed row by row, and every row is
+ * updated in one pass over contiguous doubles, which the compiler turns
+ * into SIMD code. The first sample is taken once every symbol has a price.
+ *
+ * PAIRS lists pairs of input ports, output port k sends the correlation
+ * (or the beta of the first symbol against the second one) of pair k as
+ * a MSG_ADD MsgValue after every sample.
+ *
+ * Handlers: correlation, beta (the full matrices as text, one row per
+ * line), samples.
+ */
+
+class BasketCorrelation : public Element
+{
+  public:
+    BasketCorrelation();
+    ~BasketCorrelation();
+
+    const char *class_name() const		{ return "BasketCorrelation"; }
+    const char *port_count() const		{ return "1-/0-"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void push(int port, Packet *p);
+    void run_timer(Timer *);
+
+  private:
+    // position of (i, j), i <= j, in the packed upper triangle
+    int     index         (const int i, const int j) const
+    {
+      return i * _num_symbols - (i * (i - 1)) / 2 + (j - i);
+    }
+
+    bool    take_returns  (double* returns);
+    void    update_ewma   (const double* returns);
+    void    update_window (const double* returns);
+    void    recompute_window ();
+
+    double  covariance    (const int i, const int j) const;
+    double  correlation   (const int i, const int j) const;
+    double  beta          (const int i, const int j) const;
+
+    void    send_value    (const int port, const double value, const uint64_t timestamp);
+
+    static String read_handler (Element*, void*);
+
+  private:
+    uint32_t          _interval_sec;
+    uint32_t          _window;
+    double            _alpha;
+    bool              _output_beta;
+    bool              _debug;
+    Vector<int>       _pairs;         // 2 ports per output
+
+    int               _num_symbols;
+    Timer             _timer;
+
+    // per symbol, written by push
+    Vector<int64_t>   _last_close;    // fixedpt, 0 - no price yet
+    Vector<double>    _prev_close;
+
+    // exponentially weighted: means and the covariances
+    double*           _means;
+    // windowed: sums of the returns and of their products
+    double*           _sums;
+    double*           _comoments;     // packed upper triangle
+    double*           _deltas;        // scratch
+
+    // windowed: the returns of the last WINDOW samples
+    double*           _history;       // [WINDOW][num_symbols]
+    uint32_t          _history_pos;
+    uint64_t          _samples;
+
+}; // class BasketCorrelation
+
+CLICK_ENDDECLS
+#endif
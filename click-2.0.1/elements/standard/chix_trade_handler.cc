@@ -452,5 +452,4 @@ ChixTradeHandler::add_handlers()
 }
 
 CLICK_ENDDECLS
-
-
+EXPORT_ELEMENT(ChixTradeHandler)
@@ -0,0 +1,404 @@
+/*
+ * consolidated_bars.{cc,hh} -- the bars of an instrument over several venues
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+#include <click/heap.hh>
+CLICK_DECLS
+
+#include "consolidated_bars.hh"
+#include <click/appmsgs.hh>
+#include "synapseelement.hh"
+
+using Synapse::SynapseElement;
+using Synapse::MsgSource;
+using Synapse::MsgTrade;
+
+ConsolidatedBars::ConsolidatedBars()
+  : _source_timestamps  (false)
+  , _horizon            (1000000)
+  , _max_hold_usec      (2000)
+  , _buffer_size        (4096)
+  , _interval_sec       (10)
+  , _debug              (false)
+  , _newest             (0)
+  , _released           (0)
+  , _any_released       (false)
+  , _next_order         (0)
+  , _trades             (0)
+  , _late               (0)
+  , _forced             (0)
+  , _unmapped           (0)
+  , _timer              (this)
+  , _hold_timer         (this)
+{
+}
+
+ConsolidatedBars::~ConsolidatedBars()
+{
+}
+
+int
+ConsolidatedBars::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String instruments;
+  String timestamp = "ARRIVAL";
+  if (Args(conf, this, errh)
+        .read_m ("INSTRUMENTS",               instruments)
+        .read   ("TIMESTAMP",                 WordArg (), timestamp)
+        .read   ("HORIZON",                   _horizon)
+        .read   ("MAX_HOLD_USEC",             _max_hold_usec)
+        .read   ("BUFFER",                    _buffer_size)
+        .read   ("AGGREGATION_INTERVAL_SEC",  _interval_sec)
+        .read   ("DEBUG",                     _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if (timestamp == "SOURCE")
+  {
+    _source_timestamps = true;
+  }
+  else if (timestamp != "ARRIVAL")
+  {
+    return errh->error ("TIMESTAMP must be ARRIVAL or SOURCE");
+  }
+  if (_buffer_size == 0)
+  {
+    return errh->error ("BUFFER must be positive");
+  }
+
+  // "NAME VENUE:SYMBOL VENUE:SYMBOL, ..."
+  Vector<String> entries;
+  cp_argvec (instruments, entries);
+  if (entries.size () != noutputs ())
+  {
+    return errh->error ("%d outputs, but %d INSTRUMENTS", noutputs (), entries.size ());
+  }
+
+  _venues.assign (ninputs (), InstrumentMap (-1));
+  _instruments.assign (entries.size (), Instrument ());
+  for (int i = 0; i < entries.size (); ++i)
+  {
+    Vector<String> words;
+    cp_spacevec (entries[i], words);
+    if (words.size () < 2)
+    {
+      return errh->error ("instrument %d: expected NAME VENUE:SYMBOL...", i);
+    }
+    _instruments[i]._name = words[0];
+
+    for (int w = 1; w < words.size (); ++w)
+    {
+      const int colon = words[w].find_left (':');
+      int       venue = -1;
+      if ((colon < 0) || !IntArg ().parse (words[w].substring (0, colon), venue) ||
+            (venue < 0) || (venue >= ninputs ()))
+      {
+        return errh->error ("%s: no venue in %s", words[0].c_str (), words[w].c_str ());
+      }
+
+      const String symbol = words[w].substring (colon + 1);
+      if ((symbol.length () == 0) || (symbol.length () > (int) Synapse::ORDER_SYMBOL_LEN - 1))
+      {
+        return errh->error ("%s: bad symbol %s", words[0].c_str (), symbol.c_str ());
+      }
+
+      SymbolArrayWrapper key;
+      key = symbol.c_str ();
+      if (!_venues[venue].insert (key, i))
+      {
+        return errh->error ("%s is mapped twice on venue %d", symbol.c_str (), venue);
+      }
+    }
+  }
+
+  _heap.reserve (_buffer_size + 1);
+  return 0;
+}
+
+int
+ConsolidatedBars::initialize(ErrorHandler*)
+{
+  _timer.initialize (this);
+  _hold_timer.initialize (this);
+  if (_interval_sec > 0)
+  {
+    _timer.schedule_after_sec (_interval_sec);
+  }
+  return 0;
+}
+
+void
+ConsolidatedBars::send_source (
+  const int                     instrument,
+  const Synapse::PacketAppType  type,
+  const uint64_t                timestamp,
+  const uint8_t                 dirty)
+{
+  WritablePacket* p = Packet::make (Packet::default_headroom, 0, sizeof (MsgSource) + 1, 0);
+  if (!p)
+  {
+    return;
+  }
+
+  const TimeStats& bar = _instruments[instrument]._bar;
+  MsgSource msg_source;
+  msg_source._high      = bar._high;
+  msg_source._low       = bar._low;
+  msg_source._open      = bar._open;
+  msg_source._close     = bar._close;
+  msg_source._volume    = bar._size;
+  msg_source._timestamp = timestamp;
+  msg_source._dirty     = dirty;
+
+  memcpy (p->data (), reinterpret_cast<char*>(&msg_source), sizeof (msg_source));
+  p->set_packet_app_type (type);
+
+  output (instrument).push (p);
+}
+
+// a trade into the bar of its instrument, in order unless it is late
+void
+ConsolidatedBars::release (
+  const Trade&  trade,
+  const bool    late)
+{
+  Instrument& instrument  = _instruments[trade._instrument];
+  TimeStats&  bar         = instrument._bar;
+
+  uint8_t dirty = 0;
+  if (!bar._first_time_updated)
+  {
+    bar._high                 = trade._price;
+    bar._low                  = trade._price;
+    bar._close                = trade._price;
+    bar._size                += trade._size;
+    bar._first_time_updated   = true;
+    dirty                     = Synapse::SOURCE_ALL;
+  }
+  else
+  {
+    if (trade._price > bar._high)
+    {
+      bar._high = trade._price;
+      dirty    |= Synapse::SOURCE_HIGH;
+    }
+    if (trade._price < bar._low)
+    {
+      bar._low  = trade._price;
+      dirty    |= Synapse::SOURCE_LOW;
+    }
+    bar._size += trade._size;
+    if (!late && (trade._price != bar._close))
+    {
+      bar._close = trade._price;
+      dirty     |= Synapse::SOURCE_CLOSE;
+    }
+  }
+
+  if (!late)
+  {
+    _released     = trade._timestamp;
+    _any_released = true;
+  }
+
+  // no price update - no msg, the volume goes with the next one
+  const bool init = !instrument._initialized;
+  if (!init && !(dirty & ~Synapse::SOURCE_VOLUME))
+  {
+    return;
+  }
+  instrument._initialized = true;
+
+  if (_debug)
+  {
+    click_chatter ("%s: %s %s at %s", declaration ().c_str (), instrument._name.c_str (),
+                   late ? "late trade" : "trade", fixedpt_cstr (trade._price, 4));
+  }
+
+  // the venues' times are not one clock, and a late trade's is behind the
+  // msgs sent already, so the msgs are stamped here like the ADDs
+  send_source (trade._instrument, init ? Synapse::MSG_INIT_SOURCE : Synapse::MSG_UPDATE_SOURCE,
+               Synapse::gcc_rdtsc (), init ? Synapse::SOURCE_ALL : dirty);
+}
+
+void
+ConsolidatedBars::release_top ()
+{
+  const Trade trade = _heap[0];
+  pop_heap (_heap.begin (), _heap.end (), TradeBefore ());
+  _heap.pop_back ();
+  release (trade, false);
+}
+
+void
+ConsolidatedBars::push(int port, Packet* p)
+{
+  if ((p->get_packet_app_type () != Synapse::MSG_TRADE) || (p->length () < sizeof (MsgTrade)))
+  {
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  const MsgTrade* msg         = reinterpret_cast<const MsgTrade*>(p->data ());
+  const int*      instrument  = _venues[port].findp (msg->_symbol);
+  if (!instrument || (*instrument < 0))
+  {
+    ++_unmapped;
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+  ++_trades;
+
+  const int64_t now = Timestamp::now ().nsecval ();
+
+  Trade trade;
+  trade._instrument    = *instrument;
+  trade._price         = msg->_price;
+  trade._size          = msg->_size;
+  trade._order         = _next_order++;
+  trade._held_since    = now;
+  if (_source_timestamps)
+  {
+    trade._timestamp   = msg->_src_timestamp ? msg->_src_timestamp : msg->_timestamp;
+  }
+  else
+  {
+    const Timestamp& anno = p->timestamp_anno ();
+    trade._timestamp   = anno ? anno.nsecval () : now;
+  }
+  SynapseElement::discard_packet (*p);
+
+  // behind what has left already, its place in the order is gone
+  if (_any_released && (trade._timestamp < _released))
+  {
+    ++_late;
+    release (trade, true);
+    return;
+  }
+
+  _heap.push_back (trade);
+  push_heap (_heap.begin (), _heap.end (), TradeBefore ());
+  if (trade._timestamp > _newest)
+  {
+    _newest = trade._timestamp;
+  }
+
+  // whatever is a HORIZON behind the newest can go, and the oldest if the
+  // buffer is full
+  while (!_heap.empty () && (_heap[0]._timestamp + _horizon <= _newest))
+  {
+    release_top ();
+  }
+  while (_heap.size () > (int) _buffer_size)
+  {
+    ++_forced;
+    release_top ();
+  }
+
+  if (!_heap.empty () && !_hold_timer.scheduled ())
+  {
+    _hold_timer.schedule_after (Timestamp::make_usec (_max_hold_usec));
+  }
+}
+
+void
+ConsolidatedBars::run_timer(Timer* timer)
+{
+  if (timer == &_hold_timer)
+  {
+    // the venues have gone quiet, what has waited long enough goes
+    const int64_t now = Timestamp::now ().nsecval ();
+    while (!_heap.empty () && (_heap[0]._held_since + (int64_t) _max_hold_usec * 1000 <= now))
+    {
+      release_top ();
+    }
+    if (!_heap.empty ())
+    {
+      _hold_timer.schedule_after (Timestamp::make_usec (_max_hold_usec));
+    }
+    return;
+  }
+
+  for (int i = 0; i < _instruments.size (); ++i)
+  {
+    if (_instruments[i]._initialized)
+    {
+      send_source (i, Synapse::MSG_ADD_SOURCE, Synapse::gcc_rdtsc (), Synapse::SOURCE_ALL);
+      _instruments[i]._bar.rollover ();
+    }
+  }
+
+  _timer.reschedule_after_sec (_interval_sec);
+}
+
+enum { H_TRADES, H_LATE, H_FORCED, H_UNMAPPED, H_BUFFERED, H_BARS };
+
+String
+ConsolidatedBars::read_handler(Element* e, void* thunk)
+{
+  ConsolidatedBars* cb = static_cast<ConsolidatedBars*>(e);
+  switch ((intptr_t) thunk)
+  {
+    case H_TRADES:
+      return String (cb->_trades);
+    case H_LATE:
+      return String (cb->_late);
+    case H_FORCED:
+      return String (cb->_forced);
+    case H_UNMAPPED:
+      return String (cb->_unmapped);
+    case H_BUFFERED:
+      return String (cb->_heap.size ());
+    case H_BARS:
+    {
+      // name open high low close volume
+      StringAccum sa;
+      for (int i = 0; i < cb->_instruments.size (); ++i)
+      {
+        const TimeStats& bar = cb->_instruments[i]._bar;
+        // one at a time, fixedpt_cstr has one buffer
+        sa << cb->_instruments[i]._name;
+        sa << ' ' << fixedpt_cstr (bar._open, 4);
+        sa << ' ' << fixedpt_cstr (bar._high, 4);
+        sa << ' ' << fixedpt_cstr (bar._low, 4);
+        sa << ' ' << fixedpt_cstr (bar._close, 4);
+        sa << ' ' << bar._size << '\n';
+      }
+      return sa.take_string ();
+    }
+    default:
+      return String ();
+  }
+}
+
+void
+ConsolidatedBars::add_handlers()
+{
+  add_read_handler ("trades",   read_handler, H_TRADES);
+  add_read_handler ("late",     read_handler, H_LATE);
+  add_read_handler ("forced",   read_handler, H_FORCED);
+  add_read_handler ("unmapped", read_handler, H_UNMAPPED);
+  add_read_handler ("buffered", read_handler, H_BUFFERED);
+  add_read_handler ("bars",     read_handler, H_BARS);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(ConsolidatedBars)
@@ -0,0 +1,137 @@
+#ifndef CLICK_CONSOLIDATED_BARS_HH
+#define CLICK_CONSOLIDATED_BARS_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include <click/hashmap.hh>
+#include <click/fixedptc.h>
+#include "trade_processor.hh"
+
+CLICK_DECLS
+
+/*
+ * ConsolidatedBars(INSTRUMENTS "BP 0:BPl 1:BP.L, VOD 0:VODl 1:VOD.L",
+ *                  [TIMESTAMP ARRIVAL, HORIZON 1000000, MAX_HOLD_USEC 2000,
+ *                   BUFFER 4096, AGGREGATION_INTERVAL_SEC 10, DEBUG false])
+ *
+ * One set of bars for an instrument that trades on several venues. Every
+ * input port is a venue and gets its MSG_TRADEs: a ChixTradeHandler, or
+ * a TradeProcessor with TRADES true. INSTRUMENTS maps the symbols of the
+ * venues to the instruments, "NAME VENUE:SYMBOL ...", and the bars of the
+ * i-th instrument go out on output i, with the same msgs as a
+ * TradeProcessor output port sends (INIT, UPDATE, and ADD every
+ * AGGREGATION_INTERVAL_SEC), so a SourceSplit and the indicators can be
+ * put behind it.
+ *
+ * The venues come in on their own, so the trades are merged in timestamp
+ * order through a small reorder buffer, a heap of at most BUFFER trades.
+ * A trade leaves it once a trade HORIZON later has come in on any venue,
+ * or when it has been held for MAX_HOLD_USEC, so a quiet venue does not
+ * hold the others up. A trade older than the last one that has left is
+ * late: it still counts towards the high, low and volume, but not the
+ * close.
+ *
+ * TIMESTAMP ARRIVAL orders by the timestamp annotation, when the packet
+ * came off the wire (or when it got here, if the venue does not set it),
+ * in nanoseconds. TIMESTAMP SOURCE orders by the timestamp in the trade,
+ * which the venues must then take from the same clock - HORIZON is in its
+ * units. Either way it only orders the trades: the msgs that go out are
+ * all stamped with the cycle counter when they are sent, as a
+ * TradeProcessor stamps its own, so a join behind it sees one clock.
+ *
+ * Handlers: trades, late, forced (left the buffer because it was full),
+ * unmapped, buffered, bars.
+ */
+
+class ConsolidatedBars : public Element
+{
+  public:
+    ConsolidatedBars();
+    ~ConsolidatedBars();
+
+    const char *class_name() const		{ return "ConsolidatedBars"; }
+    const char *port_count() const		{ return "1-/1-"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void push(int port, Packet *p);
+    void run_timer(Timer *);
+
+  private:
+    typedef Synapse::ArrayWrapper<char, Synapse::ORDER_SYMBOL_LEN>  SymbolArrayWrapper;
+    // venue symbol to instrument
+    typedef HashMap<SymbolArrayWrapper, int>                        InstrumentMap;
+
+    struct Trade
+    {
+      uint64_t  _timestamp;   // what they are ordered by
+      uint64_t  _order;       // arrival order, for the trades of one timestamp
+      int64_t   _held_since;  // nanoseconds, local
+      fixedpt   _price;
+      int64_t   _size;
+      int       _instrument;
+    };
+
+    struct TradeBefore
+    {
+      bool operator() (const Trade& a, const Trade& b) const
+      {
+        return (a._timestamp < b._timestamp) ||
+                 ((a._timestamp == b._timestamp) && (a._order < b._order));
+      }
+    };
+
+    struct Instrument
+    {
+      Instrument () : _initialized (false) {}
+
+      String    _name;
+      TimeStats _bar;
+      bool      _initialized;
+    };
+
+    void      release       (const Trade&     trade,
+                             const bool       late);
+    void      release_top   ();
+    void      send_source   (const int        instrument,
+                             const Synapse::PacketAppType type,
+                             const uint64_t   timestamp,
+                             const uint8_t    dirty);
+
+    static String read_handler (Element*, void*);
+
+  private:
+    bool                    _source_timestamps;
+    uint64_t                _horizon;
+    uint32_t                _max_hold_usec;
+    uint32_t                _buffer_size;
+    uint32_t                _interval_sec;
+    bool                    _debug;
+
+    Vector<InstrumentMap>   _venues;          // one per input port
+    Vector<Instrument>      _instruments;     // one per output port
+
+    // the reorder buffer
+    Vector<Trade>           _heap;
+    uint64_t                _newest;          // the latest timestamp that has come in
+    uint64_t                _released;        // the last one that has left
+    bool                    _any_released;
+    uint64_t                _next_order;
+
+    uint64_t                _trades;
+    uint64_t                _late;
+    uint64_t                _forced;
+    uint64_t                _unmapped;
+
+    Timer                   _timer;
+    Timer                   _hold_timer;
+
+}; // class ConsolidatedBars
+
+CLICK_ENDDECLS
+#endif
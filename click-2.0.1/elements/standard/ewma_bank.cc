@@ -0,0 +1,415 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "ewma_bank.hh"
+#include <click/appmsgs.hh>
+#include "synapseelement.hh"
+
+using Synapse::SynapseElement;
+using Synapse::MsgValue;
+using Synapse::MsgValueVector;
+
+EwmaBank::EwmaBank()
+  : _debug            (false)
+  , _active           (true)
+  , _initialized      (false)
+  , _num_periods      (0)
+  , _last_type        (Synapse::NO_APP_MSG)
+  , _processed_count  (0)
+  , _skipped_count    (0)
+{
+  memset (_alpha,           '\0', sizeof (_alpha));
+  memset (_one_minus_alpha, '\0', sizeof (_one_minus_alpha));
+  memset (_last,            '\0', sizeof (_last));
+  memset (_current,         '\0', sizeof (_current));
+}
+
+EwmaBank::~EwmaBank()
+{
+}
+
+int
+EwmaBank::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String periods;
+  String select;
+
+  if (Args(conf, errh)
+        .read_m ("ALPHA_PERIODS", periods)
+        .read   ("SELECT",        select)
+        .read   ("DEBUG",         _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  Vector<String> periods_vector;
+  cp_spacevec (periods, periods_vector);
+
+  if ((periods_vector.size () < 1) ||
+      (periods_vector.size () > (int) Synapse::VALUE_VECTOR_LEN))
+  {
+    return errh->error ("ALPHA_PERIODS needs between 1 and %d periods",
+                        (int) Synapse::VALUE_VECTOR_LEN);
+  }
+
+  _num_periods = periods_vector.size ();
+
+  for (int i = 0; i < _num_periods; ++i)
+  {
+    int period = 0;
+    if (!IntArg ().parse (periods_vector[i], period) || (period < 1))
+    {
+      return errh->error ("ALPHA_PERIODS: %s is not a valid period",
+                          periods_vector[i].c_str ());
+    }
+
+    // same as EwmaIncremental
+    FixedPt alpha = FixedPt::fromInt (2) /
+                      (FixedPt::fromInt (period) + FixedPt::fromInt (1));
+
+    _alpha[i]           = alpha.getC ();
+    _one_minus_alpha[i] = (1 - alpha).getC ();
+
+    click_chatter ("EwmaBank: EWMA %d alpha value is %s", period, alpha.c_str ());
+  }
+
+  Vector<String> select_vector;
+  cp_spacevec (select, select_vector);
+
+  for (int i = 0; i < select_vector.size (); ++i)
+  {
+    int index = -1;
+    if (!IntArg ().parse (select_vector[i], index) ||
+        (index < 0) || (index >= _num_periods))
+    {
+      return errh->error ("SELECT: %s is not a position in ALPHA_PERIODS",
+                          select_vector[i].c_str ());
+    }
+    _select.push_back (index);
+  }
+
+  if (_select.size () > 0)
+  {
+    if (_select.size () != noutputs ())
+    {
+      return errh->error ("SELECT has %d positions, but there are %d outputs",
+                          _select.size (), noutputs ());
+    }
+  }
+  else if (noutputs () != 1)
+  {
+    return errh->error ("without SELECT all the values go to one output");
+  }
+
+  return 0;
+}
+
+void EwmaBank::calculate (const fixedpt value)
+{
+  // EwmaIncremental: (1 - alpha) * increment + alpha * last
+  for (int i = 0; i < _num_periods; ++i)
+  {
+    _current[i] = fixedpt_add (fixedpt_mul (_one_minus_alpha[i], value),
+                               fixedpt_mul (_alpha[i], _last[i]));
+  }
+}
+
+void EwmaBank::send_vector (
+  Packet&                       packet,
+  const uint64_t                timestamp,
+  const Synapse::PacketAppType  msg_type,
+  const bool                    changed)
+{
+  const size_t msg_size = MsgValueVector::size_for (_num_periods);
+
+  // the vector is bigger than the value we got, grow the packet if needed
+  WritablePacket* p = NULL;
+  if (packet.length () < msg_size)
+  {
+    p = packet.put (msg_size - packet.length ());
+  }
+  else
+  {
+    p = packet.put (0);
+  }
+
+  if (!p)
+  {
+    click_chatter ("EwmaBank - could not grow the packet - cannot send!");
+    return;
+  }
+
+  MsgValueVector* msg = reinterpret_cast<MsgValueVector*>(p->data ());
+
+  msg->_timestamp = timestamp;
+  msg->_count     = _num_periods;
+  msg->_changed   = changed;
+  memcpy (msg->_values, _current, _num_periods * sizeof (fixedpt));
+
+  Synapse::PacketAppType new_type = Synapse::MSG_UPDATE_VECTOR;
+  switch (msg_type)
+  {
+    case Synapse::MSG_ADD:
+      new_type = Synapse::MSG_ADD_VECTOR;
+      break;
+    case Synapse::MSG_INIT:
+      new_type = Synapse::MSG_INIT_VECTOR;
+      break;
+    default:
+      break;
+  }
+  p->set_packet_app_type (new_type);
+
+  checked_output_push (0, p);
+}
+
+void EwmaBank::send_selected (
+  Packet&                       packet,
+  const uint64_t                timestamp,
+  const Synapse::PacketAppType  msg_type,
+  const bool                    changed)
+{
+  MsgValue msg_value;
+
+  const size_t msg_size = sizeof (msg_value);
+
+  if (msg_size > packet.length ())
+  {
+    click_chatter ("EwmaBank - packet too small - cannot send!");
+    SynapseElement::discard_packet (packet);
+    return;
+  }
+
+  msg_value._timestamp  = timestamp;
+  msg_value._changed    = changed;
+
+  // the last port gets the original packet, as in ReuseTee
+  const int n = _select.size ();
+  for (int i = 0; i < n; ++i)
+  {
+    Packet* q = (i < n - 1) ? packet.clone () : &packet;
+    if (!q)
+    {
+      continue;
+    }
+    WritablePacket* p = q->put (0);
+    if (!p)
+    {
+      continue;
+    }
+
+    msg_value._value = FixedPt::fromC (_current[_select[i]]);
+
+    memcpy (p->data (), reinterpret_cast<char*>(&msg_value), msg_size);
+    p->set_packet_app_type (msg_type);
+
+    checked_output_push (i, p);
+  }
+}
+
+void
+EwmaBank::push (
+  int     port,
+  Packet* p)
+{
+  if (!_active)
+  {
+    checked_output_push (0, p);
+    return;
+  }
+
+  const Synapse::PacketAppType msg_type = p->get_packet_app_type ();
+
+  if ((msg_type != Synapse::MSG_ADD) &&
+      (msg_type != Synapse::MSG_UPDATE) &&
+      (msg_type != Synapse::MSG_INIT))
+  {
+    click_chatter ("EwmaBank - incorrect msg type: need ADD or UPDATE or INIT");
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  const MsgValue* msg       = reinterpret_cast<const MsgValue*>(p->data());
+  const uint64_t  timestamp = msg->_timestamp;
+  const bool      changed   = update (msg_type, msg->_value.getC (), msg->_changed);
+
+  if (_select.size () > 0)
+  {
+    send_selected (*p, timestamp, msg_type, changed);
+  }
+  else
+  {
+    send_vector   (*p, timestamp, msg_type, changed);
+  }
+}
+
+bool
+EwmaBank::update (
+  const Synapse::PacketAppType  msg_type,
+  const fixedpt                 value,
+  const bool                    changed_in)
+{
+  bool changed = true;
+
+  if ((msg_type == Synapse::MSG_INIT) || !_initialized)
+  {
+    // same as EwmaIncremental - the first value is the ewma
+    for (int i = 0; i < _num_periods; ++i)
+    {
+      _last[i]    = value;
+      _current[i] = value;
+    }
+    _initialized = true;
+  }
+  else if ((msg_type == Synapse::MSG_UPDATE) &&
+           (_last_type == Synapse::MSG_UPDATE) && !changed_in)
+  {
+    // same input as the previous update - same values
+    changed = false;
+    ++_skipped_count;
+  }
+  else
+  {
+    calculate (value);
+    ++_processed_count;
+  }
+
+  if (msg_type == Synapse::MSG_ADD)
+  {
+    memcpy (_last, _current, _num_periods * sizeof (fixedpt));
+  }
+  _last_type = msg_type;
+
+  if (_debug)
+  {
+    click_chatter ("EwmaBank: input %s, first ewma %s, changed %d",
+                    fixedpt_cstr (value, 4), fixedpt_cstr (_current[0], 4), changed);
+  }
+
+  return changed;
+}
+
+void
+EwmaBank::warm_up (
+  int                 port,
+  const WarmUpMsg&    msg,
+  WarmUpEmitter&      emitter)
+{
+  if (!_active)
+  {
+    emitter.emit (this, 0, msg);
+    return;
+  }
+  // push drops these as well
+  if ((msg._type != Synapse::MSG_ADD) &&
+      (msg._type != Synapse::MSG_UPDATE) &&
+      (msg._type != Synapse::MSG_INIT))
+  {
+    return;
+  }
+
+  const bool changed = update (msg._type, msg._value.getC (), msg._changed);
+
+  WarmUpMsg out = msg;
+  out._changed  = changed;
+  for (int i = 0; i < _select.size (); ++i)
+  {
+    out._value = FixedPt::fromC (_current[_select[i]]);
+    emitter.emit (this, i, out);
+  }
+}
+
+void*
+EwmaBank::cast(const char *name)
+{
+  if (strcmp (name, "Checkpointable") == 0)
+  {
+    return static_cast<Checkpointable*>(this);
+  }
+  if (strcmp (name, "WarmUpTarget") == 0)
+  {
+    return static_cast<WarmUpTarget*>(this);
+  }
+  return Element::cast (name);
+}
+
+void
+EwmaBank::save_state (StateWriter& writer)
+{
+  writer.write_u32   (_num_periods);
+  writer.write_bool  (_initialized);
+  writer.write_u32   (_last_type);
+  writer.write_bytes (_last,    _num_periods * sizeof (fixedpt));
+  writer.write_bytes (_current, _num_periods * sizeof (fixedpt));
+}
+
+bool
+EwmaBank::restore_state (StateReader& reader)
+{
+  if (reader.read_u32 () != (uint32_t) _num_periods)
+  {
+    click_chatter ("EwmaBank: saved state has a different number of periods, not restoring");
+    return false;
+  }
+
+  const bool      initialized = reader.read_bool ();
+  const uint32_t  last_type   = reader.read_u32 ();
+  fixedpt         last    [Synapse::VALUE_VECTOR_LEN];
+  fixedpt         current [Synapse::VALUE_VECTOR_LEN];
+
+  reader.read_bytes (last,    _num_periods * sizeof (fixedpt));
+  reader.read_bytes (current, _num_periods * sizeof (fixedpt));
+
+  if (!reader.ok ())
+  {
+    return false;
+  }
+
+  _initialized  = initialized;
+  _last_type    = (Synapse::PacketAppType) last_type;
+  memcpy (_last,    last,    _num_periods * sizeof (fixedpt));
+  memcpy (_current, current, _num_periods * sizeof (fixedpt));
+
+  return true;
+}
+
+void
+EwmaBank::add_handlers()
+{
+  add_data_handlers("active", Handler::OP_READ | Handler::OP_WRITE | Handler::CHECKBOX | Handler::CALM, &_active);
+  add_data_handlers("processed",  Handler::OP_READ, &_processed_count);
+  add_data_handlers("skipped",    Handler::OP_READ, &_skipped_count);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(EwmaBank)
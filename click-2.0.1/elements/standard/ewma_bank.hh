@@ -0,0 +1,96 @@
+#ifndef CLICK_EWMA_BANK_HH
+#define CLICK_EWMA_BANK_HH
+#include <click/element.hh>
+#include <click/string.hh>
+
+#include <click/global_sizes.hh>
+#include <click/fixedptc.h>
+#include <click/appmsgs.hh>
+#include <click/checkpoint.hh>
+#include <click/warm_up.hh>
+
+CLICK_DECLS
+
+/*
+ * EwmaBank(ALPHA_PERIODS "5 8 13 21", [SELECT "0 2", DEBUG false])
+ *
+ * Calculates EWMAs with several periods over the same series in one go.
+ * The values are the same as the ones of EwmaIncremental (OP_MODE 2) for
+ * each of the periods, but the state of all of them is kept in contiguous
+ * arrays and updated in one pass, instead of one element (with its own
+ * packet clone, Buffers and cache) per period.
+ *
+ * Without SELECT there is one output, which gets all the values in one
+ * MsgValueVector (MSG_ADD_VECTOR, MSG_UPDATE_VECTOR, MSG_INIT_VECTOR).
+ * With SELECT, output port i gets a MsgValue with the EWMA at position
+ * SELECT[i] of ALPHA_PERIODS, so the outputs can be fed to the existing
+ * indicator elements.
+ *
+ * During a WarmUp the EWMAs are brought up to date the same way, and the
+ * SELECT outputs pass theirs on. A MsgValueVector has no warm-up msg, so
+ * without SELECT nothing goes further.
+ */
+class EwmaBank : public Element, public Checkpointable, public WarmUpTarget
+{
+  public:
+    EwmaBank();
+    ~EwmaBank();
+
+    const char *class_name() const		{ return "EwmaBank"; }
+    const char *port_count() const		{ return "1/1-"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+    void *cast(const char *name);
+
+    void save_state    (StateWriter& writer);
+    bool restore_state (StateReader& reader);
+
+    void push(int port, Packet *p);
+
+    void warm_up(int port, const WarmUpMsg& msg, WarmUpEmitter& emitter);
+
+  private:
+    // the EWMAs after a msg, false if they are the same as before
+    bool update         (const Synapse::PacketAppType msg_type,
+                         const fixedpt                value,
+                         const bool                   changed);
+
+    void calculate      (const fixedpt                value);
+
+    void send_vector    (Packet&                      packet,
+                         const uint64_t               timestamp,
+                         const Synapse::PacketAppType msg_type,
+                         const bool                   changed);
+
+    void send_selected  (Packet&                      packet,
+                         const uint64_t               timestamp,
+                         const Synapse::PacketAppType msg_type,
+                         const bool                   changed);
+
+  private:
+    bool                        _debug;
+    bool                        _active;
+    bool                        _initialized;
+    int                         _num_periods;
+    Vector<int>                 _select;
+
+    // one entry per period - kept apart so that the update is one
+    // straight loop over contiguous arrays
+    fixedpt                     _alpha          [Synapse::VALUE_VECTOR_LEN];
+    fixedpt                     _one_minus_alpha[Synapse::VALUE_VECTOR_LEN];
+    fixedpt                     _last           [Synapse::VALUE_VECTOR_LEN];
+    fixedpt                     _current        [Synapse::VALUE_VECTOR_LEN];
+
+    // change propagation, see IndicatorBase
+    Synapse::PacketAppType      _last_type;
+
+    uint64_t                    _processed_count;
+    uint64_t                    _skipped_count;
+
+}; // class EwmaBank
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,231 @@
+/*
+ * feed_arbiter.{cc,hh} -- the first copy of every msg of a redundant feed
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+CLICK_DECLS
+
+#include "feed_arbiter.hh"
+#include "synapseelement.hh"
+
+using Synapse::SynapseElement;
+
+// the timestamp the timestamper puts in front of every msg
+static const uint32_t s_tstamp_len = 8;
+
+FeedArbiter::FeedArbiter()
+  : _header_len   (42)
+  , _window_size  (4096)
+  , _debug        (false)
+  , _forwarded    (0)
+  , _unsequenced  (0)
+{
+}
+
+FeedArbiter::~FeedArbiter()
+{
+}
+
+int
+FeedArbiter::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  if (Args(conf, this, errh)
+        .read ("HEADER_LEN",  _header_len)
+        .read ("WINDOW",      _window_size)
+        .read ("DEBUG",       _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if ((_window_size < 64) || (_window_size & (_window_size - 1)))
+  {
+    return errh->error ("WINDOW must be a power of 2, at least 64");
+  }
+  if (ninputs () >= NO_LINE)
+  {
+    return errh->error ("too many lines");
+  }
+
+  _window.configure (_window_size);
+  _arrival.assign (_window_size, 0);
+  _winner.assign (_window_size, NO_LINE);
+  _lines.assign (ninputs (), LineStats ());
+
+  return 0;
+}
+
+void
+FeedArbiter::reset()
+{
+  _window.reset ();
+  for (int i = 0; i < _winner.size (); ++i)
+  {
+    _winner[i] = NO_LINE;
+  }
+  for (int i = 0; i < _lines.size (); ++i)
+  {
+    _lines[i].clear ();
+  }
+  _forwarded    = 0;
+  _unsequenced  = 0;
+}
+
+void
+FeedArbiter::push(int port, Packet* p)
+{
+  const uint32_t  skip  = _header_len + s_tstamp_len;
+  uint64_t        seq;
+  if ((p->length () <= skip) ||
+        !locate_feed_seq (reinterpret_cast<const char*>(p->data () + skip), p->length () - skip, seq))
+  {
+    ++_unsequenced;
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  const Timestamp&  anno  = p->timestamp_anno ();
+  const int64_t     now   = anno ? anno.nsecval () : Timestamp::now ().nsecval ();
+
+  LineStats& line = _lines[port];
+  ++line._msgs;
+  if (line._highest && (seq > line._highest + 1))
+  {
+    line._gaps += seq - line._highest - 1;
+  }
+  if (seq > line._highest)
+  {
+    line._highest = seq;
+  }
+
+  const uint32_t slot = _window.slot (seq);
+  switch (_window.check (seq))
+  {
+    case SeqWindow::SEQ_NEW:
+    case SeqWindow::SEQ_LATE:
+      _arrival[slot]  = now;
+      _winner[slot]   = port;
+      ++line._first;
+      ++_forwarded;
+      output (0).push (p);
+      return;
+
+    case SeqWindow::SEQ_DUPLICATE:
+      ++line._duplicates;
+      // not known for what came before the first msg
+      if (_winner[slot] != NO_LINE)
+      {
+        const int64_t lag = now - _arrival[slot];
+        line._lag_sum += lag;
+        ++line._lag_count;
+        if (lag > line._lag_max)
+        {
+          line._lag_max = lag;
+        }
+
+        LineStats& winner = _lines[_winner[slot]];
+        winner._lead_sum += lag;
+        ++winner._lead_count;
+      }
+      break;
+
+    case SeqWindow::SEQ_STALE:
+      ++line._stale;
+      if (_debug)
+      {
+        click_chatter ("%s: stale msg %llu on line %d, the highest is %llu", declaration ().c_str (),
+                       (unsigned long long) seq, port, (unsigned long long) _window.highest ());
+      }
+      break;
+  }
+
+  SynapseElement::discard_packet (*p);
+}
+
+enum { H_STATS, H_FORWARDED, H_DUPLICATES, H_STALE, H_GAPS, H_MISSING, H_UNSEQUENCED, H_RESET };
+
+String
+FeedArbiter::read_handler(Element* e, void* thunk)
+{
+  FeedArbiter* fa = static_cast<FeedArbiter*>(e);
+
+  uint64_t total = 0;
+  switch ((intptr_t) thunk)
+  {
+    case H_STATS:
+    {
+      StringAccum sa;
+      sa << "line msgs first duplicates stale gaps lag_avg_ns lag_max_ns lead_avg_ns\n";
+      for (int i = 0; i < fa->_lines.size (); ++i)
+      {
+        const LineStats& line = fa->_lines[i];
+        sa << i << ' ' << line._msgs << ' ' << line._first << ' ' << line._duplicates
+           << ' ' << line._stale << ' ' << line._gaps
+           << ' ' << (line._lag_count ? line._lag_sum / (int64_t) line._lag_count : 0)
+           << ' ' << line._lag_max
+           << ' ' << (line._lead_count ? line._lead_sum / (int64_t) line._lead_count : 0) << '\n';
+      }
+      return sa.take_string ();
+    }
+    case H_FORWARDED:
+      return String (fa->_forwarded);
+    case H_DUPLICATES:
+      for (int i = 0; i < fa->_lines.size (); ++i)
+      {
+        total += fa->_lines[i]._duplicates;
+      }
+      return String (total);
+    case H_STALE:
+      for (int i = 0; i < fa->_lines.size (); ++i)
+      {
+        total += fa->_lines[i]._stale;
+      }
+      return String (total);
+    case H_GAPS:
+      return String (fa->_window.gaps ());
+    case H_MISSING:
+      return String (fa->_window.missing ());
+    case H_UNSEQUENCED:
+      return String (fa->_unsequenced);
+    default:
+      return String ();
+  }
+}
+
+int
+FeedArbiter::write_handler(const String&, Element* e, void*, ErrorHandler*)
+{
+  static_cast<FeedArbiter*>(e)->reset ();
+  return 0;
+}
+
+void
+FeedArbiter::add_handlers()
+{
+  add_read_handler  ("stats",       read_handler, H_STATS);
+  add_read_handler  ("forwarded",   read_handler, H_FORWARDED);
+  add_read_handler  ("duplicates",  read_handler, H_DUPLICATES);
+  add_read_handler  ("stale",       read_handler, H_STALE);
+  add_read_handler  ("gaps",        read_handler, H_GAPS);
+  add_read_handler  ("missing",     read_handler, H_MISSING);
+  add_read_handler  ("unsequenced", read_handler, H_UNSEQUENCED);
+  add_write_handler ("reset",       write_handler, H_RESET);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(FeedArbiter)
@@ -0,0 +1,99 @@
+#ifndef CLICK_FEED_ARBITER_HH
+#define CLICK_FEED_ARBITER_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/feed_seq.hh>
+
+CLICK_DECLS
+
+/*
+ * FeedArbiter([HEADER_LEN 42, WINDOW 4096, DEBUG false])
+ *
+ * The A/B arbitration of a redundant feed: every input port is a line of
+ * it, all sending the same sequenced trade msgs ("...|size|seq", see
+ * locate_feed_seq), and the first copy of every msg to arrive, on any
+ * line, goes out to the TradeProcessor. The others are dropped, so the
+ * feed is as fast as the faster line at every msg and a msg lost on one
+ * line is still there if another has it.
+ *
+ * The msgs seen are kept in a sliding bitmap of the last WINDOW sequence
+ * numbers, see SeqWindow. A msg that is older than that is dropped as
+ * stale, and one that drops out of it without having come on any line
+ * counts as a gap of the feed. HEADER_LEN is the same as for the
+ * TradeProcessor behind it: 42 from FromDevice, 0 from a Socket.
+ *
+ * For every line it keeps the msgs, the ones it was first with, its
+ * duplicates, the jumps in its own sequence, and how far it was behind
+ * (lag) or ahead of (lead) the other lines on the msgs they both had.
+ * The times are the timestamp annotations if the lines set them, else
+ * when the msg got here. The lines are meant to be on one thread.
+ *
+ * Handlers: stats, forwarded, duplicates, stale, gaps, missing,
+ * unsequenced, reset (write).
+ */
+
+class FeedArbiter : public Element
+{
+  public:
+    FeedArbiter();
+    ~FeedArbiter();
+
+    const char *class_name() const		{ return "FeedArbiter"; }
+    const char *port_count() const		{ return "2-/1"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void push(int port, Packet *p);
+
+  private:
+    struct LineStats
+    {
+      LineStats () { clear (); }
+
+      void clear () { memset (this, '\0', sizeof (*this)); }
+
+      uint64_t  _msgs;
+      uint64_t  _first;
+      uint64_t  _duplicates;
+      uint64_t  _stale;
+      uint64_t  _gaps;        // the msgs it skipped in its own sequence
+      uint64_t  _highest;
+
+      // nanoseconds behind the first copy, and ahead of the later ones
+      uint64_t  _lag_count;
+      int64_t   _lag_sum;
+      int64_t   _lag_max;
+      uint64_t  _lead_count;
+      int64_t   _lead_sum;
+    }; // struct LineStats
+
+    enum { NO_LINE = 0xff };
+
+    void            reset           ();
+
+    static String   read_handler    (Element*, void*);
+    static int      write_handler   (const String&, Element*, void*, ErrorHandler*);
+
+  private:
+    uint32_t            _header_len;
+    uint32_t            _window_size;
+    bool                _debug;
+
+    SeqWindow           _window;
+    // per slot of the window: when the first copy came and on which line
+    Vector<int64_t>     _arrival;
+    Vector<uint8_t>     _winner;
+
+    Vector<LineStats>   _lines;
+
+    uint64_t            _forwarded;
+    uint64_t            _unsequenced;
+
+}; // class FeedArbiter
+
+CLICK_ENDDECLS
+#endif
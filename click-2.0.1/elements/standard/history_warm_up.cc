@@ -0,0 +1,283 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+#include "history_warm_up.hh"
+#include "trade_processor.hh"
+#include <click/router.hh>
+#include <click/userutils.hh>
+#include <click/timestamp.hh>
+
+using Synapse::MsgSource;
+
+WarmUp::WarmUp()
+  : _num_bars     (100)
+  , _debug        (false)
+  , _symbols      (0)
+  , _bars         (0)
+  , _delivered    (0)
+  , _warm_up_usec (0)
+{
+}
+
+WarmUp::~WarmUp()
+{
+}
+
+int
+WarmUp::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String pass = "Timestamper Tee";
+  if (Args(conf, errh)
+        .read_m ("FILENAME",  FilenameArg(), _filename)
+        .read   ("BARS",      _num_bars)
+        .read   ("PASS",      pass)
+        .read   ("DEBUG",     _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if (_num_bars == 0)
+  {
+    return errh->error ("BARS must be positive");
+  }
+
+  cp_spacevec (pass, _pass_classes);
+
+  return 0;
+}
+
+// symbol,timestamp,open,high,low,close,volume
+static bool parse_bar (const String& line, String& symbol, MsgSource& bar)
+{
+  Vector<String> fields;
+  int start = 0;
+  for (int i = 0; i <= line.length (); ++i)
+  {
+    if ((i == line.length ()) || (line[i] == ','))
+    {
+      fields.push_back (line.substring (start, i - start).trim_space ());
+      start = i + 1;
+    }
+  }
+  if ((fields.size () != 7) || !fields[0])
+  {
+    return false;
+  }
+
+  double prices[4];
+  for (int i = 0; i < 4; ++i)
+  {
+    char* end = NULL;
+    prices[i] = strtod (fields[2 + i].c_str (), &end);
+    if (*end != '\0')
+    {
+      return false;
+    }
+  }
+
+  symbol          = fields[0];
+  bar._timestamp  = strtoull (fields[1].c_str (), NULL, 10);
+  bar._open       = fixedpt_rconst (prices[0]);
+  bar._high       = fixedpt_rconst (prices[1]);
+  bar._low        = fixedpt_rconst (prices[2]);
+  bar._close      = fixedpt_rconst (prices[3]);
+  bar._volume     = strtoll (fields[6].c_str (), NULL, 10);
+  bar._dirty      = Synapse::SOURCE_ALL;
+
+  return true;
+}
+
+int
+WarmUp::load_bars (BarsMap& bars, ErrorHandler* errh)
+{
+  const String text = file_string (_filename, errh);
+  if (!text)
+  {
+    return -1;
+  }
+
+  int line_no = 0;
+  int start   = 0;
+  while (start < text.length ())
+  {
+    int end = text.find_left ('\n', start);
+    if (end < 0)
+    {
+      end = text.length ();
+    }
+    const String line = text.substring (start, end - start).trim_space ();
+    start = end + 1;
+    ++line_no;
+
+    if (!line || (line[0] == '#'))
+    {
+      continue;
+    }
+
+    String    symbol;
+    MsgSource bar;
+    if (!parse_bar (line, symbol, bar))
+    {
+      errh->warning ("%s:%d: cannot parse the bar, skipped", _filename.c_str (), line_no);
+      continue;
+    }
+
+    Vector<MsgSource>& series = bars.find_force (symbol);
+    if (!series.empty () && (bar._timestamp <= series.back ()._timestamp))
+    {
+      errh->warning ("%s:%d: %s bar out of order, skipped", _filename.c_str (),
+                        line_no, symbol.c_str ());
+      continue;
+    }
+    series.push_back (bar);
+  }
+
+  return 0;
+}
+
+bool
+WarmUp::is_pass_through (const Element* e) const
+{
+  for (int i = 0; i < _pass_classes.size (); ++i)
+  {
+    if (_pass_classes[i] == e->class_name ())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+WarmUp::emit (
+  Element*          from,
+  const int         out_port,
+  const WarmUpMsg&  msg)
+{
+  if (out_port >= from->noutputs ())
+  {
+    return;
+  }
+
+  const Port& port = from->output (out_port);
+  Element*    to   = port.element ();
+  if (!to)
+  {
+    return;
+  }
+
+  ++_delivered;
+  if (_debug)
+  {
+    click_chatter ("WarmUp: %s[%d] -> [%d]%s, type %d", from->name ().c_str (), out_port,
+                      port.port (), to->name ().c_str (), msg._type);
+  }
+
+  WarmUpTarget* target = static_cast<WarmUpTarget*>(to->cast ("WarmUpTarget"));
+  if (target)
+  {
+    target->warm_up (port.port (), msg, *this);
+  }
+  else if (is_pass_through (to))
+  {
+    for (int i = 0; i < to->noutputs (); ++i)
+    {
+      emit (to, i, msg);
+    }
+  }
+}
+
+int
+WarmUp::initialize(ErrorHandler* errh)
+{
+  BarsMap bars;
+  if (load_bars (bars, errh) < 0)
+  {
+    return -1;
+  }
+
+  const Timestamp start = Timestamp::now_steady ();
+
+  Vector<TradeProcessor*> sources;
+  for (int i = 0; i < router ()->nelements (); ++i)
+  {
+    Element* e = router ()->element (i);
+    if (strcmp (e->class_name (), "TradeProcessor") == 0)
+    {
+      sources.push_back (static_cast<TradeProcessor*>(e));
+    }
+  }
+  if (sources.empty ())
+  {
+    errh->warning ("no TradeProcessor to warm up");
+  }
+
+  for (BarsMap::iterator it = bars.begin (); it.live (); ++it)
+  {
+    Vector<MsgSource>& series = it.value ();
+    // only the last BARS bars
+    if (series.size () > (int) _num_bars)
+    {
+      series.erase (series.begin (), series.end () - _num_bars);
+    }
+
+    bool warmed = false;
+    for (int i = 0; i < sources.size (); ++i)
+    {
+      warmed = sources[i]->warm_up_symbol (it.key (), series, *this) || warmed;
+    }
+    if (warmed)
+    {
+      ++_symbols;
+      _bars += series.size ();
+    }
+    else if (_debug)
+    {
+      click_chatter ("WarmUp: nobody subscribes to %s", it.key ().c_str ());
+    }
+  }
+
+  _warm_up_usec = (Timestamp::now_steady () - start).usecval ();
+
+  click_chatter ("WarmUp: %u symbols, %llu bars, %llu msgs in %llu usec",
+                    _symbols, (unsigned long long) _bars,
+                    (unsigned long long) _delivered, (unsigned long long) _warm_up_usec);
+
+  return 0;
+}
+
+void
+WarmUp::add_handlers()
+{
+  add_data_handlers("symbols",  Handler::OP_READ, &_symbols);
+  add_data_handlers("bars",     Handler::OP_READ, &_bars);
+  add_data_handlers("msgs",     Handler::OP_READ, &_delivered);
+  add_data_handlers("usec",     Handler::OP_READ, &_warm_up_usec);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(WarmUp)
@@ -0,0 +1,74 @@
+#ifndef CLICK_HISTORY_WARM_UP_HH
+#define CLICK_HISTORY_WARM_UP_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/hashmap.hh>
+#include <click/vector.hh>
+#include <click/appmsgs.hh>
+#include <click/warm_up.hh>
+
+CLICK_DECLS
+
+/*
+ * WarmUp(FILENAME path, [BARS 100, PASS "Timestamper Tee", DEBUG false])
+ *
+ * Loads the last BARS historical bars of every symbol from FILENAME and
+ * runs them through the indicators while the router is being initialized,
+ * i.e. before the first packet arrives, so that the indicators start in
+ * NORMAL mode with full buffers instead of waiting BUF_SIZE intervals.
+ *
+ * No packets are involved: every TradeProcessor of the router sends the
+ * bars of its symbols downstream as WarmUpMsgs, and they are handed from
+ * element to element along the connections of the config. The elements
+ * that implement WarmUpTarget (SourceSplit, ReuseTee, the indicators)
+ * process them the way they process the packets. The elements whose
+ * class is in PASS forward them to all their outputs. Anything else
+ * (StatPrinter, Discard, sinks, ...) ends the walk.
+ *
+ * FILENAME is a text file with one bar per line, oldest first:
+ *   symbol,timestamp,open,high,low,close,volume
+ * Lines starting with '#' are ignored. The timestamps are only used to
+ * check the order of the bars of a symbol.
+ *
+ * Use either WarmUp or a Checkpoint with RESTORE, not both.
+ */
+
+class WarmUp : public Element, public WarmUpEmitter
+{
+  public:
+    WarmUp();
+    ~WarmUp();
+
+    const char *class_name() const		{ return "WarmUp"; }
+    const char *port_count() const		{ return PORTS_0_0; }
+
+    // after everything else, so that the indicators are initialized
+    int configure_phase() const		{ return CONFIGURE_PHASE_LAST; }
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void emit(Element* from, const int out_port, const WarmUpMsg& msg);
+
+  private:
+    typedef HashMap<String, Vector<Synapse::MsgSource> > BarsMap;
+
+    int   load_bars       (BarsMap& bars, ErrorHandler* errh);
+    bool  is_pass_through (const Element* e) const;
+
+  private:
+    String            _filename;
+    uint32_t          _num_bars;
+    Vector<String>    _pass_classes;
+    bool              _debug;
+
+    uint32_t          _symbols;
+    uint64_t          _bars;
+    uint64_t          _delivered;
+    uint64_t          _warm_up_usec;
+
+}; // class WarmUp
+
+CLICK_ENDDECLS
+#endif
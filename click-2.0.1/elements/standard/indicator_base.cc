@@ -49,6 +49,12 @@ IndicatorBase::IndicatorBase()
   , _op_mode      (NAIVE)
   , _buffers      (NULL)
   , _initialized  (false)
+  , _changed_tstamp   (0)
+  , _inputs_changed   (true)
+  , _last_type        (Synapse::NO_APP_MSG)
+  , _has_last_result  (false)
+  , _processed_count  (0)
+  , _skipped_count    (0)
 {
 }
 
@@ -94,7 +100,8 @@ void IndicatorBase::send_msg_value (
   Packet&             packet,
   const FixedPt&      value,
   const uint64_t      timestamp,
-  const PacketAppType msg_type)
+  const PacketAppType msg_type,
+  const bool          changed)
 {   
   WritablePacket* p = packet.put (0);           
     
@@ -117,6 +124,7 @@ void IndicatorBase::send_msg_value (
     
   msg_value._value      = value;
   msg_value._timestamp  = timestamp;
+  msg_value._changed    = changed;
 
   // copy the msg to the packet 
   memcpy (p->data(), reinterpret_cast<char*>(&msg_value), msg_size);
@@ -137,33 +145,61 @@ void IndicatorBase::send_msg_value (
   return;
 }           
 
-void
-IndicatorBase::push (
-  int     port,
-  Packet* p)
+bool IndicatorBase::can_skip_update (const PacketAppType msg_type)
 {
-  if (!_active)
-  {
-      checked_output_push (0, p);
-      return;
-  }
+  // the cache only moves on ADD, so the previous result can be reused
+  // only if it was produced by an update as well
+  return ((msg_type == Synapse::MSG_UPDATE) &&
+          (_last_type == Synapse::MSG_UPDATE) &&
+          _has_last_result &&
+          !_inputs_changed);
+}
 
+bool IndicatorBase::take_result (
+  const FixedPt&      value,
+  const PacketAppType msg_type,
+  ResultMsg&          result)
+{
+  // downstream elements can skip their work if we send them
+  // the same value as last time
+  result._value   = value;
+  result._type    = msg_type;
+  result._changed = !_has_last_result || (value.getC () != _last_result.getC ());
+
+  _last_result      = value;
+  _has_last_result  = true;
+  _last_type        = msg_type;
+  ++_processed_count;
+
+  return true;
+}
+
+bool IndicatorBase::take_cached_result (ResultMsg& result)
+{
   if (_debug)
   {
-    click_chatter ("IB-%s: packet length is %d", class_name (), p->length ());
+    click_chatter ("IB-%s: inputs unchanged, re-sending %s", class_name (),
+                                                             _last_result.c_str ());
   }
 
-  // 1. make sure that the msg is the right one
-  if ((p->get_packet_app_type () != Synapse::MSG_ADD) && 
-      (p->get_packet_app_type () != Synapse::MSG_UPDATE) &&
-      (p->get_packet_app_type () != Synapse::MSG_INIT))
-  {
-    click_chatter ("IndicatorBase - incorrect msg type: need ADD or UPDATE or INIT");
-    // TODO: discard the msg
-    checked_output_push (0, p);
-    return;
-  }
+  ++_skipped_count;
+
+  result._value   = _last_result;
+  result._type    = Synapse::MSG_UPDATE;
+  result._changed = false;
 
+  return true;
+}
+
+bool
+IndicatorBase::process_value (
+  const int           port,
+  const FixedPt&      value,
+  const uint64_t      timestamp,
+  const bool          changed,
+  const PacketAppType msg_type,
+  ResultMsg&          result)
+{
   // 1. switch-case on operation mode
   // 1a. startup - ignore an update, add ADD to ring buffer and pass it up
   // 1b. normal  - if ADD     -> prepend to the cache, pass it up. Use the return value to refresh the cache.
@@ -176,137 +212,297 @@ IndicatorBase::push (
   // ii)  we ask the element to calculate the return value
   //      which we then forward to the next element in the chain
 
-  const MsgValue* msg = reinterpret_cast<const MsgValue*>(p->data());
+  // all the inputs for a timestamp have to be unchanged for us to skip it
+  if ((timestamp != _changed_tstamp) || (_buffers->is_update_complete ()))
+  {
+    _changed_tstamp = timestamp;
+    _inputs_changed = false;
+  }
+  _inputs_changed = _inputs_changed || changed;
+
   // first of all we need to check if this is an "initialize" msg.
-  if ((p->get_packet_app_type () == Synapse::MSG_INIT) || (_initialized == false))
+  if ((msg_type == Synapse::MSG_INIT) || (_initialized == false))
   {
-    _buffers->add_new_value (msg->_value, msg->_timestamp, port);
-    if (_buffers->is_update_complete ())
+    _buffers->add_new_value (value, timestamp, port);
+    if (!_buffers->is_update_complete ())
     {
-      FixedPt init_value = initialize_element (*_buffers);
-      if (_debug)
-      {
-        click_chatter ("IB: onInit the result to pass on is %s, valid is %d", 
-                          init_value.c_str (), init_value.get_valid ());
-      }
-      if (init_value.get_valid ())
-      {
-        send_msg_value (*p, init_value, msg->_timestamp, p->get_packet_app_type ());
-      }
-      else
-      {
-        // discard as this will not reach the Discard element
-        SynapseElement::discard_packet (*p);
-      }
-      _initialized = true;
-      return;
+      return false; // we will come back here later
     }
-    else
+
+    FixedPt init_value = initialize_element (*_buffers);
+    if (_debug)
+    {
+      click_chatter ("IB: onInit the result to pass on is %s, valid is %d",
+                        init_value.c_str (), init_value.get_valid ());
+    }
+    _initialized = true;
+    if (init_value.get_valid ())
     {
-      // FIXME: do I have to discard here?
-      SynapseElement::discard_packet (*p);
-      return; // we will come back here later
+      return take_result (init_value, msg_type, result);
     }
+    _last_type = msg_type;
+    return false;
   }
 
   if (_op_mode == NAIVE)
   {
-    if (p->get_packet_app_type () == Synapse::MSG_ADD)
+    if (msg_type == Synapse::MSG_ADD)
     {
-      _buffers->add_new_value (msg->_value, msg->_timestamp, port);
+      _buffers->add_new_value (value, timestamp, port);
     }
     else
     {
-      _buffers->add_new_value_temp (msg->_value, msg->_timestamp, port);
+      _buffers->add_new_value_temp (value, timestamp, port);
     }
 
-    if (_buffers->is_update_complete ())
+    if (!_buffers->is_update_complete ())
     {
-      FixedPt result = process_naive (*_buffers);
-      send_msg_value (*p, result, msg->_timestamp, p->get_packet_app_type ());
+      return false; // we will come back later :-)
     }
-    else
+    if (can_skip_update (msg_type))
     {
-      // FIXME: do I have to discard here?
-      SynapseElement::discard_packet (*p);
-      return; // we will come back later :-)
+      return take_cached_result (result);
     }
-
-    return; // just to be future-proof
+    return take_result (process_naive (*_buffers), msg_type, result);
   }
 
   if (_op_mode == STARTUP)
   {
-    if (p->get_packet_app_type () == Synapse::MSG_ADD)
+    if (msg_type == Synapse::MSG_ADD)
     {
-      _buffers->add_new_value (msg->_value, msg->_timestamp, port);
+      _buffers->add_new_value (value, timestamp, port);
     }
     else
     {
-      _buffers->add_new_value_temp (msg->_value, msg->_timestamp, port);
+      _buffers->add_new_value_temp (value, timestamp, port);
     }
 
-    if (_buffers->is_update_complete ())
+    if (!_buffers->is_update_complete ())
     {
-      if (p->get_packet_app_type () == Synapse::MSG_ADD)
-      {
-        _cache = process_ext (*_buffers);
-        _op_mode = NORMAL;
-        send_msg_value (*p, _cache[0]._value, msg->_timestamp, p->get_packet_app_type ());
-      }
-      else
-      {
-        VectorCache&  cache = process_ext (*_buffers);
-        send_msg_value (*p, cache[0]._value, msg->_timestamp, p->get_packet_app_type ());
-      }
-      return; // we are done here
+      return false; // we will come back here later
     }
-    else
+    if (msg_type == Synapse::MSG_ADD)
+    {
+      _cache = process_ext (*_buffers);
+      _op_mode = NORMAL;
+      return take_result (_cache[0]._value, msg_type, result);
+    }
+    else if (can_skip_update (msg_type))
     {
-      // FIXME: do I have to discard here?
-      SynapseElement::discard_packet (*p);
-      return; // we will come back here later
+      return take_cached_result (result);
     }
+    VectorCache&  cache = process_ext (*_buffers);
+    return take_result (cache[0]._value, msg_type, result);
   }
 
-  if (_op_mode == NORMAL)
+  // NORMAL
+  // we keep on using the buffers for the case of multiple input ports
+  // we are not using add_new_value_temp, because we don't reuse the buffers
+  // later, i.e. we don't care
+  _buffers->add_new_value (value, timestamp, port);
+  if (!(_buffers->is_update_complete ()))
   {
-    // we keep on using the buffers for the case of multiple input ports
-    // we are not using add_new_value_temp, because we don't reuse the buffers
-    // later, i.e. we don't care
-    _buffers->add_new_value (msg->_value, msg->_timestamp, port);
-    if (!(_buffers->is_update_complete ()))
-    {
-      // FIXME: do I have to discard here?
-      SynapseElement::discard_packet (*p);
-      return; // we will come back here later
-    }
-    // now assemble the increments into one vector
-    Vector<FixedPt> increments;
-    for (int i = 0; i < _buffers->get_num_ports (); ++i)
-    {
-      increments.push_back ((*_buffers)[i].pop_front ());
-    }
+    return false; // we will come back here later
+  }
+  // now assemble the increments into one vector
+  Vector<FixedPt> increments;
+  for (int i = 0; i < _buffers->get_num_ports (); ++i)
+  {
+    increments.push_back ((*_buffers)[i].pop_front ());
+  }
 
-    if (p->get_packet_app_type () == Synapse::MSG_ADD)
-    {
-      _cache = process_opt_ext (increments, _cache); // a copy here
-      send_msg_value (*p, _cache[0]._value, msg->_timestamp, p->get_packet_app_type ());
-      return;
-    }
-    else
-    {
-      VectorCache&  cache = process_opt_ext (increments, _cache); // no copy here
-      send_msg_value (*p, cache[0]._value, msg->_timestamp, p->get_packet_app_type ());
+  if (msg_type == Synapse::MSG_ADD)
+  {
+    _cache = process_opt_ext (increments, _cache); // a copy here
+    commit_opt_ext (increments);
+    return take_result (_cache[0]._value, msg_type, result);
+  }
+  else if (can_skip_update (msg_type))
+  {
+    return take_cached_result (result);
+  }
+  VectorCache&  cache = process_opt_ext (increments, _cache); // no copy here
+  return take_result (cache[0]._value, msg_type, result);
+}
+
+void
+IndicatorBase::push (
+  int     port,
+  Packet* p)
+{
+  if (!_active)
+  {
+      checked_output_push (0, p);
       return;
-    }
   }
+
+  if (_debug)
+  {
+    click_chatter ("IB-%s: packet length is %d", class_name (), p->length ());
+  }
+
+  // 1. make sure that the msg is the right one
+  if ((p->get_packet_app_type () != Synapse::MSG_ADD) && 
+      (p->get_packet_app_type () != Synapse::MSG_UPDATE) &&
+      (p->get_packet_app_type () != Synapse::MSG_INIT))
+  {
+    click_chatter ("IndicatorBase - incorrect msg type: need ADD or UPDATE or INIT");
+    // TODO: discard the msg
+    checked_output_push (0, p);
+    return;
+  }
+
+  const MsgValue* msg = reinterpret_cast<const MsgValue*>(p->data());
+  ResultMsg       result;
+
+  if (process_value (port, msg->_value, msg->_timestamp, msg->_changed,
+                     p->get_packet_app_type (), result))
+  {
+    send_msg_value (*p, result._value, msg->_timestamp, result._type, result._changed);
+  }
+  else
+  {
+    // FIXME: do I have to discard here?
+    SynapseElement::discard_packet (*p);
+  }
+}
+
+void
+IndicatorBase::warm_up (
+  int                 port,
+  const WarmUpMsg&    msg,
+  WarmUpEmitter&      emitter)
+{
+  if (!_active ||
+      ((msg._type != Synapse::MSG_ADD) &&
+       (msg._type != Synapse::MSG_UPDATE) &&
+       (msg._type != Synapse::MSG_INIT)))
+  {
+    emitter.emit (this, 0, msg);
+    return;
+  }
+
+  ResultMsg result;
+  if (process_value (port, msg._value, msg._timestamp, msg._changed, msg._type, result))
+  {
+    WarmUpMsg out = msg;
+    out._value    = result._value;
+    out._type     = result._type;
+    out._changed  = result._changed;
+
+    emitter.emit (this, 0, out);
+  }
+}
+
+void*
+IndicatorBase::cast(const char *name)
+{
+  if (strcmp (name, "Checkpointable") == 0)
+  {
+    return static_cast<Checkpointable*>(this);
+  }
+  if (strcmp (name, "WarmUpTarget") == 0)
+  {
+    return static_cast<WarmUpTarget*>(this);
+  }
+  return Element::cast (name);
+}
+
+void
+IndicatorBase::save_state (StateWriter& writer)
+{
+  writer.write_u32  (_op_mode);
+  writer.write_bool (_initialized);
+
+  _buffers->save_state (writer);
+
+  writer.write_u32 (_cache.size ());
+  for (int i = 0; i < _cache.size (); ++i)
+  {
+    writer.write_u32      (_cache[i]._type);
+    writer.write_fixedpt  (_cache[i]._value);
+    writer.write_ring     (_cache[i]._ring_buffer);
+  }
+
+  writer.write_u64      (_changed_tstamp);
+  writer.write_bool     (_inputs_changed);
+  writer.write_u32      (_last_type);
+  writer.write_fixedpt  (_last_result);
+  writer.write_bool     (_has_last_result);
+
+  save_element_state (writer);
+}
+
+bool
+IndicatorBase::restore_state (StateReader& reader)
+{
+  const OpMode  op_mode     = (OpMode) reader.read_u32 ();
+  const bool    initialized = reader.read_bool ();
+
+  // a NAIVE element cannot take over a STARTUP/NORMAL state and back
+  if ((op_mode == NAIVE) != (_op_mode == NAIVE))
+  {
+    click_chatter ("IB-%s: saved op mode does not match OP_MODE, not restoring", class_name ());
+    return false;
+  }
+
+  if (!_buffers->restore_state (reader))
+  {
+    click_chatter ("IB-%s: saved buffers do not match IN_PORTS/BUF_SIZE, not restoring", class_name ());
+    return false;
+  }
+
+  VectorCache cache (reader.read_u32 (), CacheStruct ());
+  for (int i = 0; reader.ok () && (i < cache.size ()); ++i)
+  {
+    cache[i]._type  = (CacheType) reader.read_u32 ();
+    cache[i]._value = reader.read_fixedpt ();
+    reader.read_ring (cache[i]._ring_buffer);
+  }
+
+  _changed_tstamp   = reader.read_u64 ();
+  _inputs_changed   = reader.read_bool ();
+  _last_type        = (PacketAppType) reader.read_u32 ();
+  _last_result      = reader.read_fixedpt ();
+  _has_last_result  = reader.read_bool ();
+
+  if (!reader.ok () || !restore_element_state (reader))
+  {
+    // only the buffers are restored, which is history that INIT can
+    // start from just as well
+    _has_last_result  = false;
+    return false;
+  }
+
+  _op_mode      = op_mode;
+  _initialized  = initialized;
+  _cache        = cache;
+
+  return true;
+}
+
+enum { H_LATE, H_DROPPED };
+
+String
+IndicatorBase::read_join_handler(Element* e, void* thunk)
+{
+  IndicatorBase* ib = static_cast<IndicatorBase*>(e);
+  if (!ib->_buffers)
+  {
+    return String (0);
+  }
+  return String ((intptr_t) thunk == H_LATE ? ib->_buffers->get_late ()
+                                            : ib->_buffers->get_dropped ());
 }
 
 void
 IndicatorBase::add_handlers()
 {
   add_data_handlers("active", Handler::OP_READ | Handler::OP_WRITE | Handler::CHECKBOX | Handler::CALM, &_active);
+  add_data_handlers("processed",  Handler::OP_READ, &_processed_count);
+  add_data_handlers("skipped",    Handler::OP_READ, &_skipped_count);
+  add_read_handler ("late",       read_join_handler, H_LATE);
+  add_read_handler ("dropped",    read_join_handler, H_DROPPED);
 }
 
 CLICK_ENDDECLS
@@ -7,6 +7,8 @@
 #include <click/global_sizes.hh>
 #include <click/fixedpt_cpp.h>
 #include <click/buffers.hh>
+#include <click/checkpoint.hh>
+#include <click/warm_up.hh>
 
 CLICK_DECLS
 
@@ -35,7 +37,7 @@ struct CacheStruct
 
 typedef Vector<CacheStruct>   VectorCache;
 
-class IndicatorBase : public Element
+class IndicatorBase : public Element, public Checkpointable, public WarmUpTarget
 {
   public:
     IndicatorBase  ();
@@ -45,6 +47,7 @@ class IndicatorBase : public Element
     int configure         (Vector<String>&, ErrorHandler*);
     bool can_live_reconfigure() const		{ return false; }
     void add_handlers();
+    void *cast(const char *name);
 
     void push           (int                 port,
                          Packet*             p);
@@ -52,7 +55,8 @@ class IndicatorBase : public Element
     void send_msg_value (Packet&             packet,
                          const FixedPt&      value,
                          const uint64_t      timestamp,
-                         const PacketAppType msg_type);
+                         const PacketAppType msg_type,
+                         const bool          changed = true);
 
     virtual FixedPt       initialize_element  (Buffers&         buffers)      = 0;
     // takes in a buffer, returns 1 value
@@ -62,17 +66,72 @@ class IndicatorBase : public Element
     // takes in an increment + cache, returnes 1 value + cache
     virtual VectorCache&  process_opt_ext     (Vector<FixedPt>& increments,
                                                VectorCache&     cache)        = 0;
+    // called after process_opt_ext for an ADD only, for the elements that
+    // keep state outside of the cache and must not change it on an UPDATE
+    virtual void          commit_opt_ext      (Vector<FixedPt>& increments)   {}
+
+    // the same as push, without the packet, see the WarmUp element
+    void  warm_up       (int                 port,
+                         const WarmUpMsg&    msg,
+                         WarmUpEmitter&      emitter);
+
+    // the buffers, the cache and the op mode, see the Checkpoint element
+    void  save_state    (StateWriter& writer);
+    bool  restore_state (StateReader& reader);
+
+    // for the elements that keep state outside of the cache
+    virtual void          save_element_state    (StateWriter&     writer)   {}
+    virtual bool          restore_element_state (StateReader&     reader)   { return true; }
 
   protected:
     bool                        _debug;
     bool                        _active;
     OpMode                      _op_mode;
 
+  private:
+    static String read_join_handler (Element*, void*);
+
+    struct ResultMsg
+    {
+      FixedPt         _value;
+      PacketAppType   _type;
+      bool            _changed;
+    };
+
+    // runs a value through the op mode state machine, returns true
+    // if there is a result to pass on
+    bool  process_value       (const int           port,
+                               const FixedPt&      value,
+                               const uint64_t      timestamp,
+                               const bool          changed,
+                               const PacketAppType msg_type,
+                               ResultMsg&          result);
+
+    // an update whose inputs are all flagged as unchanged gives the same
+    // result as the previous update, so it does not need to be recalculated
+    bool  can_skip_update     (const PacketAppType msg_type);
+
+    bool  take_result         (const FixedPt&      value,
+                               const PacketAppType msg_type,
+                               ResultMsg&          result);
+
+    bool  take_cached_result  (ResultMsg&          result);
+
   private:
     Buffers*                    _buffers;
     VectorCache                 _cache;
     bool                        _initialized;
 
+    // change propagation
+    uint64_t                    _changed_tstamp;
+    bool                        _inputs_changed;
+    PacketAppType               _last_type;
+    FixedPt                     _last_result;
+    bool                        _has_last_result;
+
+    uint64_t                    _processed_count;
+    uint64_t                    _skipped_count;
+
 #ifdef CLICK_LINUXMODULE
     bool                        _cpu : 1;
 #endif
@@ -0,0 +1,441 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "indicator_sink.hh"
+#include <click/appmsgs.hh>
+#include <click/master.hh>
+#include "synapseelement.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using Synapse::SynapseElement;
+using Synapse::MsgValue;
+using Synapse::MsgValueVector;
+
+// O_DIRECT needs the buffer, the offset and the length aligned to this
+static const size_t SINK_BLOCK_SIZE   = 4096;
+static const size_t SINK_STAGING_SIZE = 256 * SINK_BLOCK_SIZE;
+static const size_t SINK_MAX_CSV_LINE = 96;
+static const size_t SINK_BATCH        = 512;
+
+IndicatorSink::IndicatorSink()
+  : _debug          (false)
+  , _active         (true)
+  , _csv            (false)
+  , _direct         (false)
+  , _run_suffix     (true)
+  , _ring_size      (65536)
+  , _idle_usec      (1000)
+  , _fd             (-1)
+  , _writer_running (false)
+  , _stop           (false)
+  , _staging        (NULL)
+  , _staging_fill   (0)
+  , _bytes_written  (0)
+  , _write_failed   (false)
+{
+}
+
+IndicatorSink::~IndicatorSink()
+{
+  for (int i = 0; i < _rings.size (); ++i)
+  {
+    delete _rings[i];
+  }
+  free (_staging);
+}
+
+int
+IndicatorSink::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String format = "BINARY";
+
+  if (Args(conf, errh)
+        .read_m ("FILENAME",    FilenameArg(), _filename)
+        .read   ("FORMAT",      format)
+        .read   ("DIRECT",      _direct)
+        .read   ("RING_SIZE",   _ring_size)
+        .read   ("RUN_SUFFIX",  _run_suffix)
+        .read   ("IDLE_USEC",   _idle_usec)
+        .read   ("DEBUG",       _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if (format == "CSV")
+  {
+    _csv = true;
+  }
+  else if (format != "BINARY")
+  {
+    return errh->error ("FORMAT must be BINARY or CSV");
+  }
+
+  if (_ring_size < 1)
+  {
+    return errh->error ("RING_SIZE must be positive");
+  }
+
+#ifndef O_DIRECT
+  if (_direct)
+  {
+    errh->warning ("O_DIRECT is not supported here, DIRECT is ignored");
+    _direct = false;
+  }
+#endif
+
+  return 0;
+}
+
+int
+IndicatorSink::initialize(ErrorHandler* errh)
+{
+  if (_run_suffix)
+  {
+    _filename += "." + String (Timestamp::now ().sec ()) +
+                 "." + String ((int) getpid ()) +
+                 (_csv ? ".csv" : ".bin");
+  }
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if (_direct)
+  {
+    flags |= O_DIRECT;
+  }
+#endif
+
+  _fd = open (_filename.c_str (), flags, 0644);
+  if (_fd < 0)
+  {
+    return errh->error ("%s: %s", _filename.c_str (), strerror (errno));
+  }
+
+  if (posix_memalign (reinterpret_cast<void**>(&_staging), SINK_BLOCK_SIZE, SINK_STAGING_SIZE) != 0)
+  {
+    _staging = NULL;
+    return errh->error ("cannot allocate the staging buffer");
+  }
+
+  const int num_rings = master ()->nthreads () + 1;
+  for (int i = 0; i < num_rings; ++i)
+  {
+    ThreadRing* ring = new ThreadRing;
+    ring->_ring.set_capacity (_ring_size);
+    ring->_recorded = 0;
+    ring->_dropped  = 0;
+    _rings.push_back (ring);
+  }
+
+  if (_csv)
+  {
+    const char header[] = "timestamp,port,slot,type,changed,value\n";
+    memcpy (_staging, header, sizeof (header) - 1);
+    _staging_fill = sizeof (header) - 1;
+  }
+
+  const int err = pthread_create (&_writer, NULL, writer_thread, this);
+  if (err != 0)
+  {
+    return errh->error ("cannot start the writer thread: %s", strerror (err));
+  }
+  _writer_running = true;
+
+  click_chatter ("IndicatorSink: writing to %s", _filename.c_str ());
+
+  return 0;
+}
+
+void
+IndicatorSink::cleanup(CleanupStage)
+{
+  // the router does not push any more, so whatever is in the rings
+  // now is all there is. The writer drains them before it exits
+  if (_writer_running)
+  {
+    __atomic_store_n (&_stop, true, __ATOMIC_RELEASE);
+    pthread_join (_writer, NULL);
+    _writer_running = false;
+  }
+
+  if (_fd >= 0)
+  {
+    close (_fd);
+    _fd = -1;
+
+    uint64_t recorded = 0;
+    uint64_t dropped  = 0;
+    for (int i = 0; i < _rings.size (); ++i)
+    {
+      recorded  += _rings[i]->_recorded;
+      dropped   += _rings[i]->_dropped;
+    }
+    click_chatter ("IndicatorSink: %llu records, %llu dropped, %llu bytes written to %s",
+                   (unsigned long long) recorded, (unsigned long long) dropped,
+                   (unsigned long long) _bytes_written, _filename.c_str ());
+  }
+}
+
+inline void
+IndicatorSink::record (
+  ThreadRing&     ring,
+  const uint64_t  timestamp,
+  const fixedpt   value,
+  const int       port,
+  const int       slot,
+  const int       msg_type,
+  const bool      changed)
+{
+  SinkRecord rec;
+  rec._timestamp  = timestamp;
+  rec._value      = value;
+  rec._port       = port;
+  rec._slot       = slot;
+  rec._msg_type   = msg_type;
+  rec._changed    = changed;
+  memset (rec._reserved, '\0', sizeof (rec._reserved));
+
+  if (ring._ring.try_push (rec))
+  {
+    ++ring._recorded;
+  }
+  else
+  {
+    ++ring._dropped;
+  }
+}
+
+void
+IndicatorSink::push(int port, Packet* p)
+{
+  if (_active)
+  {
+    // the pushes of a Click thread all go to its own ring, so there is
+    // only ever one producer per ring
+    int idx = _rings.size () - 1;
+#if CLICK_USERLEVEL && HAVE_MULTITHREAD && HAVE___THREAD_STORAGE_CLASS
+    if ((click_current_thread_id >= 0) && (click_current_thread_id < idx))
+    {
+      idx = click_current_thread_id;
+    }
+#else
+    idx = 0;
+#endif
+    ThreadRing& ring = *_rings[idx];
+
+    const int msg_type = p->get_packet_app_type ();
+
+    switch (msg_type)
+    {
+      case Synapse::MSG_ADD:
+      case Synapse::MSG_UPDATE:
+      case Synapse::MSG_INIT:
+      {
+        const MsgValue* msg = reinterpret_cast<const MsgValue*>(p->data ());
+        record (ring, msg->_timestamp, msg->_value.getC (), port, 0, msg_type, msg->_changed);
+        break;
+      }
+      case Synapse::MSG_ADD_VECTOR:
+      case Synapse::MSG_UPDATE_VECTOR:
+      case Synapse::MSG_INIT_VECTOR:
+      {
+        const MsgValueVector* msg = reinterpret_cast<const MsgValueVector*>(p->data ());
+        for (int i = 0; i < msg->_count; ++i)
+        {
+          record (ring, msg->_timestamp, msg->_values[i], port, i, msg_type, msg->_changed);
+        }
+        break;
+      }
+      default:
+        break; // nothing to record
+    }
+  }
+
+  if (port < noutputs ())
+  {
+    output (port).push (p);
+  }
+  else
+  {
+    SynapseElement::discard_packet (*p);
+  }
+}
+
+void*
+IndicatorSink::writer_thread (void* arg)
+{
+  static_cast<IndicatorSink*>(arg)->run_writer ();
+  return NULL;
+}
+
+void
+IndicatorSink::run_writer ()
+{
+  SinkRecord batch[SINK_BATCH];
+
+  while (true)
+  {
+    // read the flag before draining, so that everything pushed before
+    // it was set has been seen when we stop
+    const bool stopping = __atomic_load_n (&_stop, __ATOMIC_ACQUIRE);
+
+    size_t drained = 0;
+    for (int i = 0; i < _rings.size (); ++i)
+    {
+      const size_t count = _rings[i]->_ring.pop_bulk (batch, SINK_BATCH);
+      for (size_t j = 0; j < count; ++j)
+      {
+        append_record (batch[j]);
+      }
+      drained += count;
+    }
+
+    if (drained == 0)
+    {
+      if (stopping)
+      {
+        break;
+      }
+      usleep (_idle_usec);
+    }
+  }
+
+  write_out (true);
+}
+
+void
+IndicatorSink::append_record (const SinkRecord& record)
+{
+  if (_staging_fill + SINK_MAX_CSV_LINE > SINK_STAGING_SIZE)
+  {
+    write_out (false);
+  }
+
+  char* dst = _staging + _staging_fill;
+
+  if (_csv)
+  {
+    char value_str[32];
+    fixedpt_str (record._value, value_str, 6);
+
+    _staging_fill += snprintf (dst, SINK_MAX_CSV_LINE, "%llu,%u,%u,%u,%u,%s\n",
+                               (unsigned long long) record._timestamp,
+                               record._port, record._slot, record._msg_type,
+                               record._changed, value_str);
+  }
+  else
+  {
+    memcpy (dst, &record, sizeof (record));
+    _staging_fill += sizeof (record);
+  }
+}
+
+bool
+IndicatorSink::write_out (const bool final)
+{
+  if (_write_failed)
+  {
+    _staging_fill = 0;
+    return false;
+  }
+
+  size_t len = _staging_fill;
+
+  if (_direct && !final)
+  {
+    // whole blocks only, the rest waits for the next round
+    len -= len % SINK_BLOCK_SIZE;
+  }
+#ifdef O_DIRECT
+  else if (_direct && (len % SINK_BLOCK_SIZE != 0))
+  {
+    // the tail of the file cannot be written with O_DIRECT
+    fcntl (_fd, F_SETFL, fcntl (_fd, F_GETFL) & ~O_DIRECT);
+  }
+#endif
+
+  size_t done = 0;
+  while (done < len)
+  {
+    const ssize_t ret = write (_fd, _staging + done, len - done);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      click_chatter ("IndicatorSink: write to %s failed: %s, no more records will be written",
+                     _filename.c_str (), strerror (errno));
+      _write_failed = true;
+      _staging_fill = 0;
+      return false;
+    }
+    done += ret;
+  }
+
+  _bytes_written += done;
+
+  memmove (_staging, _staging + done, _staging_fill - done);
+  _staging_fill -= done;
+
+  return true;
+}
+
+String
+IndicatorSink::read_handler (Element* e, void* thunk)
+{
+  IndicatorSink* sink = static_cast<IndicatorSink*>(e);
+
+  uint64_t total = 0;
+  for (int i = 0; i < sink->_rings.size (); ++i)
+  {
+    total += thunk ? sink->_rings[i]->_dropped : sink->_rings[i]->_recorded;
+  }
+
+  return String (total);
+}
+
+void
+IndicatorSink::add_handlers()
+{
+  add_data_handlers("active", Handler::OP_READ | Handler::OP_WRITE | Handler::CHECKBOX | Handler::CALM, &_active);
+  add_data_handlers("bytes_written", Handler::OP_READ, &_bytes_written);
+  add_read_handler("recorded", read_handler, 0);
+  add_read_handler("dropped",  read_handler, 1);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(IndicatorSink)
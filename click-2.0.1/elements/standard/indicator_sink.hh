@@ -0,0 +1,112 @@
+#ifndef CLICK_INDICATOR_SINK_HH
+#define CLICK_INDICATOR_SINK_HH
+#include <click/element.hh>
+#include <click/string.hh>
+
+#include <click/global_sizes.hh>
+#include <click/fixedptc.h>
+#include <click/spsc_ring.hpp>
+#include <pthread.h>
+
+CLICK_DECLS
+
+/*
+ * IndicatorSink(FILENAME path, [FORMAT BINARY|CSV, DIRECT false,
+ *               RING_SIZE 65536, RUN_SUFFIX true, IDLE_USEC 1000, DEBUG false])
+ *
+ * Records every MsgValue (ADD, UPDATE, INIT) and every value of a
+ * MsgValueVector that goes through it. The push only copies a
+ * SinkRecord into a ring of the current Click thread, the formatting
+ * and the writes are done by a writer thread in large batches, so the
+ * data path never waits for the disk. If a ring is full the record is
+ * dropped and counted (see the "dropped" handler).
+ *
+ * With RUN_SUFFIX the file is FILENAME.<unix time>.<pid>.{bin,csv}, so
+ * each run gets a new one. BINARY writes the SinkRecords as they are,
+ * DIRECT opens the file with O_DIRECT and writes whole 4KB blocks only.
+ *
+ * A packet from input N leaves on output N if there is one, otherwise
+ * it is discarded.
+ */
+
+// the binary file is a plain array of these
+struct SinkRecord
+{
+  uint64_t  _timestamp;
+  fixedpt   _value;
+  uint16_t  _port;
+  uint8_t   _slot;        // position in a MsgValueVector, 0 for MsgValue
+  uint8_t   _msg_type;
+  uint8_t   _changed;
+  uint8_t   _reserved[3];
+}; // struct SinkRecord
+
+class IndicatorSink : public Element
+{
+  public:
+    IndicatorSink();
+    ~IndicatorSink();
+
+    const char *class_name() const		{ return "IndicatorSink"; }
+    const char *port_count() const		{ return "1-/0-"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void push(int port, Packet *p);
+
+  private:
+    struct ThreadRing
+    {
+      SpscRing<SinkRecord>  _ring;
+      // only written by the thread that owns the ring
+      uint64_t              _recorded;
+      uint64_t              _dropped;
+    };
+
+    inline void record          (ThreadRing&      ring,
+                                 const uint64_t   timestamp,
+                                 const fixedpt    value,
+                                 const int        port,
+                                 const int        slot,
+                                 const int        msg_type,
+                                 const bool       changed);
+
+    static void* writer_thread  (void* arg);
+    void  run_writer            ();
+    void  append_record         (const SinkRecord& record);
+    bool  write_out             (const bool       final);
+
+    static String read_handler  (Element* e, void* thunk);
+
+  private:
+    bool                  _debug;
+    bool                  _active;
+    String                _filename;
+    bool                  _csv;
+    bool                  _direct;
+    bool                  _run_suffix;
+    int                   _ring_size;
+    int                   _idle_usec;
+
+    // one per Click thread, plus one for anything else
+    Vector<ThreadRing*>   _rings;
+
+    // writer side
+    int                   _fd;
+    pthread_t             _writer;
+    bool                  _writer_running;
+    bool                  _stop;
+    char*                 _staging;
+    size_t                _staging_fill;
+    uint64_t              _bytes_written;
+    bool                  _write_failed;
+
+}; // class IndicatorSink
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,350 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "market_breadth.hh"
+#include <click/appmsgs.hh>
+#include <click/master.hh>
+#include "synapseelement.hh"
+
+using Synapse::SynapseElement;
+using Synapse::MsgSource;
+using Synapse::MsgValue;
+
+// McClellan: 10% and 5% trend EMAs of the net advances
+static const fixedpt s_alpha_19 = fixedpt_rconst (0.10);
+static const fixedpt s_alpha_39 = fixedpt_rconst (0.05);
+
+// only the owner thread writes a shard, the readers must not see torn values
+static inline void shard_add (int64_t& counter, const int64_t delta)
+{
+  __atomic_store_n (&counter, __atomic_load_n (&counter, __ATOMIC_RELAXED) + delta,
+                    __ATOMIC_RELAXED);
+}
+
+MarketBreadth::MarketBreadth()
+  : _interval_sec (10)
+  , _debug        (false)
+  , _timer        (this)
+  , _ad_line      (0)
+  , _has_ema      (false)
+{
+}
+
+MarketBreadth::~MarketBreadth()
+{
+}
+
+int
+MarketBreadth::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  if (Args(conf, errh)
+        .read ("INTERVAL_SEC",  _interval_sec)
+        .read ("DEBUG",         _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+int
+MarketBreadth::initialize(ErrorHandler* errh)
+{
+  SymbolState empty;
+  empty._prev_close   = 0;
+  empty._volume       = 0;
+  empty._tick         = BREADTH_UNCHANGED;
+  empty._initialized  = false;
+  _symbols.resize (ninputs (), empty);
+
+  // one per Click thread plus one for anybody else
+  Shard zero;
+  memset (&zero, '\0', sizeof (zero));
+  _shards.resize (master ()->nthreads () + 1, zero);
+
+  _timer.initialize (this);
+  if (_interval_sec > 0)
+  {
+    _timer.schedule_after_sec (_interval_sec);
+  }
+
+  return 0;
+}
+
+MarketBreadth::Shard&
+MarketBreadth::my_shard ()
+{
+  int idx = _shards.size () - 1;
+#if CLICK_USERLEVEL && HAVE_MULTITHREAD && HAVE___THREAD_STORAGE_CLASS
+  if ((click_current_thread_id >= 0) && (click_current_thread_id < idx))
+  {
+    idx = click_current_thread_id;
+  }
+#else
+  idx = 0;
+#endif
+  return _shards[idx];
+}
+
+void
+MarketBreadth::push(int port, Packet* p)
+{
+  const PacketAppType type = p->get_packet_app_type ();
+  if ((type != Synapse::MSG_ADD_SOURCE) &&
+        (type != Synapse::MSG_UPDATE_SOURCE) &&
+          (type != Synapse::MSG_INIT_SOURCE))
+  {
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  const MsgSource* msg    = reinterpret_cast<const MsgSource*>(p->data());
+  SymbolState&     symbol = _symbols[port];
+  Shard&           shard  = my_shard ();
+
+  if ((type == Synapse::MSG_INIT_SOURCE) || !symbol._initialized)
+  {
+    if (symbol._initialized)
+    {
+      // the symbol is back after a remove_symbol, take it out first
+      shard_add (shard._count [symbol._tick], -1);
+      shard_add (shard._volume[symbol._tick], -symbol._volume);
+    }
+    symbol._prev_close  = msg->_close;
+    symbol._volume      = msg->_volume;
+    symbol._tick        = BREADTH_UNCHANGED;
+    symbol._initialized = true;
+
+    shard_add (shard._count [BREADTH_UNCHANGED], 1);
+    shard_add (shard._volume[BREADTH_UNCHANGED], symbol._volume);
+
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  BreadthTick tick = BREADTH_UNCHANGED;
+  if (msg->_close > symbol._prev_close)
+  {
+    tick = BREADTH_UP;
+  }
+  else if (msg->_close < symbol._prev_close)
+  {
+    tick = BREADTH_DOWN;
+  }
+
+  if (tick != symbol._tick)
+  {
+    shard_add (shard._count [symbol._tick], -1);
+    shard_add (shard._count [tick],          1);
+  }
+  shard_add (shard._volume[symbol._tick], -symbol._volume);
+  shard_add (shard._volume[tick],          msg->_volume);
+
+  symbol._tick    = tick;
+  symbol._volume  = msg->_volume;
+
+  // the next bar is compared with this one
+  if (type == Synapse::MSG_ADD_SOURCE)
+  {
+    symbol._prev_close = msg->_close;
+  }
+
+  if (_debug)
+  {
+    click_chatter ("MarketBreadth: port %d tick %d volume %lld", port, tick,
+                      (long long) msg->_volume);
+  }
+
+  SynapseElement::discard_packet (*p);
+}
+
+void
+MarketBreadth::merge (Totals& totals) const
+{
+  memset (&totals, '\0', sizeof (totals));
+  for (int i = 0; i < _shards.size (); ++i)
+  {
+    for (int t = 0; t < BREADTH_TICKS; ++t)
+    {
+      totals._count [t] += __atomic_load_n (&_shards[i]._count [t], __ATOMIC_RELAXED);
+      totals._volume[t] += __atomic_load_n (&_shards[i]._volume[t], __ATOMIC_RELAXED);
+    }
+  }
+}
+
+FixedPt
+MarketBreadth::trin (const Totals& totals) const
+{
+  const int64_t adv     = totals._count [BREADTH_UP];
+  const int64_t dec     = totals._count [BREADTH_DOWN];
+  const int64_t up_vol  = totals._volume[BREADTH_UP];
+  const int64_t dn_vol  = totals._volume[BREADTH_DOWN];
+
+  FixedPt result;
+  if ((dec <= 0) || (up_vol <= 0))
+  {
+    result.set_valid (false);
+    return result;
+  }
+
+  // (adv * dn_vol) / (dec * up_vol), the products do not fit into a fixedpt
+  const fixedptd num = ((fixedptd) adv * dn_vol) << FIXEDPT_FBITS;
+  const fixedptd den = (fixedptd) dec * up_vol;
+
+  return FixedPt::fromC ((fixedpt) (num / den));
+}
+
+void
+MarketBreadth::send_value (
+  const int       port,
+  const FixedPt&  value,
+  const uint64_t  timestamp)
+{
+  if (port >= noutputs ())
+  {
+    return;
+  }
+
+  MsgValue msg_value;
+  msg_value._value      = value;
+  msg_value._timestamp  = timestamp;
+
+  WritablePacket* p = Packet::make (Packet::default_headroom, 0, sizeof (MsgValue) + 1, 0);
+  if (!p)
+  {
+    return;
+  }
+  memcpy (p->data (), reinterpret_cast<char*>(&msg_value), sizeof (msg_value));
+  p->set_packet_app_type (Synapse::MSG_ADD);
+
+  output (port).push (p);
+}
+
+void
+MarketBreadth::run_timer(Timer*)
+{
+  Totals totals;
+  merge (totals);
+
+  const int64_t net     = totals._count[BREADTH_UP] - totals._count[BREADTH_DOWN];
+  const fixedpt net_fp  = fixedpt_fromint (net);
+
+  _ad_line += net;
+
+  if (!_has_ema)
+  {
+    _ema_19   = FixedPt::fromC (net_fp);
+    _ema_39   = FixedPt::fromC (net_fp);
+    _has_ema  = true;
+  }
+  else
+  {
+    _ema_19 = FixedPt::fromC (_ema_19.getC () +
+                              fixedpt_mul (s_alpha_19, net_fp - _ema_19.getC ()));
+    _ema_39 = FixedPt::fromC (_ema_39.getC () +
+                              fixedpt_mul (s_alpha_39, net_fp - _ema_39.getC ()));
+  }
+  _mcclellan = _ema_19 - _ema_39;
+
+  const uint64_t timestamp = Synapse::gcc_rdtsc ();
+  send_value (0, FixedPt::fromInt (_ad_line), timestamp);
+  send_value (1, _mcclellan, timestamp);
+
+  FixedPt trin_value = trin (totals);
+  if (trin_value.get_valid ())
+  {
+    send_value (2, trin_value, timestamp);
+  }
+
+  if (_debug)
+  {
+    click_chatter ("MarketBreadth: adv %lld dec %lld unch %lld, A/D %lld, McClellan %s",
+                      (long long) totals._count[BREADTH_UP], (long long) totals._count[BREADTH_DOWN],
+                      (long long) totals._count[BREADTH_UNCHANGED], (long long) _ad_line,
+                      _mcclellan.c_str ());
+  }
+
+  _timer.reschedule_after_sec (_interval_sec);
+}
+
+enum { H_ADVANCES, H_DECLINES, H_UNCHANGED, H_UP_VOLUME, H_DOWN_VOLUME, H_TRIN, H_AD_LINE, H_MCCLELLAN };
+
+String
+MarketBreadth::read_handler(Element* e, void* thunk)
+{
+  MarketBreadth* mb = static_cast<MarketBreadth*>(e);
+  Totals         totals;
+  mb->merge (totals);
+
+  switch ((intptr_t) thunk)
+  {
+    case H_ADVANCES:
+      return String (totals._count [BREADTH_UP]);
+    case H_DECLINES:
+      return String (totals._count [BREADTH_DOWN]);
+    case H_UNCHANGED:
+      return String (totals._count [BREADTH_UNCHANGED]);
+    case H_UP_VOLUME:
+      return String (totals._volume[BREADTH_UP]);
+    case H_DOWN_VOLUME:
+      return String (totals._volume[BREADTH_DOWN]);
+    case H_TRIN:
+      {
+        FixedPt value = mb->trin (totals);
+        return value.get_valid () ? String (value.c_str ()) : String ("-");
+      }
+    case H_AD_LINE:
+      return String (mb->_ad_line);
+    case H_MCCLELLAN:
+      return String (mb->_mcclellan.c_str ());
+    default:
+      return String ();
+  }
+}
+
+void
+MarketBreadth::add_handlers()
+{
+  add_read_handler ("advances",     read_handler, H_ADVANCES);
+  add_read_handler ("declines",     read_handler, H_DECLINES);
+  add_read_handler ("unchanged",    read_handler, H_UNCHANGED);
+  add_read_handler ("up_volume",    read_handler, H_UP_VOLUME);
+  add_read_handler ("down_volume",  read_handler, H_DOWN_VOLUME);
+  add_read_handler ("trin",         read_handler, H_TRIN);
+  add_read_handler ("ad_line",      read_handler, H_AD_LINE);
+  add_read_handler ("mcclellan",    read_handler, H_MCCLELLAN);
+}
+
+CLICK_ENDDECLS
+ELEMENT_MT_SAFE(MarketBreadth)
+EXPORT_ELEMENT(MarketBreadth)
@@ -0,0 +1,112 @@
+#ifndef CLICK_MARKET_BREADTH_HH
+#define CLICK_MARKET_BREADTH_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include <click/fixedpt_cpp.h>
+
+CLICK_DECLS
+
+/*
+ * MarketBreadth([INTERVAL_SEC 10, DEBUG false])
+ *
+ * Universe-wide breadth of the bars a TradeProcessor sends, one symbol
+ * per input port (tee the TradeProcessor outputs into it). A symbol is
+ * advancing if the close of its current bar is above the close of its
+ * previous bar, declining if below, unchanged otherwise - like
+ * hand_coded's ADLineTick.
+ *
+ * Every source msg moves its symbol between the advancing, declining and
+ * unchanged counts and volumes in O(1). The counts are kept per Click
+ * thread, as the differences that thread made, so the symbols can be
+ * spread over several threads; they are summed up when read. A symbol
+ * must only be pushed by one thread at a time.
+ *
+ * Every INTERVAL_SEC seconds the element adds the net advances to the
+ * A/D line, moves the McClellan oscillator (19 and 39 period EMAs of the
+ * net advances) and sends the results as MSG_ADD MsgValues:
+ *   output 0 - A/D line
+ *   output 1 - McClellan oscillator
+ *   output 2 - TRIN (advances/declines) / (up volume/down volume)
+ *
+ * Handlers: advances, declines, unchanged, up_volume, down_volume, trin
+ * (all live), ad_line, mcclellan (as of the last interval).
+ */
+
+enum BreadthTick
+{
+  BREADTH_UNCHANGED,
+  BREADTH_UP,
+  BREADTH_DOWN,
+  BREADTH_TICKS
+};
+
+class MarketBreadth : public Element
+{
+  public:
+    MarketBreadth();
+    ~MarketBreadth();
+
+    const char *class_name() const		{ return "MarketBreadth"; }
+    const char *port_count() const		{ return "1-/0-3"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void push(int port, Packet *p);
+    void run_timer(Timer *);
+
+  private:
+    // dense, one per input port
+    struct SymbolState
+    {
+      fixedpt       _prev_close;
+      int64_t       _volume;
+      BreadthTick   _tick;
+      bool          _initialized;
+    };
+
+    // what one thread has added to the universe-wide figures
+    struct Shard
+    {
+      int64_t       _count  [BREADTH_TICKS];
+      int64_t       _volume [BREADTH_TICKS];
+      char          _pad [64 - 2 * BREADTH_TICKS * sizeof (int64_t) % 64];
+    };
+
+    struct Totals
+    {
+      int64_t       _count  [BREADTH_TICKS];
+      int64_t       _volume [BREADTH_TICKS];
+    };
+
+    Shard&  my_shard    ();
+    void    merge       (Totals& totals) const;
+    FixedPt trin        (const Totals& totals) const;
+    void    send_value  (const int port, const FixedPt& value, const uint64_t timestamp);
+
+    static String read_handler (Element*, void*);
+
+  private:
+    uint32_t            _interval_sec;
+    bool                _debug;
+
+    Vector<SymbolState> _symbols;
+    Vector<Shard>       _shards;
+
+    Timer               _timer;
+
+    // per interval, only touched by the timer
+    int64_t             _ad_line;
+    FixedPt             _ema_19;
+    FixedPt             _ema_39;
+    FixedPt             _mcclellan;
+    bool                _has_ema;
+
+}; // class MarketBreadth
+
+CLICK_ENDDECLS
+#endif
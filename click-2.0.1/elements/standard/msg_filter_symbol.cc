@@ -38,7 +38,8 @@ CLICK_DECLS
 using Synapse::MsgTrade;
 
 MsgFilterSymbol::MsgFilterSymbol()
-  : _filter_mode    (RESTRICTIVE)
+  : _symbol_map     (new SymbolMap ())
+  , _filter_mode    (RESTRICTIVE)
   , _active         (true)
 {
 }
@@ -88,22 +89,29 @@ MsgFilterSymbol::configure(Vector<String> &conf, ErrorHandler* errh)
     }
   }
 
+  SymbolMap* symbol_map = new SymbolMap ();
+
   for (int i = 0; i < symbols_vector.size (); ++i)
   {
     String& symbol = symbols_vector[i];
     
     SymbolArrayWrapper array_wrapper;
     array_wrapper = symbol.c_str();
-    bool inserted = _symbol_map.insert (array_wrapper, true);
+    bool inserted = symbol_map->insert (array_wrapper, true);
 
     if (!inserted)
     {
       click_chatter ("MsgFilterSymbol - could not insert symbol %s into the map", symbol.c_str());
 
+      delete symbol_map;
       return -1;
     }
   }
 
+  _symbol_map.write_lock ();
+  _symbol_map.publish (symbol_map);
+  _symbol_map.write_unlock ();
+
   return 0;
 }
 
@@ -126,7 +134,9 @@ MsgFilterSymbol::push (int port, Packet *p)
 
   const MsgTrade*   msg_trade = reinterpret_cast<const MsgTrade*>(p->data());
 
-  SymbolMap::Pair*  pair      = _symbol_map.find_pair (msg_trade->_symbol);
+  int               epoch;
+  const bool        pair      = (_symbol_map.read_lock (epoch)->findp (msg_trade->_symbol) != NULL);
+  _symbol_map.read_unlock (epoch);
 
   if (_filter_mode == RESTRICTIVE)
   {
@@ -168,10 +178,75 @@ void MsgFilterSymbol::discard_packet (
   packet.kill ();
 }
 
+enum { H_ADD_SYMBOL, H_REMOVE_SYMBOL };
+
+// adds/removes symbols to/from the ALLOW or RESTRICT list, whichever was configured
+int
+MsgFilterSymbol::symbols_write_handler (
+  const String& str,
+  Element*      e,
+  void*         thunk,
+  ErrorHandler* errh)
+{
+  MsgFilterSymbol* filter = static_cast<MsgFilterSymbol*>(e);
+
+  Vector<String> symbols;
+  cp_spacevec (str, symbols);
+  for (int i = 0; i < symbols.size (); ++i)
+  {
+    if (symbols[i].length () > Synapse::ORDER_SYMBOL_LEN - 1)
+    {
+      return errh->error ("symbol %s is too long", symbols[i].c_str ());
+    }
+  }
+
+  filter->_symbol_map.write_lock ();
+  SymbolMap* symbol_map = new SymbolMap (*filter->_symbol_map.current ());
+  for (int i = 0; i < symbols.size (); ++i)
+  {
+    SymbolArrayWrapper array_wrapper;
+    array_wrapper = symbols[i].c_str();
+    if ((intptr_t) thunk == H_ADD_SYMBOL)
+    {
+      symbol_map->insert (array_wrapper, true);
+    }
+    else
+    {
+      symbol_map->remove (array_wrapper);
+    }
+  }
+  filter->_symbol_map.publish (symbol_map);
+  filter->_symbol_map.write_unlock ();
+
+  return 0;
+}
+
+String
+MsgFilterSymbol::symbols_read_handler (
+  Element*  e,
+  void*)
+{
+  MsgFilterSymbol* filter = static_cast<MsgFilterSymbol*>(e);
+  StringAccum      sa;
+
+  filter->_symbol_map.write_lock ();
+  const SymbolMap* symbol_map = filter->_symbol_map.current ();
+  for (SymbolMap::const_iterator i = symbol_map->begin (); i.live (); ++i)
+  {
+    sa << i.key ().array_ptr () << '\n';
+  }
+  filter->_symbol_map.write_unlock ();
+
+  return sa.take_string ();
+}
+
 void
 MsgFilterSymbol::add_handlers()
 {
     add_data_handlers("active", Handler::OP_READ | Handler::OP_WRITE | Handler::CHECKBOX | Handler::CALM, &_active);
+    add_write_handler("add_symbol",    symbols_write_handler, H_ADD_SYMBOL);
+    add_write_handler("remove_symbol", symbols_write_handler, H_REMOVE_SYMBOL);
+    add_read_handler ("symbols",       symbols_read_handler,  0);
 }
 
 CLICK_ENDDECLS
@@ -6,6 +6,7 @@
 #include <click/hashmap.hh>
 #include <click/array_wrapper.hh>
 #include <click/global_sizes.hh>
+#include <click/rcu_pointer.hpp>
 
 CLICK_DECLS
 
@@ -38,8 +39,13 @@ class MsgFilterSymbol : public Element
   private:
     void   discard_packet (Packet& packet);
 
+    static int    symbols_write_handler (const String&, Element*, void*, ErrorHandler*);
+    static String symbols_read_handler  (Element*, void*);
+
   private:
-    SymbolMap     _symbol_map;
+    // the allowed or restricted symbols, depending on the mode,
+    // replaced as a whole by the add_symbol/remove_symbol handlers
+    RcuPointer<SymbolMap>  _symbol_map;
 
     FilterMode    _filter_mode;
     bool          _active;
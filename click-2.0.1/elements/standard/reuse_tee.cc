@@ -80,6 +80,25 @@ ReuseTee::push(int, Packet *p)
   output(n - 1).push(write_packet);
 }
 
+void
+ReuseTee::warm_up(int, const WarmUpMsg& msg, WarmUpEmitter& emitter)
+{
+  for (int i = 0; i < noutputs(); i++)
+  {
+    emitter.emit (this, i, msg);
+  }
+}
+
+void*
+ReuseTee::cast(const char *name)
+{
+  if (strcmp (name, "WarmUpTarget") == 0)
+  {
+    return static_cast<WarmUpTarget*>(this);
+  }
+  return Element::cast (name);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(ReuseTee)
 ELEMENT_MT_SAFE(ReuseTee)
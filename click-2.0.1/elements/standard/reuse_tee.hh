@@ -1,6 +1,7 @@
 #ifndef CLICK_REUSE_TEE_HH
 #define CLICK_REUSE_TEE_HH
 #include <click/element.hh>
+#include <click/warm_up.hh>
 CLICK_DECLS
 
 /*
@@ -20,11 +21,13 @@ CLICK_DECLS
  * ReuseTee and PullReuseTee have however many outputs are used in the configuration,
  * but you can say how many outputs you expect with the optional argument
  * N.
+ *
+ * During a WarmUp, ReuseTee passes the msgs on to each output the same way.
  */
 
-static const size_t COPY_MSG_MAX_LEN = 256;
+static const size_t COPY_MSG_MAX_LEN = 512; // fits a full MsgValueVector
 
-class ReuseTee : public Element {
+class ReuseTee : public Element, public WarmUpTarget {
 
  public:
 
@@ -36,8 +39,10 @@ class ReuseTee : public Element {
   const char *processing() const		{ return PUSH; }
 
   int configure(Vector<String> &, ErrorHandler *);
+  void *cast(const char *name);
 
   void push(int, Packet *);
+  void warm_up(int port, const WarmUpMsg& msg, WarmUpEmitter& emitter);
 
  private:
   char _copy_buffer[COPY_MSG_MAX_LEN];
@@ -51,6 +51,8 @@ SourceSplit::SourceSplit()
   , _low_port     (-1)
   , _open_port    (-1)
   , _volume_port  (-1)
+  , _sent_count   (0)
+  , _unchanged_count (0)
 {
   _active = true;
 }
@@ -78,12 +80,28 @@ SourceSplit::configure(Vector<String> &conf, ErrorHandler* errh)
   return 0;
 }
 
+Synapse::PacketAppType SourceSplit::value_type (
+  Synapse::PacketAppType source_type)
+{
+  switch (source_type)
+  {
+    case Synapse::MSG_ADD_SOURCE:
+      return Synapse::MSG_ADD;
+    case Synapse::MSG_INIT_SOURCE:
+      return Synapse::MSG_INIT;
+    case Synapse::MSG_UPDATE_SOURCE:
+    default:
+      return Synapse::MSG_UPDATE;
+  }
+}
+
 void SourceSplit::sendMsg (
   Packet&         packet,
   const int       out_port,
   const fixedpt&  value,
   const uint64_t  timestamp,
-  Synapse::PacketAppType msg_type)
+  Synapse::PacketAppType msg_type,
+  const bool      changed)
 {
   WritablePacket* p = packet.put (0);
 
@@ -102,31 +120,23 @@ void SourceSplit::sendMsg (
 
   msg_value._value      = FixedPt::fromC (value);
   msg_value._timestamp  = timestamp;
+  msg_value._changed    = changed;
 
   // copy the msg to the packet
   memcpy (p->data(), reinterpret_cast<char*>(&msg_value), msg_size);
   // set new packet type
-  Synapse::PacketAppType new_type = Synapse::MSG_UPDATE;
-  switch (msg_type)
+  p->set_packet_app_type (value_type (msg_type));
+
+  if (_debug)
   {
-    case Synapse::MSG_ADD_SOURCE:
-      new_type = Synapse::MSG_ADD;
-      break;
-    case Synapse::MSG_UPDATE_SOURCE:
-      new_type = Synapse::MSG_UPDATE;
-      break;
-    case Synapse::MSG_INIT_SOURCE:
-      new_type = Synapse::MSG_INIT;
-      break;
-    default:
-      break;
+    click_chatter ("SourceSplit: sending value %s on port %d, changed %d",
+                    msg_value._value.c_str (), out_port, changed);
   }
-  p->set_packet_app_type (new_type);
 
-  if (_debug)
+  ++_sent_count;
+  if (!changed)
   {
-    click_chatter ("SourceSplit: sending value %s on port %d", msg_value._value.c_str (),
-                                                               out_port);
+    ++_unchanged_count;
   }
 
   checked_output_push (out_port, p);
@@ -174,37 +184,115 @@ SourceSplit::push (
   }
 #endif
 
+  // only the updates can carry unchanged fields, an add or an init
+  // always has to reach every downstream element in full
+  const uint8_t dirty = (type_copy == Synapse::MSG_UPDATE_SOURCE) ? copy._dirty
+                                                                  : Synapse::SOURCE_ALL;
+
   // if msg update or add, extract the values and
   // reuse the msg as container for MsgValue, send
   // the extracted values according to subscription
   if (_open_port > -1)
   {
-    sendMsg (*(p->clone ()), _open_port, copy._open, copy._timestamp, type_copy);
+    sendMsg (*(p->clone ()), _open_port, copy._open, copy._timestamp, type_copy,
+             dirty & Synapse::SOURCE_OPEN);
   }
   if (_high_port > -1)
   {
-    sendMsg (*(p->clone()), _high_port, copy._high, copy._timestamp, type_copy);
+    sendMsg (*(p->clone()), _high_port, copy._high, copy._timestamp, type_copy,
+             dirty & Synapse::SOURCE_HIGH);
   }
   if (_close_port > -1)
   {
-    sendMsg (*(p->clone()), _close_port, copy._close, copy._timestamp, type_copy);
+    sendMsg (*(p->clone()), _close_port, copy._close, copy._timestamp, type_copy,
+             dirty & Synapse::SOURCE_CLOSE);
   }
   if (_low_port > -1)
   {
-    sendMsg (*(p->clone()), _low_port, copy._low, copy._timestamp, type_copy);
+    sendMsg (*(p->clone()), _low_port, copy._low, copy._timestamp, type_copy,
+             dirty & Synapse::SOURCE_LOW);
   }
   if (_volume_port > -1)
   {
-    sendMsg (*(p->clone()), _volume_port, fixedpt_fromint(copy._volume), copy._timestamp, type_copy);
+    sendMsg (*(p->clone()), _volume_port, fixedpt_fromint(copy._volume), copy._timestamp, type_copy,
+             dirty & Synapse::SOURCE_VOLUME);
   }
 
   SynapseElement::discard_packet (*p);
 }
 
+void SourceSplit::emitMsg (
+  WarmUpEmitter&    emitter,
+  const WarmUpMsg&  source,
+  const int         out_port,
+  const fixedpt&    value,
+  const bool        changed)
+{
+  WarmUpMsg msg;
+  msg._type       = value_type (source._type);
+  msg._timestamp  = source._timestamp;
+  msg._changed    = changed;
+  msg._value      = FixedPt::fromC (value);
+
+  emitter.emit (this, out_port, msg);
+}
+
+void
+SourceSplit::warm_up (
+  int               port,
+  const WarmUpMsg&  msg,
+  WarmUpEmitter&    emitter)
+{
+  if ((msg._type != Synapse::MSG_ADD_SOURCE) &&
+        (msg._type != Synapse::MSG_UPDATE_SOURCE) &&
+          (msg._type != Synapse::MSG_INIT_SOURCE))
+  {
+    return;
+  }
+
+  const MsgSource& source = msg._source;
+  const uint8_t    dirty  = (msg._type == Synapse::MSG_UPDATE_SOURCE) ? source._dirty
+                                                                      : Synapse::SOURCE_ALL;
+
+  if (_open_port > -1)
+  {
+    emitMsg (emitter, msg, _open_port, source._open, dirty & Synapse::SOURCE_OPEN);
+  }
+  if (_high_port > -1)
+  {
+    emitMsg (emitter, msg, _high_port, source._high, dirty & Synapse::SOURCE_HIGH);
+  }
+  if (_close_port > -1)
+  {
+    emitMsg (emitter, msg, _close_port, source._close, dirty & Synapse::SOURCE_CLOSE);
+  }
+  if (_low_port > -1)
+  {
+    emitMsg (emitter, msg, _low_port, source._low, dirty & Synapse::SOURCE_LOW);
+  }
+  if (_volume_port > -1)
+  {
+    emitMsg (emitter, msg, _volume_port, fixedpt_fromint(source._volume),
+             dirty & Synapse::SOURCE_VOLUME);
+  }
+}
+
+void*
+SourceSplit::cast(const char *name)
+{
+  if (strcmp (name, "WarmUpTarget") == 0)
+  {
+    return static_cast<WarmUpTarget*>(this);
+  }
+  return Element::cast (name);
+}
+
 void
 SourceSplit::add_handlers()
 {
   add_data_handlers("active", Handler::OP_READ | Handler::OP_WRITE | Handler::CHECKBOX | Handler::CALM, &_active);
+  add_data_handlers("sent",       Handler::OP_READ, &_sent_count);
+  add_data_handlers("unchanged",  Handler::OP_READ, &_unchanged_count);
 }
 
 CLICK_ENDDECLS
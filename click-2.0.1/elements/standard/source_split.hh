@@ -8,10 +8,11 @@
 #include <click/array_wrapper.hh>
 
 #include <click/global_sizes.hh>
+#include <click/warm_up.hh>
 
 CLICK_DECLS
 
-class SourceSplit : public Element
+class SourceSplit : public Element, public WarmUpTarget
 {
   public:
     SourceSplit();
@@ -23,15 +24,28 @@ class SourceSplit : public Element
     int configure(Vector<String> &, ErrorHandler *);
     bool can_live_reconfigure() const		{ return false; }
     void add_handlers();
+    void *cast(const char *name);
 
     void push(int port, Packet *p);
 
+    // splits a bar the same way push does, see the WarmUp element
+    void warm_up(int port, const WarmUpMsg& msg, WarmUpEmitter& emitter);
+
 private:
+    static Synapse::PacketAppType value_type (Synapse::PacketAppType source_type);
+
+    void emitMsg (WarmUpEmitter&  emitter,
+                  const WarmUpMsg& source,
+                  const int       outPort,
+                  const fixedpt&  value,
+                  const bool      changed);
+
     void sendMsg (Packet&         packet,
                   const int       outPort,
                   const fixedpt&  value,
                   const uint64_t  timestamp,
-                  Synapse::PacketAppType msg_type);
+                  Synapse::PacketAppType msg_type,
+                  const bool      changed);
 
 private:
     bool                        _debug;
@@ -40,6 +54,10 @@ private:
     int                         _low_port;
     int                         _open_port;
     int                         _volume_port;
+
+    // values sent and how many of them were flagged as unchanged
+    uint64_t                    _sent_count;
+    uint64_t                    _unchanged_count;
     
     bool                        _active;
 #ifdef CLICK_LINUXMODULE
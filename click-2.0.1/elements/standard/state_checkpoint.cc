@@ -0,0 +1,497 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "state_checkpoint.hh"
+#include <click/router.hh>
+#include <click/straccum.hh>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char     s_magic[8]  = { 'S', 'Y', 'N', 'C', 'K', 'P', 'T', '\0' };
+static const uint32_t s_version   = 2;
+
+static uint64_t fnv1a (const char* data, const size_t len)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= (uint8_t) data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+Checkpoint::Checkpoint()
+  : _interval_sec     (10)
+  , _restore          (true)
+  , _save_on_exit     (true)
+  , _debug            (false)
+  , _timer            (this)
+  , _outstanding      (0)
+  , _writer_running   (false)
+  , _stop             (false)
+  , _has_pending      (false)
+  , _pending_records  (0)
+  , _num_records      (0)
+  , _snapshots        (0)
+  , _restored         (0)
+{
+  pthread_mutex_init (&_lock, NULL);
+  pthread_cond_init  (&_cond, NULL);
+}
+
+Checkpoint::~Checkpoint()
+{
+  for (int i = 0; i < _thread_snapshots.size (); ++i)
+  {
+    delete _thread_snapshots[i];
+  }
+  pthread_cond_destroy  (&_cond);
+  pthread_mutex_destroy (&_lock);
+}
+
+int
+Checkpoint::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  if (Args(conf, errh)
+        .read_m ("FILENAME",      FilenameArg(), _filename)
+        .read   ("INTERVAL_SEC",  _interval_sec)
+        .read   ("RESTORE",       _restore)
+        .read   ("SAVE_ON_EXIT",  _save_on_exit)
+        .read   ("DEBUG",         _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+int
+Checkpoint::initialize(ErrorHandler* errh)
+{
+  if (_restore)
+  {
+    restore (errh);
+  }
+
+  const int err = pthread_create (&_writer, NULL, writer_thread, this);
+  if (err != 0)
+  {
+    return errh->error ("cannot start the writer thread: %s", strerror (err));
+  }
+  _writer_running = true;
+
+  // a timer on the home thread of every Checkpointable element
+  for (int i = 0; i < router ()->nelements (); ++i)
+  {
+    Element* e = router ()->element (i);
+    if (e->cast ("Checkpointable") == NULL)
+    {
+      continue;
+    }
+
+    const int       thread  = router ()->home_thread_id (e);
+    ThreadSnapshot* ts      = NULL;
+    for (int t = 0; (t < _thread_snapshots.size ()) && !ts; ++t)
+    {
+      if (router ()->home_thread_id (_thread_snapshots[t]->_elements[0]) == thread)
+      {
+        ts = _thread_snapshots[t];
+      }
+    }
+    if (!ts)
+    {
+      ts = new ThreadSnapshot (this);
+      ts->_timer.initialize (e);
+      _thread_snapshots.push_back (ts);
+    }
+    ts->_elements.push_back (e);
+  }
+
+  _timer.initialize (this);
+  if (_interval_sec > 0)
+  {
+    _timer.schedule_after_sec (_interval_sec);
+  }
+
+  return 0;
+}
+
+void
+Checkpoint::cleanup(CleanupStage stage)
+{
+  if (_writer_running)
+  {
+    pthread_mutex_lock   (&_lock);
+    _stop = true;
+    pthread_cond_signal  (&_cond);
+    pthread_mutex_unlock (&_lock);
+
+    pthread_join (_writer, NULL);
+    _writer_running = false;
+  }
+
+  for (int i = 0; i < _thread_snapshots.size (); ++i)
+  {
+    _thread_snapshots[i]->_timer.unschedule ();
+  }
+
+  // the other elements are cleaned up after us, so their state is still
+  // there, and the threads have stopped
+  if (_save_on_exit && (stage >= CLEANUP_ROUTER_INITIALIZED))
+  {
+    String payload = take_snapshot ();
+    write_file (payload, _num_records);
+  }
+}
+
+void
+Checkpoint::append_record (StringAccum& sa, StringAccum& state, Element* e)
+{
+  Checkpointable* cp = static_cast<Checkpointable*>(e->cast ("Checkpointable"));
+  StateWriter     writer (state);
+
+  state.clear ();
+  cp->save_state (writer);
+
+  const String    name        = e->name ();
+  const String    class_name  = e->class_name ();
+  const uint32_t  name_len    = name.length ();
+  const uint32_t  class_len   = class_name.length ();
+  const uint32_t  state_len   = state.length ();
+
+  sa.append (reinterpret_cast<const char*>(&name_len),  sizeof (name_len));
+  sa.append (name.data (), name_len);
+  sa.append (reinterpret_cast<const char*>(&class_len), sizeof (class_len));
+  sa.append (class_name.data (), class_len);
+  sa.append (reinterpret_cast<const char*>(&state_len), sizeof (state_len));
+  sa.append (state.data (), state_len);
+}
+
+// all of them from here, only once the threads have stopped
+String
+Checkpoint::take_snapshot ()
+{
+  StringAccum sa;
+  StringAccum state;
+
+  _num_records = 0;
+
+  for (int i = 0; i < _thread_snapshots.size (); ++i)
+  {
+    const Vector<Element*>& elements = _thread_snapshots[i]->_elements;
+    for (int j = 0; j < elements.size (); ++j)
+    {
+      append_record (sa, state, elements[j]);
+      ++_num_records;
+    }
+  }
+
+  ++_snapshots;
+
+  return sa.take_string ();
+}
+
+bool
+Checkpoint::write_file (const String& payload, const uint32_t num_records)
+{
+  CheckpointHeader header;
+  memset (&header, '\0', sizeof (header));
+  memcpy (header._magic, s_magic, sizeof (s_magic));
+  header._version     = s_version;
+  header._num_records = num_records;
+  header._payload_len = payload.length ();
+  header._checksum    = fnv1a (payload.data (), payload.length ());
+  header._created_sec = Timestamp::now ().sec ();
+
+  const String tmp_name = _filename + ".tmp";
+
+  const int fd = open (tmp_name.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    click_chatter ("Checkpoint: cannot open %s: %s", tmp_name.c_str (), strerror (errno));
+    return false;
+  }
+
+  bool ok = (write (fd, &header, sizeof (header)) == (ssize_t) sizeof (header)) &&
+            (write (fd, payload.data (), payload.length ()) == (ssize_t) payload.length ()) &&
+            (fsync (fd) == 0);
+  close (fd);
+
+  if (ok)
+  {
+    ok = (rename (tmp_name.c_str (), _filename.c_str ()) == 0);
+  }
+  if (!ok)
+  {
+    click_chatter ("Checkpoint: writing %s failed: %s", _filename.c_str (), strerror (errno));
+    unlink (tmp_name.c_str ());
+    return false;
+  }
+
+  if (_debug)
+  {
+    click_chatter ("Checkpoint: saved %u elements, %d bytes", num_records, payload.length ());
+  }
+
+  return true;
+}
+
+int
+Checkpoint::restore (ErrorHandler* errh)
+{
+  const int fd = open (_filename.c_str (), O_RDONLY);
+  if (fd < 0)
+  {
+    click_chatter ("Checkpoint: no %s, starting from scratch", _filename.c_str ());
+    return 0;
+  }
+
+  struct stat st;
+  if ((fstat (fd, &st) != 0) || ((size_t) st.st_size < sizeof (CheckpointHeader)))
+  {
+    close (fd);
+    errh->warning ("%s is too short, starting from scratch", _filename.c_str ());
+    return 0;
+  }
+
+  void* data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+  {
+    errh->warning ("cannot map %s: %s", _filename.c_str (), strerror (errno));
+    return 0;
+  }
+
+  const CheckpointHeader* header  = static_cast<const CheckpointHeader*>(data);
+  const char*             payload = static_cast<const char*>(data) + sizeof (CheckpointHeader);
+
+  if ((memcmp (header->_magic, s_magic, sizeof (s_magic)) != 0) ||
+      (header->_version != s_version) ||
+      (header->_payload_len != st.st_size - sizeof (CheckpointHeader)) ||
+      (header->_checksum != fnv1a (payload, header->_payload_len)))
+  {
+    munmap (data, st.st_size);
+    errh->warning ("%s is not a valid checkpoint, starting from scratch", _filename.c_str ());
+    return 0;
+  }
+
+  StateReader records (payload, header->_payload_len);
+
+  for (uint32_t r = 0; r < header->_num_records; ++r)
+  {
+    char            name_buf  [256];
+    char            class_buf [256];
+
+    const uint32_t  name_len  = records.read_u32 ();
+    if (name_len >= sizeof (name_buf) || !records.read_bytes (name_buf, name_len))
+    {
+      break;
+    }
+    const uint32_t  class_len = records.read_u32 ();
+    if (class_len >= sizeof (class_buf) || !records.read_bytes (class_buf, class_len))
+    {
+      break;
+    }
+    const uint32_t  state_len = records.read_u32 ();
+    Vector<char>    state (state_len, '\0');
+    if (!records.read_bytes (state.begin (), state_len))
+    {
+      break;
+    }
+
+    const String    name        (name_buf,  name_len);
+    const String    class_name  (class_buf, class_len);
+    Element*        e           = router ()->find (name);
+
+    if ((e == NULL) || (class_name != e->class_name ()))
+    {
+      click_chatter ("Checkpoint: %s (%s) is not in this configuration, skipping",
+                     name.c_str (), class_name.c_str ());
+      continue;
+    }
+
+    Checkpointable* cp = static_cast<Checkpointable*>(e->cast ("Checkpointable"));
+    StateReader     reader (state.begin (), state_len);
+    if ((cp != NULL) && cp->restore_state (reader))
+    {
+      ++_restored;
+    }
+    else
+    {
+      click_chatter ("Checkpoint: could not restore %s, it starts from scratch", name.c_str ());
+    }
+  }
+
+  click_chatter ("Checkpoint: restored %llu of %u elements from %s (saved at %llu)",
+                 (unsigned long long) _restored, header->_num_records, _filename.c_str (),
+                 (unsigned long long) header->_created_sec);
+
+  munmap (data, st.st_size);
+
+  return 0;
+}
+
+void
+Checkpoint::run_timer (Timer*)
+{
+  // every thread copies its own elements, the last one to finish puts
+  // the snapshot together. A thread that is still busy with the last one
+  // skips this one
+  pthread_mutex_lock   (&_lock);
+  const bool idle = (_outstanding == 0);
+  if (idle)
+  {
+    _outstanding = _thread_snapshots.size ();
+  }
+  pthread_mutex_unlock (&_lock);
+
+  if (idle)
+  {
+    for (int i = 0; i < _thread_snapshots.size (); ++i)
+    {
+      _thread_snapshots[i]->_timer.schedule_now ();
+    }
+  }
+  else if (_debug)
+  {
+    click_chatter ("Checkpoint: the last snapshot is not done yet, skipping this one");
+  }
+
+  if (_interval_sec > 0)
+  {
+    _timer.reschedule_after_sec (_interval_sec);
+  }
+}
+
+void
+Checkpoint::run_thread_snapshot (Timer*, void* arg)
+{
+  ThreadSnapshot* ts = static_cast<ThreadSnapshot*>(arg);
+  ts->_owner->snapshot_thread (*ts);
+}
+
+void
+Checkpoint::snapshot_thread (ThreadSnapshot& ts)
+{
+  // on the elements' own thread, between two of their packets
+  StringAccum state;
+  ts._records.clear ();
+  for (int i = 0; i < ts._elements.size (); ++i)
+  {
+    append_record (ts._records, state, ts._elements[i]);
+  }
+  ts._num_records = ts._elements.size ();
+
+  // the writer only ever needs the latest one. The snapshot is put
+  // together under the lock, so that the threads never share a String
+  pthread_mutex_lock (&_lock);
+  if (--_outstanding == 0)
+  {
+    StringAccum sa;
+    _num_records = 0;
+    for (int i = 0; i < _thread_snapshots.size (); ++i)
+    {
+      const ThreadSnapshot& t = *_thread_snapshots[i];
+      sa.append (t._records.data (), t._records.length ());
+      _num_records += t._num_records;
+    }
+    ++_snapshots;
+
+    _pending          = sa.take_string ();
+    _pending_records  = _num_records;
+    _has_pending      = true;
+    pthread_cond_signal (&_cond);
+  }
+  pthread_mutex_unlock (&_lock);
+}
+
+void*
+Checkpoint::writer_thread (void* arg)
+{
+  static_cast<Checkpoint*>(arg)->run_writer ();
+  return NULL;
+}
+
+void
+Checkpoint::run_writer ()
+{
+  pthread_mutex_lock (&_lock);
+
+  while (true)
+  {
+    while (!_has_pending && !_stop)
+    {
+      pthread_cond_wait (&_cond, &_lock);
+    }
+    if (!_has_pending)
+    {
+      break; // stopping
+    }
+
+    String    payload     = _pending;
+    uint32_t  num_records = _pending_records;
+    _pending      = String ();
+    _has_pending  = false;
+
+    pthread_mutex_unlock (&_lock);
+    write_file (payload, num_records);
+    pthread_mutex_lock (&_lock);
+  }
+
+  pthread_mutex_unlock (&_lock);
+}
+
+int
+Checkpoint::write_handler (const String&, Element* e, void*, ErrorHandler*)
+{
+  Checkpoint* cp = static_cast<Checkpoint*>(e);
+  cp->run_timer (&cp->_timer);
+  return 0;
+}
+
+void
+Checkpoint::add_handlers()
+{
+  add_write_handler("snapshot", write_handler, 0);
+  add_data_handlers("snapshots", Handler::OP_READ, &_snapshots);
+  add_data_handlers("restored",  Handler::OP_READ, &_restored);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(Checkpoint)
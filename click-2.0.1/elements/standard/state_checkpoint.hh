@@ -0,0 +1,124 @@
+#ifndef CLICK_STATE_CHECKPOINT_HH
+#define CLICK_STATE_CHECKPOINT_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+#include <click/straccum.hh>
+#include <click/vector.hh>
+#include <click/checkpoint.hh>
+#include <pthread.h>
+
+CLICK_DECLS
+
+/*
+ * Checkpoint(FILENAME path, [INTERVAL_SEC 10, RESTORE true, SAVE_ON_EXIT true, DEBUG false])
+ *
+ * Saves the state of every Checkpointable element of the router (the
+ * TradeProcessor bars, the indicators' buffers, cache and op mode, ...)
+ * into one file every INTERVAL_SEC seconds, and restores it when the
+ * router starts, so that the indicators carry on in NORMAL mode instead
+ * of going through INIT and STARTUP again.
+ *
+ * Every element is copied on its home thread, by a timer there, between
+ * two of its packets, so its state is consistent, and so is that of the
+ * elements that share a thread. The threads are not stopped for it: the
+ * elements of different threads are copied about the same time, not at
+ * the same packet. The file is written by a thread of its own: to
+ * FILENAME.tmp, fsync'ed and renamed, so there always is a complete file.
+ *
+ * The records are matched by element name and class on restore. An
+ * element whose configuration does not fit its saved state (other
+ * BUF_SIZE, PERIOD, ports) starts from scratch.
+ *
+ * File layout, all of it readable through a plain mmap:
+ *   CheckpointHeader
+ *   per element: uint32 name_len, name, uint32 class_len, class,
+ *                uint32 state_len, state (see Checkpointable)
+ */
+
+struct CheckpointHeader
+{
+  char      _magic[8];
+  uint32_t  _version;
+  uint32_t  _num_records;
+  uint64_t  _payload_len;
+  uint64_t  _checksum;      // FNV-1a of the payload
+  uint64_t  _created_sec;
+}; // struct CheckpointHeader
+
+class Checkpoint : public Element
+{
+  public:
+    Checkpoint();
+    ~Checkpoint();
+
+    const char *class_name() const		{ return "Checkpoint"; }
+    const char *port_count() const		{ return PORTS_0_0; }
+
+    // after everything else, so that all the elements are ready to be restored
+    int configure_phase() const		{ return CONFIGURE_PHASE_LAST; }
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void run_timer(Timer *);
+
+  private:
+    // the Checkpointable elements of one router thread, copied by a
+    // timer on that thread
+    struct ThreadSnapshot
+    {
+      ThreadSnapshot (Checkpoint* owner)
+        : _owner (owner), _timer (run_thread_snapshot, this), _num_records (0) {}
+
+      Checkpoint*       _owner;
+      Timer             _timer;
+      Vector<Element*>  _elements;
+      StringAccum       _records;
+      uint32_t          _num_records;
+    }; // struct ThreadSnapshot
+
+    static void   append_record       (StringAccum& sa, StringAccum& state, Element* e);
+    static void   run_thread_snapshot (Timer*, void* arg);
+    void          snapshot_thread     (ThreadSnapshot& ts);
+
+    String  take_snapshot   ();
+    bool    write_file      (const String& payload, const uint32_t num_records);
+    int     restore         (ErrorHandler* errh);
+
+    static void*  writer_thread (void* arg);
+    void          run_writer    ();
+
+    static int    write_handler (const String&, Element*, void*, ErrorHandler*);
+
+  private:
+    String            _filename;
+    uint32_t          _interval_sec;
+    bool              _restore;
+    bool              _save_on_exit;
+    bool              _debug;
+
+    Timer             _timer;
+    Vector<ThreadSnapshot*> _thread_snapshots;
+    uint32_t          _outstanding;     // the threads still copying, under the lock
+
+    // the latest snapshot the writer has not taken yet
+    pthread_t         _writer;
+    pthread_mutex_t   _lock;
+    pthread_cond_t    _cond;
+    bool              _writer_running;
+    bool              _stop;
+    bool              _has_pending;
+    String            _pending;
+    uint32_t          _pending_records;
+    uint32_t          _num_records;
+
+    uint64_t          _snapshots;
+    uint64_t          _restored;
+
+}; // class Checkpoint
+
+CLICK_ENDDECLS
+#endif
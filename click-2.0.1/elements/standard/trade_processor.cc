@@ -21,6 +21,7 @@
 #include <click/args.hh>
 #include <click/error.hh>
 #include <click/straccum.hh>
+#include <click/hashmap.hh>
 #ifdef CLICK_LINUXMODULE
 # include <click/cxxprotect.h>
 CLICK_CXX_PROTECT
@@ -37,7 +38,16 @@ CLICK_DECLS
 static const size_t s_whole_price_len       = 10;
 static const size_t s_fractional_price_len  = 10;
 
-static const size_t s_mac_ip_udp_len        = 42;
+static const size_t s_mac_ip_udp_len        = 42; // the default HEADER_LEN
+// the gaps of the closed bars that are remembered, so that their msgs
+// are told apart from the duplicates if they come after all
+static const int    s_max_closed_gaps       = 1024;
+// a wider gap is not looked up in the journal msg by msg on the router
+// thread, it is given up on as soon as it opens
+static const uint64_t s_max_replay_gap      = 10000;
+// a msg this far behind that fills no gap is not a duplicate: the sender
+// has started its numbering over
+static const uint64_t s_reset_window        = 1 << 16;
 
 static bool         s_debug                 = false;
 
@@ -45,8 +55,11 @@ using Synapse::MsgTrade;
 using Synapse::SynapseElement;
 using Synapse::MsgSource;
 
-static bool update_stats (TimeStats&      time_stats,
-                          const MsgTrade& msg_trade);
+static uint8_t update_stats (TimeStats&      time_stats,
+                             const MsgTrade& msg_trade);
+
+static uint8_t merge_trade  (TimeStats&      time_stats,
+                             const MsgTrade& msg_trade);
 
 static int denominator_for_len (size_t len)
 {
@@ -141,10 +154,27 @@ static fixedpt parse_price_as_fixedpt (
 
 TradeProcessor::TradeProcessor()
   : _timer                    (this)
+  , _timer_started            (false)
   , _aggregation_interval_sec (10)
+  , _subscriptions            (new Subscriptions ())
+  , _header_len               (s_mac_ip_udp_len)
   , _debug                    (false)
   , _active                   (true)
+  , _emit_trades              (false)
   , _total_msgs               (0)
+  , _sequenced                (false)
+  , _expected                 (0)
+  , _bar_first_seq            (0)
+  , _gaps                     (0)
+  , _missing_msgs             (0)
+  , _late_msgs                (0)
+  , _recovered_msgs           (0)
+  , _unrecovered_msgs         (0)
+  , _stale_msgs               (0)
+  , _duplicates               (0)
+  , _seq_resets               (0)
+  , _recovery_timer           (this)
+  , _recovery_delay_ms        (100)
 {
 
   _w_packet = NULL;
@@ -165,6 +195,13 @@ TradeProcessor::configure(Vector<String> &conf, ErrorHandler* errh)
   if (Args(conf)
         .read("AGGREGATION_INTERVAL_SEC", _aggregation_interval_sec)
         .read("SYMBOLS_ROUTING",          symbols_ports)
+        .read("HEADER_LEN",               _header_len)
+        .read("SEQUENCED",                _sequenced)
+        .read("TRADES",                   _emit_trades)
+#if CLICK_USERLEVEL
+        .read("JOURNAL",                  FilenameArg(), _journal_name)
+#endif
+        .read("RECOVERY_DELAY_MSEC",      _recovery_delay_ms)
         .read("DEBUG",                    _debug)
         .complete() >= 0)
   {
@@ -177,6 +214,8 @@ TradeProcessor::configure(Vector<String> &conf, ErrorHandler* errh)
   Vector<String>  symbols_ports_vector;
   cp_spacevec (symbols_ports, symbols_ports_vector);
 
+  Subscriptions* subscriptions = new Subscriptions ();
+
   for (int i = 0; i < symbols_ports_vector.size (); i += 2)
   {
     String& symbol = symbols_ports_vector[i];
@@ -187,13 +226,15 @@ TradeProcessor::configure(Vector<String> &conf, ErrorHandler* errh)
 
     int port_int = strtol (port.c_str(), NULL, 10);
 
-    bool inserted = _subscriptions_map.insert (array_wrapper, port_int);
+    Route route    = { port_int, 0 };
+    bool  inserted = subscriptions->_ports.insert (array_wrapper, route);
 
     if (!inserted)
     {
       click_chatter ("MsgFilterSymbol - could not insert symbol %s into the map",
                         symbol.c_str());
 
+      delete subscriptions;
       return -1;
     }
     else
@@ -202,14 +243,85 @@ TradeProcessor::configure(Vector<String> &conf, ErrorHandler* errh)
     }
   }
 
+  subscriptions->rebuild_bloom ();
+
+  _subscriptions.write_lock ();
+  _subscriptions.publish (subscriptions);
+  _subscriptions.write_unlock ();
+
   return 0;
 }
 
+int
+TradeProcessor::find_port (
+  const SymbolArrayWrapper& symbol,
+  uint32_t*                 since)
+{
+  int                     epoch;
+  const Subscriptions*    subscriptions = _subscriptions.read_lock (epoch);
+  const Route*            route         = subscriptions->_ports.findp (symbol);
+  const int               port          = route ? route->_port : -1;
+  if (route && since)
+  {
+    *since = route->_since;
+  }
+  _subscriptions.read_unlock (epoch);
+
+  return port;
+}
+
+int
+TradeProcessor::find_port (
+  const char*   symbol,
+  const size_t  symbol_len,
+  uint32_t*     since)
+{
+  if (symbol_len > Synapse::ORDER_SYMBOL_LEN - 1)
+  {
+    return -1;
+  }
+
+  int                     epoch;
+  const Subscriptions*    subscriptions = _subscriptions.read_lock (epoch);
+  int                     port          = -1;
+  if (subscriptions->_bloom.may_contain (symbol, symbol_len))
+  {
+    char key [Synapse::ORDER_SYMBOL_LEN];
+    memset (key, '\0', sizeof (key));
+    memcpy (key, symbol, symbol_len);
+
+    const Route* route = subscriptions->_ports.findp (key);
+    port               = route ? route->_port : -1;
+    if (route && since)
+    {
+      *since = route->_since;
+    }
+  }
+  _subscriptions.read_unlock (epoch);
+
+  return port;
+}
+
 int
 TradeProcessor::initialize (
-  ErrorHandler*)
+  ErrorHandler* errh)
 {
   _timer.initialize(this);
+  _recovery_timer.initialize(this);
+
+#if CLICK_USERLEVEL
+  if (_journal_name)
+  {
+    if (!_sequenced)
+    {
+      return errh->error ("JOURNAL needs SEQUENCED");
+    }
+    if (const int err = _journal.open (_journal_name))
+    {
+      return errh->error ("%s: %s", _journal_name.c_str (), strerror (err));
+    }
+  }
+#endif
   // we scheduler timer after we receive the first update, in this way
   // we can compare the results
   /* 
@@ -256,11 +368,15 @@ static void print_as_hex_inline (const char* str, const size_t str_len)
   click_chatter ("2:%s", buffer);
 }
 
-static bool populate_msg_trade (MsgTrade& msg, Packet& p)
-{
-  // how do we filter out the wrong messages?
-  // -> probably by simply parsing the msg bit by by bit
+static const unsigned s_tstamp_len = 8;
 
+// the text of the market data msg, after the headers and the timestamp
+static bool msg_text (
+  Packet&         p,
+  const uint32_t  header_len,
+  const char*&    md_msg,
+  uint32_t&       md_len)
+{
   const uint32_t  packet_len          = p.length();
 
   if (s_debug)
@@ -270,7 +386,7 @@ static bool populate_msg_trade (MsgTrade& msg, Packet& p)
 
   // needs to make sure that we can at least reach
   // the market data msg type field
-  if (packet_len < s_mac_ip_udp_len + 1)
+  if (packet_len < header_len + s_tstamp_len + 1)
   {
     if (s_debug)
     {
@@ -279,78 +395,58 @@ static bool populate_msg_trade (MsgTrade& msg, Packet& p)
     return false;
   }
 
+  md_msg = reinterpret_cast<const char*>(p.data() + header_len + s_tstamp_len);
+  md_len = packet_len - header_len - s_tstamp_len;
+  return true;
+}
 
-  const unsigned  tstamp_len      = 8;
-  const char*     md_msg          = reinterpret_cast<const char*>(p.data() + 
-                                                                  s_mac_ip_udp_len + tstamp_len);
-  const uint32_t  md_len          = packet_len - s_mac_ip_udp_len - tstamp_len;
+// the symbol has been found and is subscribed, parses the rest
+static bool populate_msg_trade (
+  MsgTrade&       msg,
+  const char*     md_msg,
+  const uint32_t  md_len,
+  const char*     symbol,
+  const size_t    symbol_len)
+{
+  if (symbol_len > Synapse::ORDER_SYMBOL_LEN - 1)
+  {
+    click_chatter ("ERROR: Symbol is too long!");
+    return false;
+  }
+  strncpy (msg._symbol, symbol, symbol_len);
 
-  int                   component_start = 0;
-  int                   counter         = 0;
+  // it's a price, the size is immediately after
+  const char* end       = md_msg + md_len;
+  const char* price_ptr = symbol + symbol_len + 1;
+  const char* bar       = static_cast<const char*>(memchr (price_ptr, '|', end - price_ptr));
+  if (!bar || (bar + 1 >= end))
+  {
+    click_chatter ("No size detected in the trade msg!!!");
+    return false;
+  }
+  msg._price = parse_price_as_fixedpt (price_ptr, bar - price_ptr);
 
-  for (int i = 0; i < md_len; ++i)
+  // now parse the size, a sequenced feed has its sequence number after it
+  const char*   size_ptr = bar + 1;
+  size_t        size_len = end - size_ptr;
+  bar                    = static_cast<const char*>(memchr (size_ptr, '|', size_len));
+  if (bar)
   {
-    if (md_msg[i] == '|')
+    size_len = bar - size_ptr;
+    if (memchr (bar + 1, '|', end - bar - 1))
     {
-      ++counter;
-
-      switch (counter)
-      {
-        case 0: // should never happen
-        case 1: // do nothing 
-        case 2: // it's the timestamp delta from previous message - ignore
-          break;
-        case 3: // it's a symbol
-          {
-            size_t symbol_len = i - component_start;
-
-            if (symbol_len > Synapse::ORDER_SYMBOL_LEN - 1)
-            {
-              click_chatter ("ERROR: Symbol is too long!");
-              return false;
-            }
-            strncpy (msg._symbol, md_msg + component_start, symbol_len);
-          }
-          break;
-        case 4: // it's a price, the size is immediately after
-          {
-            size_t price_len = i - component_start;
-            msg._price = parse_price_as_fixedpt (md_msg + component_start, price_len);
-            if ((i + 1) >= md_len)
-            {
-              click_chatter ("No size detected in the trade msg!!!");
-              return false;
-            }
-            // now parse the size
-            const char*   size_ptr = md_msg + i + 1;
-            size_t        size_len = md_len - i - 1;
-
-            char buffer [size_len + 1];
-            memcpy (buffer, size_ptr, size_len);
-            buffer [size_len] = '\0';
-
-            msg._size = strtol (buffer, NULL, 10);
-          }
-          break;
-        default:
-          // too many vertical bars - return false
-          click_chatter ("TP: Too many vertical bars, could not parse a message!!!");
-          return false;
-          break;
-      }
-
-      component_start = i + 1; // the next char after the vertical bar
+      // too many vertical bars - return false
+      click_chatter ("TP: Too many vertical bars, could not parse a message!!!");
+      return false;
     }
   }
 
-  if (counter < 1)
-  {
-    return false; // incorrect message basically - no delimiters
-  }
+  char buffer [size_len + 1];
+  memcpy (buffer, size_ptr, size_len);
+  buffer [size_len] = '\0';
+
+  msg._size = strtol (buffer, NULL, 10);
 
-  // this timestamp is produced by timestamper - if we get here, the msg is the correct one
-  msg._src_timestamp              = *(reinterpret_cast<const uint64_t*>(p.data () + s_mac_ip_udp_len));
-  //click_chatter ("KB: timestamp is %lld", msg._src_timestamp);
   if (s_debug)
   {
     click_chatter ("TP: populated MsgTrade");
@@ -376,45 +472,139 @@ TradeProcessor::push(
 
   ++_total_msgs;
 
-  // 1. parse the trade message into the MsgTrade structure
-  //    and look up the symbol in the hash table
-  // 2. then look at the subscriptions for this particular symbol
+  if (p->get_packet_app_type () == Synapse::MSG_TRADE)
+  {
+    push_msg_trade (p);
+    return;
+  }
+
+  // 1. find the symbol and look it up in the subscriptions, most
+  //    of the feed is dropped here without parsing the numbers
+  // 2. parse the rest of the trade message into the MsgTrade structure
   //    and send out the updates for the subscribed components
   //    no updates - no msg
   // 3. don't forget to update the hash table in all of this!
-  MsgTrade msg_trade;
-  if (!populate_msg_trade (msg_trade, *p))
+  const char* md_msg;
+  uint32_t    md_len;
+  const char* symbol;
+  size_t      symbol_len;
+  if (!msg_text (*p, _header_len, md_msg, md_len) ||
+        !locate_trade_symbol (md_msg, md_len, symbol, symbol_len))
   {
     // destroy the msg and return. Do not pass it forward.
     SynapseElement::discard_packet  (*p);
     return;
   }
 
+  // every msg moves the sequence on, subscribed or not
+  uint64_t  seq   = 0;
+  bool      late  = false;
+  if (_sequenced && (!locate_feed_seq (md_msg, md_len, seq) || !check_seq (seq, late)))
+  {
+    SynapseElement::discard_packet  (*p);
+    return;
+  }
+
+  uint32_t  since    = 0;
+  const int out_port = find_port (symbol, symbol_len, &since);
+
+  if (out_port < 0)
+  {
+    SynapseElement::discard_packet  (*p);
+    return;
+  }
+
+  MsgTrade msg_trade;
+  if (!populate_msg_trade (msg_trade, md_msg, md_len, symbol, symbol_len))
+  {
+    SynapseElement::discard_packet  (*p);
+    return;
+  }
+  // this timestamp is produced by timestamper - if we get here, the msg is the correct one
+  msg_trade._src_timestamp  = *(reinterpret_cast<const uint64_t*>(p->data () + _header_len));
+  msg_trade._seq            = seq;
+
+  aggregate_trade (msg_trade, out_port, since, late, p);
+}
+
+// a trade that has been decoded already, by a FixTradeHandler or a
+// ChixTradeHandler
+void
+TradeProcessor::push_msg_trade(
+  Packet* p)
+{
+  if (p->length () < sizeof (MsgTrade))
+  {
+    SynapseElement::discard_packet  (*p);
+    return;
+  }
+
+  MsgTrade msg_trade;
+  memcpy (&msg_trade, p->data (), sizeof (msg_trade));
+
+  // the feeds that number their trades the way the text one does
+  bool late = false;
+  if (_sequenced && msg_trade._seq && !check_seq (msg_trade._seq, late))
+  {
+    SynapseElement::discard_packet  (*p);
+    return;
+  }
+
+  uint32_t  since    = 0;
+  const int out_port = find_port (msg_trade._symbol, strnlen (msg_trade._symbol, Synapse::ORDER_SYMBOL_LEN),
+                                  &since);
+  if (out_port < 0)
+  {
+    SynapseElement::discard_packet  (*p);
+    return;
+  }
+
+  aggregate_trade (msg_trade, out_port, since, late, p);
+}
+
+void
+TradeProcessor::aggregate_trade(
+  const MsgTrade& msg_trade,
+  const int       out_port,
+  const uint32_t  since,
+  const bool      late,
+  Packet*         p)
+{
+  const uint64_t seq = msg_trade._seq;
+
+  if (_emit_trades)
+  {
+    send_trade_msg (msg_trade, out_port, *p);
+    return;
+  }
+
   if (_debug)
   {
     click_chatter ("TP: checking msg trade symbol %s", msg_trade._symbol);
   }
 
-  const int* out_port = _subscriptions_map.findp (msg_trade._symbol);
-
-  if (out_port == NULL)
+  if (late && (seq < _bar_first_seq))
   {
+    // its bar has gone out already
+    ++_stale_msgs;
+    if (TimeStats* time_stats = _time_stats_map.findp (msg_trade._symbol))
+    {
+      ++time_stats->_gaps;
+    }
     SynapseElement::discard_packet  (*p);
     return;
   }
 
-  static bool first_symbol = true;
-  // start the timestamp now (do it only once)
-  if (first_symbol)
+  // start the timer now (do it only once), every TradeProcessor with its
+  // own first trade
+  if (!_timer_started)
   {
     _timer.schedule_after_sec(_aggregation_interval_sec);
-    first_symbol = false;
+    _timer_started = true;
   }
 
   bool time_stats_added = false;
-  TimeStats* time_stats = SynapseElement::get_or_create<TimeStatsMap> (_time_stats_map,
-                                                                       time_stats_added,
-                                                                       msg_trade._symbol);
+  TimeStats* time_stats = bar_on_port (msg_trade._symbol, out_port, since, time_stats_added);
 
   if (!time_stats)
   {
@@ -422,8 +612,19 @@ TradeProcessor::push(
     return;
   }
   
-  // no update - no msg
-  if (!update_stats (*time_stats, msg_trade))
+  uint8_t dirty;
+  if (late)
+  {
+    ++time_stats->_gaps;
+    dirty = merge_trade (*time_stats, msg_trade);
+  }
+  else
+  {
+    dirty = update_stats (*time_stats, msg_trade);
+  }
+
+  // no price update - no msg, the volume goes with the next one
+  if (!(dirty & ~Synapse::SOURCE_VOLUME))
   {
     SynapseElement::discard_packet  (*p);
     return;
@@ -431,12 +632,13 @@ TradeProcessor::push(
 
   if (_debug)
   {
-    click_chatter ("TP: about to send symbol %s on port %d", msg_trade._symbol, *out_port);
+    click_chatter ("TP: about to send symbol %s on port %d", msg_trade._symbol, out_port);
   }
-  send_update_msg (*time_stats, msg_trade._src_timestamp, *out_port, *p, time_stats_added);
+  send_update_msg (*time_stats, msg_trade._src_timestamp, out_port, *p, time_stats_added, dirty);
 }
 
-static bool update_stats (
+// returns the mask of the fields that have changed, 0 - nothing changed
+static uint8_t update_stats (
   TimeStats&      time_stats,
   const MsgTrade& msg_trade)
 {
@@ -444,7 +646,9 @@ static bool update_stats (
   //    set the close, high, low to new trade's price
   // 2. if not first update, update as usual
 
-  bool rc = false; 
+  uint8_t rc = 0; 
+
+  time_stats._last_seq = msg_trade._seq;
 
   if (!(time_stats._first_time_updated))
   {
@@ -454,29 +658,33 @@ static bool update_stats (
     time_stats._size += msg_trade._size;
 
     time_stats._first_time_updated  = true;
-    rc                              = true;
 
-    return true;
+    // the open has changed on rollover, so everything is new
+    return Synapse::SOURCE_ALL;
   }
 
   if (msg_trade._price > time_stats._high)
   {
     time_stats._high = msg_trade._price;
-    rc               = true;
+    rc              |= Synapse::SOURCE_HIGH;
   }
 
   if (msg_trade._price < time_stats._low)
   {
     time_stats._low  = msg_trade._price;
-    rc               = true;
+    rc              |= Synapse::SOURCE_LOW;
   }
 
   time_stats._size += msg_trade._size;
+  if (msg_trade._size != 0)
+  {
+    rc              |= Synapse::SOURCE_VOLUME;
+  }
 
   if (msg_trade._price != time_stats._close)
   {
     time_stats._close = msg_trade._price;
-    rc                = true;
+    rc               |= Synapse::SOURCE_CLOSE;
   }
 
   if (s_debug)
@@ -499,35 +707,382 @@ static bool update_stats (
   return rc;
 }
 
+// a msg of the open bar that comes after the ones behind it: it may set a
+// new high or low, and the close only if it is the latest msg of the
+// symbol. Returns the mask of the fields that have changed
+static uint8_t merge_trade (
+  TimeStats&      time_stats,
+  const MsgTrade& msg_trade)
+{
+  if (!(time_stats._first_time_updated))
+  {
+    return update_stats (time_stats, msg_trade);
+  }
+
+  uint8_t rc = 0;
+
+  if (msg_trade._price > time_stats._high)
+  {
+    time_stats._high = msg_trade._price;
+    rc              |= Synapse::SOURCE_HIGH;
+  }
+
+  if (msg_trade._price < time_stats._low)
+  {
+    time_stats._low  = msg_trade._price;
+    rc              |= Synapse::SOURCE_LOW;
+  }
+
+  time_stats._size += msg_trade._size;
+  if (msg_trade._size != 0)
+  {
+    rc              |= Synapse::SOURCE_VOLUME;
+  }
+
+  if (msg_trade._seq > time_stats._last_seq)
+  {
+    time_stats._last_seq = msg_trade._seq;
+    if (msg_trade._price != time_stats._close)
+    {
+      time_stats._close = msg_trade._price;
+      rc               |= Synapse::SOURCE_CLOSE;
+    }
+  }
+
+  return rc;
+}
+
+bool
+TradeProcessor::check_seq (
+  const uint64_t  seq,
+  bool&           late)
+{
+  late = false;
+
+  if ((seq == _expected) || (_expected == 0))
+  {
+    if (_expected == 0)
+    {
+      _bar_first_seq = seq;
+    }
+    _expected = seq + 1;
+    return true;
+  }
+
+  if (seq > _expected)
+  {
+    SeqRange gap = { _expected, seq - 1 };
+
+    ++_gaps;
+    _missing_msgs += seq - _expected;
+    if (_debug)
+    {
+      click_chatter ("TP: gap of msgs %llu to %llu", (unsigned long long) _expected,
+                        (unsigned long long) (seq - 1));
+    }
+    _expected = seq + 1;
+
+    if (gap._last - gap._first >= s_max_replay_gap)
+    {
+      // unrecovered already, only remembered so that its msgs still count
+      // as late if they come after all
+      _unrecovered_msgs += gap._last - gap._first + 1;
+      _closed_gaps.push_back (gap);
+      trim_closed_gaps ();
+      return true;
+    }
+    _pending.push_back (gap);
+
+#if CLICK_USERLEVEL
+    if (_journal.is_open () && !_recovery_timer.scheduled ())
+    {
+      _recovery_timer.schedule_after_msec (_recovery_delay_ms);
+    }
+#endif
+    return true;
+  }
+
+  // behind: one of the gaps, or a msg that has been seen
+  if (take_seq (_pending, seq))
+  {
+    ++_late_msgs;
+    late = true;
+    return true;
+  }
+  // a gap of a bar that has gone out, aggregate_trade counts it as stale,
+  // or one too wide to replay
+  if (take_seq (_closed_gaps, seq))
+  {
+    if (seq >= _bar_first_seq)
+    {
+      ++_late_msgs;
+    }
+    late = true;
+    return true;
+  }
+  if (_expected - seq > s_reset_window)
+  {
+    if (_debug)
+    {
+      click_chatter ("TP: msg %llu while expecting %llu, the feed has started over",
+                        (unsigned long long) seq, (unsigned long long) _expected);
+    }
+    reset_seq ();
+    _bar_first_seq = seq;
+    _expected      = seq + 1;
+    return true;
+  }
+  ++_duplicates;
+  return false;
+}
+
+void
+TradeProcessor::reset_seq ()
+{
+  // the old numbering's gaps will not be filled now
+  for (int i = 0; i < _pending.size (); ++i)
+  {
+    _unrecovered_msgs += _pending[i]._last - _pending[i]._first + 1;
+  }
+  _pending.clear ();
+  _closed_gaps.clear ();
+  _expected = 0;
+  ++_seq_resets;
+
+#if CLICK_USERLEVEL
+  _journal.restart ();
+#endif
+}
+
+void
+TradeProcessor::trim_closed_gaps ()
+{
+  if (_closed_gaps.size () > s_max_closed_gaps)
+  {
+    _closed_gaps.erase (_closed_gaps.begin (),
+                        _closed_gaps.end () - s_max_closed_gaps);
+  }
+}
+
+bool
+TradeProcessor::take_seq (
+  Vector<SeqRange>& ranges,
+  const uint64_t    seq)
+{
+  for (int i = 0; i < ranges.size (); ++i)
+  {
+    SeqRange& range = ranges[i];
+    if ((seq < range._first) || (seq > range._last))
+    {
+      continue;
+    }
+
+    if (range._first == range._last)
+    {
+      ranges.erase (ranges.begin () + i);
+    }
+    else if (seq == range._first)
+    {
+      ++range._first;
+    }
+    else if (seq == range._last)
+    {
+      --range._last;
+    }
+    else
+    {
+      SeqRange upper = { seq + 1, range._last };
+      range._last = seq - 1;
+      ranges.insert (ranges.begin () + i + 1, upper);
+    }
+    return true;
+  }
+  return false;
+}
+
+TimeStats*
+TradeProcessor::bar_on_port (
+  const char      (&symbol)[Synapse::ORDER_SYMBOL_LEN],
+  const int       out_port,
+  const uint32_t  since,
+  bool&           added)
+{
+  TimeStats* time_stats = SynapseElement::get_or_create<TimeStatsMap> (_time_stats_map,
+                                                                       added,
+                                                                       symbol);
+  if (time_stats && ((time_stats->_port != out_port) || (time_stats->_since != since)))
+  {
+    // moved by the add_symbol handler, or removed and added back: what
+    // the old subscription was sent means nothing to the new one
+    if (!added && _debug)
+    {
+      click_chatter ("TP: symbol %s moved from port %d to %d, new bar", symbol,
+                        time_stats->_port, out_port);
+    }
+    *time_stats         = TimeStats ();
+    time_stats->_port   = out_port;
+    time_stats->_since  = since;
+    added               = true;
+  }
+  return time_stats;
+}
+
+// what the recovery has done to the bar of a symbol
+struct RecoveredBar
+{
+  RecoveredBar () : _dirty (0), _added (false) {}
+
+  uint8_t _dirty;
+  bool    _added;
+};
+
+void
+TradeProcessor::recover ()
+{
+#if CLICK_USERLEVEL
+  if (!_journal.is_open () || _pending.empty ())
+  {
+    return;
+  }
+  if (_journal.refresh () < 0)
+  {
+    click_chatter ("TP: %s: the msg at offset %llu is bigger than %u bytes, nothing past it is indexed",
+                      _journal_name.c_str (), (unsigned long long) _journal.offset (),
+                      (unsigned) FeedJournal::MAX_CHUNK);
+  }
+
+  // the symbols whose bars have changed
+  HashMap<SymbolArrayWrapper, RecoveredBar> affected;
+
+  Vector<SeqRange> still_pending;
+  for (int i = 0; i < _pending.size (); ++i)
+  {
+    const SeqRange range = _pending[i];
+    for (uint64_t seq = range._first; seq <= range._last; ++seq)
+    {
+      String text;
+      if (!_journal.find (seq, text))
+      {
+        // not in the journal yet
+        if (!still_pending.empty () && (still_pending.back ()._last == seq - 1))
+        {
+          still_pending.back ()._last = seq;
+        }
+        else
+        {
+          SeqRange missing = { seq, seq };
+          still_pending.push_back (missing);
+        }
+        continue;
+      }
+      ++_recovered_msgs;
+
+      const char* symbol;
+      size_t      symbol_len;
+      MsgTrade    msg_trade;
+      if (!locate_trade_symbol (text.data (), text.length (), symbol, symbol_len))
+      {
+        continue;
+      }
+      uint32_t  since    = 0;
+      const int out_port = find_port (symbol, symbol_len, &since);
+      if ((out_port < 0) ||
+            !populate_msg_trade (msg_trade, text.data (), text.length (), symbol, symbol_len))
+      {
+        continue;
+      }
+      msg_trade._seq = seq;
+
+      bool        added       = false;
+      TimeStats*  time_stats  = bar_on_port (msg_trade._symbol, out_port, since, added);
+      if (!time_stats)
+      {
+        continue;
+      }
+      ++time_stats->_gaps;
+
+      RecoveredBar& a = affected.find_force (msg_trade._symbol);
+      a._dirty   |= merge_trade (*time_stats, msg_trade);
+      a._added   |= added;
+    }
+  }
+  _pending.swap (still_pending);
+
+  // one update per symbol, with its bar as it is now
+  for (HashMap<SymbolArrayWrapper, RecoveredBar>::iterator i = affected.begin (); i.live (); ++i)
+  {
+    const int out_port = find_port (i.key ());
+    if ((out_port < 0) || !(i.value ()._added || (i.value ()._dirty & ~Synapse::SOURCE_VOLUME)))
+    {
+      continue;
+    }
+    Packet* p = Packet::make (Packet::default_headroom, 0, sizeof (MsgSource), 0);
+    if (!p)
+    {
+      break;
+    }
+    send_update_msg (*_time_stats_map.findp (i.key ()), Synapse::gcc_rdtsc (), out_port, *p,
+                     i.value ()._added, i.value ()._dirty);
+  }
+
+  if (_debug)
+  {
+    click_chatter ("TP: recovered from the journal, %d symbols changed, %d gaps still pending",
+                      affected.size (), _pending.size ());
+  }
+
+  if (!_pending.empty ())
+  {
+    // a chunk of the journal a time, the packets go in between
+    if (_journal.behind ())
+    {
+      _recovery_timer.schedule_now ();
+    }
+    else
+    {
+      _recovery_timer.schedule_after_msec (_recovery_delay_ms);
+    }
+  }
+#endif
+}
+
 void TradeProcessor::send_update_msg (
   const TimeStats&  stats,
   const uint64_t    timestamp,
   int               out_port,
   Packet&           packet,
-  const bool        is_init)
+  const bool        is_init,
+  const uint8_t     dirty)
 {
   WritablePacket* p = packet.put (0);
 
   MsgSource msg_source;
 
-  // make sure there is enough room for stats msg
+  // make sure there is enough room for stats msg, a bare UDP payload
+  // (HEADER_LEN 0) can be shorter than it
   const size_t msg_size = sizeof (msg_source);
   const size_t data_len = p->length ();
 
   if (msg_size > data_len)
   {
-    click_chatter ("Trade processor - packet too small - cannot send!");
-    SynapseElement::discard_packet (*p);
-    return;
+    p = p->put (msg_size - data_len);
+    if (!p)
+    {
+      click_chatter ("Trade processor - packet too small - cannot send!");
+      return;
+    }
   }
 
   msg_source._high      = stats._high;
   msg_source._low       = stats._low;
   msg_source._open      = stats._open;
   msg_source._close     = stats._close;
+  msg_source._volume    = stats._size;
 
   msg_source._timestamp = timestamp;
 
+  msg_source._dirty     = is_init ? Synapse::SOURCE_ALL : dirty;
+
   // copy the msg to the packet
   memcpy (p->data(), reinterpret_cast<char*>(&msg_source), msg_size);
   // set new packet type
@@ -537,6 +1092,31 @@ void TradeProcessor::send_update_msg (
   return;
 }
 
+void TradeProcessor::send_trade_msg (
+  const MsgTrade&   msg_trade,
+  const int         out_port,
+  Packet&           packet)
+{
+  WritablePacket* p = packet.put (0);
+  if (p && (p->length () < sizeof (MsgTrade)))
+  {
+    p = p->put (sizeof (MsgTrade) - p->length ());
+  }
+  if (!p)
+  {
+    click_chatter ("Trade processor - packet too small - cannot send!");
+    return;
+  }
+
+  MsgTrade msg = msg_trade;
+  msg._timestamp = msg._src_timestamp;
+
+  memcpy (p->data (), reinterpret_cast<char*>(&msg), sizeof (msg));
+  p->set_packet_app_type (Synapse::MSG_TRADE);
+
+  checked_output_push (out_port, p);
+}
+
 void TradeProcessor::send_add_msg (
   const TimeStats&          stats,
   const int                 out_port)
@@ -584,39 +1164,368 @@ void TradeProcessor::send_add_msg (
   return;
 }
 
+bool
+TradeProcessor::warm_up_symbol (
+  const String&             symbol,
+  const Vector<MsgSource>&  bars,
+  WarmUpEmitter&            emitter)
+{
+  if (bars.empty () || (symbol.length () > Synapse::ORDER_SYMBOL_LEN - 1))
+  {
+    return false;
+  }
+
+  char key [Synapse::ORDER_SYMBOL_LEN];
+  memset (key, '\0', sizeof (key));
+  memcpy (key, symbol.data (), symbol.length ());
+
+  uint32_t  since    = 0;
+  const int out_port = find_port (key, &since);
+  if (out_port < 0)
+  {
+    return false;
+  }
+
+  TimeStats* time_stats = SynapseElement::get_or_create<TimeStatsMap> (_time_stats_map,
+                                                                       key);
+  if (!time_stats)
+  {
+    return false;
+  }
+  time_stats->_port  = out_port;
+  time_stats->_since = since;
+
+  // the live timestamps are cpu cycles, so a plain sequence keeps the
+  // warm-up behind them, an INIT and the first ADD must not share one
+  uint64_t  timestamp = 1;
+  WarmUpMsg msg;
+
+  msg._source         = bars[0];
+  msg._source._dirty  = Synapse::SOURCE_ALL;
+  msg._type           = Synapse::MSG_INIT_SOURCE;
+  msg._timestamp      = msg._source._timestamp = timestamp++;
+  emitter.emit (this, out_port, msg);
+
+  msg._type = Synapse::MSG_ADD_SOURCE;
+  for (int i = 0; i < bars.size (); ++i)
+  {
+    msg._source         = bars[i];
+    msg._source._dirty  = Synapse::SOURCE_ALL;
+    msg._timestamp      = msg._source._timestamp = timestamp++;
+    emitter.emit (this, out_port, msg);
+  }
+
+  const MsgSource& last = bars.back ();
+  time_stats->_high   = last._high;
+  time_stats->_low    = last._low;
+  time_stats->_open   = last._open;
+  time_stats->_close  = last._close;
+  time_stats->_size   = last._volume;
+  time_stats->rollover ();
+
+  return true;
+}
+
 void
 TradeProcessor::run_timer (
   Timer*  timer)
 {
+  if (timer == &_recovery_timer)
+  {
+    recover ();
+    return;
+  }
+
+  // the last chance for the gaps of the bars that are closing
+  recover ();
+  for (int i = 0; i < _pending.size (); ++i)
+  {
+    _unrecovered_msgs += _pending[i]._last - _pending[i]._first + 1;
+    _closed_gaps.push_back (_pending[i]);
+  }
+  _pending.clear ();
+  _bar_first_seq = _expected;
+  trim_closed_gaps ();
+
+  Vector<SymbolArrayWrapper> removed;
+
   // flush files periodically
   for (TimeStatsMap::iterator i = _time_stats_map.begin(); i.live(); ++i)
   {
     // get the port
-    int* out_port = _subscriptions_map.findp (i.key ());
-    if (!out_port)
+    uint32_t  since    = 0;
+    const int out_port = find_port (i.key (), &since);
+    if ((out_port < 0) || (out_port != i.value ()._port) || (since != i.value ()._since))
     {
-      click_chatter ("TP: could not find subscription for symbol %s",
-                      i.key ().array_ptr ());
+      // removed, moved or added back by the symbols handlers, a new
+      // subscription starts with an INIT again
+      removed.push_back (i.key ());
       continue;
     }
     // send msg
     if (_debug)
     {
       click_chatter ("TP: sending add message for symbol %s on port %d",
-                        i.key ().array_ptr (), *out_port);
+                        i.key ().array_ptr (), out_port);
     }
-    send_add_msg(i.value(), *out_port);
+    send_add_msg(i.value(), out_port);
 
     i.value().rollover ();
   }
 
+  for (int i = 0; i < removed.size (); ++i)
+  {
+    if (_debug)
+    {
+      click_chatter ("TP: dropping the bar of symbol %s", removed[i].array_ptr ());
+    }
+    _time_stats_map.remove (removed[i]);
+  }
+
   _timer.reschedule_after_sec (_aggregation_interval_sec);
 }
 
+void*
+TradeProcessor::cast(const char *name)
+{
+  if (strcmp (name, "Checkpointable") == 0)
+  {
+    return static_cast<Checkpointable*>(this);
+  }
+  return Element::cast (name);
+}
+
+void
+TradeProcessor::save_state (StateWriter& writer)
+{
+  writer.write_u32 (_time_stats_map.size ());
+  for (TimeStatsMap::iterator i = _time_stats_map.begin(); i.live(); ++i)
+  {
+    const TimeStats& stats = i.value ();
+
+    writer.write_bytes (i.key ().array_ptr (), Synapse::ORDER_SYMBOL_LEN);
+    writer.write_i64   (stats._high);
+    writer.write_i64   (stats._low);
+    writer.write_i64   (stats._open);
+    writer.write_i64   (stats._close);
+    writer.write_i64   (stats._size);
+    writer.write_bool  (stats._first_time_updated);
+  }
+}
+
+bool
+TradeProcessor::restore_state (StateReader& reader)
+{
+  TimeStatsMap    restored;
+  const uint32_t  count = reader.read_u32 ();
+
+  for (uint32_t i = 0; reader.ok () && (i < count); ++i)
+  {
+    char      symbol [Synapse::ORDER_SYMBOL_LEN];
+    TimeStats stats;
+
+    reader.read_bytes (symbol, Synapse::ORDER_SYMBOL_LEN);
+    symbol [Synapse::ORDER_SYMBOL_LEN - 1] = '\0';
+
+    stats._high               = reader.read_i64 ();
+    stats._low                = reader.read_i64 ();
+    stats._open               = reader.read_i64 ();
+    stats._close              = reader.read_i64 ();
+    stats._size               = reader.read_i64 ();
+    stats._first_time_updated = reader.read_bool ();
+    stats._port               = find_port (symbol, &stats._since);
+
+    restored.insert (SymbolArrayWrapper (symbol), stats);
+  }
+
+  if (!reader.ok ())
+  {
+    return false;
+  }
+
+  // known symbols do not send an INIT again, the indicators
+  // downstream have been restored as well
+  _time_stats_map.clear ();
+  for (TimeStatsMap::iterator i = restored.begin(); i.live(); ++i)
+  {
+    _time_stats_map.insert (i.key (), i.value ());
+  }
+
+  return true;
+}
+
+enum { H_ADD_SYMBOL, H_REMOVE_SYMBOL };
+
+// "add_symbol SYMBOL PORT", "remove_symbol SYMBOL"
+int
+TradeProcessor::symbols_write_handler (
+  const String& str,
+  Element*      e,
+  void*         thunk,
+  ErrorHandler* errh)
+{
+  TradeProcessor* tp = static_cast<TradeProcessor*>(e);
+
+  Vector<String> words;
+  cp_spacevec (str, words);
+
+  const bool adding = ((intptr_t) thunk == H_ADD_SYMBOL);
+  if (words.size () != (adding ? 2 : 1))
+  {
+    return errh->error (adding ? "expected SYMBOL PORT" : "expected SYMBOL");
+  }
+  if (words[0].length () > Synapse::ORDER_SYMBOL_LEN - 1)
+  {
+    return errh->error ("symbol %s is too long", words[0].c_str ());
+  }
+
+  int port = -1;
+  if (adding && (!IntArg ().parse (words[1], port) || (port < 0) || (port >= tp->noutputs ())))
+  {
+    return errh->error ("no output port %s", words[1].c_str ());
+  }
+
+  SymbolArrayWrapper symbol;
+  symbol = words[0].c_str ();
+
+  // the old table stays in use until the new one is published, the
+  // symbols that are not touched keep their bars
+  tp->_subscriptions.write_lock ();
+  Subscriptions* subscriptions = new Subscriptions (*tp->_subscriptions.current ());
+  if (adding)
+  {
+    Route route = { port, ++subscriptions->_adds };
+    subscriptions->_ports.insert (symbol, route); // replaces the old port
+  }
+  else
+  {
+    subscriptions->_ports.remove (symbol);
+  }
+  subscriptions->rebuild_bloom ();
+  tp->_subscriptions.publish (subscriptions);
+  tp->_subscriptions.write_unlock ();
+
+  click_chatter ("TradeProcessor - %s %s %s", adding ? "added" : "removed",
+                    words[0].c_str (), adding ? words[1].c_str () : "");
+  return 0;
+}
+
+String
+TradeProcessor::symbols_read_handler (
+  Element*  e,
+  void*)
+{
+  TradeProcessor* tp = static_cast<TradeProcessor*>(e);
+  StringAccum     sa;
+
+  tp->_subscriptions.write_lock ();
+  const Subscriptions* subscriptions = tp->_subscriptions.current ();
+  for (SubscriptionsMap::const_iterator i = subscriptions->_ports.begin (); i.live (); ++i)
+  {
+    sa << i.key ().array_ptr () << ' ' << i.value ()._port << '\n';
+  }
+  tp->_subscriptions.write_unlock ();
+
+  return sa.take_string ();
+}
+
+enum { H_GAPS, H_MISSING, H_LATE, H_RECOVERED, H_UNRECOVERED, H_STALE, H_DUPLICATES, H_PENDING,
+       H_SYMBOL_GAPS, H_RESETS };
+
+String
+TradeProcessor::seq_read_handler (
+  Element*  e,
+  void*     thunk)
+{
+  TradeProcessor* tp = static_cast<TradeProcessor*>(e);
+
+  switch ((intptr_t) thunk)
+  {
+    case H_GAPS:
+      return String (tp->_gaps);
+    case H_MISSING:
+      return String (tp->_missing_msgs);
+    case H_LATE:
+      return String (tp->_late_msgs);
+    case H_RECOVERED:
+      return String (tp->_recovered_msgs);
+    case H_UNRECOVERED:
+      return String (tp->_unrecovered_msgs);
+    case H_STALE:
+      return String (tp->_stale_msgs);
+    case H_DUPLICATES:
+      return String (tp->_duplicates);
+    case H_RESETS:
+      return String (tp->_seq_resets);
+    case H_PENDING:
+    {
+      uint64_t pending = 0;
+      for (int i = 0; i < tp->_pending.size (); ++i)
+      {
+        pending += tp->_pending[i]._last - tp->_pending[i]._first + 1;
+      }
+      return String (pending);
+    }
+    case H_SYMBOL_GAPS:
+    {
+      StringAccum sa;
+      for (TimeStatsMap::iterator i = tp->_time_stats_map.begin (); i.live (); ++i)
+      {
+        if (i.value ()._gaps)
+        {
+          sa << i.key ().array_ptr () << ' ' << i.value ()._gaps << '\n';
+        }
+      }
+      return sa.take_string ();
+    }
+    default:
+      return String ();
+  }
+}
+
+int
+TradeProcessor::recover_write_handler (
+  const String&,
+  Element*      e,
+  void*,
+  ErrorHandler*)
+{
+  static_cast<TradeProcessor*>(e)->recover ();
+  return 0;
+}
+
+// the sender is known to have started over, the next msg starts the
+// numbering whatever it is
+int
+TradeProcessor::reset_seq_write_handler (
+  const String&,
+  Element*      e,
+  void*,
+  ErrorHandler*)
+{
+  static_cast<TradeProcessor*>(e)->reset_seq ();
+  return 0;
+}
+
 void
 TradeProcessor::add_handlers()
 {
     add_data_handlers("active", Handler::OP_READ | Handler::OP_WRITE | Handler::CHECKBOX | Handler::CALM, &_active);
+    add_write_handler("add_symbol",    symbols_write_handler, H_ADD_SYMBOL);
+    add_write_handler("remove_symbol", symbols_write_handler, H_REMOVE_SYMBOL);
+    add_read_handler ("symbols",       symbols_read_handler,  0);
+    add_read_handler ("gaps",          seq_read_handler,      H_GAPS);
+    add_read_handler ("missing",       seq_read_handler,      H_MISSING);
+    add_read_handler ("late",          seq_read_handler,      H_LATE);
+    add_read_handler ("recovered",     seq_read_handler,      H_RECOVERED);
+    add_read_handler ("unrecovered",   seq_read_handler,      H_UNRECOVERED);
+    add_read_handler ("stale",         seq_read_handler,      H_STALE);
+    add_read_handler ("duplicates",    seq_read_handler,      H_DUPLICATES);
+    add_read_handler ("pending",       seq_read_handler,      H_PENDING);
+    add_read_handler ("symbol_gaps",   seq_read_handler,      H_SYMBOL_GAPS);
+    add_write_handler("recover",       recover_write_handler, 0);
+    add_read_handler ("resets",        seq_read_handler,      H_RESETS);
+    add_write_handler("reset_seq",     reset_seq_write_handler, 0);
 }
 
 CLICK_ENDDECLS
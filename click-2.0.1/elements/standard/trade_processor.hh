@@ -8,6 +8,12 @@
 #include <click/global_sizes.hh>
 #include <click/hashmap.hh>
 #include <click/array_wrapper.hh>
+#include <click/checkpoint.hh>
+#include <click/warm_up.hh>
+#include <click/rcu_pointer.hpp>
+#include <click/symbol_filter.hh>
+#include <click/feed_seq.hh>
+#include <click/feed_journal.hh>
 
 CLICK_DECLS
 
@@ -18,6 +24,10 @@ struct TimeStats
     _first_time_updated = false;
     _size               = 0;
     _high = _low = _open = _close = 0;
+    _last_seq           = 0;
+    _gaps               = 0;
+    _port               = -1;
+    _since              = 0;
   }
 
   fixedpt  _high;
@@ -28,6 +38,16 @@ struct TimeStats
 
   bool    _first_time_updated;
 
+  // a sequenced feed: the msg the close is from, and the msgs of the
+  // symbol that did not come in order
+  uint64_t _last_seq;
+  uint64_t _gaps;
+
+  // the output the INIT went out on, and the add_symbol it was routed
+  // by (see TradeProcessor::Route)
+  int       _port;
+  uint32_t  _since;
+
   void rollover ()
   {
     _open               = _close;
@@ -38,14 +58,50 @@ struct TimeStats
   }
 }; // struct TimeStats
 
-class TradeProcessor : public Element
+class TradeProcessor : public Element, public Checkpointable
 {
   public:
 
     typedef Synapse::ArrayWrapper<char, Synapse::ORDER_SYMBOL_LEN>  SymbolArrayWrapper;
     typedef HashMap<SymbolArrayWrapper, TimeStats>                  TimeStatsMap;
+
+    // the port of a symbol, and the add_symbol that put it there: a
+    // symbol removed and added back is a new subscription even on the
+    // same port
+    struct Route
+    {
+      int       _port;
+      uint32_t  _since;
+    };
     // symbol to port
-    typedef HashMap<SymbolArrayWrapper, int>                        SubscriptionsMap;
+    typedef HashMap<SymbolArrayWrapper, Route>                      SubscriptionsMap;
+
+    // the msgs of a sequenced feed that have not come yet
+    struct SeqRange
+    {
+      uint64_t _first;
+      uint64_t _last;
+    };
+
+    // what the RCU pointer swaps: the routing plus a bloom filter of its
+    // symbols, to drop the unsubscribed ones before parsing the msg
+    struct Subscriptions
+    {
+      Subscriptions () : _adds (0) {}
+
+      SubscriptionsMap  _ports;
+      SymbolBloom       _bloom;
+      uint32_t          _adds;      // by the add_symbol handler
+
+      void rebuild_bloom ()
+      {
+        _bloom.clear ();
+        for (SubscriptionsMap::const_iterator i = _ports.begin (); i.live (); ++i)
+        {
+          _bloom.add (i.key ().array_ptr (), strlen (i.key ().array_ptr ()));
+        }
+      }
+    }; // struct Subscriptions
 
 
     TradeProcessor();
@@ -59,6 +115,18 @@ class TradeProcessor : public Element
 
     bool can_live_reconfigure() const		{ return false; }
     void add_handlers();
+    void *cast(const char *name);
+
+    // the open bars of all the symbols, see the Checkpoint element
+    void save_state    (StateWriter& writer);
+    bool restore_state (StateReader& reader);
+
+    // feeds the historical bars of a symbol downstream, the first one as
+    // an INIT and all of them as ADDs, and leaves the symbol as if the
+    // last bar had just been closed. See the WarmUp element
+    bool        warm_up_symbol   (const String&                         symbol,
+                                  const Vector<Synapse::MsgSource>&     bars,
+                                  WarmUpEmitter&                        emitter);
 
     void        push             (int                       port,
                                   Packet*                   p);
@@ -66,27 +134,110 @@ class TradeProcessor : public Element
     void        run_timer        (Timer*                    timer);
 
   private:
+    // the port a symbol is routed to, -1 if it is not subscribed
+    int         find_port        (const SymbolArrayWrapper& symbol,
+                                  uint32_t*                 since = NULL);
+    // the same straight from the msg, through the bloom filter first
+    int         find_port        (const char*               symbol,
+                                  const size_t              symbol_len,
+                                  uint32_t*                 since = NULL);
+
+    static int  symbols_write_handler (const String&, Element*, void*, ErrorHandler*);
+    static String symbols_read_handler (Element*, void*);
+    static int  recover_write_handler (const String&, Element*, void*, ErrorHandler*);
+    static int  reset_seq_write_handler (const String&, Element*, void*, ErrorHandler*);
+    static String seq_read_handler (Element*, void*);
+
+    // false for a msg that has been seen already, late for one that fills
+    // a gap, of the open bars or of the closed ones. O(1) unless the msg
+    // is behind. One far behind starts the numbering over
+    bool        check_seq        (const uint64_t            seq,
+                                  bool&                     late);
+    static bool take_seq         (Vector<SeqRange>&         ranges,
+                                  const uint64_t            seq);
+    // forgets the gaps, the next msg is taken as the first one
+    void        reset_seq        ();
+    void        trim_closed_gaps ();
+
+    // replays the gaps from the journal into the open bars, and sends the
+    // bars that have changed
+    void        recover          ();
+
+    // the bar of a symbol routed to out_port. A new one (added) if there
+    // is none yet, or if the symbol has been moved to another port or
+    // removed and added back since its INIT
+    TimeStats*  bar_on_port      (const char              (&symbol)[Synapse::ORDER_SYMBOL_LEN],
+                                  const int                 out_port,
+                                  const uint32_t            since,
+                                  bool&                     added);
+
     void        send_update_msg  (const TimeStats&          stats,
                                   const uint64_t            timestamp,
                                   int                       out_port,
                                   Packet&                   packet,
-                                  const bool                is_init);
+                                  const bool                is_init,
+                                  const uint8_t             dirty);
 
     void        send_add_msg     (const TimeStats&          stats,
                                   const int                 out_port);
+
+    // the MsgTrades that come decoded already
+    void        push_msg_trade   (Packet*                   p);
+
+    // into the open bar of its symbol, or out as it is with TRADES
+    void        aggregate_trade  (const Synapse::MsgTrade&  msg_trade,
+                                  const int                 out_port,
+                                  const uint32_t            since,
+                                  const bool                late,
+                                  Packet*                   p);
+
+    // the trade itself, for a ConsolidatedBars
+    void        send_trade_msg   (const Synapse::MsgTrade&  msg_trade,
+                                  const int                 out_port,
+                                  Packet&                   packet);
   private:
 
     Timer             _timer;
+    bool              _timer_started;   // by the first trade
     uint32_t          _aggregation_interval_sec;
 
     TimeStatsMap      _time_stats_map;
-    SubscriptionsMap  _subscriptions_map;
+    // replaced as a whole by the add_symbol/remove_symbol handlers
+    RcuPointer<Subscriptions>     _subscriptions;
+    // what comes before the 8 byte timestamp of a msg: 42 for the
+    // ethernet frames of FromDevice, 0 for the payloads of a UDP Socket
+    uint32_t          _header_len;
 
     bool              _debug;
     bool              _active;
+    // the subscribed trades go out as they are instead of the bars
+    bool              _emit_trades;
 
     uint64_t          _total_msgs;
 
+    // the msgs end with the sequence number of the feed
+    bool              _sequenced;
+    uint64_t          _expected;
+    uint64_t          _bar_first_seq;   // the first msg of the open bars
+    Vector<SeqRange>  _pending;
+    Vector<SeqRange>  _closed_gaps;     // what the closed bars never got, oldest first
+
+    uint64_t          _gaps;
+    uint64_t          _missing_msgs;
+    uint64_t          _late_msgs;       // came later on their own
+    uint64_t          _recovered_msgs;  // from the journal
+    uint64_t          _unrecovered_msgs;
+    uint64_t          _stale_msgs;      // for a bar that had been closed
+    uint64_t          _duplicates;
+    uint64_t          _seq_resets;      // the sender started its numbering over
+
+    Timer             _recovery_timer;
+    uint32_t          _recovery_delay_ms;
+#if CLICK_USERLEVEL
+    String            _journal_name;
+    FeedJournal       _journal;
+#endif
+
     WritablePacket*   _w_packet;
 
 #ifdef CLICK_LINUXMODULE
@@ -0,0 +1,304 @@
+/*
+ * print.{cc,hh} -- element prints packet contents to system log
+ * John Jannotti, Eddie Kohler
+ *
+ * Copyright (c) 1999-2000 Massachusetts Institute of Technology
+ * Copyright (c) 2008 Regents of the University of California
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#ifdef CLICK_LINUXMODULE
+# include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+# include <linux/sched.h>
+CLICK_CXX_UNPROTECT
+# include <click/cxxunprotect.h>
+#endif
+CLICK_DECLS
+
+#include "weighted_index.hh"
+#include <click/appmsgs.hh>
+#include "synapseelement.hh"
+
+using Synapse::SynapseElement;
+using Synapse::MsgSource;
+
+WeightedIndex::WeightedIndex()
+  : _divisor          (FIXEDPT_ONE)
+  , _interval_sec     (10)
+  , _recompute_every  (10000)
+  , _debug            (false)
+  , _missing          (0)
+  , _sum              (0)
+  , _updates          (0)
+  , _recomputes       (0)
+  , _initialized      (false)
+  , _timer            (this)
+{
+}
+
+WeightedIndex::~WeightedIndex()
+{
+}
+
+int
+WeightedIndex::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  String weights;
+  String divisor;
+  if (Args(conf, errh)
+        .read_m ("WEIGHTS",                   weights)
+        .read   ("DIVISOR",                   divisor)
+        .read   ("AGGREGATION_INTERVAL_SEC",  _interval_sec)
+        .read   ("RECOMPUTE",                 _recompute_every)
+        .read   ("DEBUG",                     _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  Vector<String> words;
+  cp_spacevec (weights, words);
+  if (words.size () != ninputs ())
+  {
+    return errh->error ("%d inputs, but %d WEIGHTS", ninputs (), words.size ());
+  }
+  for (int i = 0; i < words.size (); ++i)
+  {
+    _weights.push_back (fixedpt_rconst (strtod (words[i].c_str (), NULL)));
+  }
+
+  if (divisor)
+  {
+    _divisor = fixedpt_rconst (strtod (divisor.c_str (), NULL));
+  }
+  if (_divisor <= 0)
+  {
+    return errh->error ("DIVISOR must be positive");
+  }
+  if (_recompute_every == 0)
+  {
+    return errh->error ("RECOMPUTE must be positive");
+  }
+
+  return 0;
+}
+
+int
+WeightedIndex::initialize(ErrorHandler*)
+{
+  _prices.resize   (ninputs (), 0);
+  _weighted.resize (ninputs (), 0);
+  _missing = ninputs ();
+
+  _timer.initialize (this);
+  if (_interval_sec > 0)
+  {
+    _timer.schedule_after_sec (_interval_sec);
+  }
+
+  return 0;
+}
+
+void
+WeightedIndex::recompute ()
+{
+  fixedptd sum = 0;
+  for (int i = 0; i < _weighted.size (); ++i)
+  {
+    sum += _weighted[i];
+  }
+  _sum = sum;
+  ++_recomputes;
+}
+
+fixedpt
+WeightedIndex::index_value () const
+{
+  // the sum carries 2 x FBITS fraction bits, the division takes one off
+  return (fixedpt) (_sum / _divisor);
+}
+
+// like the TradeProcessor bars, returns the changed fields
+uint8_t
+WeightedIndex::update_bar (const fixedpt value)
+{
+  if (!_bar._first_time_updated)
+  {
+    _bar._high                = value;
+    _bar._low                 = value;
+    _bar._close               = value;
+    _bar._first_time_updated  = true;
+    return Synapse::SOURCE_ALL;
+  }
+
+  uint8_t rc = 0;
+  if (value > _bar._high)
+  {
+    _bar._high = value;
+    rc        |= Synapse::SOURCE_HIGH;
+  }
+  if (value < _bar._low)
+  {
+    _bar._low  = value;
+    rc        |= Synapse::SOURCE_LOW;
+  }
+  if (value != _bar._close)
+  {
+    _bar._close = value;
+    rc         |= Synapse::SOURCE_CLOSE;
+  }
+  return rc;
+}
+
+void
+WeightedIndex::send_source (
+  Packet*                       packet,
+  const Synapse::PacketAppType  type,
+  const uint64_t                timestamp,
+  const uint8_t                 dirty)
+{
+  WritablePacket* p = packet ? packet->put (0)
+                             : Packet::make (Packet::default_headroom, 0, sizeof (MsgSource) + 1, 0);
+  if (!p)
+  {
+    return;
+  }
+  if (p->length () < sizeof (MsgSource))
+  {
+    click_chatter ("WeightedIndex - packet too small - cannot send!");
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  MsgSource msg_source;
+  msg_source._high      = _bar._high;
+  msg_source._low       = _bar._low;
+  msg_source._open      = _bar._open;
+  msg_source._close     = _bar._close;
+  msg_source._volume    = 0;
+  msg_source._timestamp = timestamp;
+  msg_source._dirty     = dirty;
+
+  memcpy (p->data (), reinterpret_cast<char*>(&msg_source), sizeof (msg_source));
+  p->set_packet_app_type (type);
+
+  output (0).push (p);
+}
+
+void
+WeightedIndex::push(int port, Packet* p)
+{
+  const PacketAppType type = p->get_packet_app_type ();
+  if ((type != Synapse::MSG_ADD_SOURCE) &&
+        (type != Synapse::MSG_UPDATE_SOURCE) &&
+          (type != Synapse::MSG_INIT_SOURCE))
+  {
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  const MsgSource* msg    = reinterpret_cast<const MsgSource*>(p->data ());
+  const fixedpt    close  = msg->_close;
+
+  if (close == _prices[port])
+  {
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+  if (_prices[port] == 0)
+  {
+    --_missing;
+  }
+
+  // O(1): only this constituent moves
+  const fixedptd weighted = (fixedptd) _weights[port] * close;
+  _sum            += weighted - _weighted[port];
+  _weighted[port]  = weighted;
+  _prices[port]    = close;
+
+  if (++_updates % _recompute_every == 0)
+  {
+    recompute ();
+  }
+
+  if (_missing > 0)
+  {
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+
+  const fixedpt value = index_value ();
+  const bool    init  = !_initialized;
+  const uint8_t dirty = update_bar (value);
+  if (!dirty && !init)
+  {
+    SynapseElement::discard_packet (*p);
+    return;
+  }
+  _initialized = true;
+
+  if (_debug)
+  {
+    click_chatter ("WeightedIndex: port %d, index %s", port, fixedpt_cstr (value, 4));
+  }
+
+  send_source (p, init ? Synapse::MSG_INIT_SOURCE : Synapse::MSG_UPDATE_SOURCE,
+               msg->_timestamp, init ? Synapse::SOURCE_ALL : dirty);
+}
+
+void
+WeightedIndex::run_timer(Timer*)
+{
+  if (_initialized)
+  {
+    send_source (NULL, Synapse::MSG_ADD_SOURCE, Synapse::gcc_rdtsc (), Synapse::SOURCE_ALL);
+    _bar.rollover ();
+  }
+
+  _timer.reschedule_after_sec (_interval_sec);
+}
+
+enum { H_VALUE, H_UPDATES, H_RECOMPUTES };
+
+String
+WeightedIndex::read_handler(Element* e, void* thunk)
+{
+  WeightedIndex* wi = static_cast<WeightedIndex*>(e);
+  switch ((intptr_t) thunk)
+  {
+    case H_VALUE:
+      return (wi->_missing > 0) ? String ("-") : String (fixedpt_cstr (wi->index_value (), 4));
+    case H_UPDATES:
+      return String (wi->_updates);
+    case H_RECOMPUTES:
+      return String (wi->_recomputes);
+    default:
+      return String ();
+  }
+}
+
+void
+WeightedIndex::add_handlers()
+{
+  add_read_handler ("value",      read_handler, H_VALUE);
+  add_read_handler ("updates",    read_handler, H_UPDATES);
+  add_read_handler ("recomputes", read_handler, H_RECOMPUTES);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(WeightedIndex)
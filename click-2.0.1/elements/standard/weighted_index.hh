@@ -0,0 +1,87 @@
+#ifndef CLICK_WEIGHTED_INDEX_HH
+#define CLICK_WEIGHTED_INDEX_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include <click/fixedptc.h>
+#include "trade_processor.hh"
+
+CLICK_DECLS
+
+/*
+ * WeightedIndex(WEIGHTS "0.5 1.2 ...", [DIVISOR 1, AGGREGATION_INTERVAL_SEC 10,
+ *               RECOMPUTE 10000, DEBUG false])
+ *
+ * An index over a basket of constituents, one per input port (the
+ * TradeProcessor outputs, teed), each with its weight in WEIGHTS:
+ *   index = sum (weight[i] * close[i]) / DIVISOR
+ *
+ * The weights, last prices and weighted prices are kept in dense arrays.
+ * A source msg only changes its own constituent: its weighted price is
+ * taken out of the sum and the new one added, so an update is O(1). The
+ * sum is kept with the 128 bit intermediates of fixedpt, the weighted
+ * prices are not rounded twice, and every RECOMPUTE updates it is summed
+ * up from scratch anyway so that nothing can drift.
+ *
+ * The index goes out as a synthetic symbol, with the same msgs as a
+ * TradeProcessor output port sends: MSG_INIT_SOURCE once every
+ * constituent has a price, MSG_UPDATE_SOURCE when the index changes and
+ * MSG_ADD_SOURCE every AGGREGATION_INTERVAL_SEC, so it can be fed to a
+ * SourceSplit and the indicators like any other symbol.
+ *
+ * Handlers: value, updates, recomputes.
+ */
+
+class WeightedIndex : public Element
+{
+  public:
+    WeightedIndex();
+    ~WeightedIndex();
+
+    const char *class_name() const		{ return "WeightedIndex"; }
+    const char *port_count() const		{ return "1-/1"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    bool can_live_reconfigure() const		{ return false; }
+    void add_handlers();
+
+    void push(int port, Packet *p);
+    void run_timer(Timer *);
+
+  private:
+    void      recompute     ();
+    fixedpt   index_value   () const;
+    uint8_t   update_bar    (const fixedpt value);
+    void      send_source   (Packet*                       packet,
+                             const Synapse::PacketAppType  type,
+                             const uint64_t                timestamp,
+                             const uint8_t                 dirty);
+
+    static String read_handler (Element*, void*);
+
+  private:
+    fixedpt             _divisor;
+    uint32_t            _interval_sec;
+    uint32_t            _recompute_every;
+    bool                _debug;
+
+    // dense, one per input port
+    Vector<fixedpt>     _weights;
+    Vector<fixedpt>     _prices;
+    Vector<fixedptd>    _weighted;      // weight * price, not rounded yet
+    int                 _missing;       // constituents without a price
+
+    fixedptd            _sum;
+    uint64_t            _updates;
+    uint64_t            _recomputes;
+    bool                _initialized;
+
+    TimeStats           _bar;
+    Timer               _timer;
+
+}; // class WeightedIndex
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,304 @@
+/*
+ * fix_trade_handler.{cc,hh} -- the trades of a FIX feed or log as MsgTrades
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packet.hh>
+#include <click/router.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <click/appmsgs.hh>
+#include <click/fixedptc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include "fix_trades.hpp"
+CLICK_DECLS
+
+#include "fix_trade_handler.hh"
+#include "elements/standard/synapseelement.hh"
+
+using Synapse::MsgTrade;
+using Synapse::SynapseElement;
+
+// more than that and what is kept is not going to be a msg
+static const ssize_t s_max_partial_len = 64 << 10;
+
+// the decoded price, mantissa * 10^exponent
+static fixedpt price_as_fixedpt (int64_t mantissa, int64_t exponent)
+{
+  fixedptd divisor = 1;
+  for (; exponent < 0; ++exponent)
+  {
+    divisor *= 10;
+  }
+  for (; exponent > 0; --exponent)
+  {
+    mantissa *= 10;
+  }
+  return static_cast<fixedpt>((static_cast<fixedptd>(mantissa) << FIXEDPT_FBITS) / divisor);
+}
+
+FixTradeHandler::FixTradeHandler()
+  : _header_len   (0)
+  , _chunk        (256 << 10)
+  , _stop         (false)
+  , _debug        (false)
+  , _fd           (-1)
+  , _task         (this)
+  , _long_symbols (0)
+{
+}
+
+FixTradeHandler::~FixTradeHandler()
+{
+}
+
+int
+FixTradeHandler::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  if (Args(conf, this, errh)
+        .read ("HEADER_LEN",  _header_len)
+        .read ("FILE",        FilenameArg (), _filename)
+        .read ("CHUNK",       _chunk)
+        .read ("STOP",        _stop)
+        .read ("DEBUG",       _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if (_filename && (ninputs () > 0))
+  {
+    return errh->error ("FILE takes no input");
+  }
+  if (!_filename && (ninputs () == 0))
+  {
+    return errh->error ("FILE or an input is needed");
+  }
+  if ((_chunk < 4096) || (_chunk > (64 << 20)))
+  {
+    return errh->error ("CHUNK must be between 4096 and 64MB");
+  }
+
+  return 0;
+}
+
+int
+FixTradeHandler::initialize(ErrorHandler* errh)
+{
+  if (!_filename)
+  {
+    return 0;
+  }
+
+  _fd = open (_filename.c_str (), O_RDONLY);
+  if (_fd < 0)
+  {
+    return errh->error ("%s: %s", _filename.c_str (), strerror (errno));
+  }
+  posix_fadvise (_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  ScheduleInfo::initialize_task (this, &_task, errh);
+  return 0;
+}
+
+void
+FixTradeHandler::cleanup(CleanupStage)
+{
+  if (_fd >= 0)
+  {
+    close (_fd);
+    _fd = -1;
+  }
+}
+
+void
+FixTradeHandler::decode_partial()
+{
+  const char* begin = _partial.data ();
+  const char* end   = begin + _partial.length ();
+  const char* rest  = FixTrades::decode_md_trades (begin, end, *this, _stats);
+
+  if (end - rest > s_max_partial_len)
+  {
+    ++_stats._invalid;
+    _partial.clear ();
+    return;
+  }
+  // keeps the rest in place, the buffer is only ever as big as a chunk
+  // and a msg
+  memmove (_partial.data (), rest, end - rest);
+  _partial.set_length (end - rest);
+}
+
+void
+FixTradeHandler::push(int, Packet* p)
+{
+  if (p->length () > _header_len)
+  {
+    const char* data = reinterpret_cast<const char*>(p->data ()) + _header_len;
+    const char* end  = reinterpret_cast<const char*>(p->end_data ());
+    if (_partial.length () == 0)
+    {
+      // the usual case, whole msgs decoded in the packet
+      const char* rest = FixTrades::decode_md_trades (data, end, *this, _stats);
+      if (end - rest > s_max_partial_len)
+      {
+        ++_stats._invalid;
+      }
+      else
+      {
+        _partial.append (rest, end);
+      }
+    }
+    else
+    {
+      _partial.append (data, end);
+      decode_partial ();
+    }
+  }
+
+  SynapseElement::discard_packet (*p);
+}
+
+bool
+FixTradeHandler::run_task(Task*)
+{
+  if (_fd < 0)
+  {
+    return false;
+  }
+
+  const int kept = _partial.length ();
+  char*     buf  = _partial.extend (_chunk);
+  if (!buf)
+  {
+    click_chatter ("%s: out of memory", declaration ().c_str ());
+    return false;
+  }
+
+  const ssize_t len = read (_fd, buf, _chunk);
+  if (len <= 0)
+  {
+    _partial.set_length (kept);
+    if ((len < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+    {
+      _task.fast_reschedule ();
+      return false;
+    }
+    if (len < 0)
+    {
+      click_chatter ("%s: %s", declaration ().c_str (), strerror (errno));
+    }
+    if (_debug)
+    {
+      click_chatter ("%s: end of %s, %llu msgs, %llu trades", declaration ().c_str (), _filename.c_str (),
+                     (unsigned long long) _stats._msgs, (unsigned long long) _stats._trades);
+    }
+    close (_fd);
+    _fd = -1;
+    if (_stop)
+    {
+      router ()->please_stop_driver ();
+    }
+    return false;
+  }
+
+  _partial.set_length (kept + len);
+  decode_partial ();
+
+  _task.fast_reschedule ();
+  return true;
+}
+
+void
+FixTradeHandler::operator() (const FixTrades::Trade& trade)
+{
+  MsgTrade msg;
+  if (trade._symbol_len > Synapse::ORDER_SYMBOL_LEN - 1)
+  {
+    ++_long_symbols;
+    return;
+  }
+  memcpy (msg._symbol, trade._symbol, trade._symbol_len);
+
+  msg._price          = price_as_fixedpt (trade._price_mantissa, trade._price_exponent);
+  msg._size           = trade._size;
+  msg._timestamp      = Synapse::gcc_rdtsc ();
+  msg._src_timestamp  = trade._sending_time_us;
+  // the entries of one msg share its MsgSeqNum, so it is not a feed
+  // sequence a TradeProcessor could check
+  msg._seq            = 0;
+
+  if (_debug)
+  {
+    click_chatter ("%s: %s %s %lld", declaration ().c_str (), msg._symbol,
+                   fixedpt_cstr (msg._price, 4), (long long) msg._size);
+  }
+
+  WritablePacket* p = Packet::make (Packet::default_headroom, 0, sizeof (msg), 0);
+  if (!p)
+  {
+    return;
+  }
+  memcpy (p->data (), reinterpret_cast<char*>(&msg), sizeof (msg));
+  p->set_packet_app_type (Synapse::MSG_TRADE);
+
+  output (0).push (p);
+}
+
+enum { H_MSGS, H_MD_MSGS, H_TRADES, H_INVALID, H_LONG_SYMBOLS };
+
+String
+FixTradeHandler::read_handler(Element* e, void* thunk)
+{
+  FixTradeHandler* fth = static_cast<FixTradeHandler*>(e);
+
+  switch ((intptr_t) thunk)
+  {
+    case H_MSGS:
+      return String (fth->_stats._msgs);
+    case H_MD_MSGS:
+      return String (fth->_stats._md_msgs);
+    case H_TRADES:
+      return String (fth->_stats._trades);
+    case H_INVALID:
+      return String (fth->_stats._invalid);
+    case H_LONG_SYMBOLS:
+      return String (fth->_long_symbols);
+    default:
+      return String ();
+  }
+}
+
+void
+FixTradeHandler::add_handlers()
+{
+  add_read_handler ("msgs",         read_handler, H_MSGS);
+  add_read_handler ("md_msgs",      read_handler, H_MD_MSGS);
+  add_read_handler ("trades",       read_handler, H_TRADES);
+  add_read_handler ("invalid",      read_handler, H_INVALID);
+  add_read_handler ("long_symbols", read_handler, H_LONG_SYMBOLS);
+  if (_filename)
+  {
+    add_task_handlers (&_task);
+  }
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(FixTradeHandler)
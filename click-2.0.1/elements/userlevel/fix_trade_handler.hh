@@ -0,0 +1,82 @@
+#ifndef CLICK_FIX_TRADE_HANDLER_HH
+#define CLICK_FIX_TRADE_HANDLER_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/task.hh>
+#include <click/straccum.hh>
+#include "fix_trades.hpp"
+
+CLICK_DECLS
+
+/*
+ * FixTradeHandler([HEADER_LEN 0, FILE filename, CHUNK 262144, STOP false,
+ *                  DEBUG false])
+ *
+ * The trades of a FIX market data feed as MSG_TRADEs, the way a
+ * ChixTradeHandler sends the CHIX ones: every new trade entry of a
+ * MarketDataIncrementalRefresh goes out in a packet of its own, with the
+ * SendingTime of its msg (microseconds since the epoch) as the source
+ * timestamp and the cycles when it was decoded as the trade timestamp.
+ * The msgs are decoded where they are with hffix, see
+ * FixTrades::decode_md_trades, with no text made on the way, and a
+ * TradeProcessor behind it takes the MsgTrades as they are.
+ *
+ * The packets on the input are the feed, with HEADER_LEN bytes in front
+ * of the FIX: 0 from a Socket, 42 from FromDevice. A msg that is cut off
+ * at the end of a packet is finished from the next one, so a TCP Socket
+ * works too.
+ *
+ * With FILE there is no input and it reads a FIX log instead, CHUNK bytes
+ * a time, with whatever the lines have in front of the msgs skipped. STOP
+ * stops the router at the end of the log.
+ *
+ * Handlers: msgs, md_msgs, trades, invalid, long_symbols.
+ */
+
+class FixTradeHandler : public Element
+{
+  public:
+    FixTradeHandler();
+    ~FixTradeHandler();
+
+    const char *class_name() const		{ return "FixTradeHandler"; }
+    const char *port_count() const		{ return "0-1/1"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void push(int port, Packet *p);
+    bool run_task(Task *);
+
+    // called by FixTrades::decode_md_trades
+    void operator() (const FixTrades::Trade& trade);
+
+  private:
+    // decodes what it can of _partial and keeps the rest for the next time
+    void            decode_partial  ();
+
+    static String   read_handler    (Element*, void*);
+
+  private:
+    uint32_t                _header_len;
+    String                  _filename;
+    uint32_t                _chunk;
+    bool                    _stop;
+    bool                    _debug;
+
+    int                     _fd;
+    Task                    _task;
+
+    // a msg that has not come whole yet
+    StringAccum             _partial;
+
+    FixTrades::DecodeStats  _stats;
+    uint64_t                _long_symbols;
+
+}; // class FixTradeHandler
+
+CLICK_ENDDECLS
+#endif
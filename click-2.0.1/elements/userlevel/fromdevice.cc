@@ -47,12 +47,14 @@
 # include <sys/socket.h>
 # include <net/if.h>
 # include <features.h>
+// <linux/if_packet.h> through packet_ring.hh, for TPACKET_V3; it
+// clashes with <netpacket/packet.h>
+# include <click/packet_ring.hh>
+# include <linux/sockios.h>
 # if __GLIBC__ >= 2 && __GLIBC_MINOR__ >= 1
-#  include <netpacket/packet.h>
 #  include <net/ethernet.h>
 # else
 #  include <net/if_packet.h>
-#  include <linux/if_packet.h>
 #  include <linux/if_ether.h>
 # endif
 #endif
@@ -69,10 +71,19 @@ FromDevice::FromDevice()
 #if FROMDEVICE_LINUX || FROMDEVICE_PCAP
     _fd = -1;
 #endif
+#if FROMDEVICE_LINUX
+    _ring = 0;
+    _ring_drops = 0;
+#endif
 }
 
 FromDevice::~FromDevice()
 {
+#if FROMDEVICE_LINUX
+    // zero-copy packets may still be out in the ring
+    if (_ring)
+	PacketRing::retire(_ring);
+#endif
 }
 
 int
@@ -86,6 +97,14 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     _burst = 1;
     String bpf_filter, capture, encap_type;
     bool has_encap;
+#if FROMDEVICE_LINUX
+    String fanout_mode = "HASH";
+    _ring_block_size = 1 << 20;
+    _ring_blocks = 16;
+    _ring_timeout = 1;
+    _fanout = 0;
+    _zero_copy = true;
+#endif
     if (Args(conf, this, errh)
 	.read_mp("DEVNAME", _ifname)
 	.read_p("PROMISC", promisc)
@@ -99,6 +118,14 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("HEADROOM", _headroom)
 	.read("ENCAP", WordArg(), encap_type).read_status(has_encap)
 	.read("BURST", _burst)
+#if FROMDEVICE_LINUX
+	.read("RING_BLOCK_SIZE", _ring_block_size)
+	.read("RING_BLOCKS", _ring_blocks)
+	.read("RING_TIMEOUT", _ring_timeout)
+	.read("FANOUT", _fanout)
+	.read("FANOUT_MODE", WordArg(), fanout_mode)
+	.read("ZERO_COPY", _zero_copy)
+#endif
 	.complete() < 0)
 	return -1;
     if (_snaplen > 8190 || _snaplen < 14)
@@ -132,6 +159,8 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 #if FROMDEVICE_LINUX
     else if (capture == "LINUX")
 	_capture = CAPTURE_LINUX;
+    else if (capture == "RING")
+	_capture = CAPTURE_RING;
 #endif
 #if FROMDEVICE_PCAP
     else if (capture == "PCAP")
@@ -143,6 +172,28 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     if (bpf_filter && _capture != CAPTURE_PCAP)
 	errh->warning("not using METHOD PCAP, BPF filter ignored");
 
+#if FROMDEVICE_LINUX
+    if (_capture == CAPTURE_RING) {
+	if (_ring_block_size < (uint32_t) getpagesize()
+	    || _ring_block_size % getpagesize() != 0)
+	    return errh->error("RING_BLOCK_SIZE must be a multiple of the page size");
+	if (_ring_blocks == 0)
+	    return errh->error("RING_BLOCKS out of range");
+	if (_fanout > 0xFFFF)
+	    return errh->error("FANOUT out of range");
+	if (fanout_mode == "HASH")
+	    _fanout_mode = PACKET_FANOUT_HASH;
+	else if (fanout_mode == "LB")
+	    _fanout_mode = PACKET_FANOUT_LB;
+	else if (fanout_mode == "CPU")
+	    _fanout_mode = PACKET_FANOUT_CPU;
+	else if (fanout_mode == "QM")
+	    _fanout_mode = PACKET_FANOUT_QM;
+	else
+	    return errh->error("bad FANOUT_MODE");
+    }
+#endif
+
     _sniffer = sniffer;
     _promisc = promisc;
     _outbound = outbound;
@@ -219,6 +270,23 @@ FromDevice::set_promiscuous(int fd, String ifname, bool promisc)
 
     return was_promisc;
 }
+
+int
+FromDevice::initialize_ring(ErrorHandler *errh)
+{
+    // the frames are the ring's, a snaplen of them is enough
+    uint32_t frame_size = TPACKET_ALIGN(TPACKET3_HDRLEN + _snaplen);
+    _ring = new PacketRing;
+    if (int err = _ring->setup(_fd, _ring_block_size, _ring_blocks, frame_size, _ring_timeout))
+	return errh->error("%s: TPACKET_V3 ring: %s", _ifname.c_str(), strerror(err));
+
+    if (_fanout) {
+	int arg = _fanout | (_fanout_mode << 16);
+	if (setsockopt(_fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0)
+	    return errh->error("%s: PACKET_FANOUT: %s", _ifname.c_str(), strerror(errno));
+    }
+    return 0;
+}
 #endif /* FROMDEVICE_LINUX */
 
 #if FROMDEVICE_PCAP
@@ -337,10 +405,12 @@ FromDevice::initialize(ErrorHandler *errh)
 #endif
 
 #if FROMDEVICE_LINUX
-    if (_capture == CAPTURE_LINUX) {
+    if (_capture == CAPTURE_LINUX || _capture == CAPTURE_RING) {
 	_fd = open_packet_socket(_ifname, errh);
 	if (_fd < 0)
 	    return -1;
+	if (_capture == CAPTURE_RING && initialize_ring(errh) < 0)
+	    return -1;
 
 	int promisc_ok = set_promiscuous(_fd, _ifname, _promisc);
 	if (promisc_ok < 0) {
@@ -369,9 +439,15 @@ FromDevice::cleanup(CleanupStage stage)
     if (stage >= CLEANUP_INITIALIZED && !_sniffer)
 	KernelFilter::device_filter(_ifname, false, ErrorHandler::default_handler());
 #if FROMDEVICE_LINUX
-    if (_fd >= 0 && _capture == CAPTURE_LINUX) {
+    if (_fd >= 0 && (_capture == CAPTURE_LINUX || _capture == CAPTURE_RING)) {
 	if (_was_promisc >= 0)
 	    set_promiscuous(_fd, _ifname, _was_promisc);
+	// packets still out keep the mapping, the socket can go; the
+	// last of them to be killed deletes the ring
+	if (_ring) {
+	    PacketRing::retire(_ring);
+	    _ring = 0;
+	}
 	close(_fd);
     }
 #endif
@@ -464,9 +540,61 @@ FromDevice::selected(int, int)
 	    break;
 	}
     }
+
+    if (_capture == CAPTURE_RING) {
+	// a block is gone through before the next one is looked at, BURST
+	// blocks at most
+	uint64_t last = _ring->blocks_walked() + _burst;
+	while (_ring->blocks_walked() < last)
+	    if (struct tpacket3_hdr *frame = _ring->next_frame())
+		push_frame(frame);
+	    else
+		break;
+	_ring->finish();
+    }
 #endif
 }
 
+#if FROMDEVICE_LINUX
+void
+FromDevice::push_frame(struct tpacket3_hdr *frame)
+{
+    const struct sockaddr_ll *sa = PacketRing::frame_addr(frame);
+    if (sa->sll_pkttype == PACKET_OUTGOING && !_outbound)
+	return;
+
+    unsigned char *data = PacketRing::frame_data(frame);
+    WritablePacket *p;
+    if (_zero_copy) {
+	// the rest of the frame is tailroom
+	uint32_t room = frame->tp_next_offset ? frame->tp_next_offset - frame->tp_mac
+	    : frame->tp_snaplen;
+	if (!(p = Packet::make(data, room, release_frame)))
+	    return;
+	p->take(room - frame->tp_snaplen);
+	_ring->hold(data);
+    } else if (!(p = Packet::make(_headroom, data, frame->tp_snaplen, 0)))
+	return;
+
+    if (frame->tp_len > frame->tp_snaplen)
+	SET_EXTRA_LENGTH_ANNO(p, frame->tp_len - frame->tp_snaplen);
+    p->set_packet_type_anno((Packet::PacketType)sa->sll_pkttype);
+    p->timestamp_anno().assign(frame->tp_sec, frame->tp_nsec / 1000);
+    p->set_mac_header(p->data());
+    ++_count;
+    if (!_force_ip || fake_pcap_force_ip(p, _datalink))
+	output(0).push(p);
+    else
+	checked_output_push(1, p);
+}
+
+void
+FromDevice::release_frame(unsigned char *data, size_t)
+{
+    PacketRing::release(data);
+}
+#endif
+
 #if FROMDEVICE_PCAP
 bool
 FromDevice::run_task(Task *)
@@ -485,11 +613,20 @@ FromDevice::run_task(Task *)
 void
 FromDevice::kernel_drops(bool& known, int& max_drops) const
 {
+    known = false, max_drops = -1;
 #if FROMDEVICE_LINUX
     // You might be able to do this better by parsing netstat/ifconfig output,
-    // but for now, we just give up.
+    // but for now, we just give up.  The ring has its own count, which the
+    // kernel resets on every read.
+    if (_capture == CAPTURE_RING && _fd >= 0) {
+	struct tpacket_stats_v3 stats;
+	socklen_t len = sizeof(stats);
+	if (getsockopt(_fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) >= 0) {
+	    const_cast<FromDevice *>(this)->_ring_drops += stats.tp_drops;
+	    known = true, max_drops = _ring_drops;
+	}
+    }
 #endif
-    known = false, max_drops = -1;
 #if FROMDEVICE_PCAP
     if (_capture == CAPTURE_PCAP) {
 	struct pcap_stat stats;
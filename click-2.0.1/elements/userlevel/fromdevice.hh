@@ -18,6 +18,9 @@ void FromDevice_get_packet(u_char*, const struct pcap_pkthdr*, const u_char*);
 }
 #endif
 CLICK_DECLS
+#if FROMDEVICE_LINUX
+class PacketRing;
+#endif
 
 /*
 =title FromDevice.u
@@ -82,8 +85,49 @@ but the IP header annotation has been set appropriately.) Default is false.
 =item METHOD
 
 Word.  Defines the capture method FromDevice will use to read packets from the
-device.  Linux targets generally support PCAP and LINUX; other targets support
-only PCAP.  Defaults to PCAP.
+device.  Linux targets generally support PCAP, LINUX and RING; other targets
+support only PCAP.  Defaults to PCAP.
+
+RING reads a TPACKET_V3 ring of the packet socket, mapped into the process:
+the kernel fills a block of frames at a time and hands it over, and
+FromDevice walks the block and gives it back, with no copy and no syscall
+per packet.  See RING_BLOCK_SIZE, RING_BLOCKS, RING_TIMEOUT, FANOUT and
+ZERO_COPY.
+
+=item RING_BLOCK_SIZE
+
+Unsigned.  With METHOD RING, the size of a block, a multiple of the page
+size.  Defaults to 1MB.
+
+=item RING_BLOCKS
+
+Unsigned.  With METHOD RING, the number of blocks.  Defaults to 16.
+
+=item RING_TIMEOUT
+
+Unsigned.  With METHOD RING, the milliseconds the kernel waits before it
+hands over a block that is not full.  Defaults to 1.
+
+=item FANOUT
+
+Unsigned.  With METHOD RING, the packet fanout group of the socket, 0 for
+none.  The FromDevice elements on a device with the same FANOUT share its
+packets, typically one per thread (see StaticThreadSched).  Defaults to 0.
+
+=item FANOUT_MODE
+
+Word.  How the packets of a FANOUT group are shared: HASH (by flow), LB
+(round robin), CPU (by the CPU that received it) or QM (by the receive
+queue).  Defaults to HASH.
+
+=item ZERO_COPY
+
+Boolean.  With METHOD RING, the packets are made around the frames of the
+ring, and a block goes back to the kernel once all its packets are killed.
+Those packets must be killed on the thread of the FromDevice, which is what
+an element like TradeProcessor that parses them and passes on its own msgs
+does; held for long, they keep their blocks from the kernel.  If false, the
+frames are copied into packets of their own.  Defaults to true.
 
 =item BPF_FILTER
 
@@ -110,6 +154,7 @@ to roughly 28.
 =item BURST
 
 Integer. Maximum number of packets to read per scheduling. Defaults to 1.
+With METHOD RING, the maximum number of blocks walked per scheduling.
 
 =back
 
@@ -171,7 +216,7 @@ class FromDevice : public Element { public:
 #endif
 
 #if FROMDEVICE_LINUX
-    int linux_fd() const		{ return _capture == CAPTURE_LINUX ? _fd : -1; }
+    int linux_fd() const		{ return _capture == CAPTURE_LINUX || _capture == CAPTURE_RING ? _fd : -1; }
     static int open_packet_socket(String, ErrorHandler *);
     static int set_promiscuous(int, String, bool);
 #endif
@@ -185,6 +230,18 @@ class FromDevice : public Element { public:
 #endif
 #if FROMDEVICE_LINUX
     unsigned char *_linux_packetbuf;
+    PacketRing *_ring;
+    uint32_t _ring_block_size;
+    uint32_t _ring_blocks;
+    uint32_t _ring_timeout;
+    uint32_t _fanout;
+    int _fanout_mode;
+    bool _zero_copy;
+    uint64_t _ring_drops;
+
+    int initialize_ring(ErrorHandler *);
+    void push_frame(struct tpacket3_hdr *);
+    static void release_frame(unsigned char *, size_t);
 #endif
 #if FROMDEVICE_PCAP
     pcap_t *_pcap;
@@ -214,7 +271,7 @@ class FromDevice : public Element { public:
     int _was_promisc : 2;
     int _snaplen;
     unsigned _headroom;
-    enum { CAPTURE_PCAP, CAPTURE_LINUX };
+    enum { CAPTURE_PCAP, CAPTURE_LINUX, CAPTURE_RING };
     int _capture;
 #if FROMDEVICE_PCAP
     String _bpf_filter;
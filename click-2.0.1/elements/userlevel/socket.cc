@@ -24,6 +24,7 @@
 #include <click/standard/scheduleinfo.hh>
 #include <click/packet_anno.hh>
 #include <click/packet.hh>
+#include <click/straccum.hh>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
@@ -31,8 +32,20 @@
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
 #include <fcntl.h>
+#include <time.h>
+#include <sched.h>
+#ifdef __linux__
+# include <linux/sockios.h>
+#endif
+#include <click/symbol_filter.hh>
+#include <clicknet/udp.h>
 #include "socket.hh"
 
+// the kernel's receive timestamp of the last datagram, for LATENCY
+#if defined(SIOCGSTAMPNS) && defined(CLOCK_REALTIME)
+# define SOCKET_LATENCY 1
+#endif
+
 #ifdef HAVE_PROPER
 #include <proper/prop.h>
 #endif
@@ -45,8 +58,14 @@ Socket::Socket()
     _local_port(0), _local_pathname(""),
     _timestamp(true), _sndbuf(-1), _rcvbuf(-1),
     _snaplen(2048), _headroom(Packet::default_headroom), _nodelay(1),
-    _verbose(false), _client(false), _proper(false), _allow(0), _deny(0)
+    _verbose(false), _client(false), _proper(false), _allow(0), _deny(0),
+    _reuseport(false), _steer_sockets(0),
+    _busy_poll(false), _spin_usec(10000), _kernel_busy_poll(0), _cpu(-1),
+    _latency(false), _spinning(false), _pinned(false),
+    _polls(0), _empty_polls(0), _sleeps(0), _wakeups(0),
+    _latency_count(0), _latency_sum_ns(0), _latency_max_ns(0)
 {
+  memset(_latency_buckets, 0, sizeof(_latency_buckets));
 }
 
 Socket::~Socket()
@@ -76,6 +95,14 @@ Socket::configure(Vector<String> &conf, ErrorHandler *errh)
       .read("PROPER", _proper)
       .read("ALLOW", allow)
       .read("DENY", deny)
+      .read("SYMBOLS_ROUTING", _symbols_routing)
+      .read("REUSEPORT", _reuseport)
+      .read("STEER_SOCKETS", _steer_sockets)
+      .read("BUSY_POLL", _busy_poll)
+      .read("SPIN_USEC", _spin_usec)
+      .read("KERNEL_BUSY_POLL", _kernel_busy_poll)
+      .read("CPU", _cpu)
+      .read("LATENCY", _latency)
       .consume() < 0)
     return -1;
 
@@ -119,6 +146,17 @@ Socket::configure(Vector<String> &conf, ErrorHandler *errh)
   else
     return errh->error("unknown socket type `%s'", socktype.c_str());
 
+  if (_symbols_routing && _protocol != IPPROTO_UDP)
+    return errh->error("SYMBOLS_ROUTING needs a UDP socket");
+  if (_steer_sockets && (!_reuseport || _protocol != IPPROTO_UDP))
+    return errh->error("STEER_SOCKETS needs a UDP socket with REUSEPORT");
+  if (_busy_poll && (_socktype != SOCK_DGRAM || _client || !noutputs() || ninputs()))
+    return errh->error("BUSY_POLL needs a datagram server socket without inputs");
+#if !SOCKET_LATENCY
+  if (_latency)
+    return errh->error("LATENCY is not supported here, the kernel gives no SIOCGSTAMPNS");
+#endif
+
   return 0;
 }
 
@@ -172,8 +210,9 @@ Socket::initialize(ErrorHandler *errh)
       memcpy(_local.un.sun_path, _local_pathname.c_str(), _local_pathname.length());
   }
 
-  // enable timestamps
-  if (_timestamp) {
+  // enable timestamps; not with LATENCY, SO_TIMESTAMP hands the stamps
+  // to recvmsg() only and SIOCGSTAMPNS would find none
+  if (_timestamp && !_latency) {
 #ifdef SO_TIMESTAMP
     int one = 1;
     if (setsockopt(_fd, SOL_SOCKET, SO_TIMESTAMP, &one, sizeof(one)) < 0)
@@ -200,6 +239,45 @@ Socket::initialize(ErrorHandler *errh)
     if (setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &_rcvbuf, sizeof(_rcvbuf)) < 0)
       return initialize_socket_error(errh, "setsockopt(SO_RCVBUF)");
 
+#ifdef __linux__
+  // let the kernel drop the trade msgs of the other symbols, before
+  // bind() so that none gets through unfiltered
+  if (_symbols_routing) {
+    Vector<String> symbols;
+    Vector<struct sock_filter> prog;
+    SymbolBpf::routing_symbols(_symbols_routing, symbols);
+    if (!SymbolBpf::build(symbols, sizeof(click_udp) + 8, prog)) {
+      errno = E2BIG;		// too many symbols for one BPF program
+      return initialize_socket_error(errh, "SYMBOLS_ROUTING");
+    }
+    if (int err = SymbolBpf::attach(_fd, prog)) {
+      errno = err;
+      return initialize_socket_error(errh, "setsockopt(SO_ATTACH_FILTER)");
+    }
+  }
+#endif
+
+  // let the kernel poll the device queue in recv() for a while
+  if (_kernel_busy_poll > 0) {
+#ifdef SO_BUSY_POLL
+    if (setsockopt(_fd, SOL_SOCKET, SO_BUSY_POLL, &_kernel_busy_poll, sizeof(_kernel_busy_poll)) < 0)
+      return initialize_socket_error(errh, "setsockopt(SO_BUSY_POLL)");
+#else
+    return initialize_socket_error(errh, "KERNEL_BUSY_POLL not supported on this platform");
+#endif
+  }
+
+  // several sockets, one per thread, on the same port
+  if (_reuseport) {
+#ifdef SO_REUSEPORT
+    int one = 1;
+    if (setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+      return initialize_socket_error(errh, "setsockopt(SO_REUSEPORT)");
+#else
+    return initialize_socket_error(errh, "REUSEPORT not supported on this platform");
+#endif
+  }
+
   // if a server, then the first arguments should be interpreted as
   // the address/port/file to bind() to, not to connect() to
   if (!_client) {
@@ -223,6 +301,19 @@ Socket::initialize(ErrorHandler *errh)
       return initialize_socket_error(errh, "bind");
   }
 
+#ifdef __linux__
+  // after bind(), when the socket is in its group: the program is the
+  // group's, every socket of it attaches the same one
+  if (_steer_sockets) {
+    Vector<struct sock_filter> prog;
+    SymbolBpf::build_steering(_steer_sockets, 8, prog);
+    if (int err = SymbolBpf::attach(_fd, prog, SO_ATTACH_REUSEPORT_CBPF)) {
+      errno = err;
+      return initialize_socket_error(errh, "setsockopt(SO_ATTACH_REUSEPORT_CBPF)");
+    }
+  }
+#endif
+
   if (_client) {
     // connect
     if (_socktype == SOCK_STREAM) {
@@ -252,8 +343,15 @@ Socket::initialize(ErrorHandler *errh)
   fcntl(_fd, F_SETFL, O_NONBLOCK);
   fcntl(_fd, F_SETFD, FD_CLOEXEC);
 
-  if (noutputs())
-    add_select(_fd, SELECT_READ);
+  if (noutputs()) {
+    if (_busy_poll) {
+      // spin from the start, select() only once idle
+      ScheduleInfo::join_scheduler(this, &_task, errh);
+      _spinning = true;
+      _last_rx.assign_now();
+    } else
+      add_select(_fd, SELECT_READ);
+  }
 
   if (ninputs() && input_is_pull(0)) {
     ScheduleInfo::join_scheduler(this, &_task, errh);
@@ -318,7 +416,6 @@ Socket::close_active(void)
 void
 Socket::selected(int fd, int)
 {
-  int len;
   union { struct sockaddr_in in; struct sockaddr_un un; } from;
   socklen_t from_len = sizeof(from);
   bool allow;
@@ -359,62 +456,160 @@ Socket::selected(int fd, int)
       _events = SELECT_READ | SELECT_WRITE;
     }
 
+    // back from select() to spinning
+    if (_busy_poll && fd == _fd) {
+      remove_select(_fd, SELECT_READ);
+      _spinning = true;
+      _last_rx.assign_now();
+      _wakeups++;
+      _task.reschedule();
+    }
+
     // read data from socket
-    if (!_rq)
-      _rq = Packet::make(_headroom, 0, _snaplen, 0);
-    if (_rq) {
-      if (_socktype == SOCK_STREAM)
-	len = read(_active, _rq->data(), _rq->length());
-      else if (_client)
-	len = recv(_active, _rq->data(), _rq->length(), MSG_TRUNC);
-      else {
-	// datagram server, find out who we are talking to
-	len = recvfrom(_active, _rq->data(), _rq->length(), MSG_TRUNC, (struct sockaddr *)&from, &from_len);
-
-	if (_family == AF_INET && !allowed(IPAddress(from.in.sin_addr))) {
-	  if (_verbose)
-	    click_chatter("%s: dropped datagram from %s:%d", declaration().c_str(),
-			  IPAddress(from.in.sin_addr).unparse().c_str(), ntohs(from.in.sin_port));
-	  len = -1;
-	  errno = EAGAIN;
-	} else if (len > 0) {
-	  memcpy(&_remote, &from, from_len);
-	  _remote_len = from_len;
-	}
-      }
+    if (receive() < 0)
+      return;
+  }
 
-      // this segment OK
-      if (len > 0) {
-	if (len > _snaplen) {
-	  // truncate packet to max length (should never happen)
-	  assert(_rq->length() == (uint32_t)_snaplen);
-	  SET_EXTRA_LENGTH_ANNO(_rq, len - _snaplen);
-	} else {
-	  // trim packet to actual length
-	  _rq->take(_snaplen - len);
-	}
+  if (ninputs() && input_is_pull(0))
+    run_task(0);
+}
 
-	// set timestamp
-	if (_timestamp)
-	  _rq->timestamp_anno().assign_now();
+// 1 if a packet was pushed, 0 if there was none, -1 if the connection
+// has been closed
+int
+Socket::receive()
+{
+  int len;
+  union { struct sockaddr_in in; struct sockaddr_un un; } from;
+  socklen_t from_len = sizeof(from);
 
-	// push packet
-	output(0).push(_rq);
-	_rq = 0;
-      }
+  if (!_rq)
+    _rq = Packet::make(_headroom, 0, _snaplen, 0);
+  if (!_rq)
+    return 0;
 
-      // connection terminated or fatal error
-      else if (len == 0 || errno != EAGAIN) {
-	if (errno != EAGAIN && _verbose)
-	  click_chatter("%s: %s", declaration().c_str(), strerror(errno));
-	close_active();
-	return;
-      }
+  if (_socktype == SOCK_STREAM)
+    len = read(_active, _rq->data(), _rq->length());
+  else if (_client)
+    len = recv(_active, _rq->data(), _rq->length(), MSG_TRUNC);
+  else {
+    // datagram server, find out who we are talking to
+    len = recvfrom(_active, _rq->data(), _rq->length(), MSG_TRUNC, (struct sockaddr *)&from, &from_len);
+
+    if (_family == AF_INET && !allowed(IPAddress(from.in.sin_addr))) {
+      if (_verbose)
+	click_chatter("%s: dropped datagram from %s:%d", declaration().c_str(),
+		      IPAddress(from.in.sin_addr).unparse().c_str(), ntohs(from.in.sin_port));
+      len = -1;
+      errno = EAGAIN;
+    } else if (len > 0) {
+      memcpy(&_remote, &from, from_len);
+      _remote_len = from_len;
     }
   }
 
-  if (ninputs() && input_is_pull(0))
-    run_task(0);
+  // this segment OK
+  if (len > 0) {
+    if (len > _snaplen) {
+      // truncate packet to max length (should never happen)
+      assert(_rq->length() == (uint32_t)_snaplen);
+      SET_EXTRA_LENGTH_ANNO(_rq, len - _snaplen);
+    } else {
+      // trim packet to actual length
+      _rq->take(_snaplen - len);
+    }
+
+    // set timestamp
+    if (_timestamp)
+      _rq->timestamp_anno().assign_now();
+
+    if (_latency)
+      record_latency();
+
+    // push packet
+    output(0).push(_rq);
+    _rq = 0;
+    return 1;
+  }
+
+  // connection terminated or fatal error
+  else if (len == 0 || errno != EAGAIN) {
+    if (errno != EAGAIN && _verbose)
+      click_chatter("%s: %s", declaration().c_str(), strerror(errno));
+    close_active();
+    return -1;
+  }
+
+  return 0;
+}
+
+// from the kernel receiving the datagram to pushing it, which is where a
+// sleeping thread pays for its wakeup
+void
+Socket::record_latency()
+{
+#if SOCKET_LATENCY
+  struct timespec rx, now;
+  if (ioctl(_active, SIOCGSTAMPNS, &rx) < 0)
+    return;			// the first one only switches timestamping on
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  int64_t ns = (now.tv_sec - rx.tv_sec) * 1000000000LL + (now.tv_nsec - rx.tv_nsec);
+  if (ns < 0)
+    ns = 0;
+
+  _latency_count++;
+  _latency_sum_ns += ns;
+  if ((uint64_t) ns > _latency_max_ns)
+    _latency_max_ns = ns;
+
+  // < 1us, < 10us, < 100us, < 1ms, more
+  int bucket = 0;
+  for (int64_t limit = 1000; bucket < LATENCY_BUCKETS - 1 && ns >= limit; limit *= 10)
+    bucket++;
+  _latency_buckets[bucket]++;
+#endif
+}
+
+// the BUSY_POLL task: reads what there is, and goes back to select()
+// once nothing has come for SPIN_USEC
+bool
+Socket::run_poll()
+{
+  if (_cpu >= 0 && !_pinned) {
+#ifdef __linux__
+    // the thread this socket runs on, see StaticThreadSched
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(_cpu, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0)
+      click_chatter("%s: sched_setaffinity: %s", declaration().c_str(), strerror(errno));
+#endif
+    _pinned = true;
+  }
+
+  int n = 0;
+  while (n < POLL_BURST && receive() > 0)
+    n++;
+  _polls++;
+
+  if (n) {
+    _last_rx.assign_now();
+    _task.fast_reschedule();
+    return true;
+  }
+
+  // reading the clock every time would cost more than the poll
+  if ((++_empty_polls & 63) == 0
+      && (Timestamp::now() - _last_rx).usecval() >= _spin_usec) {
+    _spinning = false;
+    _sleeps++;
+    add_select(_fd, SELECT_READ);
+    return false;
+  }
+
+  _task.fast_reschedule();
+  return false;
 }
 
 int
@@ -497,6 +692,9 @@ Socket::push(int, Packet *p)
 bool
 Socket::run_task(Task *)
 {
+  if (_busy_poll)
+    return run_poll();
+
   assert(ninputs() && input_is_pull(0));
   bool any = false;
 
@@ -532,10 +730,51 @@ Socket::run_task(Task *)
   return any;
 }
 
+enum { H_POLL_STATS, H_LATENCY };
+
+String
+Socket::read_handler(Element *e, void *thunk)
+{
+  Socket *s = static_cast<Socket *>(e);
+  StringAccum sa;
+
+  switch ((intptr_t) thunk) {
+  case H_POLL_STATS:
+    sa << "spinning " << s->_spinning << '\n'
+       << "polls " << s->_polls << '\n'
+       << "empty_polls " << s->_empty_polls << '\n'
+       << "sleeps " << s->_sleeps << '\n'
+       << "wakeups " << s->_wakeups << '\n';
+    break;
+  case H_LATENCY: {
+    static const char * const names[LATENCY_BUCKETS] = { "<1us", "<10us", "<100us", "<1ms", ">=1ms" };
+    sa << "count " << s->_latency_count << '\n'
+       << "avg_ns " << (s->_latency_count ? s->_latency_sum_ns / s->_latency_count : 0) << '\n'
+       << "max_ns " << s->_latency_max_ns << '\n';
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+      sa << names[i] << ' ' << s->_latency_buckets[i] << '\n';
+    break;
+  }
+  }
+  return sa.take_string();
+}
+
+int
+Socket::reset_latency_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  Socket *s = static_cast<Socket *>(e);
+  memset(s->_latency_buckets, 0, sizeof(s->_latency_buckets));
+  s->_latency_count = s->_latency_sum_ns = s->_latency_max_ns = 0;
+  return 0;
+}
+
 void
 Socket::add_handlers()
 {
   add_task_handlers(&_task);
+  add_read_handler("poll_stats", read_handler, H_POLL_STATS);
+  add_read_handler("latency", read_handler, H_LATENCY);
+  add_write_handler("reset_latency", reset_latency_handler, 0, Handler::BUTTON);
 }
 
 CLICK_ENDDECLS
@@ -128,6 +128,63 @@ table, if specified, is checked first. Wildcard matches may be
 specified with netmasks; for example, to deny all hosts, specify a
 route to "0.0.0.0/0" in the DENY table.
 
+=item SYMBOLS_ROUTING
+
+String, the SYMBOLS_ROUTING of the TradeProcessor behind this UDP
+socket, "SYM PORT SYM PORT ...". If set, a socket filter is attached
+that accepts only the trade messages of these symbols, so the kernel
+drops the rest before they are copied to user space. Symbols added
+later through the TradeProcessor's add_symbol handler are not in the
+filter. Linux only.
+
+=item REUSEPORT
+
+Boolean. If set, the socket is bound with SO_REUSEPORT, so that several
+Socket elements, one per thread (see StaticThreadSched), can share the
+port. The kernel then spreads the datagrams over them by flow, so the
+throughput scales with the number of flows of the sender. Default is
+false.
+
+=item STEER_SOCKETS
+
+Unsigned integer, the number of sockets of a REUSEPORT group. If set,
+a reuseport BPF program picks the socket from a hash of the symbol of
+the trade message instead of the flow, so a symbol always goes to the
+same socket, and its state to the same thread, whatever flow it comes
+on. All the sockets of the group should have the same value. Linux
+only.
+
+=item BUSY_POLL
+
+Boolean. Datagram servers only. If set, the socket is read by a task
+that spins on non-blocking reads instead of waiting in select(), so a
+message does not pay for waking the thread up. The task goes back to
+select() once nothing has come for SPIN_USEC, and spins again from the
+next message on. Give the socket a thread of its own. Default is false.
+
+=item SPIN_USEC
+
+Unsigned integer. How long BUSY_POLL spins without a message before it
+sleeps in select(). Default is 10000.
+
+=item KERNEL_BUSY_POLL
+
+Integer. If set, SO_BUSY_POLL with this many microseconds, so that the
+kernel polls the device queue itself when the socket is read. Linux
+only, needs CAP_NET_ADMIN to raise it above the sysctl.
+
+=item CPU
+
+Integer. With BUSY_POLL, pins the thread running the socket to this
+CPU. Default is -1, not pinned.
+
+=item LATENCY
+
+Boolean. If set, measures for every packet the time from the kernel
+receiving it to the push, see the latency handler. Costs an ioctl per
+packet, and leaves SO_TIMESTAMP off. Needs SIOCGSTAMPNS (Linux), elsewhere
+it is an error. Default is false.
+
 =item VERBOSE
 
 Boolean. When true, Socket will print messages whenever it accepts a
@@ -167,6 +224,21 @@ Integer. Per-packet headroom. Defaults to 28.
   allow -> deny -> allow; // (makes the configuration valid)
   Socket(TCP, 0.0.0.0, 80, ALLOW allow, DENY deny) -> ...
 
+=h poll_stats read-only
+
+With BUSY_POLL, whether the task is spinning and the number of polls,
+empty polls, sleeps in select() and wakeups from it.
+
+=h latency read-only
+
+With LATENCY, the count, average and maximum of the kernel-to-push
+latency in nanoseconds, and how many were under 1us, 10us, 100us, 1ms
+and above.
+
+=h reset_latency write-only
+
+Clears the latency counters.
+
 =a RawSocket */
 
 class Socket : public Element { public:
@@ -188,6 +260,8 @@ class Socket : public Element { public:
   void add_handlers();
   bool run_task(Task *);
   void selected(int fd, int mask);
+
+  enum { POLL_BURST = 32, LATENCY_BUCKETS = 5 };
   void push(int port, Packet*);
 
   bool allowed(IPAddress);
@@ -238,8 +312,34 @@ private:
   bool _proper;			// (PlanetLab only) use Proper to bind port
   IPRouteTable *_allow;		// lookup table of good hosts
   IPRouteTable *_deny;		// lookup table of bad hosts
+  String _symbols_routing;	// symbols whose trade msgs pass the socket filter
+  bool _reuseport;		// bind with SO_REUSEPORT
+  uint32_t _steer_sockets;	// size of the group to steer by symbol, 0 - by flow
+
+  bool _busy_poll;		// read from a spinning task, not select()
+  uint32_t _spin_usec;		// idle time before going back to select()
+  int _kernel_busy_poll;	// SO_BUSY_POLL usecs
+  int _cpu;			// pin the thread with BUSY_POLL, -1 - don't
+  bool _latency;		// measure kernel-to-push latency
+  bool _spinning;
+  bool _pinned;
+  Timestamp _last_rx;		// last packet, or wakeup
+  uint64_t _polls;
+  uint64_t _empty_polls;
+  uint64_t _sleeps;
+  uint64_t _wakeups;
+  uint64_t _latency_count;
+  uint64_t _latency_sum_ns;
+  uint64_t _latency_max_ns;
+  uint64_t _latency_buckets[LATENCY_BUCKETS];
 
   int initialize_socket_error(ErrorHandler *, const char *);
+  int receive();
+  bool run_poll();
+  void record_latency();
+
+  static String read_handler(Element *, void *);
+  static int reset_latency_handler(const String &, Element *, void *, ErrorHandler *);
 
 };
 
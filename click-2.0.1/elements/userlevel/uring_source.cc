@@ -0,0 +1,232 @@
+/*
+ * uring_source.{cc,hh} -- a UDP socket read through io_uring
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packet.hh>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+CLICK_DECLS
+
+#include "uring_source.hh"
+
+UringSource::UringSource()
+  : _port       (0)
+  , _num_bufs   (1024)
+  , _buf_size   (2048)
+  , _zero_copy  (true)
+  , _burst      (64)
+  , _rcvbuf     (0)
+  , _debug      (false)
+  , _fd         (-1)
+  , _count      (0)
+{
+}
+
+UringSource::~UringSource()
+{
+}
+
+int
+UringSource::configure(Vector<String> &conf, ErrorHandler* errh)
+{
+  _addr = IPAddress ();
+  if (Args(conf, this, errh)
+        .read_mp ("PORT",       IPPortArg (IP_PROTO_UDP), _port)
+        .read    ("ADDR",       _addr)
+        .read    ("BUFFERS",    _num_bufs)
+        .read    ("BUF_SIZE",   _buf_size)
+        .read    ("ZERO_COPY",  _zero_copy)
+        .read    ("BURST",      _burst)
+        .read    ("RCVBUF",     _rcvbuf)
+        .read    ("DEBUG",      _debug)
+        .complete() < 0)
+  {
+    return -1;
+  }
+
+  if ((_num_bufs == 0) || (_num_bufs > 32768) || (_num_bufs & (_num_bufs - 1)))
+  {
+    return errh->error ("BUFFERS must be a power of 2, up to 32768");
+  }
+  if (_burst <= 0)
+  {
+    return errh->error ("BURST must be positive");
+  }
+
+  return 0;
+}
+
+int
+UringSource::initialize(ErrorHandler* errh)
+{
+  _fd = socket (AF_INET, SOCK_DGRAM, 0);
+  if (_fd < 0)
+  {
+    return errh->error ("socket: %s", strerror (errno));
+  }
+
+  if ((_rcvbuf > 0) && (setsockopt (_fd, SOL_SOCKET, SO_RCVBUF, &_rcvbuf, sizeof (_rcvbuf)) < 0))
+  {
+    return errh->error ("setsockopt(SO_RCVBUF): %s", strerror (errno));
+  }
+
+  struct sockaddr_in addr;
+  memset (&addr, '\0', sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port   = htons (_port);
+  addr.sin_addr   = _addr.in_addr ();
+  if (bind (_fd, (struct sockaddr*) &addr, sizeof (addr)) < 0)
+  {
+    return errh->error ("bind: %s", strerror (errno));
+  }
+
+  if (const int err = _uring.setup (_fd, _num_bufs, _buf_size, SLOT_HEADROOM))
+  {
+    return errh->error ("io_uring: %s", strerror (err));
+  }
+
+  add_select (_uring.fd (), SELECT_READ);
+
+  if (_debug)
+  {
+    click_chatter ("%s: io_uring on port %d, %u buffers of %u bytes", declaration ().c_str (),
+                   _port, _num_bufs, _buf_size);
+  }
+
+  return 0;
+}
+
+void
+UringSource::cleanup(CleanupStage)
+{
+  if (_uring.fd () >= 0)
+  {
+    remove_select (_uring.fd (), SELECT_READ);
+
+    // the packets still out must not come back to an element that is gone,
+    // and their slab stays mapped for them
+    const bool held = (_uring.held () > 0);
+    if (held)
+    {
+      for (uint32_t bid = 0; bid < _uring.num_bufs (); ++bid)
+      {
+        reinterpret_cast<SlotHeader*>(_uring.slot (bid))->_owner = 0;
+      }
+    }
+    _uring.close (held);
+  }
+
+  if (_fd >= 0)
+  {
+    close (_fd);
+    _fd = -1;
+  }
+}
+
+void
+UringSource::selected(int, int)
+{
+  _uring.drain (*this, _burst);
+}
+
+bool
+UringSource::operator() (char* data, const uint32_t len, const uint32_t bid)
+{
+  ++_count;
+
+  if (!_zero_copy)
+  {
+    if (WritablePacket* p = Packet::make (Packet::default_headroom, data, len, 0))
+    {
+      output (0).push (p);
+    }
+    return true;
+  }
+
+  SlotHeader* header = reinterpret_cast<SlotHeader*>(_uring.slot (bid));
+  header->_owner  = this;
+  header->_bid    = bid;
+
+  // the rest of the buffer is tailroom, the msg that replaces this one
+  // downstream is written in place too
+  WritablePacket* p = Packet::make (reinterpret_cast<unsigned char*>(data), _buf_size, release_buffer);
+  if (!p)
+  {
+    return true;
+  }
+  p->take (_buf_size - len);
+
+  // killing the packet gives the buffer back, maybe before push returns
+  output (0).push (p);
+  return false;
+}
+
+void
+UringSource::release_buffer(unsigned char* data, size_t)
+{
+  const SlotHeader* header = reinterpret_cast<const SlotHeader*>(
+    data - sizeof (struct io_uring_recvmsg_out) - SLOT_HEADROOM);
+
+  if (header->_owner)
+  {
+    header->_owner->_uring.release (header->_bid);
+  }
+}
+
+enum { H_COUNT, H_SYSCALLS, H_REARMS, H_NO_BUFFERS, H_TRUNCATED, H_HELD };
+
+String
+UringSource::read_handler(Element* e, void* thunk)
+{
+  UringSource* us = static_cast<UringSource*>(e);
+  switch ((intptr_t) thunk)
+  {
+    case H_COUNT:
+      return String (us->_count);
+    case H_SYSCALLS:
+      return String (us->_uring.syscalls ());
+    case H_REARMS:
+      return String (us->_uring.rearms ());
+    case H_NO_BUFFERS:
+      return String (us->_uring.no_bufs ());
+    case H_TRUNCATED:
+      return String (us->_uring.truncated ());
+    case H_HELD:
+      return String (us->_uring.held ());
+    default:
+      return String ();
+  }
+}
+
+void
+UringSource::add_handlers()
+{
+  add_read_handler ("count",      read_handler, H_COUNT);
+  add_read_handler ("syscalls",   read_handler, H_SYSCALLS);
+  add_read_handler ("rearms",     read_handler, H_REARMS);
+  add_read_handler ("no_buffers", read_handler, H_NO_BUFFERS);
+  add_read_handler ("truncated",  read_handler, H_TRUNCATED);
+  add_read_handler ("held",       read_handler, H_HELD);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel linux)
+EXPORT_ELEMENT(UringSource)
@@ -0,0 +1,86 @@
+#ifndef CLICK_URING_SOURCE_HH
+#define CLICK_URING_SOURCE_HH
+#include <click/element.hh>
+#include <click/string.hh>
+#include <click/ipaddress.hh>
+#include <click/uring_recv.hh>
+
+CLICK_DECLS
+
+/*
+ * UringSource(PORT, [ADDR 0.0.0.0, BUFFERS 1024, BUF_SIZE 2048,
+ *             ZERO_COPY true, BURST 64, RCVBUF 0, DEBUG false])
+ *
+ * A UDP server socket read through io_uring: one multishot recvmsg into
+ * a ring of BUFFERS provided buffers of BUF_SIZE, all in one slab, see
+ * UringRecv. While the msgs keep coming there is no syscall per msg, and
+ * when there are none the router sleeps in select on the ring fd. Every
+ * packet is the bare UDP payload, as from Socket with TIMESTAMP false, so
+ * a TradeProcessor behind it wants HEADER_LEN 0.
+ *
+ * With ZERO_COPY the packets are made around the slab buffers - the trade
+ * parser reads the msgs where the kernel put them, and a buffer goes back
+ * to the kernel when its packet is killed. That has to happen on the
+ * thread of the UringSource and before the router goes away, which is
+ * what a TradeProcessor straight behind it does. If the packets are
+ * queued or go to another thread, set ZERO_COPY false and they are copied
+ * out of the slab instead. When all the buffers are in use the msgs stay
+ * in the socket until one comes back.
+ *
+ * BURST is the most packets pushed per select wakeup.
+ *
+ * Handlers: count, syscalls, rearms, no_buffers, truncated, held.
+ */
+
+class UringSource : public Element
+{
+  public:
+    UringSource();
+    ~UringSource();
+
+    const char *class_name() const		{ return "UringSource"; }
+    const char *port_count() const		{ return PORTS_0_1; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void selected(int fd, int mask);
+
+    // called by UringRecv::drain
+    bool operator() (char* data, const uint32_t len, const uint32_t bid);
+
+  private:
+    // in the headroom of every slab buffer, for the packet destructor
+    struct SlotHeader
+    {
+      UringSource*  _owner;
+      uint32_t      _bid;
+    };
+
+    enum { SLOT_HEADROOM = 16 };
+
+    static void     release_buffer  (unsigned char* data, size_t len);
+    static String   read_handler    (Element*, void*);
+
+  private:
+    IPAddress         _addr;
+    uint16_t          _port;
+    uint32_t          _num_bufs;
+    uint32_t          _buf_size;
+    bool              _zero_copy;
+    int               _burst;
+    int               _rcvbuf;
+    bool              _debug;
+
+    int               _fd;
+    UringRecv         _uring;
+
+    uint64_t          _count;
+
+}; // class UringSource
+
+CLICK_ENDDECLS
+#endif
@@ -23,7 +23,22 @@ enum PacketAppType
   MSG_UPDATE,
   MSG_ADD,
   MSG_INIT,
-  MSG_INIT_SOURCE
+  MSG_INIT_SOURCE,
+  MSG_ADD_VECTOR,
+  MSG_UPDATE_VECTOR,
+  MSG_INIT_VECTOR
+};
+
+// which of the MsgSource fields have changed since the previous
+// source msg for the same symbol
+enum SourceField
+{
+  SOURCE_HIGH   = 0x01,
+  SOURCE_LOW    = 0x02,
+  SOURCE_OPEN   = 0x04,
+  SOURCE_CLOSE  = 0x08,
+  SOURCE_VOLUME = 0x10,
+  SOURCE_ALL    = 0x1F
 };
 
 struct MsgTrade
@@ -33,6 +48,7 @@ struct MsgTrade
     , _size           (0)
     , _timestamp      (0)
     , _src_timestamp  (0)
+    , _seq            (0)
   {
     memset (_symbol, '\0', sizeof(_symbol));
   }
@@ -42,6 +58,7 @@ struct MsgTrade
   char      _symbol[ORDER_SYMBOL_LEN];
   uint64_t  _timestamp;
   uint64_t  _src_timestamp;
+  uint64_t  _seq;           // of the feed, 0 if it is not sequenced
 
 }; // struct MsgTrade
 
@@ -88,11 +105,14 @@ struct MsgValue
   {
     _timestamp = 0;
 //    _volume    = 0;
+    _changed   = true;
   }
 
   FixedPt   _value;
 //  int64_t   _volume;
   uint64_t _timestamp;
+  // false if _value is the same as in the previous msg on this link
+  bool      _changed;
 }; // struct MsgValue
 
 // types: MSG_ADD_SOURCE, MSG_UPDATE_SOURCE
@@ -101,6 +121,7 @@ struct MsgSource
   MsgSource ()
     : _timestamp  (0)
     , _volume     (0)
+    , _dirty      (SOURCE_ALL)
   {
     _close  = fixedpt_fromint (0);
     _high   = fixedpt_fromint (0);
@@ -115,9 +136,37 @@ struct MsgSource
   uint64_t  _timestamp;
 
   int64_t   _volume; 
+
+  // a bitmask of SourceField values
+  uint8_t   _dirty;
 }; // struct MsgSource
 
 
+// types: MSG_ADD_VECTOR, MSG_UPDATE_VECTOR, MSG_INIT_VECTOR
+// several values of the same series, e.g. EWMAs with different periods
+struct MsgValueVector
+{
+  MsgValueVector ()
+    : _timestamp  (0)
+    , _count      (0)
+    , _changed    (true)
+  {
+    memset (_values, '\0', sizeof(_values));
+  }
+
+  // only the first _count values are sent
+  static size_t size_for (const size_t count)
+  {
+    return sizeof (MsgValueVector) - (VALUE_VECTOR_LEN - count) * sizeof (fixedpt);
+  }
+
+  uint64_t  _timestamp;
+  uint8_t   _count;
+  // false if all the values are the same as in the previous msg on this link
+  bool      _changed;
+  fixedpt   _values[VALUE_VECTOR_LEN];
+}; // struct MsgValueVector
+
 } // namespace Synapse
 
 #pragma pack()
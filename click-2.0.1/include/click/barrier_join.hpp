@@ -0,0 +1,175 @@
+// Copyright QUB 2019
+
+#ifndef BarrierJoinH
+#define BarrierJoinH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include "fixedpt_cpp.h"
+
+CLICK_DECLS
+
+/*
+  Joins the values that the input ports of an element receive for the
+  same timestamp. A round is complete when every port has delivered its
+  value, which is a single compare of a bitmask.
+
+  The values of a round are held back until it is complete, and up to
+  MAX_PENDING rounds can be open at a time, so the updates of two bars
+  that arrive interleaved are still joined correctly:
+    - a value older than the last completed round is late and ignored
+    - when a round completes, the older rounds that are still open
+      never will, they are dropped
+    - when all the slots are taken, the oldest open round is dropped
+*/
+class BarrierJoin
+{
+public:
+  enum { MAX_PORTS = 64, MAX_PENDING = 4 };
+
+  struct Round
+  {
+    uint64_t  _tstamp;
+    uint64_t  _arrived;   // bit per port
+    uint64_t  _temp;      // the port's value is an update
+    FixedPt*  _values;    // [num_ports]
+    bool      _used;
+  };
+
+  BarrierJoin (const int num_ports)
+    : _num_ports    (num_ports)
+    , _all_ports    ((num_ports >= MAX_PORTS) ? ~0ULL : ((1ULL << num_ports) - 1))
+    , _last_tstamp  (0)
+    , _late         (0)
+    , _dropped      (0)
+  {
+    for (int i = 0; i < MAX_PENDING; ++i)
+    {
+      _rounds[i]._values = new FixedPt [num_ports];
+    }
+    reset ();
+  }
+
+  ~BarrierJoin ()
+  {
+    for (int i = 0; i < MAX_PENDING; ++i)
+    {
+      delete [] _rounds[i]._values;
+    }
+  }
+
+  // the round the value has completed, NULL if it is still open.
+  // The round has to be released once its values have been used
+  Round*    add         (const FixedPt& value,
+                         const uint64_t tstamp,
+                         const int      port,
+                         const bool     temp);
+
+  void      release     (Round* round)  { round->_used = false; }
+
+  // forget the open rounds
+  void      reset       ()
+  {
+    for (int i = 0; i < MAX_PENDING; ++i)
+    {
+      _rounds[i]._used = false;
+    }
+  }
+
+  int       num_ports   () const { return _num_ports; }
+  uint64_t  last_tstamp () const { return _last_tstamp; }
+  void      set_last_tstamp (const uint64_t tstamp) { _last_tstamp = tstamp; }
+
+  uint64_t  late        () const { return _late; }
+  uint64_t  dropped     () const { return _dropped; }
+
+  static bool has_port  (const uint64_t mask, const int port) { return (mask >> port) & 1; }
+  static int  count     (const uint64_t mask) { return __builtin_popcountll (mask); }
+
+private:
+  BarrierJoin (const BarrierJoin& copy);
+  BarrierJoin& operator= (const BarrierJoin& rhs);
+
+  const int       _num_ports;
+  const uint64_t  _all_ports;
+  uint64_t        _last_tstamp;
+  uint64_t        _late;
+  uint64_t        _dropped;
+  Round           _rounds [MAX_PENDING];
+}; // class BarrierJoin
+
+inline BarrierJoin::Round* BarrierJoin::add (
+  const FixedPt& value,
+  const uint64_t tstamp,
+  const int      port,
+  const bool     temp)
+{
+  if ((tstamp <= _last_tstamp) && (_last_tstamp != 0))
+  {
+    ++_late;
+    return NULL;
+  }
+
+  Round* round  = NULL;
+  Round* free   = NULL;
+  Round* oldest = NULL;
+  for (int i = 0; i < MAX_PENDING; ++i)
+  {
+    Round& r = _rounds[i];
+    if (!r._used)
+    {
+      free = free ? free : &r;
+    }
+    else if (r._tstamp == tstamp)
+    {
+      round = &r;
+      break;
+    }
+    else if (!oldest || (r._tstamp < oldest->_tstamp))
+    {
+      oldest = &r;
+    }
+  }
+
+  if (!round)
+  {
+    if (!free)
+    {
+      ++_dropped;
+      free = oldest;
+    }
+    round           = free;
+    round->_tstamp  = tstamp;
+    round->_arrived = 0;
+    round->_temp    = 0;
+    round->_used    = true;
+  }
+
+  // a second value for the port replaces the first one
+  const uint64_t bit = 1ULL << port;
+  round->_values[port] = value;
+  round->_arrived     |= bit;
+  round->_temp         = temp ? (round->_temp | bit) : (round->_temp & ~bit);
+
+  if (round->_arrived != _all_ports)
+  {
+    return NULL;
+  }
+
+  for (int i = 0; i < MAX_PENDING; ++i)
+  {
+    Round& r = _rounds[i];
+    if (r._used && (r._tstamp < tstamp))
+    {
+      ++_dropped;
+      r._used = false;
+    }
+  }
+  _last_tstamp = tstamp;
+
+  return round;
+}
+
+CLICK_ENDDECLS
+
+#endif
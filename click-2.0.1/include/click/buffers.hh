@@ -7,6 +7,8 @@
 #include <click/glue.hh>
 #include "circ_array.hpp"
 #include "fixedpt_cpp.h"
+#include "checkpoint.hh"
+#include "barrier_join.hpp"
 
 CLICK_DECLS
 
@@ -30,6 +32,8 @@ public:
 
   RingBuffer& operator[]    (const int index);
   
+  // the values of a timestamp are only added to the buffers once
+  // all the ports have got theirs, see BarrierJoin
   void  add_new_value       (const FixedPt& value,
                              const uint64_t tstamp,
                              const int      port);
@@ -38,21 +42,39 @@ public:
                              const uint64_t tstamp,
                              const int      port);
 
-  bool  new_value_check     (const int port, const uint64_t tstamp);
-
+  // forgets the timestamps that are not complete yet
   void  reset               ();
 
-  bool  is_update_complete  () { return ((_state == ACCUMULATED) ||
-                                         (_state == ACCUMULATED_TEMP) ||
-                                         (_state == ACCUMULATED_TEMP_POP)); }
+  // true right after the value that completed a timestamp
+  bool  is_update_complete  () { return _complete; }
 
   int   get_num_ports       () { return _num_ports; }
 
+  // values older than the last complete timestamp and
+  // timestamps that never completed
+  uint64_t  get_late        () const { return _join.late (); }
+  uint64_t  get_dropped     () const { return _join.dropped (); }
+
+  // the restore fails, leaving the buffers as they are, if the number
+  // of ports or the buffer length is not the same as in the saved state
+  void  save_state          (StateWriter& writer);
+  bool  restore_state       (StateReader& reader);
+
+private:
+  bool  add_value           (const FixedPt& value,
+                             const uint64_t tstamp,
+                             const int      port,
+                             const bool     temp);
+
+  void  start_round         ();
+  void  push_value          (const FixedPt& value, const int port);
+  void  push_value_temp     (const FixedPt& value, const int port);
+
 private:
   RingBuffer**  _buffers;
-  char*         _updated;
   FixedPt*      _temp_updates;
-  uint64_t      _tstamp;
+  BarrierJoin   _join;
+  bool          _complete;
   const int     _num_ports;
   BufferStates  _state;
   const bool    _debug;
@@ -0,0 +1,150 @@
+// Copyright QUB 2019
+
+#ifndef Synapse_Checkpoint_H
+#define Synapse_Checkpoint_H
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#include "circ_array.hpp"
+#include "fixedpt_cpp.h"
+
+CLICK_DECLS
+
+/*
+  The state of an element as a flat little-endian byte string, used by
+  the Checkpoint element. Every element writes and reads its own fields
+  in its own order - the format of a record is private to its element.
+*/
+class StateWriter
+{
+public:
+  StateWriter (StringAccum& sa) : _sa (sa) {}
+
+  void write_bytes  (const void* data, const size_t len)
+  {
+    _sa.append (reinterpret_cast<const char*>(data), len);
+  }
+
+  void write_u8     (const uint8_t  value) { write_bytes (&value, sizeof (value)); }
+  void write_u32    (const uint32_t value) { write_bytes (&value, sizeof (value)); }
+  void write_u64    (const uint64_t value) { write_bytes (&value, sizeof (value)); }
+  void write_i64    (const int64_t  value) { write_bytes (&value, sizeof (value)); }
+  void write_bool   (const bool     value) { write_u8 (value ? 1 : 0); }
+
+  void write_fixedpt (const FixedPt& value)
+  {
+    write_i64  (value.getC ());
+    write_bool (const_cast<FixedPt&>(value).get_valid ());
+  }
+
+  // the front (newest) value first
+  void write_ring   (CircArray<FixedPt>& ring)
+  {
+    write_u32 (ring.capacity ());
+    write_u32 (ring.occupancy ());
+    for (size_t i = 0; i < ring.occupancy (); ++i)
+    {
+      write_fixedpt (ring[i]);
+    }
+  }
+
+private:
+  StringAccum& _sa;
+}; // class StateWriter
+
+/*
+  Reads what StateWriter wrote. Reading past the end does not crash, it
+  returns zeros and ok () becomes false.
+*/
+class StateReader
+{
+public:
+  StateReader (const char* data, const size_t len)
+    : _pos  (data)
+    , _end  (data + len)
+    , _ok   (true)
+  {}
+
+  bool ok         () const { return _ok; }
+  bool at_end     () const { return _pos == _end; }
+
+  bool read_bytes (void* data, const size_t len)
+  {
+    if ((size_t)(_end - _pos) < len)
+    {
+      memset (data, '\0', len);
+      _ok = false;
+      return false;
+    }
+    memcpy (data, _pos, len);
+    _pos += len;
+    return true;
+  }
+
+  uint8_t  read_u8   () { uint8_t  v; read_bytes (&v, sizeof (v)); return v; }
+  uint32_t read_u32  () { uint32_t v; read_bytes (&v, sizeof (v)); return v; }
+  uint64_t read_u64  () { uint64_t v; read_bytes (&v, sizeof (v)); return v; }
+  int64_t  read_i64  () { int64_t  v; read_bytes (&v, sizeof (v)); return v; }
+  bool     read_bool () { return read_u8 () != 0; }
+
+  FixedPt  read_fixedpt ()
+  {
+    FixedPt value = FixedPt::fromC (read_i64 ());
+    value.set_valid (read_bool ());
+    return value;
+  }
+
+  // the ring gets the capacity of the saved one
+  bool     read_ring (CircArray<FixedPt>& ring)
+  {
+    const uint32_t capacity  = read_u32 ();
+    const uint32_t occupancy = read_u32 ();
+    if (!_ok || (capacity == 0) || (occupancy > capacity))
+    {
+      _ok = false;
+      return false;
+    }
+
+    if (ring.capacity () != capacity)
+    {
+      ring = CircArray<FixedPt> (capacity);
+    }
+    while (!ring.empty ())
+    {
+      ring.pop_front ();
+    }
+    for (uint32_t i = 0; i < occupancy; ++i)
+    {
+      ring.push_back (read_fixedpt ());
+    }
+    return _ok;
+  }
+
+private:
+  const char* _pos;
+  const char* _end;
+  bool        _ok;
+}; // class StateReader
+
+/*
+  Implemented by the elements whose state the Checkpoint element saves.
+  They return it from Element::cast ("Checkpointable").
+
+  restore_state is called after all the elements have been initialized.
+  It should check everything that depends on the configuration (number of
+  ports, buffer sizes, ...) before changing anything, and return false if
+  the saved state does not fit - the element then starts from scratch.
+*/
+class Checkpointable
+{
+public:
+  virtual ~Checkpointable () {}
+
+  virtual void save_state    (StateWriter& writer)  = 0;
+  virtual bool restore_state (StateReader& reader)  = 0;
+}; // class Checkpointable
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,280 @@
+// Copyright QUB 2019
+
+#ifndef SynapseFeedJournalH
+#define SynapseFeedJournalH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/feed_seq.hh>
+#if CLICK_USERLEVEL
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+#endif
+
+CLICK_DECLS
+
+#if CLICK_USERLEVEL
+
+/*
+  The msgs of a sequenced feed kept on disk, to replay the ones that were
+  lost on the way. Either a text file with a msg per line, the way the
+  msgSender sends them with -s ("...|size|seq"), or a pcap capture of the
+  feed's ethernet frames, where a msg is the UDP payload past its 8 byte
+  timestamp. Someone else may still be appending to it.
+
+  refresh () indexes what has been added to the file since the last time:
+  the offset and length of every msg by its sequence number, 12 bytes a
+  msg. The numbers are taken to go up by one, a msg that is out of order
+  is left out. find () is then a lookup and a pread.
+
+  A refresh reads one chunk at most, so that it can be called between
+  packets: behind () says that there is more to index. The chunk grows
+  for a msg that does not fit in it, up to MAX_CHUNK, and a msg bigger
+  than that stops the indexing for good.
+*/
+class FeedJournal
+{
+public:
+  static const size_t CHUNK     = 4 << 20;
+  static const size_t MAX_CHUNK = 64 << 20;
+
+  FeedJournal ()
+    : _fd (-1), _pcap (false), _swapped (false), _indexed (0), _size (0)
+    , _chunk (NULL), _chunk_len (0), _too_big (false), _first_seq (0) {}
+
+  ~FeedJournal () { close (); }
+
+  // returns the errno
+  int open (const String& filename)
+  {
+    close ();
+    _fd = ::open (filename.c_str (), O_RDONLY);
+    if (_fd < 0)
+    {
+      return errno;
+    }
+
+    uint32_t magic = 0;
+    if (pread (_fd, &magic, sizeof (magic), 0) == sizeof (magic))
+    {
+      _pcap     = (magic == 0xa1b2c3d4) || (magic == 0xa1b23c4d) ||
+                  (magic == 0xd4c3b2a1) || (magic == 0x4d3cb2a1);
+      _swapped  = (magic == 0xd4c3b2a1) || (magic == 0x4d3cb2a1);
+    }
+    // past the global header of a pcap
+    _indexed = _pcap ? 24 : 0;
+    _size    = _indexed;
+    return 0;
+  }
+
+  void close ()
+  {
+    if (_fd >= 0)
+    {
+      ::close (_fd);
+      _fd = -1;
+    }
+    delete [] _chunk;
+    _chunk      = NULL;
+    _chunk_len  = 0;
+    _too_big    = false;
+    _entries.clear ();
+    _first_seq  = 0;
+  }
+
+  bool is_open () const { return _fd >= 0; }
+
+  // more has been appended than indexed, as of the last refresh
+  bool behind () const { return !_too_big && (_size > _indexed); }
+
+  /*
+    Indexes a chunk of what has been appended since the last call, returns
+    how many msgs. -1 when the msg at offset () does not fit in MAX_CHUNK,
+    nothing is indexed after that.
+  */
+  int refresh ()
+  {
+    struct stat st;
+    if ((_fd < 0) || _too_big || (fstat (_fd, &st) != 0))
+    {
+      return 0;
+    }
+    _size = st.st_size;
+    if (_size <= _indexed)
+    {
+      return 0;
+    }
+
+    if (!_chunk)
+    {
+      _chunk_len  = CHUNK;
+      _chunk      = new char [_chunk_len];
+    }
+
+    const int     before  = _entries.size ();
+    const size_t  len     = (_size - _indexed < _chunk_len) ? _size - _indexed : _chunk_len;
+    if (pread (_fd, _chunk, len, _indexed) != (ssize_t) len)
+    {
+      return 0;
+    }
+    // a msg that is not whole yet is indexed the next time
+    const size_t used = _pcap ? index_pcap (_chunk, len) : index_lines (_chunk, len);
+    _indexed += used;
+
+    if ((used == 0) && (len == _chunk_len))
+    {
+      // not even one msg in a full chunk
+      if (_chunk_len >= MAX_CHUNK)
+      {
+        _too_big = true;
+        return -1;
+      }
+      delete [] _chunk;
+      _chunk_len *= 2;
+      _chunk      = new char [_chunk_len];
+    }
+
+    return _entries.size () - before;
+  }
+
+  // the feed has started its numbering over: what has been indexed is
+  // forgotten, the indexing goes on from where it is up to
+  void restart ()
+  {
+    _entries.clear ();
+    _first_seq = 0;
+  }
+
+  // where the indexing is up to
+  uint64_t offset () const { return _indexed; }
+
+  // the text of msg seq, false if the journal does not have it
+  bool find (const uint64_t seq, String& msg) const
+  {
+    if ((seq < _first_seq) || (seq - _first_seq >= (uint64_t) _entries.size ()))
+    {
+      return false;
+    }
+    const Entry& entry = _entries[seq - _first_seq];
+    if (entry._len == 0)
+    {
+      return false;
+    }
+
+    msg = String::make_garbage (entry._len);
+    char* buf = msg.mutable_data ();
+    return buf && (pread (_fd, buf, entry._len, entry._offset) == (ssize_t) entry._len);
+  }
+
+  uint64_t  first_seq () const { return _first_seq; }
+  uint64_t  last_seq  () const { return _entries.empty () ? 0 : _first_seq + _entries.size () - 1; }
+
+private:
+  FeedJournal (const FeedJournal&);
+  FeedJournal& operator= (const FeedJournal&);
+
+  struct Entry
+  {
+    uint64_t  _offset;
+    uint32_t  _len;
+  } __attribute__ ((packed));
+
+  void add (const uint64_t seq, const uint64_t offset, const uint32_t len)
+  {
+    if (_entries.empty ())
+    {
+      _first_seq = seq;
+    }
+    else if (seq <= last_seq ())
+    {
+      return;
+    }
+
+    // the numbers the journal missed itself are left empty
+    Entry empty = { 0, 0 };
+    while (_first_seq + _entries.size () < seq)
+    {
+      _entries.push_back (empty);
+    }
+    Entry entry = { offset, len };
+    _entries.push_back (entry);
+  }
+
+  // whole lines only, the last one may still be being written
+  size_t index_lines (const char* data, const size_t len)
+  {
+    size_t start = 0;
+    for (const char* nl; (nl = static_cast<const char*>(memchr (data + start, '\n', len - start))); )
+    {
+      size_t line_len = nl - data - start;
+      if ((line_len > 0) && (data[start + line_len - 1] == '\r'))
+      {
+        --line_len;
+      }
+
+      uint64_t seq;
+      if (locate_feed_seq (data + start, line_len, seq))
+      {
+        add (seq, _indexed + start, line_len);
+      }
+      start = nl - data + 1;
+    }
+    return start;
+  }
+
+  // whole records only, ethernet + IPv4 + UDP
+  size_t index_pcap (const char* data, const size_t len)
+  {
+    size_t start = 0;
+    while (start + 16 <= len)
+    {
+      uint32_t caplen;
+      memcpy (&caplen, data + start + 8, sizeof (caplen));
+      if (_swapped)
+      {
+        caplen = __builtin_bswap32 (caplen);
+      }
+      if (start + 16 + caplen > len)
+      {
+        break;
+      }
+
+      const unsigned char* frame = reinterpret_cast<const unsigned char*>(data + start + 16);
+      if ((caplen > 14 + 20) && (frame[12] == 0x08) && (frame[13] == 0x00) && (frame[14 + 9] == 17))
+      {
+        const size_t payload = 14 + (frame[14] & 0x0f) * 4 + 8 + 8;
+        uint64_t     seq;
+        if ((caplen > payload) &&
+              locate_feed_seq (reinterpret_cast<const char*>(frame + payload), caplen - payload, seq))
+        {
+          add (seq, _indexed + start + 16 + payload, caplen - payload);
+        }
+      }
+      start += 16 + caplen;
+    }
+    return start;
+  }
+
+private:
+  int             _fd;
+  bool            _pcap;
+  bool            _swapped;
+  uint64_t        _indexed;     // the file offset indexed up to
+  uint64_t        _size;        // of the file at the last refresh
+  char*           _chunk;
+  size_t          _chunk_len;
+  bool            _too_big;     // a msg bigger than MAX_CHUNK
+
+  uint64_t        _first_seq;
+  Vector<Entry>   _entries;
+}; // class FeedJournal
+
+#endif
+
+CLICK_ENDDECLS
+
+#endif
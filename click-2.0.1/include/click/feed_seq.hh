@@ -0,0 +1,165 @@
+// Copyright QUB 2019
+
+#ifndef SynapseFeedSeqH
+#define SynapseFeedSeqH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/*
+  The sequence number of a trade msg of a sequenced feed,
+  "type|delta|SYMBOL|price|size|seq". The feed numbers its msgs one after
+  the other, and every line of a redundant feed sends the same msg under
+  the same number. It is the last field, so it is read backwards from the
+  end of the msg and nothing else is looked at. Only for a feed that is
+  known to be sequenced - the size of a plain msg would be taken for it.
+*/
+inline bool locate_feed_seq (
+  const char*   md_msg,
+  const size_t  md_len,
+  uint64_t&     seq)
+{
+  const char* end = md_msg + md_len;
+  const char* p   = end;
+  while ((p > md_msg) && (p[-1] >= '0') && (p[-1] <= '9'))
+  {
+    --p;
+  }
+  if ((p == end) || (end - p > 19) || (p == md_msg) || (p[-1] != '|'))
+  {
+    return false;
+  }
+
+  seq = 0;
+  for (; p < end; ++p)
+  {
+    seq = seq * 10 + (*p - '0');
+  }
+  return true;
+}
+
+/*
+  The last SIZE sequence numbers of a feed as a bitmap, a bit per number
+  and SIZE / 8 bytes in all. check () tells a number that moves the
+  window up from one that fills a hole behind the highest, a copy of one
+  already seen and one that is too old to tell. A number that drops out
+  of the window without having been seen is a gap - it was lost on every
+  line. What came before the first number is taken as seen.
+*/
+class SeqWindow
+{
+public:
+  enum Result { SEQ_NEW, SEQ_LATE, SEQ_DUPLICATE, SEQ_STALE };
+
+  SeqWindow () : _size (0), _mask (0), _highest (0), _started (false), _gaps (0) {}
+
+  // size a power of 2, at least 64
+  void configure (const uint32_t size)
+  {
+    _size = size;
+    _mask = size - 1;
+    _bits.assign (size / 64, 0);
+    reset ();
+  }
+
+  void reset ()
+  {
+    for (int i = 0; i < _bits.size (); ++i)
+    {
+      _bits[i] = ~(uint64_t) 0;
+    }
+    _highest  = 0;
+    _started  = false;
+    _gaps     = 0;
+  }
+
+  // marks seq as seen
+  Result check (const uint64_t seq)
+  {
+    if (!_started)
+    {
+      _started = true;
+      _highest = seq;
+      return SEQ_NEW;
+    }
+    if (seq > _highest)
+    {
+      advance (seq);
+      set (seq);
+      return SEQ_NEW;
+    }
+    if (_highest - seq >= _size)
+    {
+      return SEQ_STALE;
+    }
+    if (test (seq))
+    {
+      return SEQ_DUPLICATE;
+    }
+    set (seq);
+    return SEQ_LATE;
+  }
+
+  // where the per number data of seq goes, for as long as it is in the window
+  uint32_t  slot      (const uint64_t seq) const { return seq & _mask; }
+
+  uint32_t  size      () const { return _size; }
+  uint64_t  highest   () const { return _highest; }
+  uint64_t  gaps      () const { return _gaps; }
+
+  // the holes behind the highest that may still be filled
+  uint32_t  missing   () const
+  {
+    uint32_t seen = 0;
+    for (int i = 0; i < _bits.size (); ++i)
+    {
+      seen += __builtin_popcountll (_bits[i]);
+    }
+    return _size - seen;
+  }
+
+private:
+  bool test  (const uint64_t seq) const { return (_bits[slot (seq) >> 6] >> (seq & 63)) & 1; }
+  void set   (const uint64_t seq)       { _bits[slot (seq) >> 6] |=  ((uint64_t) 1 << (seq & 63)); }
+  void clear (const uint64_t seq)       { _bits[slot (seq) >> 6] &= ~((uint64_t) 1 << (seq & 63)); }
+
+  // the window moves up to seq, the slot of every number that comes in
+  // is the one of the number that drops out
+  void advance (const uint64_t seq)
+  {
+    const uint64_t distance = seq - _highest;
+    if (distance >= _size)
+    {
+      // the whole window drops out, and whatever was jumped over
+      _gaps += (distance - _size) + missing ();
+      for (int i = 0; i < _bits.size (); ++i)
+      {
+        _bits[i] = 0;
+      }
+    }
+    else
+    {
+      for (uint64_t s = _highest + 1; s <= seq; ++s)
+      {
+        _gaps += !test (s);
+        clear (s);
+      }
+    }
+    _highest = seq;
+  }
+
+private:
+  uint32_t          _size;
+  uint32_t          _mask;
+  uint64_t          _highest;
+  bool              _started;
+  uint64_t          _gaps;
+  Vector<uint64_t>  _bits;
+}; // class SeqWindow
+
+CLICK_ENDDECLS
+
+#endif
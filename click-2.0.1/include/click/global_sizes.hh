@@ -8,6 +8,8 @@ namespace Synapse
 
 const size_t ORDER_SYMBOL_LEN = 10;
 
+const size_t VALUE_VECTOR_LEN = 32;
+
 } // namespace Synapse
 
 #endif
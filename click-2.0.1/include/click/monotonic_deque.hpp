@@ -0,0 +1,180 @@
+// Copyright QUB 2019
+
+#ifndef MonotonicDequeH
+#define MonotonicDequeH
+
+#include <click/config.h>
+#include <click/glue.hh>
+
+CLICK_DECLS
+
+/*
+  Keeps the position of the maximum (IsMax == true) or the minimum of
+  a sliding window. Values are pushed with increasing indices, the ones
+  that can never become the extreme again are dropped straight away, so
+  the front is always the extreme of the window. Both push and expire
+  are amortised O(1).
+
+  Of two equal values the newer one is kept.
+
+  T needs operator> and operator< only (e.g. FixedPt).
+*/
+template<typename T, bool IsMax>
+class MonotonicDeque
+{
+public:
+  MonotonicDeque ();
+  ~MonotonicDeque ();
+
+  MonotonicDeque (const MonotonicDeque& copy);
+  MonotonicDeque& operator= (const MonotonicDeque& rhs);
+
+  // the longest window that will be kept, i.e. the number of entries
+  void      set_capacity  (const size_t capacity);
+
+  void      clear         () { _start = 0; _size = 0; }
+
+  // drops the entries with an index lower than min_index
+  void      expire        (const uint64_t min_index);
+
+  // the index has to be higher than the index of any previous push
+  void      push          (const T& value, const uint64_t index);
+
+  bool      empty         () const { return _size == 0; }
+
+  const T&  front_value   () const { return _values[_start]; }
+
+  uint64_t  front_index   () const { return _indices[_start]; }
+
+  // the entries from the front (oldest), e.g. to save them and push
+  // them again in the same order later
+  size_t    size          () const { return _size; }
+
+  const T&  value_at      (const size_t i) const { return _values[(_start + i) % _capacity]; }
+
+  uint64_t  index_at      (const size_t i) const { return _indices[(_start + i) % _capacity]; }
+
+private:
+  // true if the newer value makes the older one irrelevant
+  bool      dominates     (const T& newer, const T& older) const
+  {
+    return IsMax ? !(older > newer) : !(older < newer);
+  }
+
+  size_t    back_pos      () const { return (_start + _size - 1) % _capacity; }
+
+  void      deep_copy     (const MonotonicDeque& rhs);
+
+private:
+  T*        _values;
+  uint64_t* _indices;
+
+  size_t    _start;
+  size_t    _size;
+  size_t    _capacity;
+}; // class MonotonicDeque
+
+template<typename T, bool IsMax>
+MonotonicDeque<T, IsMax>::MonotonicDeque ()
+  : _values   (NULL)
+  , _indices  (NULL)
+  , _start    (0)
+  , _size     (0)
+  , _capacity (0)
+{
+}
+
+template<typename T, bool IsMax>
+MonotonicDeque<T, IsMax>::~MonotonicDeque ()
+{
+  delete [] _values;
+  delete [] _indices;
+}
+
+template<typename T, bool IsMax>
+MonotonicDeque<T, IsMax>::MonotonicDeque (const MonotonicDeque& copy)
+  : _values   (NULL)
+  , _indices  (NULL)
+  , _start    (0)
+  , _size     (0)
+  , _capacity (0)
+{
+  deep_copy (copy);
+}
+
+template<typename T, bool IsMax>
+MonotonicDeque<T, IsMax>& MonotonicDeque<T, IsMax>::operator= (const MonotonicDeque& rhs)
+{
+  if (this != &rhs)
+  {
+    deep_copy (rhs);
+  }
+  return *this;
+}
+
+template<typename T, bool IsMax>
+void MonotonicDeque<T, IsMax>::deep_copy (const MonotonicDeque& rhs)
+{
+  if (_capacity != rhs._capacity)
+  {
+    set_capacity (rhs._capacity);
+  }
+  _start = 0;
+  _size  = rhs._size;
+  for (size_t i = 0; i < rhs._size; ++i)
+  {
+    const size_t pos = (rhs._start + i) % rhs._capacity;
+    _values[i]  = rhs._values[pos];
+    _indices[i] = rhs._indices[pos];
+  }
+}
+
+template<typename T, bool IsMax>
+void MonotonicDeque<T, IsMax>::set_capacity (const size_t capacity)
+{
+  delete [] _values;
+  delete [] _indices;
+
+  _values   = (capacity > 0) ? new T [capacity]        : NULL;
+  _indices  = (capacity > 0) ? new uint64_t [capacity] : NULL;
+  _capacity = capacity;
+
+  clear ();
+}
+
+template<typename T, bool IsMax>
+void MonotonicDeque<T, IsMax>::expire (const uint64_t min_index)
+{
+  while ((_size > 0) && (_indices[_start] < min_index))
+  {
+    _start = (_start + 1) % _capacity;
+    --_size;
+  }
+}
+
+template<typename T, bool IsMax>
+void MonotonicDeque<T, IsMax>::push (const T& value, const uint64_t index)
+{
+  assert (_capacity > 0);
+
+  while ((_size > 0) && dominates (value, _values[back_pos ()]))
+  {
+    --_size;
+  }
+
+  // the caller should have expired the old entries, but never overflow
+  if (_size == _capacity)
+  {
+    _start = (_start + 1) % _capacity;
+    --_size;
+  }
+
+  const size_t pos = (_start + _size) % _capacity;
+  _values[pos]  = value;
+  _indices[pos] = index;
+  ++_size;
+}
+
+CLICK_ENDDECLS
+
+#endif
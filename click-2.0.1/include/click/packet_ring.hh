@@ -0,0 +1,294 @@
+// Copyright QUB 2019
+
+#ifndef SynapsePacketRingH
+#define SynapsePacketRingH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/vector.hh>
+#if CLICK_USERLEVEL && defined(__linux__)
+# include <errno.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <linux/if_packet.h>
+#endif
+
+CLICK_DECLS
+
+#if CLICK_USERLEVEL && defined(__linux__)
+
+/*
+  The TPACKET_V3 receive ring of a packet socket: BLOCKS blocks of
+  BLOCK_SIZE, mapped once, that the kernel fills with frames and hands
+  over a block at a time. A block goes back to the kernel by setting its
+  status, there is no syscall per packet or per block. Include this
+  instead of <netpacket/packet.h>, which clashes with <linux/if_packet.h>.
+
+  The frames can be used in place. Whoever keeps a frame after the walk
+  has gone past it calls hold (frame) and later PacketRing::release
+  (frame), and its block goes back to the kernel once the walk is done
+  with it and nothing holds any of its frames any more - so blocks are
+  released in bulk. All of that has to happen on one thread. While a
+  block is held the kernel fills the others, and drops once it comes
+  round to it again.
+
+  An owner that goes away while frames are still held retires the ring
+  instead of deleting it, and the release of the last of them deletes it.
+*/
+class PacketRing
+{
+public:
+  PacketRing ()
+    : _fd (-1), _ring (0), _ring_len (0), _block_size (0), _num_blocks (0)
+    , _block (0), _next (0), _left (0), _blocks_walked (0), _retired (false)
+  {}
+
+  ~PacketRing () { close (); }
+
+  /*
+    Sets the ring up on a packet socket, before it is bound or after.
+    block_size a multiple of the page size, frame_size the largest frame,
+    timeout_ms how long the kernel waits before it hands over a block
+    that is not full. Returns the errno.
+  */
+  int setup (const int       fd,
+             const uint32_t  block_size,
+             const uint32_t  num_blocks,
+             const uint32_t  frame_size,
+             const uint32_t  timeout_ms)
+  {
+    const int version = TPACKET_V3;
+    if (setsockopt (fd, SOL_PACKET, PACKET_VERSION, &version, sizeof (version)) < 0)
+    {
+      return errno;
+    }
+
+    struct tpacket_req3 req;
+    memset (&req, '\0', sizeof (req));
+    req.tp_block_size       = block_size;
+    req.tp_block_nr         = num_blocks;
+    req.tp_frame_size       = frame_size;
+    req.tp_frame_nr         = (block_size / frame_size) * num_blocks;
+    req.tp_retire_blk_tov   = timeout_ms;
+    if (setsockopt (fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req)) < 0)
+    {
+      return errno;
+    }
+
+    _ring_len = (size_t) block_size * num_blocks;
+    void* mem = mmap (0, _ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+      // MAP_LOCKED needs the memlock limit
+      mem = mmap (0, _ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mem == MAP_FAILED)
+    {
+      return errno;
+    }
+
+    _fd         = fd;
+    _ring       = static_cast<char*>(mem);
+    _block_size = block_size;
+    _num_blocks = num_blocks;
+    _holds.assign (num_blocks, 0);
+    _walking.assign (num_blocks, 0);
+    _block      = 0;
+    _left       = 0;
+
+    rings ().push_back (this);
+    return 0;
+  }
+
+  void close ()
+  {
+    if (!_ring)
+    {
+      return;
+    }
+    Vector<PacketRing*>& all = rings ();
+    for (int i = 0; i < all.size (); ++i)
+    {
+      if (all[i] == this)
+      {
+        all[i] = all.back ();
+        all.pop_back ();
+        break;
+      }
+    }
+    munmap (_ring, _ring_len);
+    _ring = 0;
+    _fd   = -1;
+  }
+
+  /*
+    The next frame the kernel has handed over, 0 if there is none. The
+    walk goes through a block before it looks at the next one. A frame is
+    valid until the next call or finish (), unless it is held.
+  */
+  struct tpacket3_hdr* next_frame ()
+  {
+    if (_left == 0)
+    {
+      finish ();
+
+      struct tpacket_block_desc* desc = block_desc (_block);
+      if (!(__atomic_load_n (&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+      {
+        return 0;
+      }
+      _walking[_block]  = 1;
+      _left             = desc->hdr.bh1.num_pkts;
+      _next             = reinterpret_cast<char*>(desc) + desc->hdr.bh1.offset_to_first_pkt;
+      if (_left == 0)
+      {
+        // a block that timed out empty
+        finish ();
+        return 0;
+      }
+    }
+
+    struct tpacket3_hdr* frame = reinterpret_cast<struct tpacket3_hdr*>(_next);
+    _next += frame->tp_next_offset;
+    --_left;
+    return frame;
+  }
+
+  // the walk is done with the frames it has had, a block that has been
+  // gone through goes back unless it is held
+  void finish ()
+  {
+    if ((_left == 0) && _walking[_block])
+    {
+      _walking[_block] = 0;
+      ++_blocks_walked;
+      if (_holds[_block] == 0)
+      {
+        give_back (_block);
+      }
+      _block = (_block + 1) % _num_blocks;
+    }
+  }
+
+  // the data of a frame, and its sockaddr_ll
+  static unsigned char* frame_data (struct tpacket3_hdr* frame)
+  {
+    return reinterpret_cast<unsigned char*>(frame) + frame->tp_mac;
+  }
+
+  static const struct sockaddr_ll* frame_addr (const struct tpacket3_hdr* frame)
+  {
+    return reinterpret_cast<const struct sockaddr_ll*>(
+      reinterpret_cast<const char*>(frame) + TPACKET_ALIGN (sizeof (struct tpacket3_hdr)));
+  }
+
+  // anything inside the ring: a frame, its data
+  void hold (const void* p)
+  {
+    ++_holds[block_index (p)];
+  }
+
+  // a held frame of whatever ring it is in is not used any more
+  static void release (const void* p)
+  {
+    Vector<PacketRing*>& all = rings ();
+    for (int i = 0; i < all.size (); ++i)
+    {
+      if (all[i]->contains (p))
+      {
+        all[i]->unhold (all[i]->block_index (p));
+        return;
+      }
+    }
+  }
+
+  // deletes a ring made with new now, or once its last held frame is
+  // released
+  static void retire (PacketRing* ring)
+  {
+    if (ring->held_blocks () == 0)
+    {
+      delete ring;
+      return;
+    }
+    ring->_retired = true;
+  }
+
+  int       fd            () const { return _fd; }
+  uint64_t  blocks_walked () const { return _blocks_walked; }
+
+  uint32_t  held_blocks   () const
+  {
+    uint32_t held = 0;
+    for (uint32_t b = 0; b < _num_blocks; ++b)
+    {
+      held += (_holds[b] > 0);
+    }
+    return held;
+  }
+
+private:
+  // the rings of the process, for release
+  static Vector<PacketRing*>& rings ()
+  {
+    static Vector<PacketRing*> all;
+    return all;
+  }
+
+  struct tpacket_block_desc* block_desc (const uint32_t b) const
+  {
+    return reinterpret_cast<struct tpacket_block_desc*>(_ring + (size_t) b * _block_size);
+  }
+
+  bool      contains    (const void* p) const
+  {
+    return (static_cast<const char*>(p) >= _ring) && (static_cast<const char*>(p) < _ring + _ring_len);
+  }
+
+  uint32_t  block_index (const void* p) const
+  {
+    return (static_cast<const char*>(p) - _ring) / _block_size;
+  }
+
+  void unhold (const uint32_t b)
+  {
+    if ((--_holds[b] == 0) && !_walking[b])
+    {
+      give_back (b);
+    }
+    if (_retired && (held_blocks () == 0))
+    {
+      delete this;
+    }
+  }
+
+  void give_back (const uint32_t b)
+  {
+    __atomic_store_n (&block_desc (b)->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+  }
+
+private:
+  int               _fd;
+  char*             _ring;
+  size_t            _ring_len;
+  uint32_t          _block_size;
+  uint32_t          _num_blocks;
+
+  // the walk
+  uint32_t          _block;
+  char*             _next;
+  uint32_t          _left;
+  uint64_t          _blocks_walked;
+
+  // per block, the frames held and whether the walk is still in it
+  Vector<uint32_t>  _holds;
+  Vector<uint8_t>   _walking;
+
+  bool              _retired;   // the owner has gone, the last release deletes it
+}; // class PacketRing
+
+#endif
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,159 @@
+// Copyright QUB 2019
+
+#ifndef RcuPointerH
+#define RcuPointerH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/sync.hh>
+#if CLICK_USERLEVEL
+# include <sched.h>
+#endif
+
+CLICK_DECLS
+
+/*
+  A pointer to a table that the data path reads without locks while a
+  handler replaces it, RCU style: the writer copies the current table,
+  changes the copy, publishes it and frees the old one once no reader can
+  still be using it.
+
+  Every Click thread has its counters on a cache line of its own, one
+  pair per epoch: read_lock counts the reader in for the current epoch
+  and read_unlock counts it out. To publish, the writer starts a new
+  epoch and waits until the readers of the previous one have all left,
+  twice, so that both epochs have been empty after the table changed;
+  the new readers already see the new table. Threads whose ids share a
+  slot just share the counters, which keeps it correct, only a bit
+  slower.
+
+  The readers must not keep the table after read_unlock.
+*/
+template<typename T>
+class RcuPointer
+{
+public:
+  enum { MAX_SLOTS = 64 };
+
+  RcuPointer  (T* initial = NULL);
+  ~RcuPointer ();
+
+  // data path, epoch has to be passed from read_lock to read_unlock
+  const T*  read_lock     (int& epoch);
+  void      read_unlock   (const int epoch);
+
+  // writers - between write_lock and write_unlock current () can be
+  // copied and the copy published, publish takes ownership of it
+  void      write_lock    () { _writer_lock.acquire (); }
+  void      write_unlock  () { _writer_lock.release (); }
+  const T*  current       () const { return _ptr; }
+  void      publish       (T* next);
+
+private:
+  RcuPointer (const RcuPointer& copy);
+  RcuPointer& operator= (const RcuPointer& rhs);
+
+  struct Slot
+  {
+    uint64_t  _entered [2];
+    uint64_t  _left    [2];
+    char      _pad [64 - 4 * sizeof (uint64_t)];
+  };
+
+  Slot&     my_slot       ();
+  void      wait_for_readers (const int epoch);
+  void      synchronize   ();
+
+private:
+  Slot      _slots [MAX_SLOTS];
+  T*        _ptr;
+  uint32_t  _epoch;
+  Spinlock  _writer_lock;
+}; // class RcuPointer
+
+template<typename T>
+RcuPointer<T>::RcuPointer (T* initial)
+  : _ptr   (initial)
+  , _epoch (0)
+{
+  memset (_slots, '\0', sizeof (_slots));
+}
+
+template<typename T>
+RcuPointer<T>::~RcuPointer ()
+{
+  delete _ptr;
+}
+
+template<typename T>
+typename RcuPointer<T>::Slot& RcuPointer<T>::my_slot ()
+{
+#if CLICK_USERLEVEL && HAVE_MULTITHREAD && HAVE___THREAD_STORAGE_CLASS
+  return _slots [((unsigned) click_current_thread_id) % MAX_SLOTS];
+#else
+  return _slots [0];
+#endif
+}
+
+template<typename T>
+const T* RcuPointer<T>::read_lock (int& epoch)
+{
+  epoch = __atomic_load_n (&_epoch, __ATOMIC_ACQUIRE) & 1;
+  // a full barrier, the table must not be loaded before we are counted in
+  __atomic_add_fetch (&my_slot ()._entered[epoch], 1, __ATOMIC_SEQ_CST);
+  return __atomic_load_n (&_ptr, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+void RcuPointer<T>::read_unlock (const int epoch)
+{
+  __atomic_add_fetch (&my_slot ()._left[epoch], 1, __ATOMIC_RELEASE);
+}
+
+template<typename T>
+void RcuPointer<T>::wait_for_readers (const int epoch)
+{
+  // left first: if entered is no higher afterwards, the epoch was empty
+  for (int i = 0; i < MAX_SLOTS; ++i)
+  {
+    for (;;)
+    {
+      const uint64_t left    = __atomic_load_n (&_slots[i]._left[epoch],    __ATOMIC_SEQ_CST);
+      const uint64_t entered = __atomic_load_n (&_slots[i]._entered[epoch], __ATOMIC_SEQ_CST);
+      if (left == entered)
+      {
+        break;
+      }
+#if CLICK_USERLEVEL
+      sched_yield ();
+#else
+      click_compiler_fence ();
+#endif
+    }
+  }
+}
+
+template<typename T>
+void RcuPointer<T>::synchronize ()
+{
+  // a reader may have read the epoch just before it changed and be
+  // counted in the previous one, so both have to be drained, each one
+  // after new readers stopped coming in
+  for (int round = 0; round < 2; ++round)
+  {
+    const int previous = __atomic_fetch_add (&_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    wait_for_readers (previous);
+  }
+}
+
+template<typename T>
+void RcuPointer<T>::publish (T* next)
+{
+  T* old = __atomic_exchange_n (&_ptr, next, __ATOMIC_SEQ_CST);
+  synchronize ();
+  delete old;
+}
+
+CLICK_ENDDECLS
+
+#endif
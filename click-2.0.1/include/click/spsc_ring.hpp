@@ -0,0 +1,134 @@
+// Copyright QUB 2019
+
+#ifndef SpscRingH
+#define SpscRingH
+
+#include <click/config.h>
+#include <click/glue.hh>
+
+CLICK_DECLS
+
+/*
+  A fixed-size ring for exactly one producer thread and one consumer
+  thread, with no locks. The producer never waits: if the ring is full
+  try_push returns false and the caller decides what to do with the
+  item. The capacity is rounded up to a power of 2.
+
+  The head (consumer) and tail (producer) are kept on separate cache
+  lines, so the two threads do not keep stealing the line from each
+  other.
+*/
+template<typename T>
+class SpscRing
+{
+public:
+  SpscRing  ();
+  ~SpscRing ();
+
+  void    set_capacity  (const size_t capacity);
+
+  size_t  capacity      () const { return _mask + 1; }
+
+  // producer side
+  bool    try_push      (const T& item);
+
+  // consumer side - copies up to max_items into out, returns how many
+  size_t  pop_bulk      (T* out, const size_t max_items);
+
+  bool    empty         () const;
+
+private:
+  SpscRing (const SpscRing& copy);
+  SpscRing& operator= (const SpscRing& rhs);
+
+private:
+  T*        _items;
+  size_t    _mask;
+
+  char      _pad0 [64];
+  size_t    _head;          // written by the consumer only
+  char      _pad1 [64 - sizeof (size_t)];
+  size_t    _tail;          // written by the producer only
+  char      _pad2 [64 - sizeof (size_t)];
+}; // class SpscRing
+
+template<typename T>
+SpscRing<T>::SpscRing ()
+  : _items  (NULL)
+  , _mask   (0)
+  , _head   (0)
+  , _tail   (0)
+{
+}
+
+template<typename T>
+SpscRing<T>::~SpscRing ()
+{
+  delete [] _items;
+}
+
+template<typename T>
+void SpscRing<T>::set_capacity (const size_t capacity)
+{
+  size_t rounded = 1;
+  while (rounded < capacity)
+  {
+    rounded <<= 1;
+  }
+
+  delete [] _items;
+  _items  = new T [rounded];
+  _mask   = rounded - 1;
+  _head   = 0;
+  _tail   = 0;
+}
+
+template<typename T>
+bool SpscRing<T>::try_push (const T& item)
+{
+  const size_t tail = _tail;
+  const size_t head = __atomic_load_n (&_head, __ATOMIC_ACQUIRE);
+
+  if (tail - head > _mask)
+  {
+    return false; // full
+  }
+
+  _items [tail & _mask] = item;
+
+  __atomic_store_n (&_tail, tail + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+template<typename T>
+size_t SpscRing<T>::pop_bulk (T* out, const size_t max_items)
+{
+  const size_t head   = _head;
+  const size_t tail   = __atomic_load_n (&_tail, __ATOMIC_ACQUIRE);
+
+  size_t count = tail - head;
+  if (count > max_items)
+  {
+    count = max_items;
+  }
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    out[i] = _items [(head + i) & _mask];
+  }
+
+  __atomic_store_n (&_head, head + count, __ATOMIC_RELEASE);
+
+  return count;
+}
+
+template<typename T>
+bool SpscRing<T>::empty () const
+{
+  return __atomic_load_n (&_tail, __ATOMIC_ACQUIRE) == _head;
+}
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,275 @@
+// Copyright QUB 2019
+
+#ifndef SymbolFilterH
+#define SymbolFilterH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/confparse.hh>
+#include <click/global_sizes.hh>
+#if CLICK_USERLEVEL && defined(__linux__)
+# include <errno.h>
+# include <sys/socket.h>
+# include <linux/filter.h>
+# ifndef SO_ATTACH_REUSEPORT_CBPF
+#  define SO_ATTACH_REUSEPORT_CBPF 51
+# endif
+#endif
+
+CLICK_DECLS
+
+/*
+  Finds the symbol of a trade msg, "type|delta|SYMBOL|price|size", without
+  parsing anything else. memchr is the vectorised one of the libc, so the
+  delimiters are found 16 or 32 bytes at a time.
+*/
+inline bool locate_trade_symbol (
+  const char*   md_msg,
+  const size_t  md_len,
+  const char*&  symbol,
+  size_t&       symbol_len)
+{
+  const char* end = md_msg + md_len;
+  const char* bar = static_cast<const char*>(memchr (md_msg, '|', md_len));
+  if (!bar)
+  {
+    return false;
+  }
+  bar = static_cast<const char*>(memchr (bar + 1, '|', end - bar - 1));
+  if (!bar)
+  {
+    return false;
+  }
+  symbol = bar + 1;
+
+  bar = static_cast<const char*>(memchr (symbol, '|', end - symbol));
+  if (!bar)
+  {
+    return false;
+  }
+  symbol_len = bar - symbol;
+
+  return true;
+}
+
+/*
+  A 512 bit bloom filter over the subscribed symbols, two probes per
+  symbol. Most of a feed is symbols nobody subscribed to, and for those
+  the test is a hash of a few bytes and two bit tests instead of a copy
+  into a key and a hash map lookup. A hit still has to be looked up.
+*/
+class SymbolBloom
+{
+public:
+  enum { WORDS = 8, BITS = WORDS * 64 };
+
+  SymbolBloom () { clear (); }
+
+  void clear ()
+  {
+    memset (_bits, '\0', sizeof (_bits));
+  }
+
+  void add (const char* symbol, const size_t len)
+  {
+    const uint64_t h = hash (symbol, len);
+    set_bit (h);
+    set_bit (h >> 32);
+  }
+
+  bool may_contain (const char* symbol, const size_t len) const
+  {
+    const uint64_t h = hash (symbol, len);
+    return test_bit (h) && test_bit (h >> 32);
+  }
+
+private:
+  // FNV-1a, the symbols are a few chars long
+  static uint64_t hash (const char* symbol, const size_t len)
+  {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+      h ^= (uint8_t) symbol[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  void set_bit  (const uint64_t h)       { _bits[(h % BITS) / 64] |= 1ULL << (h % 64); }
+  bool test_bit (const uint64_t h) const { return _bits[(h % BITS) / 64] & (1ULL << (h % 64)); }
+
+  uint64_t  _bits [WORDS];
+}; // class SymbolBloom
+
+#if CLICK_USERLEVEL && defined(__linux__)
+
+/*
+  A classic BPF program for a socket that accepts only the trade msgs of
+  the given symbols, so the kernel drops the others before they are
+  copied to user space. offset is where the msg text starts in what the
+  socket filter sees: 16 for a UDP socket (UDP header and the 8 byte
+  timestamp), 50 for a packet socket on ethernet.
+
+  BPF has no loops, so the two fields before the symbol are searched for
+  their '|' byte by byte, up to MAX_FIELD_LEN each, with X holding where
+  the current field starts. The symbol and its closing '|' are then
+  compared 4 bytes at a time against every symbol in turn. A load past
+  the end of the packet drops it, which is what a short msg deserves.
+*/
+class SymbolBpf
+{
+public:
+  enum { MAX_FIELD_LEN = 24 };
+
+  // false if the program does not fit into BPF_MAXINSNS
+  static bool build (const Vector<String>&        symbols,
+                     const uint32_t               offset,
+                     Vector<struct sock_filter>&  prog)
+  {
+    prog.clear ();
+    find_symbol (offset, prog);
+
+    for (int s = 0; s < symbols.size (); ++s)
+    {
+      const String    text    = symbols[s] + "|";
+      const uint8_t*  bytes   = reinterpret_cast<const uint8_t*>(text.data ());
+      const int       len     = text.length ();
+      const int       chunks  = (len + 3) / 4 + (((len % 4) == 3) ? 1 : 0);
+
+      int pos   = 0;
+      int chunk = 0;
+      while (pos < len)
+      {
+        const int left = len - pos;
+        const int size = (left >= 4) ? 4 : ((left >= 2) ? 2 : 1);
+
+        uint32_t value = 0;
+        for (int b = 0; b < size; ++b)
+        {
+          value = (value << 8) | bytes[pos + b];
+        }
+
+        const uint16_t code = (size == 4) ? BPF_W : ((size == 2) ? BPF_H : BPF_B);
+        prog.push_back (stmt (BPF_LD | code | BPF_IND, offset + pos));
+        prog.push_back (jump (BPF_JMP | BPF_JEQ | BPF_K, value, 0, 2 * (chunks - chunk) - 1));
+
+        pos += size;
+        ++chunk;
+      }
+      prog.push_back (stmt (BPF_RET | BPF_K, 0xFFFFFFFF));
+    }
+    prog.push_back (stmt (BPF_RET | BPF_K, 0));
+
+    return prog.size () <= BPF_MAXINSNS;
+  }
+
+  /*
+    The program of a SO_REUSEPORT group: the index of the socket that
+    gets the msg, from a hash of its symbol, so that a symbol always goes
+    to the same socket and its thread. It sees the UDP payload, so offset
+    is 8 for the timestamp.
+  */
+  static void build_steering (const uint32_t               num_sockets,
+                              const uint32_t               offset,
+                              Vector<struct sock_filter>&  prog)
+  {
+    prog.clear ();
+    find_symbol (offset, prog);
+
+    // M[0] the hash, M[1] where the symbol starts
+    prog.push_back (stmt (BPF_LD | BPF_IMM, 0));
+    prog.push_back (stmt (BPF_ST, 0));
+    prog.push_back (stmt (BPF_STX, 1));
+
+    const int steps = Synapse::ORDER_SYMBOL_LEN - 1;
+    const int done  = prog.size () + steps * 9;
+    for (int i = 0; i < steps; ++i)
+    {
+      prog.push_back (stmt (BPF_LDX | BPF_MEM, 1));
+      prog.push_back (stmt (BPF_LD | BPF_B | BPF_IND, offset + i));
+      prog.push_back (jump (BPF_JMP | BPF_JEQ | BPF_K, '|', 0, 1));
+      prog.push_back (stmt (BPF_JMP | BPF_JA, done - (prog.size () + 1)));
+      prog.push_back (stmt (BPF_MISC | BPF_TAX, 0));
+      prog.push_back (stmt (BPF_LD | BPF_MEM, 0));
+      prog.push_back (stmt (BPF_ALU | BPF_MUL | BPF_K, 31));
+      prog.push_back (stmt (BPF_ALU | BPF_ADD | BPF_X, 0));
+      prog.push_back (stmt (BPF_ST, 0));
+    }
+    prog.push_back (stmt (BPF_LD | BPF_MEM, 0));
+    prog.push_back (stmt (BPF_ALU | BPF_MOD | BPF_K, num_sockets));
+    prog.push_back (stmt (BPF_RET | BPF_A, 0));
+  }
+
+  // the symbols of a SYMBOLS_ROUTING string, "SYM PORT SYM PORT ..."
+  static void routing_symbols (const String& routing, Vector<String>& symbols)
+  {
+    Vector<String> words;
+    cp_spacevec (routing, words);
+    for (int i = 0; i < words.size (); i += 2)
+    {
+      symbols.push_back (words[i]);
+    }
+  }
+
+  // returns the errno, 0 if attached. SO_ATTACH_FILTER or
+  // SO_ATTACH_REUSEPORT_CBPF
+  static int attach (const int                   fd,
+                     Vector<struct sock_filter>& prog,
+                     const int                   option = SO_ATTACH_FILTER)
+  {
+    struct sock_fprog fprog;
+    fprog.len     = prog.size ();
+    fprog.filter  = prog.begin ();
+    if (setsockopt (fd, SOL_SOCKET, option, &fprog, sizeof (fprog)) < 0)
+    {
+      return errno;
+    }
+    return 0;
+  }
+
+private:
+  // leaves X at the start of the symbol, relative to offset
+  static void find_symbol (const uint32_t               offset,
+                           Vector<struct sock_filter>&  prog)
+  {
+    prog.push_back (stmt (BPF_LDX | BPF_IMM, 0));
+
+    for (int field = 0; field < 2; ++field)
+    {
+      const int start = prog.size ();
+      const int end   = start + MAX_FIELD_LEN * 6 + 1;
+      for (uint32_t i = 0; i < MAX_FIELD_LEN; ++i)
+      {
+        prog.push_back (stmt (BPF_LD | BPF_B | BPF_IND, offset + i));
+        prog.push_back (jump (BPF_JMP | BPF_JEQ | BPF_K, '|', 0, 4));
+        prog.push_back (stmt (BPF_MISC | BPF_TXA, 0));
+        prog.push_back (stmt (BPF_ALU | BPF_ADD | BPF_K, i + 1));
+        prog.push_back (stmt (BPF_MISC | BPF_TAX, 0));
+        prog.push_back (stmt (BPF_JMP | BPF_JA, end - (prog.size () + 1)));
+      }
+      prog.push_back (stmt (BPF_RET | BPF_K, 0));
+    }
+  }
+
+  static struct sock_filter stmt (const uint16_t code, const uint32_t k)
+  {
+    struct sock_filter insn = { code, 0, 0, k };
+    return insn;
+  }
+
+  static struct sock_filter jump (const uint16_t code, const uint32_t k,
+                                  const uint8_t jt, const uint8_t jf)
+  {
+    struct sock_filter insn = { code, jt, jf, k };
+    return insn;
+  }
+}; // class SymbolBpf
+
+#endif
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,369 @@
+// Copyright QUB 2019
+
+#ifndef SynapseUringRecvH
+#define SynapseUringRecvH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#if CLICK_USERLEVEL && defined(__linux__)
+# include <errno.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <sys/syscall.h>
+# include <linux/io_uring.h>
+#endif
+
+CLICK_DECLS
+
+#if CLICK_USERLEVEL && defined(__linux__)
+
+/*
+  The io_uring receive path of a datagram socket, without liburing: the
+  setup, the ring mappings and a provided buffer ring over one slab.
+
+  One multishot recvmsg stays armed on the socket. The kernel picks a
+  buffer of the slab for every datagram and posts a completion, so while
+  msgs keep coming there are no syscalls - the completions are read from
+  the shared ring and the buffers handed back through the buffer ring.
+  The ring fd polls readable when there are completions, that is the idle
+  state (add_select on fd ()).
+
+  Every buffer has HEADROOM bytes in front of it that the kernel does not
+  touch, for whoever holds on to the buffer after drain, and the kernel
+  puts an io_uring_recvmsg_out in front of the payload. A buffer is in
+  use from its completion until on_msg returns true or release is called,
+  all of it on one thread. When they are all in use the recvmsg ends with
+  ENOBUFS and is armed again by the next release.
+*/
+class UringRecv
+{
+public:
+  UringRecv ()
+    : _ring_fd (-1), _socket (-1), _num_bufs (0), _buf_size (0), _slot_size (0)
+    , _headroom (0), _starved (false)
+    , _sq_ring (0), _sq_ring_len (0), _cq_ring (0), _cq_ring_len (0)
+    , _sqes (0), _sqes_len (0), _buf_ring (0), _slab (0), _slab_len (0)
+    , _syscalls (0), _rearms (0), _no_bufs (0), _truncated (0), _held (0)
+  {
+    memset (&_msg, '\0', sizeof (_msg));
+  }
+
+  ~UringRecv () { close (_held > 0); }
+
+  // num_bufs a power of 2, buf_size is for the payload. Returns the errno
+  int setup (const int       socket,
+             const uint32_t  num_bufs,
+             const uint32_t  buf_size,
+             const uint32_t  headroom = 0)
+  {
+    _socket     = socket;
+    _num_bufs   = num_bufs;
+    _headroom   = headroom;
+    _buf_size   = buf_size + sizeof (struct io_uring_recvmsg_out);
+    _slot_size  = (_headroom + _buf_size + 63) & ~63U;
+
+    struct io_uring_params p;
+    memset (&p, '\0', sizeof (p));
+    // a completion per datagram, room for a full buffer ring of them
+    p.flags       = IORING_SETUP_CQSIZE;
+    p.cq_entries  = num_bufs * 2;
+
+    _ring_fd = syscall (__NR_io_uring_setup, 4, &p);
+    if (_ring_fd < 0)
+    {
+      return errno;
+    }
+    ++_syscalls;
+
+    _sq_ring_len = p.sq_off.array + p.sq_entries * sizeof (uint32_t);
+    _cq_ring_len = p.cq_off.cqes  + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      _sq_ring_len = _cq_ring_len = (_sq_ring_len > _cq_ring_len) ? _sq_ring_len : _cq_ring_len;
+    }
+
+    if (!(_sq_ring = map (_sq_ring_len, IORING_OFF_SQ_RING)))
+    {
+      return errno;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      _cq_ring = _sq_ring;
+    }
+    else if (!(_cq_ring = map (_cq_ring_len, IORING_OFF_CQ_RING)))
+    {
+      return errno;
+    }
+    _sqes_len = p.sq_entries * sizeof (struct io_uring_sqe);
+    if (!(_sqes = reinterpret_cast<struct io_uring_sqe*>(map (_sqes_len, IORING_OFF_SQES))))
+    {
+      return errno;
+    }
+
+    _sq_tail  = reinterpret_cast<uint32_t*>(_sq_ring + p.sq_off.tail);
+    _sq_mask  = *reinterpret_cast<uint32_t*>(_sq_ring + p.sq_off.ring_mask);
+    _sq_array = reinterpret_cast<uint32_t*>(_sq_ring + p.sq_off.array);
+    _cq_head  = reinterpret_cast<uint32_t*>(_cq_ring + p.cq_off.head);
+    _cq_tail  = reinterpret_cast<uint32_t*>(_cq_ring + p.cq_off.tail);
+    _cq_mask  = *reinterpret_cast<uint32_t*>(_cq_ring + p.cq_off.ring_mask);
+    _cqes     = reinterpret_cast<struct io_uring_cqe*>(_cq_ring + p.cq_off.cqes);
+
+    // the buffer ring and the slab behind it, page aligned
+    const size_t ring_len = (num_bufs * sizeof (struct io_uring_buf) + 63) & ~(size_t) 63;
+    _slab_len = ring_len + (size_t) num_bufs * _slot_size;
+    void* mem = mmap (0, _slab_len, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+      return errno;
+    }
+    _buf_ring = reinterpret_cast<struct io_uring_buf*>(mem);
+    _slab     = static_cast<char*>(mem) + ring_len;
+
+    struct io_uring_buf_reg reg;
+    memset (&reg, '\0', sizeof (reg));
+    reg.ring_addr     = (uint64_t) _buf_ring;
+    reg.ring_entries  = num_bufs;
+    reg.bgid          = BUF_GROUP;
+    if (syscall (__NR_io_uring_register, _ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+      return errno;
+    }
+    ++_syscalls;
+
+    _buf_tail = 0;
+    for (uint32_t bid = 0; bid < num_bufs; ++bid)
+    {
+      add_buffer (bid);
+    }
+    publish_buffers ();
+
+    return arm ();
+  }
+
+  // keep_slab when buffers are still held by someone, it is then left
+  // mapped for them
+  void close (const bool keep_slab = false)
+  {
+    if (_sqes)     munmap (_sqes, _sqes_len);
+    if (_cq_ring && (_cq_ring != _sq_ring)) munmap (_cq_ring, _cq_ring_len);
+    if (_sq_ring)  munmap (_sq_ring, _sq_ring_len);
+    if (_ring_fd >= 0)
+    {
+      ::close (_ring_fd);
+    }
+    if (_buf_ring && !keep_slab)
+    {
+      munmap (_buf_ring, _slab_len);
+    }
+
+    _sqes     = 0;
+    _sq_ring  = _cq_ring = 0;
+    _buf_ring = 0;
+    _ring_fd  = -1;
+  }
+
+  int       fd        () const { return _ring_fd; }
+  uint32_t  num_bufs  () const { return _num_bufs; }
+
+  // the headroom of a buffer
+  char*     slot      (const uint32_t bid) const { return _slab + (size_t) bid * _slot_size; }
+
+  /*
+    Calls on_msg (char* data, uint32_t len, uint32_t bid) for the
+    datagrams that have completed, up to max, with the data in place in
+    the slab. on_msg returns true when it is done with the buffer, false
+    if it holds on to it until release (bid). Returns the number of msgs.
+  */
+  template <typename F>
+  int drain (F& on_msg, const int max)
+  {
+    uint32_t        head  = *_cq_head;
+    const uint32_t  tail  = __atomic_load_n (_cq_tail, __ATOMIC_ACQUIRE);
+    int             count = 0;
+    bool            rearm = false;
+
+    while ((head != tail) && (count < max))
+    {
+      const struct io_uring_cqe& cqe = _cqes[head & _cq_mask];
+      ++head;
+
+      if (!(cqe.flags & IORING_CQE_F_MORE))
+      {
+        if (cqe.res == -ENOBUFS)
+        {
+          ++_no_bufs;
+          _starved = true;
+        }
+        else
+        {
+          rearm = true;
+        }
+      }
+      if ((cqe.res < 0) || !(cqe.flags & IORING_CQE_F_BUFFER))
+      {
+        continue;
+      }
+
+      const uint32_t  bid   = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+      char*           buf   = slot (bid) + _headroom;
+      const struct io_uring_recvmsg_out* out = reinterpret_cast<struct io_uring_recvmsg_out*>(buf);
+
+      ++_held;
+      if (out->flags & MSG_TRUNC)
+      {
+        ++_truncated;
+        give_back (bid);
+      }
+      else
+      {
+        ++count;
+        if (on_msg (buf + sizeof (*out), out->payloadlen, bid))
+        {
+          give_back (bid);
+        }
+      }
+    }
+
+    __atomic_store_n (_cq_head, head, __ATOMIC_RELEASE);
+    publish_buffers ();
+
+    // the buffers may have come back before the ENOBUFS was seen
+    if (_starved && (_held < _num_bufs))
+    {
+      _starved  = false;
+      rearm     = true;
+    }
+    if (rearm && !_starved)
+    {
+      ++_rearms;
+      arm ();
+    }
+    return count;
+  }
+
+  // a buffer on_msg held on to is free again
+  void release (const uint32_t bid)
+  {
+    if (_ring_fd < 0)
+    {
+      return;
+    }
+    give_back (bid);
+    publish_buffers ();
+    if (_starved)
+    {
+      _starved = false;
+      ++_rearms;
+      arm ();
+    }
+  }
+
+  uint64_t syscalls   () const { return _syscalls; }
+  uint64_t rearms     () const { return _rearms; }
+  uint64_t no_bufs    () const { return _no_bufs; }
+  uint64_t truncated  () const { return _truncated; }
+  uint32_t held       () const { return _held; }
+
+private:
+  enum { BUF_GROUP = 0 };
+
+  char* map (const size_t len, const uint64_t offset)
+  {
+    void* mem = mmap (0, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      _ring_fd, offset);
+    return (mem == MAP_FAILED) ? 0 : static_cast<char*>(mem);
+  }
+
+  void give_back (const uint32_t bid)
+  {
+    --_held;
+    add_buffer (bid);
+  }
+
+  // the ring is addressed as a plain array, in C++ the flexible array of
+  // struct io_uring_buf_ring lands at offset 8, on top of the tail
+  void add_buffer (const uint32_t bid)
+  {
+    struct io_uring_buf& buf = _buf_ring[_buf_tail & (_num_bufs - 1)];
+    buf.addr  = (uint64_t) (slot (bid) + _headroom);
+    buf.len   = _buf_size;
+    buf.bid   = bid;
+    ++_buf_tail;
+  }
+
+  void publish_buffers ()
+  {
+    __atomic_store_n (&reinterpret_cast<struct io_uring_buf_ring*>(_buf_ring)->tail,
+                      _buf_tail, __ATOMIC_RELEASE);
+  }
+
+  // the multishot recvmsg, msg has no room for the address or control
+  // data, so the payload follows the io_uring_recvmsg_out header
+  int arm ()
+  {
+    const uint32_t        tail  = *_sq_tail;
+    const uint32_t        index = tail & _sq_mask;
+    struct io_uring_sqe&  sqe   = _sqes[index];
+
+    memset (&sqe, '\0', sizeof (sqe));
+    sqe.opcode    = IORING_OP_RECVMSG;
+    sqe.fd        = _socket;
+    sqe.addr      = (uint64_t) &_msg;
+    sqe.ioprio    = IORING_RECV_MULTISHOT;
+    sqe.flags     = IOSQE_BUFFER_SELECT;
+    sqe.buf_group = BUF_GROUP;
+
+    _sq_array[index] = index;
+    __atomic_store_n (_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ++_syscalls;
+    if (syscall (__NR_io_uring_enter, _ring_fd, 1, 0, 0, 0, 0) < 0)
+    {
+      return errno;
+    }
+    return 0;
+  }
+
+private:
+  int                   _ring_fd;
+  int                   _socket;
+  uint32_t              _num_bufs;
+  uint32_t              _buf_size;
+  uint32_t              _slot_size;
+  uint32_t              _headroom;
+  bool                  _starved;
+
+  char*                 _sq_ring;
+  size_t                _sq_ring_len;
+  char*                 _cq_ring;
+  size_t                _cq_ring_len;
+  struct io_uring_sqe*  _sqes;
+  size_t                _sqes_len;
+  uint32_t*             _sq_tail;
+  uint32_t              _sq_mask;
+  uint32_t*             _sq_array;
+  uint32_t*             _cq_head;
+  uint32_t*             _cq_tail;
+  uint32_t              _cq_mask;
+  struct io_uring_cqe*  _cqes;
+
+  struct io_uring_buf*  _buf_ring;
+  uint16_t              _buf_tail;
+  char*                 _slab;
+  size_t                _slab_len;
+  struct msghdr         _msg;
+
+  uint64_t              _syscalls;
+  uint64_t              _rearms;
+  uint64_t              _no_bufs;
+  uint64_t              _truncated;
+  uint32_t              _held;
+}; // class UringRecv
+
+#endif
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,61 @@
+// Copyright QUB 2019
+
+#ifndef Synapse_WarmUp_H
+#define Synapse_WarmUp_H
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/appmsgs.hh>
+
+CLICK_DECLS
+
+class Element;
+
+/*
+  What a packet would carry during the warm-up, see the WarmUp element.
+  _value is used by MSG_INIT/ADD/UPDATE, _source by MSG_*_SOURCE.
+*/
+struct WarmUpMsg
+{
+  WarmUpMsg ()
+    : _type       (Synapse::NO_APP_MSG)
+    , _timestamp  (0)
+    , _changed    (true)
+  {}
+
+  Synapse::PacketAppType  _type;
+  uint64_t                _timestamp;
+  bool                    _changed;
+  FixedPt                 _value;
+  Synapse::MsgSource      _source;
+}; // struct WarmUpMsg
+
+// delivers a msg to whatever is connected to an output port
+class WarmUpEmitter
+{
+public:
+  virtual ~WarmUpEmitter () {}
+
+  virtual void emit (Element*         from,
+                     const int        out_port,
+                     const WarmUpMsg& msg) = 0;
+}; // class WarmUpEmitter
+
+/*
+  Implemented by the elements that take part in the warm-up. They return
+  it from Element::cast ("WarmUpTarget") and handle a msg the same way
+  push handles the packet, passing their results on through the emitter.
+*/
+class WarmUpTarget
+{
+public:
+  virtual ~WarmUpTarget () {}
+
+  virtual void warm_up (int              port,
+                        const WarmUpMsg& msg,
+                        WarmUpEmitter&   emitter) = 0;
+}; // class WarmUpTarget
+
+CLICK_ENDDECLS
+
+#endif
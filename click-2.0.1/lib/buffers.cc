@@ -1,50 +1,86 @@
 // Copyright QUB 2017
 
 #include <click/buffers.hh>
+#include <click/vector.hh>
 
 #define CLICK_DEBUG if (_debug) click_chatter
 
 CLICK_DECLS
 
 Buffers::Buffers (const int num_ports, const int buf_len, const bool debug)
-  : _tstamp (0)
+  : _join      (num_ports)
+  , _complete  (false)
   , _num_ports (num_ports)
   , _debug     (debug)
 {
+  assert (num_ports <= BarrierJoin::MAX_PORTS);
+
   _buffers = new RingBuffer* [num_ports];
   for (int i = 0; i < num_ports; ++i)
   {
     _buffers[i] = new RingBuffer (buf_len);
   }
 
-  _updated      = new char [num_ports];
-
   _temp_updates = new FixedPt [num_ports];
 
-  reset ();
-
   _state = INITIAL;
 }
 
 void Buffers::reset ()
 {
-  memset (_updated, 'N', _num_ports);
+  _join.reset ();
+  _complete = false;
 }
 
-static bool check_updated (char* updated, const int len)
+void Buffers::start_round ()
 {
-  for (int i = 0; i < len; ++i)
+  // restore all the saved values
+  if ((_state == ACCUMULATED_TEMP) || (_state == ACCUMULATED_TEMP_POP))
   {
-    if (updated[i] != 'Y')
+    for (int i = 0; i < _num_ports; ++i)
     {
-      return false;
+      _buffers[i]->pop_front (); // remove the temp vars
+    }
+    
+    if (_state == ACCUMULATED_TEMP_POP)
+    {
+      // restore the saved values
+      for (int i = 0; i < _num_ports; ++i)
+      {
+        _buffers[i]->push_back (_temp_updates[i], true);
+      }
     }
   }
 
-  return true;
+  _state  = ACCUMULATING;
+}
+
+void Buffers::push_value (
+  const FixedPt&  value,
+  const int       port)
+{
+  _buffers[port]->push_front (value, true);
+}
+
+void Buffers::push_value_temp (
+  const FixedPt&  value,
+  const int       port)
+{
+  // I want to pop back the value for that buffer (if any) and save them
+  if (_buffers[port]->occupancy () == _buffers[port]->capacity ())
+  {
+    _temp_updates[port] = _buffers[port]->pop_back ();
+    _state = ACCUMULATING_POP;
+  }
+  // then I add  the new value
+  _buffers[port]->push_front (value, true);
 }
 
-bool Buffers::new_value_check (const int port, const uint64_t tstamp)
+bool Buffers::add_value (
+  const FixedPt&  value,
+  const uint64_t  tstamp,
+  const int       port,
+  const bool      temp)
 {
   if ((port < 0) || (port > _num_ports - 1))
   {
@@ -52,41 +88,46 @@ bool Buffers::new_value_check (const int port, const uint64_t tstamp)
     return false;
   }
 
-  CLICK_DEBUG ("Buffers: check tstamp %lld (prev. tstamp is %lld)", tstamp, _tstamp);
+  CLICK_DEBUG ("Buffers: check tstamp %lld (last complete tstamp is %lld)",
+                  tstamp, _join.last_tstamp ());
+
+  _complete = false;
+
+  BarrierJoin::Round* round = _join.add (value, tstamp, port, temp);
+  if (!round)
+  {
+    CLICK_DEBUG ("Buffers: tstamp %lld not complete yet", tstamp);
+    return false;
+  }
 
-  if (tstamp > _tstamp)
+  start_round ();
+  for (int i = 0; i < _num_ports; ++i)
   {
-    CLICK_DEBUG ("Buffers KB: a higher tstamp has arrived");
-    if ((_state == ACCUMULATING) || (_state == ACCUMULATING_POP))
+    if (BarrierJoin::has_port (round->_temp, i))
     {
-      CLICK_DEBUG ("Theresa Rubel! We've got a new timestamp"
-                     " before accumulating all the updates!");
-      // TODO: we really need to abort here, how to do this safely in kernel space???
+      push_value_temp (round->_values[i], i);
     }
-    reset ();
-
-    _tstamp = tstamp;
-
-    // restore all the saved values
-    if ((_state == ACCUMULATED_TEMP) || (_state == ACCUMULATED_TEMP_POP))
+    else
     {
-      for (int i = 0; i < _num_ports; ++i)
-      {
-        _buffers[i]->pop_front (); // remove the temp vars
-      }
-      
-      if (_state == ACCUMULATED_TEMP_POP)
-      {
-        // restore the saved values
-        for (int i = 0; i < _num_ports; ++i)
-        {
-          _buffers[i]->push_back (_temp_updates[i], true);
-        }
-      }
+      push_value (round->_values[i], i);
     }
+  }
 
-    _state  = ACCUMULATING;
+  if (round->_temp == 0)
+  {
+    _state = ACCUMULATED;
   }
+  else if (_state == ACCUMULATING)
+  {
+    _state = ACCUMULATED_TEMP;
+  }
+  else
+  {
+    _state = ACCUMULATED_TEMP_POP;
+  }
+
+  _join.release (round);
+  _complete = true;
 
   return true;
 }
@@ -98,18 +139,7 @@ void Buffers::add_new_value (
 {
   CLICK_DEBUG ("Add New Value: value %s, port %d",
                   value.c_str (), port);
-  if (!new_value_check (port, tstamp))
-  {
-    return;
-  }
-
-  _buffers[port]->push_front (value, true);
-  _updated[port] = 'Y';
-
-  if (check_updated (_updated, _num_ports))
-  {
-    _state = ACCUMULATED;
-  }
+  add_value (value, tstamp, port, false);
 }
 
 void Buffers::add_new_value_temp (
@@ -119,32 +149,66 @@ void Buffers::add_new_value_temp (
 {
   CLICK_DEBUG ("Add New Value Temp: value %s, port %d",
                   value.c_str (), port);
-  if (!new_value_check (port, tstamp))
+  add_value (value, tstamp, port, true);
+}
+
+// the open timestamps are not saved, they are at most one packet
+// per port behind
+void Buffers::save_state (StateWriter& writer)
+{
+  writer.write_u32 (_num_ports);
+  writer.write_u32 (_state);
+  writer.write_u64 (_join.last_tstamp ());
+  writer.write_bool (_complete);
+  for (int i = 0; i < _num_ports; ++i)
   {
-    return;
+    writer.write_fixedpt (_temp_updates[i]);
+    writer.write_ring    (*(_buffers[i]));
   }
-  // I want to pop back the value for that buffer (if any) and save them
-  if (_buffers[port]->occupancy () == _buffers[port]->capacity ())
+}
+
+bool Buffers::restore_state (StateReader& reader)
+{
+  if (reader.read_u32 () != (uint32_t) _num_ports)
   {
-    _temp_updates[port] = _buffers[port]->pop_back ();
-    _state = ACCUMULATING_POP;
+    CLICK_DEBUG ("Buffers: saved state has a different number of ports");
+    return false;
   }
-  // then I add  the new value
-  _buffers[port]->push_front (value, true);
-  // updated works as usual
-  _updated[port] = 'Y';
 
-  if (check_updated (_updated, _num_ports))
+  const BufferStates state    = (BufferStates) reader.read_u32 ();
+  reader.read_u64 (); // the last complete tstamp
+  const bool         complete = reader.read_bool ();
+  Vector<FixedPt>    temp_updates (_num_ports, FixedPt ());
+  Vector<RingBuffer> rings        (_num_ports, RingBuffer (1));
+
+  for (int i = 0; i < _num_ports; ++i)
   {
-    if (_state == ACCUMULATING)
-    {
-      _state = ACCUMULATED_TEMP;
-    }
-    else
+    temp_updates[i] = reader.read_fixedpt ();
+    if (!reader.read_ring (rings[i]) || (rings[i].capacity () != _buffers[i]->capacity ()))
     {
-      _state = ACCUMULATED_TEMP_POP;
+      CLICK_DEBUG ("Buffers: saved state has a different buffer length");
+      return false;
     }
   }
+
+  if (!reader.ok () || (state > ACCUMULATED_TEMP_POP))
+  {
+    return false;
+  }
+
+  // everything is there, now overwrite
+  _state    = state;
+  _complete = complete;
+  // the timestamps of the previous run mean nothing now
+  _join.reset ();
+  _join.set_last_tstamp (0);
+  for (int i = 0; i < _num_ports; ++i)
+  {
+    _temp_updates[i] = temp_updates[i];
+    *(_buffers[i])   = rings[i];
+  }
+
+  return true;
 }
 
 RingBuffer& Buffers::operator[] (const int index)
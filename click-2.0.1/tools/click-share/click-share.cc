@@ -0,0 +1,446 @@
+/*
+ * click-share.cc -- merge several Click configurations into one, sharing
+ * the elements they have in common
+ *
+ * Copyright QUB 2019
+ *
+ * Several indicator configurations (e.g. dmi_opt.click and vortex_opt.click)
+ * hosted in the same router each parse the same trades and compute the same
+ * intermediate values. This tool puts all of them into one router and then
+ * merges every pair of elements that have the same class, the same
+ * configuration and exactly the same inputs, repeating until nothing else
+ * can be merged. Where a merged element ends up feeding several elements
+ * from one output, a ReuseTee is inserted.
+ */
+
+#include <click/config.h>
+
+#include "routert.hh"
+#include "lexert.hh"
+#include <click/error.hh>
+#include <click/clp.h>
+#include "toolutils.hh"
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <click/variableenv.hh>
+#include <click/driver.hh>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#define HELP_OPT		300
+#define VERSION_OPT		301
+#define ROUTER_OPT		302
+#define OUTPUT_OPT		303
+#define NAME_OPT		304
+#define EXPRESSION_OPT		306
+#define CONFIG_OPT		307
+#define VERBOSE_OPT		308
+
+static const Clp_Option options[] = {
+  { "config", 'c', CONFIG_OPT, 0, 0 },
+  { "expression", 'e', EXPRESSION_OPT, Clp_ValString, 0 },
+  { "file", 'f', ROUTER_OPT, Clp_ValString, 0 },
+  { "help", 0, HELP_OPT, 0, 0 },
+  { "name", 'n', NAME_OPT, Clp_ValString, 0 },
+  { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
+  { "verbose", 'V', VERBOSE_OPT, 0, Clp_Negate },
+  { "version", 'v', VERSION_OPT, 0, 0 },
+};
+
+// elements without inputs are only merged if they read from a shared
+// resource - merging two packet generators would change the traffic
+static const char * const shareable_sources[] = {
+  "FromDevice", "PollDevice", "FromHost", "Socket", "FromSocket", 0
+};
+
+static const char *program_name;
+static bool verbose;
+
+static Vector<String> router_names;
+static Vector<RouterT *> routers;
+
+void
+short_usage()
+{
+  fprintf(stderr, "Usage: %s [OPTION]... [ROUTERFILE | ROUTERNAME=FILE]...\n\
+Try '%s --help' for more information.\n",
+	  program_name, program_name);
+}
+
+void
+usage()
+{
+  printf("\
+'Click-share' merges several Click router configurations into one and shares\n\
+the elements they have in common. Two elements are shared if they have the\n\
+same class, the same configuration and the same inputs, so e.g. co-hosted\n\
+indicators parse each trade once and compute a common NewTrueRange once.\n\
+Elements of the combined router are named 'ROUTERNAME/ELEMENT'.\n\
+\n\
+Usage: %s [OPTION]... [ROUTERFILE | ROUTERNAME=FILE]...\n\
+\n\
+Options:\n\
+  -o, --output FILE      Write combined configuration to FILE.\n\
+  -n, --name NAME        The next router component name is NAME.\n\
+  -f, --file FILE        Read router component configuration from FILE.\n\
+  -e, --expression EXPR  Use EXPR as router component configuration.\n\
+  -c, --config           Output config only (not an archive).\n\
+  -V, --verbose          Report every shared element.\n\
+      --help             Print this message and exit.\n\
+  -v, --version          Print version number and exit.\n\
+\n\
+Report bugs to <click@pdos.lcs.mit.edu>.\n", program_name);
+}
+
+static void
+cs_read_router(String name, String &next_name, int &next_number,
+	       const char *filename, bool file_is_expr, ErrorHandler *errh)
+{
+  if (name && next_name)
+    errh->warning("router name specified twice ('%s' and '%s')",
+		  next_name.c_str(), name.c_str());
+  else if (name)
+    next_name = name;
+
+  RouterT *r = read_router(filename, file_is_expr, errh);
+
+  if (r) {
+    r->flatten(errh);
+    if (!next_name && !file_is_expr) {
+      // default the name to the file's base name, e.g. 'dmi_opt'
+      String base = filename;
+      int slash = base.find_right('/');
+      if (slash >= 0)
+	base = base.substring(slash + 1);
+      int dot = base.find_right('.');
+      if (dot > 0)
+	base = base.substring(0, dot);
+      next_name = base;
+    }
+    if (next_name) {
+      int span = strspn(next_name.c_str(), "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_/@0123456789");
+      if (span != next_name.length() || strstr(next_name.c_str(), "//") != 0
+	  || next_name[0] == '/' || next_name.back() == '/')
+	errh->error("router name '%s' is not a legal Click identifier", next_name.c_str());
+      router_names.push_back(next_name);
+    } else
+      router_names.push_back(String(next_number));
+    routers.push_back(r);
+  }
+
+  next_name = String();
+  next_number++;
+}
+
+static bool
+is_keyword_arg(const String &arg)
+{
+  const char *s = arg.begin(), *end = arg.end();
+  if (s == end || !isupper((unsigned char) *s))
+    return false;
+  while (s != end && (isupper((unsigned char) *s) || isdigit((unsigned char) *s) || *s == '_'))
+    s++;
+  return s != end && isspace((unsigned char) *s);
+}
+
+// configurations that only differ in whitespace, comments or the order of
+// keyword arguments are the same configuration
+static String
+canonical_config(const String &config)
+{
+  Vector<String> args, positional, keywords;
+  cp_argvec(cp_uncomment(config), args);
+  for (int i = 0; i < args.size(); i++) {
+    Vector<String> words;
+    cp_spacevec(args[i], words);
+    String arg = cp_unspacevec(words);
+    if (is_keyword_arg(arg))
+      keywords.push_back(arg);
+    else
+      positional.push_back(arg);
+  }
+  click_qsort(keywords.begin(), keywords.size());
+  for (int i = 0; i < keywords.size(); i++)
+    positional.push_back(keywords[i]);
+  return cp_unargvec(positional);
+}
+
+static bool
+shareable_source(const ElementT *e)
+{
+  for (const char * const *s = shareable_sources; *s; s++)
+    if (e->type_name() == *s)
+      return true;
+  return false;
+}
+
+// the key identifies an element by what it computes: its class, its
+// configuration and where every one of its inputs comes from
+static String
+element_key(RouterT *r, ElementT *e)
+{
+  ElementClassT *tee_type = ElementClassT::base_type("ReuseTee");
+  Vector<String> inputs;
+  for (RouterT::conn_iterator it = r->find_connections_to(e); it; ++it) {
+    // every arm of a ReuseTee carries the same message
+    StringAccum sa;
+    sa << it->from_eindex() << '.';
+    if (it->from_element()->type() == tee_type)
+      sa << '*';
+    else
+      sa << it->from_port();
+    sa << '>' << it->to_port();
+    inputs.push_back(sa.take_string());
+  }
+
+  if (inputs.size() == 0 && !shareable_source(e))
+    return String();
+
+  click_qsort(inputs.begin(), inputs.size());
+
+  StringAccum sa;
+  sa << e->type_name() << '(' << canonical_config(e->configuration()) << ')';
+  for (int i = 0; i < inputs.size(); i++)
+    sa << ' ' << inputs[i];
+  return sa.take_string();
+}
+
+// redirect the outputs of 'dup' to 'keep' and remove 'dup'
+static void
+merge_element(RouterT *r, ElementT *keep, ElementT *dup, ErrorHandler *errh)
+{
+  if (verbose)
+    errh->message("sharing %<%s%> with %<%s%>", dup->name_c_str(), keep->name_c_str());
+
+  Vector<RouterT::conn_iterator> outputs;
+  for (RouterT::conn_iterator it = r->find_connections_from(dup); it; ++it)
+    outputs.push_back(it);
+  for (int i = 0; i < outputs.size(); i++)
+    r->change_connection_from(outputs[i], PortT(keep, outputs[i]->from_port()));
+
+  // the inputs of 'dup' are the same as the inputs of 'keep'
+  dup->kill();
+  r->kill_bad_connections();
+}
+
+static int
+share_elements(RouterT *r, ErrorHandler *errh)
+{
+  int nshared = 0;
+
+  while (1) {
+    int nchanges = 0;
+    HashTable<String, int> keys(-1);
+
+    for (int i = 0; i < r->nelements(); i++) {
+      ElementT *e = r->element(i);
+      if (!e->live())
+	continue;
+
+      String key = element_key(r, e);
+      if (!key)
+	continue;
+
+      int &first = keys[key];
+      if (first < 0)
+	first = i;
+      else {
+	merge_element(r, r->element(first), e, errh);
+	++nchanges;
+      }
+    }
+
+    if (!nchanges)
+      break;
+
+    r->remove_duplicate_connections();
+    nshared += nchanges;
+  }
+
+  r->remove_dead_elements();
+  return nshared;
+}
+
+// a push output can only be connected once, so fan the shared outputs
+// out through a ReuseTee the same way the indicator configs do by hand;
+// if the shared element already is a ReuseTee it simply gets more arms
+static void
+add_tees(RouterT *r)
+{
+  ElementClassT *tee_type = ElementClassT::base_type("ReuseTee");
+  int nelements = r->nelements();
+
+  for (int i = 0; i < nelements; i++) {
+    ElementT *e = r->element(i);
+    if (!e->live())
+      continue;
+    bool is_tee = (e->type() == tee_type);
+    int noutputs = e->noutputs();
+
+    for (int port = 0; port < noutputs; port++) {
+      Vector<RouterT::conn_iterator> conns;
+      for (RouterT::conn_iterator it = r->find_connections_from(e, port); it; ++it)
+	conns.push_back(it);
+      if (conns.size() < 2)
+	continue;
+
+      if (is_tee) {
+	for (int j = 1; j < conns.size(); j++)
+	  r->change_connection_from(conns[j], PortT(e, e->noutputs()));
+	continue;
+      }
+
+      StringAccum name;
+      name << e->name() << "/share_tee" << port;
+      ElementT *tee = r->get_element(name.take_string(), tee_type, String(),
+				     LandmarkT::empty_landmark());
+
+      for (int j = 0; j < conns.size(); j++)
+	r->change_connection_from(conns[j], PortT(tee, j));
+      r->add_connection(e, port, tee, 0);
+    }
+
+    // a ReuseTee configured with its number of arms must agree with them
+    if (is_tee && e->noutputs() != noutputs && e->configuration())
+      e->set_configuration(String(e->noutputs()));
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  click_static_initialize();
+  CLICK_DEFAULT_PROVIDES;
+  ErrorHandler *errh = ErrorHandler::default_handler();
+  ErrorHandler *p_errh = new PrefixErrorHandler(errh, "click-share: ");
+
+  // read command line arguments
+  Clp_Parser *clp =
+    Clp_NewParser(argc, argv, sizeof(options) / sizeof(options[0]), options);
+  Clp_SetOptionChar(clp, '+', Clp_ShortNegated);
+  program_name = Clp_ProgramName(clp);
+
+  const char *output_file = 0;
+  String next_name;
+  int next_number = 1;
+  bool config_only = false;
+
+  while (1) {
+    int opt = Clp_Next(clp);
+    switch (opt) {
+
+     case HELP_OPT:
+      usage();
+      exit(0);
+      break;
+
+     case VERSION_OPT:
+      printf("click-share (Click) %s\n", CLICK_VERSION);
+      printf("Copyright QUB 2019\n\
+This is free software; see the source for copying conditions.\n\
+There is NO warranty, not even for merchantability or fitness for a\n\
+particular purpose.\n");
+      exit(0);
+      break;
+
+     case ROUTER_OPT:
+      cs_read_router(String(), next_name, next_number, clp->vstr, false, errh);
+      break;
+
+     case EXPRESSION_OPT:
+      cs_read_router(String(), next_name, next_number, clp->vstr, true, errh);
+      break;
+
+     case OUTPUT_OPT:
+      if (output_file) {
+	p_errh->error("output file specified twice");
+	goto bad_option;
+      }
+      output_file = clp->vstr;
+      break;
+
+     case NAME_OPT:
+      if (next_name)
+	p_errh->warning("router name specified twice");
+      next_name = clp->vstr;
+      break;
+
+     case CONFIG_OPT:
+      config_only = true;
+      break;
+
+     case VERBOSE_OPT:
+      verbose = !clp->negated;
+      break;
+
+     case Clp_NotOption:
+      if (const char *eq = strchr(clp->vstr, '='))
+	cs_read_router(String(clp->vstr, eq - clp->vstr), next_name, next_number, eq + 1, false, errh);
+      else
+	cs_read_router(String(), next_name, next_number, clp->vstr, false, errh);
+      break;
+
+     bad_option:
+     case Clp_BadOption:
+      short_usage();
+      exit(1);
+      break;
+
+     case Clp_Done:
+      goto done;
+
+    }
+  }
+
+ done:
+  // no routers is an error
+  if (routers.size() == 0)
+    p_errh->fatal("no routers specified");
+
+  // check that routers are named differently
+  HashTable<String, int> name_map(-1);
+  for (int i = 0; i < routers.size(); i++) {
+      int &mapval = name_map[router_names[i]];
+      if (mapval >= 0)
+	  p_errh->fatal("two routers named '%s'", router_names[i].c_str());
+      mapval = i;
+  }
+
+  // exit if there have been errors
+  if (errh->nerrors() != 0)
+    exit(1);
+
+  // open output file
+  FILE *outf = stdout;
+  if (output_file && strcmp(output_file, "-") != 0) {
+    outf = fopen(output_file, "w");
+    if (!outf)
+      errh->fatal("%s: %s", output_file, strerror(errno));
+  }
+
+  // combine routers
+  RouterT *combined = new RouterT;
+  VariableEnvironment empty_ve(0);
+  for (int i = 0; i < routers.size(); i++)
+      routers[i]->expand_into(combined, router_names[i] + "/", empty_ve, errh);
+  combined->remove_tunnels();
+
+  // exit if there have been errors (again)
+  if (errh->nerrors() != 0)
+    exit(1);
+
+  int nbefore = combined->n_live_elements();
+  int nshared = share_elements(combined, p_errh);
+  add_tees(combined);
+  p_errh->message("%d elements, %d shared", nbefore, nshared);
+
+  if (config_only) {
+    String config = combined->configuration_string();
+    ignore_result(fwrite(config.data(), 1, config.length(), outf));
+  } else
+    write_router_file(combined, outf, errh);
+  exit(0);
+}
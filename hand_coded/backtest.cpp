@@ -0,0 +1,794 @@
+// Copyright QUB 2019
+
+/*
+  Parameter sweep over the historical trades file.
+
+  The file is parsed once and aggregated into bars once per symbol and
+  interval length, exactly the way indie does it (update_hloc + a timer
+  that emits ADDs every interval). Every (symbol, parameter set) pair is
+  then a task, the tasks are spread over one worker thread per core and
+  the workers steal from each other when their own queue runs out.
+
+  The indicators are the ones from indicator_lib.hpp, i.e. the values are
+  the same as the ones produced by Trix, Dmi and Vortex.
+
+  If an output directory is given, every parameter set produces one file
+  "<indicator>_i<interval>_n<periods>.col" with the layout
+
+    uint32_t  num_symbols
+    uint32_t  num_outputs
+    uint32_t  sizeof (fixedpt)
+    then for every symbol
+      char      symbol [ORDER_SYMBOL_LEN]
+      uint32_t  num_rows
+      uint64_t  tstamp [num_rows]     - microseconds since the first trade
+      uint8_t   type   [num_rows]     - ADD or UPDATE
+      fixedpt   output [num_outputs][num_rows]
+
+  If a store directory is given, the same values plus the bars go into
+  the columnar time series files of ts_store.h, one per symbol and series:
+  "<symbol>.bars_i<interval>.ts" (see BarColumn) and
+  "<symbol>.<indicator>_i<interval>_n<periods>.ts" (type, outputs...).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include "fixedpt_cpp.h"
+#include "msg_trade.h"
+#include "msg_parsing.h"
+#include "indicator_lib.hpp"
+#include "ts_store.h"
+
+using namespace SynapseHC;
+
+enum IndicatorKind
+{
+  KIND_TRIX,
+  KIND_DMI,
+  KIND_VORTEX
+};
+
+static const char* s_kind_names[] = { "trix", "dmi", "vortex" };
+
+struct SweepParams
+{
+  SweepParams ()
+  {
+    _file = _output_dir = _store_dir = NULL;
+    _is_trix = _is_dmi = _is_vortex = false;
+    _periods_from = _periods_to = 13;
+    _periods_step = 1;
+    _num_threads  = sysconf (_SC_NPROCESSORS_ONLN);
+  }
+
+  const char*               _file;
+  const char*               _output_dir;
+  const char*               _store_dir;
+  bool                      _is_trix;
+  bool                      _is_dmi;
+  bool                      _is_vortex;
+  std::vector<std::string>  _symbols;
+  std::vector<int>          _intervals_secs;
+  int                       _periods_from;
+  int                       _periods_to;
+  int                       _periods_step;
+  int                       _num_threads;
+}; // struct SweepParams
+
+struct Trade
+{
+  uint64_t  _tstamp;  // microseconds since the first trade
+  MsgTrade  _msg;
+}; // struct Trade
+
+struct BarEvent
+{
+  uint64_t    _tstamp;
+  Bar         _bar;
+  int64_t     _volume;
+  UpdateType  _type;
+}; // struct BarEvent
+
+// the bars of one symbol for one interval length
+struct BarStream
+{
+  BarStream () : _initialized (false) {}
+
+  bool                  _initialized;
+  Bar                   _init_bar;
+  std::vector<BarEvent> _events;
+}; // struct BarStream
+
+struct SymbolData
+{
+  SymbolData () { memset (_symbol, '\0', ORDER_SYMBOL_LEN); }
+
+  char                    _symbol [ORDER_SYMBOL_LEN];
+  std::vector<Trade>      _trades;
+  std::vector<BarStream>  _streams; // one per interval length
+}; // struct SymbolData
+
+struct ParamSet
+{
+  IndicatorKind         _kind;
+  int                   _interval_idx;
+  int                   _periods;
+  int                   _outputs;
+  int                   _symbols_left;
+  std::vector<fixedpt*> _results;   // per symbol, _outputs columns
+}; // struct ParamSet
+
+struct Task
+{
+  int     _param_set;
+  int     _symbol;
+  size_t  _cost;
+}; // struct Task
+
+struct WorkQueue
+{
+  pthread_mutex_t   _lock;
+  std::deque<int>   _tasks;
+}; // struct WorkQueue
+
+static SweepParams              g_params;
+static std::vector<SymbolData>  g_symbols;
+static std::vector<ParamSet>    g_param_sets;
+static std::vector<Task>        g_tasks;
+static std::vector<WorkQueue>   g_queues;
+static bool                     g_debug = false;
+
+static uint64_t now_usecs ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+
+  return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static void parse_list (
+  const char*               in_str,
+  std::vector<std::string>& values)
+{
+  char* str = strdup (in_str);
+
+  char* t = strtok (str, ",");
+  while (t != NULL)
+  {
+    values.push_back (t);
+    t = strtok (NULL, ",");
+  }
+
+  free (str);
+}
+
+static void print_usage (const char* name)
+{
+  printf ("Usage: %s -f FILE [-t] [-d] [-v] [-s SYMBOLS] [-i SECS,...] [-n FROM:TO[:STEP]]\n"
+          "          [-j THREADS] [-o DIR] [-c DIR] [-e]\n", name);
+}
+
+static void parse_cmds (int argc, char** argv, SweepParams& p)
+{
+  // -f file - the trades file (see data/trades.txt)
+  // -t - TRIX
+  // -d - DMI
+  // -v - Vortex
+  // -s "..." - a string of comma separated symbols, all symbols if not given
+  // -i "..." - comma separated interval lengths in seconds
+  // -n from:to[:step] - the range of periods (ewma periods or sum length)
+  // -j ... - number of worker threads, one per core by default
+  // -o dir - write the results into this directory
+  // -c dir - write the bars and the results into a time series store there
+  // -e debug
+
+  extern char*  optarg;
+
+  int c = '\0';
+  while ((c = getopt(argc, argv, "f:tdvs:i:n:j:o:c:e")) != -1)
+  {
+    switch (c) {
+      case 'f':
+        p._file = optarg;
+        break;
+      case 't':
+        p._is_trix = true;
+        break;
+      case 'd':
+        p._is_dmi = true;
+        break;
+      case 'v':
+        p._is_vortex = true;
+        break;
+      case 's':
+        parse_list (optarg, p._symbols);
+        break;
+      case 'i':
+        {
+          std::vector<std::string> intervals;
+          parse_list (optarg, intervals);
+          for (int i = 0; i < intervals.size (); ++i)
+          {
+            p._intervals_secs.push_back (atoi (intervals[i].c_str ()));
+          }
+        }
+        break;
+      case 'n':
+        if (sscanf (optarg, "%d:%d:%d", &p._periods_from, &p._periods_to, &p._periods_step) < 2)
+        {
+          p._periods_to = p._periods_from;
+        }
+        break;
+      case 'j':
+        p._num_threads = atoi (optarg);
+        break;
+      case 'o':
+        p._output_dir = optarg;
+        break;
+      case 'c':
+        p._store_dir = optarg;
+        break;
+      case 'e':
+        g_debug = true;
+        break;
+      default:
+        print_usage (argv[0]);
+        exit (1);
+        break;
+    }
+  }
+
+  if (p._intervals_secs.empty ())
+  {
+    p._intervals_secs.push_back (10);
+  }
+
+  if ((p._file == NULL) || !(p._is_trix || p._is_dmi || p._is_vortex) ||
+      (p._periods_from < 2) || (p._periods_to < p._periods_from) ||
+      (p._periods_step < 1) || (p._num_threads < 1))
+  {
+    print_usage (argv[0]);
+    exit (1);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// parsing and bar aggregation - done once
+
+static void read_trades (const SweepParams& pars)
+{
+  FILE* file = fopen (pars._file, "r");
+  if (file == NULL)
+  {
+    printf ("Could not open %s, error is %s\n", pars._file, strerror (errno));
+    exit (1);
+  }
+
+  std::map<std::string, int> symbol_idx;
+  for (int i = 0; i < pars._symbols.size (); ++i)
+  {
+    symbol_idx.insert (std::make_pair (pars._symbols[i], i));
+  }
+  g_symbols.resize (pars._symbols.size ());
+  for (int i = 0; i < pars._symbols.size (); ++i)
+  {
+    strncpy (g_symbols[i]._symbol, pars._symbols[i].c_str (), ORDER_SYMBOL_LEN - 1);
+  }
+
+  // populate_msg_trade expects the 8 byte timestamp in front of the msg
+  const size_t  tstamp_len = 8;
+  char          line [BUFSIZ];
+  uint64_t      tstamp     = 0;
+  size_t        line_num   = 0;
+
+  memset (line, '\0', tstamp_len);
+
+  while (fgets (line + tstamp_len, sizeof (line) - tstamp_len, file) != NULL)
+  {
+    ++line_num;
+
+    size_t len = strlen (line + tstamp_len);
+    while ((len > 0) && ((line[tstamp_len + len - 1] == '\n') || (line[tstamp_len + len - 1] == '\r')))
+    {
+      --len;
+    }
+
+    Trade trade;
+    if (!populate_msg_trade (trade._msg, line, tstamp_len + len))
+    {
+      printf ("Could not parse line %zu, skipping\n", line_num);
+      continue;
+    }
+
+    // the second field is the delta from the previous trade
+    const char* delta = strchr (line + tstamp_len, '|');
+    if (delta != NULL)
+    {
+      tstamp += strtoull (delta + 1, NULL, 10);
+    }
+    trade._tstamp = tstamp;
+
+    std::map<std::string, int>::iterator iter = symbol_idx.find (trade._msg._symbol);
+    if (iter == symbol_idx.end ())
+    {
+      if (!pars._symbols.empty ())
+      {
+        continue; // not in our filter group
+      }
+      iter = symbol_idx.insert (std::make_pair (std::string (trade._msg._symbol),
+                                                (int) g_symbols.size ())).first;
+      g_symbols.resize (g_symbols.size () + 1);
+    }
+
+    SymbolData& data = g_symbols[iter->second];
+    memcpy (data._symbol, trade._msg._symbol, ORDER_SYMBOL_LEN);
+    data._trades.push_back (trade);
+  }
+
+  fclose (file);
+}
+
+static Bar make_bar (const TimeStats& time_stats)
+{
+  Bar bar;
+  bar._high   = FixedPt::fromC (time_stats._high);
+  bar._low    = FixedPt::fromC (time_stats._low);
+  bar._open   = FixedPt::fromC (time_stats._open);
+  bar._close  = FixedPt::fromC (time_stats._close);
+
+  return bar;
+}
+
+/*
+  Same as indie: the timer starts with the first trade and fires every
+  interval for every symbol, the trades in between are UPDATEs if they
+  change the hloc. ADDs before the symbol's first trade are not emitted.
+*/
+static void aggregate_bars (
+  const std::vector<Trade>& trades,
+  const uint64_t            start_tstamp,
+  const uint64_t            interval_usecs,
+  BarStream&                stream)
+{
+  TimeStats time_stats;
+  uint64_t  next_add = start_tstamp + interval_usecs;
+
+  for (size_t i = 0; i < trades.size (); ++i)
+  {
+    const Trade& trade = trades[i];
+
+    while (trade._tstamp >= next_add)
+    {
+      if (stream._initialized)
+      {
+        BarEvent event;
+        event._tstamp = next_add;
+        event._bar    = make_bar (time_stats);
+        event._volume = time_stats._size;
+        event._type   = ADD;
+        stream._events.push_back (event);
+      }
+      time_stats.rollover ();
+      next_add += interval_usecs;
+    }
+
+    if (!update_hloc (trade._msg, time_stats, g_debug))
+    {
+      continue; // no update = no recalculation
+    }
+
+    if (!stream._initialized)
+    {
+      stream._init_bar    = make_bar (time_stats);
+      stream._initialized = true;
+      continue;
+    }
+
+    BarEvent event;
+    event._tstamp = trade._tstamp;
+    event._bar    = make_bar (time_stats);
+    event._volume = time_stats._size;
+    event._type   = UPDATE;
+    stream._events.push_back (event);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// the sweep
+
+template <typename Ind>
+static void run_stream (
+  const BarStream&  stream,
+  const int         periods,
+  fixedpt*          results)
+{
+  const size_t  num_events = stream._events.size ();
+  Ind           indicator (periods);
+  FixedPt       values [Ind::outputs];
+
+  indicator.initialize (stream._init_bar);
+
+  for (size_t i = 0; i < num_events; ++i)
+  {
+    const BarEvent& event = stream._events[i];
+
+    indicator.calculate_value (event._bar, event._type, values);
+
+    for (int o = 0; o < Ind::outputs; ++o)
+    {
+      results [o * num_events + i] = values[o].getC ();
+    }
+  }
+}
+
+static void write_param_set (ParamSet& param_set)
+{
+  char file_name [PATH_MAX];
+  snprintf (file_name, sizeof (file_name), "%s/%s_i%d_n%d.col", g_params._output_dir,
+            s_kind_names[param_set._kind],
+            g_params._intervals_secs[param_set._interval_idx], param_set._periods);
+
+  FILE* file = fopen (file_name, "w");
+  if (file == NULL)
+  {
+    printf ("Could not open %s, error is %s\n", file_name, strerror (errno));
+    return;
+  }
+
+  const uint32_t num_symbols = g_symbols.size ();
+  const uint32_t num_outputs = param_set._outputs;
+  const uint32_t value_size  = sizeof (fixedpt);
+
+  fwrite (&num_symbols, sizeof (num_symbols), 1, file);
+  fwrite (&num_outputs, sizeof (num_outputs), 1, file);
+  fwrite (&value_size,  sizeof (value_size),  1, file);
+
+  std::vector<uint64_t> tstamps;
+  std::vector<uint8_t>  types;
+
+  for (uint32_t s = 0; s < num_symbols; ++s)
+  {
+    const BarStream& stream   = g_symbols[s]._streams[param_set._interval_idx];
+    const uint32_t   num_rows = stream._events.size ();
+
+    tstamps.resize (num_rows);
+    types.resize   (num_rows);
+    for (uint32_t i = 0; i < num_rows; ++i)
+    {
+      tstamps[i] = stream._events[i]._tstamp;
+      types[i]   = stream._events[i]._type;
+    }
+
+    fwrite (g_symbols[s]._symbol, ORDER_SYMBOL_LEN, 1, file);
+    fwrite (&num_rows, sizeof (num_rows), 1, file);
+    if (num_rows > 0)
+    {
+      fwrite (&tstamps[0], sizeof (uint64_t), num_rows, file);
+      fwrite (&types[0],   sizeof (uint8_t),  num_rows, file);
+      fwrite (param_set._results[s], sizeof (fixedpt), num_rows * num_outputs, file);
+    }
+  }
+
+  fclose (file);
+}
+
+static void store_param_set (ParamSet& param_set)
+{
+  char series [64];
+  snprintf (series, sizeof (series), "%s_i%d_n%d", s_kind_names[param_set._kind],
+            g_params._intervals_secs[param_set._interval_idx], param_set._periods);
+
+  std::vector<int64_t> row (1 + param_set._outputs);
+
+  for (size_t s = 0; s < g_symbols.size (); ++s)
+  {
+    const BarStream& stream     = g_symbols[s]._streams[param_set._interval_idx];
+    const size_t     num_events = stream._events.size ();
+
+    if (num_events == 0)
+    {
+      continue;
+    }
+
+    TsWriter writer;
+    if (!writer.open (ts_series_path (g_params._store_dir, g_symbols[s]._symbol, series).c_str (),
+                      row.size ()))
+    {
+      return;
+    }
+
+    for (size_t i = 0; i < num_events; ++i)
+    {
+      row[0] = stream._events[i]._type;
+      for (int o = 0; o < param_set._outputs; ++o)
+      {
+        row[1 + o] = param_set._results[s][o * num_events + i];
+      }
+      writer.append (stream._events[i]._tstamp, &row[0]);
+    }
+
+    writer.close ();
+  }
+}
+
+static void store_bars (const int interval_idx)
+{
+  char series [64];
+  snprintf (series, sizeof (series), "bars_i%d", g_params._intervals_secs[interval_idx]);
+
+  int64_t row [BAR_COLUMNS];
+
+  for (size_t s = 0; s < g_symbols.size (); ++s)
+  {
+    const BarStream& stream = g_symbols[s]._streams[interval_idx];
+
+    if (stream._events.empty ())
+    {
+      continue;
+    }
+
+    TsWriter writer;
+    if (!writer.open (ts_series_path (g_params._store_dir, g_symbols[s]._symbol, series).c_str (),
+                      BAR_COLUMNS))
+    {
+      return;
+    }
+
+    for (size_t i = 0; i < stream._events.size (); ++i)
+    {
+      const BarEvent& event = stream._events[i];
+
+      row[BAR_TYPE]   = event._type;
+      row[BAR_OPEN]   = event._bar._open.getC ();
+      row[BAR_HIGH]   = event._bar._high.getC ();
+      row[BAR_LOW]    = event._bar._low.getC ();
+      row[BAR_CLOSE]  = event._bar._close.getC ();
+      row[BAR_VOLUME] = event._volume;
+
+      writer.append (event._tstamp, row);
+    }
+
+    writer.close ();
+  }
+}
+
+static void run_task (const Task& task)
+{
+  ParamSet&         param_set = g_param_sets[task._param_set];
+  const BarStream&  stream    = g_symbols[task._symbol]._streams[param_set._interval_idx];
+  fixedpt*          results   = new fixedpt [param_set._outputs * stream._events.size () + 1];
+
+  param_set._results[task._symbol] = results;
+
+  if (stream._initialized)
+  {
+    switch (param_set._kind)
+    {
+      case KIND_TRIX:
+        run_stream<TrixT>   (stream, param_set._periods, results);
+        break;
+      case KIND_DMI:
+        run_stream<DmiT>    (stream, param_set._periods, results);
+        break;
+      case KIND_VORTEX:
+        run_stream<VortexT> (stream, param_set._periods, results);
+        break;
+    }
+  }
+
+  // whoever finishes the last symbol of a parameter set writes it out
+  if (__sync_sub_and_fetch (&param_set._symbols_left, 1) == 0)
+  {
+    if (g_params._output_dir != NULL)
+    {
+      write_param_set (param_set);
+    }
+    if (g_params._store_dir != NULL)
+    {
+      store_param_set (param_set);
+    }
+    for (size_t s = 0; s < param_set._results.size (); ++s)
+    {
+      delete [] param_set._results[s];
+      param_set._results[s] = NULL;
+    }
+  }
+}
+
+static bool pop_task (const int worker, int& task)
+{
+  const int num_queues = g_queues.size ();
+
+  // own queue first (from the back), then steal from the others (from the front)
+  for (int i = 0; i < num_queues; ++i)
+  {
+    WorkQueue& queue = g_queues[(worker + i) % num_queues];
+
+    pthread_mutex_lock (&queue._lock);
+    if (!queue._tasks.empty ())
+    {
+      if (i == 0)
+      {
+        task = queue._tasks.back ();
+        queue._tasks.pop_back ();
+      }
+      else
+      {
+        task = queue._tasks.front ();
+        queue._tasks.pop_front ();
+      }
+      pthread_mutex_unlock (&queue._lock);
+      return true;
+    }
+    pthread_mutex_unlock (&queue._lock);
+  }
+
+  // no new tasks are ever created, so once all queues are empty we are done
+  return false;
+}
+
+extern "C"
+{
+
+static void* worker_main (void* arg)
+{
+  const int worker = (int) (intptr_t) arg;
+  int       task   = 0;
+
+  while (pop_task (worker, task))
+  {
+    run_task (g_tasks[task]);
+  }
+
+  return NULL;
+}
+
+} // extern "C"
+
+static bool task_less (const Task& lhs, const Task& rhs)
+{
+  if (lhs._param_set != rhs._param_set)
+  {
+    return lhs._param_set < rhs._param_set;
+  }
+  return lhs._cost > rhs._cost;
+}
+
+static void create_tasks (const SweepParams& pars)
+{
+  std::vector<IndicatorKind> kinds;
+  if (pars._is_trix)   { kinds.push_back (KIND_TRIX);   }
+  if (pars._is_dmi)    { kinds.push_back (KIND_DMI);    }
+  if (pars._is_vortex) { kinds.push_back (KIND_VORTEX); }
+
+  for (int k = 0; k < kinds.size (); ++k)
+  {
+    for (int i = 0; i < pars._intervals_secs.size (); ++i)
+    {
+      for (int n = pars._periods_from; n <= pars._periods_to; n += pars._periods_step)
+      {
+        ParamSet param_set;
+        param_set._kind         = kinds[k];
+        param_set._interval_idx = i;
+        param_set._periods      = n;
+        param_set._outputs      = (kinds[k] == KIND_VORTEX) ? VortexT::outputs : 1;
+        param_set._symbols_left = g_symbols.size ();
+
+        for (int s = 0; s < g_symbols.size (); ++s)
+        {
+          param_set._results.push_back (NULL); // allocated by the task
+
+          Task task;
+          task._param_set = g_param_sets.size ();
+          task._symbol    = s;
+          task._cost      = g_symbols[s]._streams[i]._events.size ();
+          g_tasks.push_back (task);
+        }
+
+        g_param_sets.push_back (param_set);
+      }
+    }
+  }
+
+  // the parameter sets are kept in order, so that only a few of them are
+  // in flight (i.e. hold results in memory) at any time, but within a set
+  // the longest tasks go first and the short ones fill the gaps
+  std::stable_sort (g_tasks.begin (), g_tasks.end (), task_less);
+
+  g_queues.resize (pars._num_threads);
+  for (int q = 0; q < g_queues.size (); ++q)
+  {
+    pthread_mutex_init (&g_queues[q]._lock, NULL);
+  }
+  // the back of every queue is taken first by its owner
+  for (int t = g_tasks.size () - 1; t >= 0; --t)
+  {
+    g_queues[t % g_queues.size ()]._tasks.push_back (t);
+  }
+}
+
+int main (int argc, char** argv)
+{
+  parse_cmds (argc, argv, g_params);
+
+  uint64_t start = now_usecs ();
+
+  read_trades (g_params);
+
+  size_t num_trades = 0;
+  for (int s = 0; s < g_symbols.size (); ++s)
+  {
+    num_trades += g_symbols[s]._trades.size ();
+  }
+  printf ("Read %zu trades for %zu symbols in %.3f secs\n", num_trades, g_symbols.size (),
+          (now_usecs () - start) / 1e6);
+
+  // the timer starts with the first trade of our symbols
+  uint64_t first_tstamp = UINT64_MAX;
+  for (int s = 0; s < g_symbols.size (); ++s)
+  {
+    if (!g_symbols[s]._trades.empty () && (g_symbols[s]._trades[0]._tstamp < first_tstamp))
+    {
+      first_tstamp = g_symbols[s]._trades[0]._tstamp;
+    }
+  }
+
+  size_t num_events = 0;
+  for (int s = 0; s < g_symbols.size (); ++s)
+  {
+    SymbolData& data = g_symbols[s];
+    data._streams.resize (g_params._intervals_secs.size ());
+
+    for (int i = 0; i < g_params._intervals_secs.size (); ++i)
+    {
+      aggregate_bars (data._trades, first_tstamp,
+                      g_params._intervals_secs[i] * 1000000ULL, data._streams[i]);
+      num_events += data._streams[i]._events.size ();
+    }
+  }
+
+  if (g_params._store_dir != NULL)
+  {
+    for (int i = 0; i < g_params._intervals_secs.size (); ++i)
+    {
+      store_bars (i);
+    }
+  }
+
+  create_tasks (g_params);
+
+  printf ("Running %zu parameter sets (%zu tasks) on %d threads\n",
+          g_param_sets.size (), g_tasks.size (), g_params._num_threads);
+
+  start = now_usecs ();
+
+  std::vector<pthread_t> threads (g_params._num_threads);
+  for (int t = 0; t < threads.size (); ++t)
+  {
+    pthread_create (&threads[t], NULL, worker_main, (void*) (intptr_t) t);
+  }
+  for (int t = 0; t < threads.size (); ++t)
+  {
+    pthread_join (threads[t], NULL);
+  }
+
+  const double   secs     = (now_usecs () - start) / 1e6;
+  const uint64_t total    = (uint64_t) num_events *
+                              (g_param_sets.size () / g_params._intervals_secs.size ());
+  printf ("Done in %.3f secs, %lu bar updates, %.1f M updates/sec\n",
+          secs, total, total / secs / 1e6);
+
+  return 0;
+}
@@ -0,0 +1,364 @@
+// Copyright QUB 2019
+
+// The receive paths of indie side by side over loopback: a sender thread
+// sends trade msgs at a fixed rate and a receiver thread reads them with
+// recvfrom, recvmmsg or io_uring, and finds their symbol in place. For
+// every rate it prints what the receiver got, the CPU it took and the
+// syscalls per msg.
+//
+//   bench_ingest [-d secs] [-r rate,rate,...] [-m recvfrom,recvmmsg,uring] [-p port]
+//                [-f trades file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <vector>
+#include "symbol_filter.h"
+#include "uring_recv.h"
+
+enum Mode { MODE_RECVFROM, MODE_RECVMMSG, MODE_URING };
+
+static const char*  s_mode_names[] = { "recvfrom", "recvmmsg", "uring" };
+static const int    s_batch        = 32;
+static const size_t s_buflen       = 512;
+
+struct Run
+{
+  Mode          _mode;
+  int           _port;
+  uint32_t      _rate;
+  uint32_t      _secs;
+  volatile bool _stop;
+
+  uint64_t      _sent;
+  uint64_t      _received;
+  uint64_t      _symbols_len;   // so that the symbol search is not optimised away
+  uint64_t      _syscalls;
+  double        _cpu_secs;
+  double        _wall_secs;
+};
+
+static double now_secs ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double thread_cpu_secs ()
+{
+  struct rusage usage;
+  getrusage (RUSAGE_THREAD, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+       + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static int open_receiver (const int port)
+{
+  int fd = socket (AF_INET, SOCK_DGRAM, 0);
+
+  int rcvbuf = 8 * 1024 * 1024;
+  setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+
+  // the blocking reads wake up now and then to see if the run is over
+  struct timeval timeout = { 0, 100000 };
+  setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+
+  struct sockaddr_in addr;
+  memset (&addr, '\0', sizeof (addr));
+  addr.sin_family       = AF_INET;
+  addr.sin_port         = htons (port);
+  addr.sin_addr.s_addr  = htonl (INADDR_LOOPBACK);
+  if (bind (fd, (struct sockaddr*) &addr, sizeof (addr)) < 0)
+  {
+    fprintf (stderr, "bind: %s\n", strerror (errno));
+    exit (1);
+  }
+  return fd;
+}
+
+struct OnMsg
+{
+  OnMsg (Run& run) : _run (run) {}
+
+  void operator () (const char* data, const size_t len)
+  {
+    const char* symbol;
+    size_t      symbol_len;
+    // past the 8 byte timestamp
+    if ((len > 8) && locate_trade_symbol (data + 8, len - 8, symbol, symbol_len))
+    {
+      _run._symbols_len += symbol_len;
+    }
+    ++_run._received;
+  }
+
+  Run& _run;
+};
+
+static void receive_recvfrom (Run& run, const int fd, OnMsg& on_msg)
+{
+  char buffer [s_buflen];
+  while (!run._stop)
+  {
+    ++run._syscalls;
+    const ssize_t len = recvfrom (fd, buffer, sizeof (buffer), 0, NULL, NULL);
+    if (len > 0)
+    {
+      on_msg (buffer, len);
+    }
+  }
+}
+
+static void receive_recvmmsg (Run& run, const int fd, OnMsg& on_msg)
+{
+  static char     buffers [s_batch][s_buflen];
+  struct mmsghdr  msgs    [s_batch];
+  struct iovec    iovecs  [s_batch];
+
+  memset (msgs, '\0', sizeof (msgs));
+  for (int i = 0; i < s_batch; ++i)
+  {
+    iovecs[i].iov_base          = buffers[i];
+    iovecs[i].iov_len           = s_buflen;
+    msgs[i].msg_hdr.msg_iov     = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+  }
+
+  while (!run._stop)
+  {
+    ++run._syscalls;
+    const int count = recvmmsg (fd, msgs, s_batch, MSG_WAITFORONE, NULL);
+    for (int i = 0; i < count; ++i)
+    {
+      on_msg (buffers[i], msgs[i].msg_len);
+    }
+  }
+}
+
+static void receive_uring (Run& run, const int fd, OnMsg& on_msg)
+{
+  UringRecv uring;
+  const int error = uring.setup (fd, 1024, s_buflen);
+  if (error)
+  {
+    fprintf (stderr, "io_uring: %s\n", strerror (error));
+    run._stop = true;
+    return;
+  }
+
+  struct pollfd pfd = { uring.fd (), POLLIN, 0 };
+  while (!run._stop)
+  {
+    if (uring.drain (on_msg) == 0)
+    {
+      // nothing completed, sleep on the ring
+      ++run._syscalls;
+      poll (&pfd, 1, 100);
+    }
+  }
+  run._syscalls += uring.syscalls ();
+}
+
+static void* receiver_thread (void* arg)
+{
+  Run&      run   = *static_cast<Run*>(arg);
+  const int fd    = open_receiver (run._port);
+  OnMsg     on_msg (run);
+
+  const double cpu  = thread_cpu_secs ();
+  const double wall = now_secs ();
+
+  switch (run._mode)
+  {
+    case MODE_RECVFROM: receive_recvfrom (run, fd, on_msg); break;
+    case MODE_RECVMMSG: receive_recvmmsg (run, fd, on_msg); break;
+    case MODE_URING:    receive_uring    (run, fd, on_msg); break;
+  }
+
+  run._cpu_secs  = thread_cpu_secs () - cpu;
+  run._wall_secs = now_secs () - wall;
+  close (fd);
+  return NULL;
+}
+
+// sends at run._rate msgs a second, in batches of sendmmsg every 1ms
+static void send_msgs (Run& run, const std::vector<std::string>& lines)
+{
+  int fd = socket (AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  memset (&addr, '\0', sizeof (addr));
+  addr.sin_family       = AF_INET;
+  addr.sin_port         = htons (run._port);
+  addr.sin_addr.s_addr  = htonl (INADDR_LOOPBACK);
+  connect (fd, (struct sockaddr*) &addr, sizeof (addr));
+
+  std::vector<std::string> msgs (lines.size ());
+  for (size_t i = 0; i < lines.size (); ++i)
+  {
+    msgs[i] = std::string (8, '\0') + lines[i];
+  }
+
+  const double  start = now_secs ();
+  const double  end   = start + run._secs;
+  size_t        next  = 0;
+
+  struct mmsghdr  mm  [s_batch];
+  struct iovec    iov [s_batch];
+  memset (mm, '\0', sizeof (mm));
+
+  for (double now = start; now < end; now = now_secs ())
+  {
+    const uint64_t due = (uint64_t) ((now - start) * run._rate);
+    while (run._sent < due)
+    {
+      int count = 0;
+      while ((count < s_batch) && (run._sent + count < due))
+      {
+        const std::string& msg = msgs[next++ % msgs.size ()];
+        iov[count].iov_base         = const_cast<char*>(msg.data ());
+        iov[count].iov_len          = msg.size ();
+        mm[count].msg_hdr.msg_iov   = &iov[count];
+        mm[count].msg_hdr.msg_iovlen = 1;
+        ++count;
+      }
+      const int sent = sendmmsg (fd, mm, count, 0);
+      if (sent <= 0)
+      {
+        break;
+      }
+      run._sent += sent;
+    }
+    usleep (1000);
+  }
+  close (fd);
+}
+
+static void usage ()
+{
+  printf ("bench_ingest [-d secs] [-r rate,rate,...] [-m recvfrom,recvmmsg,uring] [-p port] [-f trades file]\n");
+}
+
+int main (int argc, char** argv)
+{
+  uint32_t              secs  = 3;
+  int                   port  = 25699;
+  std::string           file  = "trades.txt";
+  std::vector<uint32_t> rates;
+  std::vector<Mode>     modes;
+
+  int c;
+  while ((c = getopt (argc, argv, "d:r:m:p:f:h")) != -1)
+  {
+    switch (c)
+    {
+      case 'd':
+        secs = atoi (optarg);
+        break;
+      case 'r':
+        for (char* r = strtok (optarg, ","); r; r = strtok (NULL, ","))
+        {
+          rates.push_back (atoi (r));
+        }
+        break;
+      case 'm':
+        for (char* m = strtok (optarg, ","); m; m = strtok (NULL, ","))
+        {
+          for (int i = 0; i <= MODE_URING; ++i)
+          {
+            if (strcmp (m, s_mode_names[i]) == 0)
+            {
+              modes.push_back ((Mode) i);
+            }
+          }
+        }
+        break;
+      case 'p':
+        port = atoi (optarg);
+        break;
+      case 'f':
+        file = optarg;
+        break;
+      default:
+        usage ();
+        return 1;
+    }
+  }
+  if (rates.empty ())
+  {
+    rates.push_back (10000);
+    rates.push_back (100000);
+    rates.push_back (400000);
+  }
+  if (modes.empty ())
+  {
+    modes.push_back (MODE_RECVFROM);
+    modes.push_back (MODE_RECVMMSG);
+    modes.push_back (MODE_URING);
+  }
+
+  std::vector<std::string> lines;
+  FILE* f = fopen (file.c_str (), "r");
+  if (f)
+  {
+    char line [s_buflen];
+    while (fgets (line, sizeof (line), f) && (lines.size () < 100000))
+    {
+      const size_t len = strcspn (line, "\r\n");
+      if (len > 0)
+      {
+        lines.push_back (std::string (line, len));
+      }
+    }
+    fclose (f);
+  }
+  if (lines.empty ())
+  {
+    lines.push_back ("RRRRRRRRR|0|BPl|294.5|100");
+  }
+
+  printf ("%-10s %10s %12s %12s %8s %12s\n", "mode", "rate", "sent", "received", "cpu %", "syscalls/msg");
+  for (size_t r = 0; r < rates.size (); ++r)
+  {
+    for (size_t m = 0; m < modes.size (); ++m)
+    {
+      Run run;
+      memset (&run, '\0', sizeof (run));
+      run._mode = modes[m];
+      // a port per run, a closed io_uring lets go of its socket lazily
+      run._port = port + r * modes.size () + m;
+      run._rate = rates[r];
+      run._secs = secs;
+
+      pthread_t receiver;
+      pthread_create (&receiver, NULL, receiver_thread, &run);
+      usleep (100000);
+
+      send_msgs (run, lines);
+      usleep (200000);
+
+      run._stop = true;
+      pthread_join (receiver, NULL);
+
+      printf ("%-10s %10u %12llu %12llu %8.1f %12.3f\n",
+              s_mode_names[run._mode], run._rate,
+              (unsigned long long) run._sent, (unsigned long long) run._received,
+              100.0 * run._cpu_secs / run._wall_secs,
+              run._received ? (double) run._syscalls / run._received : 0.0);
+    }
+  }
+
+  return 0;
+}
@@ -84,6 +84,8 @@ bool Dmi::initialize (
   _prev_close = update_close;
   _prev_high  = update_high;
   _prev_low   = update_low;
+
+  return true;
 }
 
 FixedPt Dmi::calculate_value (
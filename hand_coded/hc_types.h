@@ -18,6 +18,12 @@ struct Params
   {
     _is_trix = _is_dmi = _is_vortex = _is_adline = false;
     _indicator_debug = false;
+    _symbol_bpf = false;
+    _reuseport_threads = 0;
+    _steer_by_symbol = false;
+    _spin_usecs = _kernel_busy_poll = 0;
+    _measure_latency = false;
+    _uring_bufs = 0;
     _ewma_periods = _interval_len_secs = _port = 0;
   }
 
@@ -26,6 +32,13 @@ struct Params
   bool                      _is_vortex;
   bool                      _is_adline;
   bool                      _indicator_debug;
+  bool                      _symbol_bpf;
+  int                       _reuseport_threads;
+  bool                      _steer_by_symbol;
+  int                       _spin_usecs;
+  int                       _kernel_busy_poll;
+  bool                      _measure_latency;
+  uint32_t                  _uring_bufs;
   std::vector<std::string>  _symbols;
   int                       _ewma_periods;
   int                       _interval_len_secs;
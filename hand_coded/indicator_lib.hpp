@@ -0,0 +1,554 @@
+// Copyright QUB 2019
+
+#ifndef synapse_indicator_lib_hpp
+#define synapse_indicator_lib_hpp
+
+#include "fixedpt_cpp.h"
+#include "circ_array.hpp"
+#include "hc_types.h"
+#include "common.h"
+
+/*
+  A header-only library of composable indicators. An indicator is a type
+  built out of nodes, e.g.
+
+    typedef Roc<Ewma<Ewma<Ewma<Close> > > >  TrixExpr;
+
+  and the whole tree - its state layout, the order in which the nodes are
+  updated and the way results flow between them - is fixed at compile time.
+  There are no virtual calls and no pointers between the nodes, the
+  compiler sees (and inlines) the complete calculation of an indicator.
+
+  Every node provides the same (static) interface:
+
+    Node (const int periods)    - periods are handed down to every node
+    bool init   (const Bar& bar, FixedPt& initial)
+                                - the first bar of a symbol, returns true
+                                  if the node has a value from it alone
+    bool update (const Bar& bar, const UpdateType type)
+                                - calculates the node's value for the bar,
+                                  returns false if it cannot be calculated
+    void commit (const Bar& bar)
+                                - the bar was an ADD, make it the new state
+    const FixedPt& value ()     - the value calculated by update ()
+
+  The arithmetic is kept exactly the same as in Trix, Dmi and Vortex, so
+  these are interchangeable with (and the reference for) the hand-wired
+  classes and the Click graphs.
+*/
+
+namespace SynapseHC
+{
+
+struct Bar
+{
+  FixedPt _high;
+  FixedPt _low;
+  FixedPt _open;
+  FixedPt _close;
+}; // struct Bar
+
+// ------------------------------------------------------------------------
+// common parts of the nodes
+
+template <typename Derived>
+class Node
+{
+public:
+  inline const FixedPt& value () const { return _value; }
+
+protected:
+  inline Derived&       derived ()       { return static_cast<Derived&> (*this); }
+
+  FixedPt               _value;
+}; // class Node
+
+/*
+  A node with a single input. Derived classes implement
+
+    bool seed   (const bool has_initial, FixedPt& initial)
+    bool apply  (const FixedPt& input, const UpdateType type)
+    void store  ()
+*/
+template <typename Derived, typename In>
+class UnaryNode : public Node<Derived>
+{
+public:
+  UnaryNode (const int periods) : _in (periods) {}
+
+  inline bool init (const Bar& bar, FixedPt& initial)
+  {
+    const bool has_initial = _in.init (bar, initial);
+    return this->derived ().seed (has_initial, initial);
+  }
+
+  inline bool update (const Bar& bar, const UpdateType type)
+  {
+    if (!_in.update (bar, type))
+    {
+      return false;
+    }
+    return this->derived ().apply (_in.value (), type);
+  }
+
+  inline void commit (const Bar& bar)
+  {
+    _in.commit (bar);
+    this->derived ().store ();
+  }
+
+protected:
+  In      _in;
+}; // class UnaryNode
+
+/*
+  A node with three inputs that share one denominator (Dx, Vortex).
+  Derived classes implement
+
+    bool apply  (const FixedPt& a, const FixedPt& b, const FixedPt& c)
+*/
+template <typename Derived, typename A, typename B, typename C>
+class TernaryNode : public Node<Derived>
+{
+public:
+  TernaryNode (const int periods) : _a (periods), _b (periods), _c (periods) {}
+
+  inline bool init (const Bar& bar, FixedPt& initial)
+  {
+    FixedPt ignored;
+    _a.init (bar, ignored);
+    _b.init (bar, ignored);
+    _c.init (bar, ignored);
+    return false;
+  }
+
+  inline bool update (const Bar& bar, const UpdateType type)
+  {
+    if (!(_a.update (bar, type) && _b.update (bar, type) && _c.update (bar, type)))
+    {
+      return false;
+    }
+    return this->derived ().apply (_a.value (), _b.value (), _c.value ());
+  }
+
+  inline void commit (const Bar& bar)
+  {
+    _a.commit (bar);
+    _b.commit (bar);
+    _c.commit (bar);
+  }
+
+protected:
+  A       _a;
+  B       _b;
+  C       _c;
+}; // class TernaryNode
+
+// ------------------------------------------------------------------------
+// inputs
+
+#define SYNAPSE_BAR_FIELD(name, field)                                      \
+class name : public Node<name>                                              \
+{                                                                           \
+public:                                                                     \
+  name (const int) {}                                                       \
+  inline bool init   (const Bar& bar, FixedPt& initial)                     \
+  {                                                                         \
+    initial = bar.field;                                                    \
+    return true;                                                            \
+  }                                                                         \
+  inline bool update (const Bar& bar, const UpdateType)                     \
+  {                                                                         \
+    _value = bar.field;                                                     \
+    return true;                                                            \
+  }                                                                         \
+  inline void commit (const Bar&) {}                                        \
+};
+
+SYNAPSE_BAR_FIELD (High,  _high)
+SYNAPSE_BAR_FIELD (Low,   _low)
+SYNAPSE_BAR_FIELD (Open,  _open)
+SYNAPSE_BAR_FIELD (Close, _close)
+
+#undef SYNAPSE_BAR_FIELD
+
+/*
+  The inputs below depend on the previous (i.e. last ADDed) bar, so they
+  have no value for the very first bar of a symbol.
+*/
+template <typename Derived>
+class PrevBarNode : public Node<Derived>
+{
+public:
+  inline bool init   (const Bar& bar, FixedPt&) { _prev = bar; return false; }
+  inline void commit (const Bar& bar)           { _prev = bar; }
+
+protected:
+  Bar     _prev;
+}; // class PrevBarNode
+
+class Pdm : public PrevBarNode<Pdm>
+{
+public:
+  Pdm (const int) {}
+
+  inline bool update (const Bar& bar, const UpdateType)
+  {
+    if (((bar._high - _prev._high) < (_prev._low - bar._low)) ||
+        ((bar._high - _prev._high) < FixedPt::fromInt (0)))
+    {
+      _value = FixedPt::fromInt (0);
+    }
+    else
+    {
+      _value = bar._high - _prev._high;
+    }
+    return true;
+  }
+}; // class Pdm
+
+class Ndm : public PrevBarNode<Ndm>
+{
+public:
+  Ndm (const int) {}
+
+  inline bool update (const Bar& bar, const UpdateType)
+  {
+    if (((_prev._low - bar._low) < (bar._high - _prev._high)) ||
+        ((_prev._low - bar._low) < FixedPt::fromInt (0)))
+    {
+      _value = FixedPt::fromInt (0);
+    }
+    else
+    {
+      _value = _prev._low - bar._low;
+    }
+    return true;
+  }
+}; // class Ndm
+
+class TrueRange : public PrevBarNode<TrueRange>
+{
+public:
+  TrueRange (const int) {}
+
+  inline bool update (const Bar& bar, const UpdateType)
+  {
+    _value = max (_prev._close - bar._low,
+                  max (bar._high - bar._low, bar._high - _prev._close));
+    return true;
+  }
+}; // class TrueRange
+
+class Vmu : public PrevBarNode<Vmu>
+{
+public:
+  Vmu (const int) {}
+
+  inline bool update (const Bar& bar, const UpdateType)
+  {
+    _value = abs (bar._high - _prev._low);
+    return true;
+  }
+}; // class Vmu
+
+class Vmd : public PrevBarNode<Vmd>
+{
+public:
+  Vmd (const int) {}
+
+  inline bool update (const Bar& bar, const UpdateType)
+  {
+    _value = abs (bar._low - _prev._high);
+    return true;
+  }
+}; // class Vmd
+
+// ------------------------------------------------------------------------
+// transformations
+
+// same as EwmaHc
+template <typename In>
+class Ewma : public UnaryNode<Ewma<In>, In>
+{
+public:
+  Ewma (const int periods)
+    : UnaryNode<Ewma<In>, In> (periods)
+    , _initialized (false)
+  {
+    _alfa = FixedPt::fromInt (2) /
+              (FixedPt::fromInt (periods) + FixedPt::fromInt (1));
+  }
+
+  inline bool seed (const bool has_initial, FixedPt& initial)
+  {
+    if (has_initial)
+    {
+      _last_value  = initial;
+      _initialized = true;
+    }
+    return has_initial;
+  }
+
+  inline bool apply (const FixedPt& update, const UpdateType)
+  {
+    if (!_initialized)
+    {
+      _last_value  = update;
+      _initialized = true;
+      this->_value = update;
+      return true;
+    }
+    this->_value = (1 - _alfa)*update + _alfa*_last_value;
+    return true;
+  }
+
+  inline void store () { _last_value = this->_value; _initialized = true; }
+
+private:
+  FixedPt _alfa;
+  FixedPt _last_value;
+  bool    _initialized;
+}; // class Ewma
+
+/*
+  Same as SumRingBuffer, i.e. the value is the input plus the sum of the
+  last (periods - 1) committed inputs, but the sum is kept running rather
+  than recalculated on every ADD. With fixed point the two are identical.
+*/
+template <typename In>
+class Sum : public UnaryNode<Sum<In>, In>
+{
+public:
+  Sum (const int periods)
+    : UnaryNode<Sum<In>, In> (periods)
+    , _ring_buffer (periods - 1)
+    , _initialized (false)
+  {
+  }
+
+  inline bool seed (const bool, FixedPt&) { return false; }
+
+  inline bool apply (const FixedPt& update, const UpdateType type)
+  {
+    // catering for the first update situation, same as Vortex
+    if ((type == UPDATE) && !_initialized)
+    {
+      push_back (update);
+    }
+    this->_value = _sum + update;
+    return true;
+  }
+
+  inline void store () { push_back (this->_in.value ()); }
+
+private:
+  inline void push_back (const FixedPt& value)
+  {
+    if (_ring_buffer.is_full ())
+    {
+      _sum = _sum - _ring_buffer[0];
+    }
+    _ring_buffer.push_back (value, true /*overwrite*/);
+    _sum          = _sum + value;
+    _initialized  = true;
+  }
+
+  CircArray<FixedPt>  _ring_buffer;
+  FixedPt             _sum;
+  bool                _initialized;
+}; // class Sum
+
+// the rate of change in percent since the last ADD, the last step of Trix
+template <typename In>
+class Roc : public UnaryNode<Roc<In>, In>
+{
+public:
+  Roc (const int periods) : UnaryNode<Roc<In>, In> (periods) {}
+
+  inline bool seed (const bool has_initial, FixedPt& initial)
+  {
+    _last_value = initial;
+    return false;
+  }
+
+  inline bool apply (const FixedPt& update, const UpdateType)
+  {
+    if (_last_value.getC () == 0)
+    {
+      return false;
+    }
+    this->_value = 100*((update - _last_value)/_last_value);
+    return true;
+  }
+
+  inline void store () { _last_value = this->_in.value (); }
+
+private:
+  FixedPt _last_value;
+}; // class Roc
+
+// dx out of the smoothed pdm, ndm and tr
+template <typename PlusDm, typename MinusDm, typename Range>
+class Dx : public TernaryNode<Dx<PlusDm, MinusDm, Range>, PlusDm, MinusDm, Range>
+{
+public:
+  Dx (const int periods)
+    : TernaryNode<Dx<PlusDm, MinusDm, Range>, PlusDm, MinusDm, Range> (periods)
+  {
+  }
+
+  inline bool apply (const FixedPt& pdm, const FixedPt& ndm, const FixedPt& tr)
+  {
+    if (tr.getC () == 0)
+    {
+      return false; // flat prices, Dmi would trap on the division
+    }
+    const FixedPt pdi = pdm / tr;
+    const FixedPt ndi = ndm / tr;
+    if ((pdi + ndi).getC () == 0)
+    {
+      return false; // same as Dmi
+    }
+    this->_value = 100*abs (pdi - ndi) / (pdi + ndi);
+    return true;
+  }
+}; // class Dx
+
+// viu is the value, vid is the second value
+template <typename Up, typename Down, typename Range>
+class VortexIndex : public TernaryNode<VortexIndex<Up, Down, Range>, Up, Down, Range>
+{
+public:
+  VortexIndex (const int periods)
+    : TernaryNode<VortexIndex<Up, Down, Range>, Up, Down, Range> (periods)
+  {
+  }
+
+  inline bool apply (const FixedPt& up, const FixedPt& down, const FixedPt& range)
+  {
+    if (range.getC () == 0)
+    {
+      return false; // flat prices, Vortex would trap on the division
+    }
+    this->_value  = up / range;
+    _second_value = down / range;
+    return true;
+  }
+
+  inline const FixedPt& second_value () const { return _second_value; }
+
+private:
+  FixedPt _second_value;
+}; // class VortexIndex
+
+// ------------------------------------------------------------------------
+// indicators
+
+typedef Roc<Ewma<Ewma<Ewma<Close> > > >                      TrixExpr;
+
+typedef Ewma<Dx<Ewma<Pdm>, Ewma<Ndm>, Ewma<TrueRange> > >   DmiExpr;
+
+typedef VortexIndex<Sum<Vmu>, Sum<Vmd>, Sum<TrueRange> >     VortexExpr;
+
+template <typename Expr>
+struct Outputs
+{
+  static const int count = 1;
+
+  static inline void get (const Expr& expr, FixedPt* out) { out[0] = expr.value (); }
+};
+
+template <typename Up, typename Down, typename Range>
+struct Outputs<VortexIndex<Up, Down, Range> >
+{
+  static const int count = 2;
+
+  static inline void get (const VortexIndex<Up, Down, Range>& expr, FixedPt* out)
+  {
+    out[0] = expr.value ();
+    out[1] = expr.second_value ();
+  }
+};
+
+/*
+  The root of an indicator - applies the ADD/UPDATE protocol. If the
+  value cannot be calculated (a division by 0) the outputs are 0 and
+  nothing is committed, same as in Dmi.
+*/
+template <typename Expr>
+class Indicator
+{
+public:
+  static const int outputs = Outputs<Expr>::count;
+
+  Indicator (const int periods) : _expr (periods) {}
+
+  inline void initialize (const Bar& bar)
+  {
+    FixedPt ignored;
+    _expr.init (bar, ignored);
+  }
+
+  // writes "outputs" values to out
+  inline void calculate_value (const Bar& bar, const UpdateType type, FixedPt* out)
+  {
+    if (!_expr.update (bar, type))
+    {
+      for (int i = 0; i < outputs; ++i)
+      {
+        out[i] = FixedPt::fromInt (0);
+      }
+      return;
+    }
+    Outputs<Expr>::get (_expr, out);
+    if (type == ADD)
+    {
+      _expr.commit (bar);
+    }
+  }
+
+private:
+  Expr    _expr;
+}; // class Indicator
+
+typedef Indicator<TrixExpr>   TrixT;
+typedef Indicator<DmiExpr>    DmiT;
+typedef Indicator<VortexExpr> VortexT;
+
+/*
+  A set of indicators hosted for one symbol, e.g.
+
+    IndicatorSet<TrixT, IndicatorSet<DmiT, VortexT> >
+
+  The members are laid out next to each other and updated in order. The
+  outputs of all of them are written into one array.
+*/
+template <typename Head, typename Tail>
+class IndicatorSet
+{
+public:
+  static const int outputs = Head::outputs + Tail::outputs;
+
+  IndicatorSet (const int periods) : _head (periods), _tail (periods) {}
+
+  inline void initialize (const Bar& bar)
+  {
+    _head.initialize (bar);
+    _tail.initialize (bar);
+  }
+
+  inline void calculate_value (const Bar& bar, const UpdateType type, FixedPt* out)
+  {
+    _head.calculate_value (bar, type, out);
+    _tail.calculate_value (bar, type, out + Head::outputs);
+  }
+
+private:
+  Head    _head;
+  Tail    _tail;
+}; // class IndicatorSet
+
+} // namespace SynapseHC
+
+#endif
@@ -13,12 +13,21 @@
 #include <ext/hash_map>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 #include "trix.h"
 #include "dmi.h"
 #include "vortex.h"
 #include "fixedpt_cpp.h"
 #include "msg_trade.h"
 #include "msg_parsing.h"
+#include "symbol_filter.h"
+#include "uring_recv.h"
 #include "running_stat.hh"
 #include "array_wrapper.hh"
 #include "indicator_manager.h"
@@ -26,13 +35,75 @@
 typedef ArrayWrapper<char, ORDER_SYMBOL_LEN>  SymbolArrayWrapper;
 typedef __gnu_cxx::hash_map<SymbolArrayWrapper, std::pair<TimeStats,IndicatorManager*> >  SymbolsMap;
 
-SymbolsMap    gSymbols;
-int           gSocket = 0;
-bool          g_debug = false;
+// a socket with its own loop and symbols. There is one, on the default
+// loop, unless -r asks for a SO_REUSEPORT group with a thread per socket
+struct Worker
+{
+  Worker ()
+    : _id (0), _socket (-1), _measure_latency (false), _polls (0), _sleeps (0)
+    , _latency_count (0), _latency_sum (0), _latency_max (0), _uring (NULL)
+    , _params (NULL), _loop (NULL) {}
+
+  int               _id;
+  int               _socket;
+  bool              _measure_latency;
+  // busy polling
+  uint64_t          _polls;
+  uint64_t          _sleeps;
+  // kernel receive to read, in nanosecs
+  uint64_t          _latency_count;
+  uint64_t          _latency_sum;
+  uint64_t          _latency_max;
+  // the io_uring receive path, NULL with recvfrom
+  UringRecv*        _uring;
+  SymbolsMap        _symbols;
+  const Params*     _params;
+  struct ev_loop*   _loop;
+  ev_io             _io_watcher;
+  ev_timer          _timer_watcher;
+  ev_async          _stop_watcher;
+  pthread_t         _thread;
+};
 
-ev_timer      gTimerWatcher;
+bool          g_debug = false;
+volatile bool g_stop  = false;
 
 const size_t  BUFLEN  = 512;
+// the completions handled per io_uring callback, so the timer gets a look in
+const int     URING_BURST = 64;
+
+static uint64_t now_usecs ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+
+  return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+// the kernel timestamp of the datagram just read against now, which is
+// mostly the wakeup when the thread was asleep in libev
+static void record_latency (Worker& worker)
+{
+  struct timespec rx;
+  struct timespec now;
+  if (ioctl (worker._socket, SIOCGSTAMPNS, &rx) < 0)
+  {
+    return; // the first call only switches the timestamps on
+  }
+  clock_gettime (CLOCK_REALTIME, &now);
+
+  int64_t ns = (now.tv_sec - rx.tv_sec) * 1000000000LL + (now.tv_nsec - rx.tv_nsec);
+  if (ns < 0)
+  {
+    ns = 0;
+  }
+  ++worker._latency_count;
+  worker._latency_sum += ns;
+  if ((uint64_t) ns > worker._latency_max)
+  {
+    worker._latency_max = ns;
+  }
+}
 
 static void parse_symbol_list (
   const char*               in_str,
@@ -76,10 +147,20 @@ static void parse_cmds (int argc, char** argv, Params& p)
   // -i ... - interval len in seconds
   // -p ... - port to listen on
   // -e debug
+  // -b - let the kernel drop the msgs of the other symbols (socket filter)
+  // -r ... - a thread per core, each with its own SO_REUSEPORT socket
+  // -k - steer the msgs to the threads by symbol, not by flow. Always on
+  //      with -r: every thread subscribes to every symbol, so by flow the
+  //      trades of a symbol would be split between the bars of the threads
+  // -y ... - spin on the socket, sleep in libev after these usecs idle
+  // -u ... - SO_BUSY_POLL usecs, the kernel polls the device in recv
+  // -l - measure the latency from the kernel receiving a msg to reading it
+  //      (not with -g)
+  // -g ... - receive through io_uring into this many buffers (a power of 2)
 
   printf ("Trying to parse params\n");
 
-  while ((c = getopt(argc, argv, "tdvs:n:i:p:ewa")) != -1)
+  while ((c = getopt(argc, argv, "tdvs:n:i:p:ewabr:ky:u:lg:")) != -1)
   {
     switch (c) {
       case 't':
@@ -94,6 +175,27 @@ static void parse_cmds (int argc, char** argv, Params& p)
       case 'a':
         p._is_adline = true;
         break;
+      case 'b':
+        p._symbol_bpf = true;
+        break;
+      case 'r':
+        p._reuseport_threads = atoi (optarg);
+        break;
+      case 'k':
+        p._steer_by_symbol = true;
+        break;
+      case 'y':
+        p._spin_usecs = atoi (optarg);
+        break;
+      case 'u':
+        p._kernel_busy_poll = atoi (optarg);
+        break;
+      case 'l':
+        p._measure_latency = true;
+        break;
+      case 'g':
+        p._uring_bufs = atoi (optarg);
+        break;
       case 's':
         parse_symbol_list (optarg, p._symbols);
         break;
@@ -120,91 +222,129 @@ static void parse_cmds (int argc, char** argv, Params& p)
         break;
     }
   }
+
+  if ((p._reuseport_threads > 1) && !p._steer_by_symbol)
+  {
+    printf ("-r steers the msgs by symbol (-k)\n");
+    p._steer_by_symbol = true;
+  }
 }
 
-static void setup_conn (const Params& pars)
+static void setup_conn (const Params& pars, Worker& worker)
 {
   struct sockaddr_in  si_me;
 
-  if ((gSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))==-1)
+  if ((worker._socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))==-1)
   {
     printf ("could not create socket\n");
     exit(1);
   }
 
-  memset((char *) &si_me, 0, sizeof(si_me));
-  si_me.sin_family = AF_INET;
-  si_me.sin_port = htons(pars._port);
-  si_me.sin_addr.s_addr = htonl(INADDR_ANY);
-
-  if (bind(gSocket, (sockaddr*)&si_me, sizeof(si_me))==-1)
+  if (pars._kernel_busy_poll > 0)
   {
-    printf ("could not bind socket, error is %s\n", strerror (errno));
-    exit(1);
+    if (setsockopt (worker._socket, SOL_SOCKET, SO_BUSY_POLL,
+                    &pars._kernel_busy_poll, sizeof (pars._kernel_busy_poll)) < 0)
+    {
+      printf ("could not set SO_BUSY_POLL, error is %s\n", strerror (errno));
+      exit(1);
+    }
   }
-}
 
-static bool update_hloc (
-  const MsgTrade& msg_trade,
-  TimeStats&      time_stats)
-{
-  // 1. if first update in an interval
-  //    set the close, high, low to new trade's price
-  // 2. if not first update, update as usual
-
-  bool rc = false; // false = not updated. true = updated.
-
-  if (!(time_stats._first_time_updated))
+  // spinning reads must not block
+  if (pars._spin_usecs > 0)
   {
-    time_stats._high  = msg_trade._price;
-    time_stats._low   = msg_trade._price;
-    time_stats._close = msg_trade._price;
-    time_stats._size += msg_trade._size;
-
-    time_stats._first_time_updated  = true;
-    rc                              = true;
-
-    return true;
+    fcntl (worker._socket, F_SETFL, O_NONBLOCK);
   }
 
-  if (msg_trade._price > time_stats._high)
+  if (pars._reuseport_threads > 0)
   {
-    time_stats._high = msg_trade._price;
-    rc               = true;
+    int one = 1;
+    if (setsockopt (worker._socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof (one)) < 0)
+    {
+      printf ("could not set SO_REUSEPORT, error is %s\n", strerror (errno));
+      exit(1);
+    }
   }
 
-  if (msg_trade._price < time_stats._low)
+  memset((char *) &si_me, 0, sizeof(si_me));
+  si_me.sin_family = AF_INET;
+  si_me.sin_port = htons(pars._port);
+  si_me.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  // before bind, so that nothing gets queued unfiltered
+  if (pars._symbol_bpf)
   {
-    time_stats._low  = msg_trade._price;
-    rc               = true;
+    std::vector<struct sock_filter> prog;
+    // the UDP header and the timestamp come before the msg
+    if (!build_symbol_bpf (pars._symbols, 16, prog))
+    {
+      printf ("too many symbols for a socket filter\n");
+      exit(1);
+    }
+    const int err = attach_symbol_bpf (worker._socket, prog);
+    if (err != 0)
+    {
+      printf ("could not attach the socket filter, error is %s\n", strerror (err));
+      exit(1);
+    }
+    printf ("Attached a socket filter of %zu instructions\n", prog.size ());
   }
 
-  time_stats._size += msg_trade._size;
+  if (bind(worker._socket, (sockaddr*)&si_me, sizeof(si_me))==-1)
+  {
+    printf ("could not bind socket, error is %s\n", strerror (errno));
+    exit(1);
+  }
 
-  if (msg_trade._price != time_stats._close)
+  // the group's program, it can only be attached once the socket is in
+  // the group. The payload starts with the timestamp
+  if ((pars._reuseport_threads > 0) && pars._steer_by_symbol)
   {
-    time_stats._close = msg_trade._price;
-    rc                = true;
+    std::vector<struct sock_filter> prog;
+    build_steering_bpf (pars._reuseport_threads, 8, prog);
+    const int err = attach_symbol_bpf (worker._socket, prog, SO_ATTACH_REUSEPORT_CBPF);
+    if (err != 0)
+    {
+      printf ("could not attach the steering program, error is %s\n", strerror (err));
+      exit(1);
+    }
   }
+}
 
-  if (g_debug)
+static void create_symbols (const Params& pars, Worker& worker)
+{
+  // create hash map -> populate with symbols from "-s"
+  char symbol_buffer [ORDER_SYMBOL_LEN];
+  for (int i = 0; i < pars._symbols.size(); ++i)
   {
-    char high_str [25];
-    char low_str  [25];
-    char close_str[25];
-    char open_str [25];
+    memset (symbol_buffer, '\0', ORDER_SYMBOL_LEN);
+    strcpy (symbol_buffer, pars._symbols[i].c_str ());
+    SymbolArrayWrapper wrapper (symbol_buffer);
 
-    fixedpt_str (time_stats._high, high_str, 4);
-    fixedpt_str (time_stats._low, low_str, 4);
-    fixedpt_str (time_stats._close, close_str, 4);
-    fixedpt_str (time_stats._open, open_str, 4);
+    if (g_debug)
+    {
+      printf ("Trying to insert symbol %s into the symbol map of worker %d\n", wrapper.array_ptr (), worker._id);
+    }
 
-    printf ("TP: attempted to update time stats:\n");
-    printf ("\thigh - %s, low - %s, close - %s, open - %s, size - %ld\n",
-                    high_str, low_str, close_str, open_str, time_stats._size);
+    worker._symbols.insert (std::make_pair (wrapper, std::make_pair(TimeStats (), new IndicatorManager (pars, symbol_buffer))));
+  }
+}
 
+static void destroy_symbols (Worker& worker)
+{
+  // iterate over all the symbols and
+  // delete the indicator managers
+  SymbolsMap::iterator iter = worker._symbols.begin ();
+  while (iter != worker._symbols.end ())
+  {
+    IndicatorManager* mgr = iter->second.second;
+    if (mgr)
+    {
+      printf ("Deleting symbol %s\n", iter->first.array_ptr ());
+      delete mgr;
+    }
+    ++iter;
   }
-  return rc;
 }
 
 extern "C"
@@ -215,14 +355,23 @@ void on_timer_cb (
   struct ev_timer*  watcher,
   int               revents)
 {
+  Worker* worker = static_cast<Worker*>(watcher->data);
+
   // the map is "key --> <timestats, indicator_manager*>"
   // for every symbol
-  SymbolsMap::iterator iter = gSymbols.begin ();
-  while (iter != gSymbols.end ())
+  SymbolsMap::iterator iter = worker->_symbols.begin ();
+  while (iter != worker->_symbols.end ())
   {
     TimeStats&        time_stats  = iter->second.first;
     IndicatorManager* ind_mgr     = iter->second.second;
 
+    // no trade yet - it may well be another worker's symbol
+    if (!ind_mgr->initialized ())
+    {
+      ++iter;
+      continue;
+    }
+
     FixedPt close_price   = FixedPt::fromC(time_stats._close);
     FixedPt high_price    = FixedPt::fromC(time_stats._high);
     FixedPt low_price     = FixedPt::fromC(time_stats._low);
@@ -236,17 +385,43 @@ void on_timer_cb (
   }
 }
 
-static void udp_read_cb (
+static void process_datagram (
   struct ev_loop* loop,
-  struct ev_io*   watcher,
-  int             revents)
+  Worker*         worker,
+  char*           buffer,
+  int             bytesReceived);
+
+// the msgs are parsed where the kernel put them, in the slab of the ring
+struct UringMsg
 {
+  UringMsg (struct ev_loop* loop, Worker* worker) : _loop (loop), _worker (worker) {}
+
+  void operator () (char* data, const size_t len)
+  {
+    process_datagram (_loop, _worker, data, len);
+  }
+
+  struct ev_loop* _loop;
+  Worker*         _worker;
+};
+
+// false if there was nothing to read
+static bool read_datagram (
+  struct ev_loop* loop,
+  Worker*         worker,
+  const bool      spinning)
+{
+  if (worker->_uring)
+  {
+    UringMsg on_msg (loop, worker);
+    return worker->_uring->drain (on_msg, URING_BURST) > 0;
+  }
 
   char buffer [BUFLEN];
   struct sockaddr    clientAddress;
   socklen_t          clientAddrLen = sizeof (clientAddress);
 
-  int bytesReceived = recvfrom(gSocket,
+  int bytesReceived = recvfrom(worker->_socket,
                                buffer,
                                BUFLEN,
                                0, // flags
@@ -257,16 +432,45 @@ static void udp_read_cb (
   {
     if ((errno == EWOULDBLOCK) || (errno == EAGAIN))
     {
-      fprintf (stderr, "EWOULDBLOCK: no UDP message\n");
-      return;
+      // the normal case when spinning
+      if (!spinning)
+      {
+        fprintf (stderr, "EWOULDBLOCK: no UDP message\n");
+      }
+      return false;
     }
     else
     {
       fprintf (stderr, "Connection error, errno is %s\n", strerror (errno));
-      return;
+      return false;
     }
   }
 
+  if (worker->_measure_latency)
+  {
+    record_latency (*worker);
+  }
+
+  process_datagram (loop, worker, buffer, bytesReceived);
+  return true;
+}
+
+static void udp_read_cb (
+  struct ev_loop* loop,
+  struct ev_io*   watcher,
+  int             revents)
+{
+  Worker* worker = static_cast<Worker*>(watcher->data);
+
+  read_datagram (loop, worker, false);
+}
+
+static void process_datagram (
+  struct ev_loop* loop,
+  Worker*         worker,
+  char*           buffer,
+  int             bytesReceived)
+{
   if (bytesReceived > BUFLEN)
   {
     fprintf (stderr, "UDP packet size is greater than the buffer, continuing as is\n");
@@ -277,6 +481,31 @@ static void udp_read_cb (
     printf ("Read %d bytes from the socket\n", bytesReceived);
   }
 
+  // apply filtering before parsing the numbers - borrow from trade processor
+  const unsigned  tstamp_len  = 8;
+  const char*     symbol      = NULL;
+  size_t          symbol_len  = 0;
+  if ((bytesReceived <= (int) tstamp_len) ||
+        !locate_trade_symbol (buffer + tstamp_len, bytesReceived - tstamp_len, symbol, symbol_len) ||
+          (symbol_len > ORDER_SYMBOL_LEN - 1))
+  {
+    return;
+  }
+
+  char symbol_key [ORDER_SYMBOL_LEN];
+  memset (symbol_key, '\0', ORDER_SYMBOL_LEN);
+  memcpy (symbol_key, symbol, symbol_len);
+
+  SymbolsMap::iterator iter = worker->_symbols.find (SymbolArrayWrapper (symbol_key));
+  if (iter == worker->_symbols.end ())
+  {
+    if (g_debug)
+    {
+      printf ("Symbol %s is not in our filter group\n", symbol_key);
+    }
+    return;
+  }
+
   // parse into MsgTrade - borrow from trade processor
   MsgTrade msg;
   if (!populate_msg_trade (msg, buffer, bytesReceived))
@@ -290,30 +519,19 @@ static void udp_read_cb (
     printf ("Populated msg trade. Symbol %s, price %s\n", msg._symbol, fixedpt_cstr (msg._price, 4));
   }
   
-  // apply filtering - borrow from trade processor
-  SymbolsMap::iterator iter = gSymbols.find (msg._symbol);
-  if (iter == gSymbols.end ())
-  {
-    if (g_debug)
-    {
-      printf ("Symbol %s is not in our filter group\n", msg._symbol);
-    }
-    return;
-  }
-
   // per symbol need to be initialized first
   // if our symbol, start the ev_timer, if not already started
-  if (!ev_is_active (&gTimerWatcher))
+  if (!ev_is_active (&worker->_timer_watcher))
   {
     printf ("Starting timer to generate ADDs\n");
-    ev_timer_start(EV_DEFAULT, &gTimerWatcher);
+    ev_timer_start(loop, &worker->_timer_watcher);
   }
 
   IndicatorManager* ind_mgr     = iter->second.second;
   TimeStats&        time_stats  = iter->second.first;
 
   // update the hloc - borrow from trade processor
-  if (!update_hloc (msg, time_stats))
+  if (!update_hloc (msg, time_stats, g_debug))
   {
     // no update = no recalculation
     if (g_debug)
@@ -341,82 +559,219 @@ static void udp_read_cb (
 
 static void
 sigint_cb (struct ev_loop *loop, ev_signal *w, int revents)
+{
+  g_stop = true;
+  ev_break (loop, EVBREAK_ALL);
+}
+
+static void
+stop_cb (struct ev_loop *loop, ev_async *w, int revents)
 {
   ev_break (loop, EVBREAK_ALL);
 }
 
 } // extern "C"
 
-int main (int argc, char** argv)
+// the spin mode: reads the socket in a tight loop, and sleeps in libev
+// only once nothing has come for spin_usecs. libev still gets a look in
+// every so often, for the timer and the signals
+static void run_worker (const Params& pars, Worker& worker)
 {
-  // parse the parameters - take from hh
-  Params pars;
-  parse_cmds (argc, argv, pars);
+  if (pars._spin_usecs <= 0)
+  {
+    ev_run (worker._loop, 0);
+    return;
+  }
 
-  // create hash map -> populate with symbols from "-s"
-  char symbol_buffer [ORDER_SYMBOL_LEN];
-  for (int i = 0; i < pars._symbols.size(); ++i)
+  uint64_t last_rx = now_usecs ();
+  uint32_t count   = 0;
+  while (!g_stop)
   {
-    memset (symbol_buffer, '\0', ORDER_SYMBOL_LEN);
-    strcpy (symbol_buffer, pars._symbols[i].c_str ());
-    SymbolArrayWrapper wrapper (symbol_buffer);
+    ++worker._polls;
+    if (read_datagram (worker._loop, &worker, true))
+    {
+      last_rx = 0;
+    }
 
-    printf ("Trying to insert symbol %s into the symbol map\n", wrapper.array_ptr ());
+    if ((++count & 63) != 0)
+    {
+      continue;
+    }
+
+    ev_run (worker._loop, EVRUN_NOWAIT);
 
-    gSymbols.insert (std::make_pair (wrapper, std::make_pair(TimeStats (), new IndicatorManager (pars, symbol_buffer))));
+    // only read the clock every 64 polls
+    const uint64_t now = now_usecs ();
+    if (last_rx == 0)
+    {
+      last_rx = now;
+    }
+    else if (now - last_rx >= (uint64_t) pars._spin_usecs)
+    {
+      ++worker._sleeps;
+      ev_run (worker._loop, EVRUN_ONCE);
+      last_rx = now_usecs ();
+    }
   }
+}
+
+static void start_worker (const Params& pars, Worker& worker)
+{
+  worker._measure_latency = pars._measure_latency;
+
+  create_symbols (pars, worker);
+
   // create connection
-  setup_conn (pars);
+  setup_conn (pars, worker);
+
+  // with io_uring the ring fd is readable when there are completions
+  int read_fd = worker._socket;
+  if (pars._uring_bufs > 0)
+  {
+    worker._uring = new UringRecv ();
+    const int err = worker._uring->setup (worker._socket, pars._uring_bufs, BUFLEN);
+    if (err)
+    {
+      printf ("could not set up io_uring, error is %s\n", strerror (err));
+      exit(1);
+    }
+    read_fd = worker._uring->fd ();
+  }
+
+  // setup ev_io - to read from the socket
+  worker._io_watcher.data = &worker;
+  ev_io_init  (&worker._io_watcher, udp_read_cb, read_fd, EV_READ);
+  ev_io_start (worker._loop, &worker._io_watcher);
+
+  // initialize, but not start the timer watcher
+  worker._timer_watcher.data = &worker;
+  ev_timer_init (&worker._timer_watcher, on_timer_cb,
+      pars._interval_len_secs/*first firing*/,
+      pars._interval_len_secs/*repeat after these secs*/);
+
+  // the main thread stops the loop of a worker thread through this
+  ev_async_init  (&worker._stop_watcher, stop_cb);
+  ev_async_start (worker._loop, &worker._stop_watcher);
+}
+
+static void stop_worker (Worker& worker)
+{
+  if (worker._polls > 0)
+  {
+    printf ("Worker %d: %llu polls, %llu sleeps\n", worker._id,
+            (unsigned long long) worker._polls, (unsigned long long) worker._sleeps);
+  }
+  if (worker._latency_count > 0)
+  {
+    printf ("Worker %d: kernel to read latency avg %llu ns, max %llu ns, %llu msgs\n", worker._id,
+            (unsigned long long) (worker._latency_sum / worker._latency_count),
+            (unsigned long long) worker._latency_max,
+            (unsigned long long) worker._latency_count);
+  }
+
+  if (worker._uring)
+  {
+    printf ("Worker %d: io_uring %llu syscalls, %llu rearms, %llu out of buffers, %llu truncated\n",
+            worker._id,
+            (unsigned long long) worker._uring->syscalls (),
+            (unsigned long long) worker._uring->rearms (),
+            (unsigned long long) worker._uring->no_bufs (),
+            (unsigned long long) worker._uring->truncated ());
+    delete worker._uring;
+    worker._uring = NULL;
+  }
+
+  destroy_symbols (worker);
+
+  // close socket
+  close (worker._socket);
+}
+
+static void* worker_thread (void* arg)
+{
+  Worker* worker = static_cast<Worker*>(arg);
+
+  // a core per worker, the state of its symbols stays on it
+  cpu_set_t cpus;
+  CPU_ZERO (&cpus);
+  CPU_SET (worker->_id % sysconf (_SC_NPROCESSORS_ONLN), &cpus);
+  if (pthread_setaffinity_np (pthread_self (), sizeof (cpus), &cpus) != 0)
+  {
+    printf ("Could not pin worker %d\n", worker->_id);
+  }
+
+  run_worker (*worker->_params, *worker);
+  return NULL;
+}
+
+int main (int argc, char** argv)
+{
+  // parse the parameters - take from hh
+  Params pars;
+  parse_cmds (argc, argv, pars);
 
-  printf ("Opened socket to listen on port %d\n", pars._port);
-  
   // create the indicator objects
   // only trix for now
   // Trix trix (13);
 
   // create default loop
   ev_default_loop (EVFLAG_AUTO);
-  // setup ev_io - to read from the socket
-  ev_io io_watcher;
-  io_watcher.data = NULL;
-  ev_io_init  (&io_watcher, udp_read_cb, gSocket, EV_READ);
-  ev_io_start (EV_DEFAULT, &io_watcher);
+
+  const int num_workers = (pars._reuseport_threads > 0) ? pars._reuseport_threads : 1;
+  std::vector<Worker> workers (num_workers);
+  for (int i = 0; i < num_workers; ++i)
+  {
+    workers[i]._id      = i;
+    workers[i]._params  = &pars;
+    workers[i]._loop    = (pars._reuseport_threads > 0) ? ev_loop_new (EVFLAG_AUTO) : EV_DEFAULT;
+    start_worker (pars, workers[i]);
+  }
+
+  printf ("Opened %d socket(s) to listen on port %d\n", num_workers, pars._port);
 
   // setup sig handler to terminate application
   ev_signal signal_watcher;
   ev_signal_init (&signal_watcher, sigint_cb, SIGINT);
   ev_signal_start (EV_DEFAULT, &signal_watcher);
 
-  // initialize, but not start the timer watcher
-  gTimerWatcher.data = NULL;
-  ev_timer_init (&gTimerWatcher, on_timer_cb,
-      pars._interval_len_secs/*first firing*/,
-      pars._interval_len_secs/*repeat after these secs*/);
-
   printf ("Starting default EV loop\n");
 
-  // run ev loop
-  ev_run (EV_DEFAULT, 0);
+  if (pars._reuseport_threads > 0)
+  {
+    for (int i = 0; i < num_workers; ++i)
+    {
+      pthread_create (&workers[i]._thread, NULL, worker_thread, &workers[i]);
+    }
+  }
+
+  // run ev loop, the only worker runs on it, unless there is a group
+  if (pars._reuseport_threads > 0)
+  {
+    ev_run (EV_DEFAULT, 0);
+  }
+  else
+  {
+    run_worker (pars, workers[0]);
+  }
 
   // printf indicator stats
   printf ("Left the default loop\n");
 
-  // iterate over all the symbols and
-  // delete the indicator managers
-  SymbolsMap::iterator iter = gSymbols.begin ();
-  while (iter != gSymbols.end ())
+  if (pars._reuseport_threads > 0)
   {
-    IndicatorManager* mgr = iter->second.second;
-    if (mgr)
+    g_stop = true;
+    for (int i = 0; i < num_workers; ++i)
     {
-      printf ("Deleting symbol %s\n", iter->first.array_ptr ());
-      delete mgr;
+      ev_async_send (workers[i]._loop, &workers[i]._stop_watcher);
+      pthread_join  (workers[i]._thread, NULL);
+      ev_loop_destroy (workers[i]._loop);
     }
-    ++iter;
   }
 
-  // close socket
-  close (gSocket);
+  for (int i = 0; i < num_workers; ++i)
+  {
+    stop_worker (workers[i]);
+  }
 
   return 0;
 }
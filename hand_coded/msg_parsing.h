@@ -190,6 +190,68 @@ static bool populate_msg_trade (
   return true;
 }
 
+static bool update_hloc (
+  const MsgTrade& msg_trade,
+  TimeStats&      time_stats,
+  const bool      debug)
+{
+  // 1. if first update in an interval
+  //    set the close, high, low to new trade's price
+  // 2. if not first update, update as usual
+
+  bool rc = false; // false = not updated. true = updated.
+
+  if (!(time_stats._first_time_updated))
+  {
+    time_stats._high  = msg_trade._price;
+    time_stats._low   = msg_trade._price;
+    time_stats._close = msg_trade._price;
+    time_stats._size += msg_trade._size;
+
+    time_stats._first_time_updated  = true;
+    rc                              = true;
+
+    return true;
+  }
+
+  if (msg_trade._price > time_stats._high)
+  {
+    time_stats._high = msg_trade._price;
+    rc               = true;
+  }
 
+  if (msg_trade._price < time_stats._low)
+  {
+    time_stats._low  = msg_trade._price;
+    rc               = true;
+  }
+
+  time_stats._size += msg_trade._size;
+
+  if (msg_trade._price != time_stats._close)
+  {
+    time_stats._close = msg_trade._price;
+    rc                = true;
+  }
+
+  if (debug)
+  {
+    char high_str [25];
+    char low_str  [25];
+    char close_str[25];
+    char open_str [25];
+
+    fixedpt_str (time_stats._high, high_str, 4);
+    fixedpt_str (time_stats._low, low_str, 4);
+    fixedpt_str (time_stats._close, close_str, 4);
+    fixedpt_str (time_stats._open, open_str, 4);
+
+    printf ("TP: attempted to update time stats:\n");
+    printf ("\thigh - %s, low - %s, close - %s, open - %s, size - %ld\n",
+                    high_str, low_str, close_str, open_str, time_stats._size);
+
+  }
+  return rc;
+}
 
 #endif
@@ -1,3 +1,9 @@
 export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:/home/kostik/compilables/libev_4.24_install/lib/
 ./indie  -t -s "BPl" -n 13 -i 10 -p 25687 -e
+# a thread per core on SO_REUSEPORT sockets, steered by symbol
+#./indie  -t -s "BARCl,LLOYl,BPl" -n 13 -i 10 -p 25687 -r 4 -k -b
 #./indie  -t -s "BARCl,LLOYl" -n 13 -i 10 -p 25687 -e
+# spin on the socket, sleep after 10ms idle, print the kernel to read latency
+#./indie  -t -s "BPl" -n 13 -i 10 -p 25687 -y 10000 -l
+# receive through io_uring, 1024 buffers
+#./indie  -t -s "BPl" -n 13 -i 10 -p 25687 -g 1024
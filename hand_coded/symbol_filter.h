@@ -0,0 +1,184 @@
+// Copyright QUB 2019
+
+#ifndef symbol_filter_h
+#define symbol_filter_h
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <string>
+#include <vector>
+#include "msg_trade.h"
+
+// borrowed from the trade processor, see click/symbol_filter.hh
+
+// finds the symbol of "type|delta|SYMBOL|price|size" without parsing
+// the rest, memchr goes through the msg a vector at a time
+static bool locate_trade_symbol (
+  const char*   md_msg,
+  const size_t  md_len,
+  const char*&  symbol,
+  size_t&       symbol_len)
+{
+  const char* end = md_msg + md_len;
+  const char* bar = static_cast<const char*>(memchr (md_msg, '|', md_len));
+  if (!bar)
+  {
+    return false;
+  }
+  bar = static_cast<const char*>(memchr (bar + 1, '|', end - bar - 1));
+  if (!bar)
+  {
+    return false;
+  }
+  symbol = bar + 1;
+
+  bar = static_cast<const char*>(memchr (symbol, '|', end - symbol));
+  if (!bar)
+  {
+    return false;
+  }
+  symbol_len = bar - symbol;
+
+  return true;
+}
+
+static const uint32_t s_bpf_max_field_len = 24;
+
+static struct sock_filter bpf_insn (
+  const uint16_t code,
+  const uint32_t k,
+  const uint8_t  jt = 0,
+  const uint8_t  jf = 0)
+{
+  struct sock_filter insn = { code, jt, jf, k };
+  return insn;
+}
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+// leaves X at the start of the symbol: the '|' of the two fields before
+// it are searched byte by byte, BPF has no loops
+static void bpf_find_symbol (
+  const uint32_t                    offset,
+  std::vector<struct sock_filter>&  prog)
+{
+  prog.push_back (bpf_insn (BPF_LDX | BPF_IMM, 0));
+
+  for (int field = 0; field < 2; ++field)
+  {
+    const int end = prog.size () + s_bpf_max_field_len * 6 + 1;
+    for (uint32_t i = 0; i < s_bpf_max_field_len; ++i)
+    {
+      prog.push_back (bpf_insn (BPF_LD | BPF_B | BPF_IND, offset + i));
+      prog.push_back (bpf_insn (BPF_JMP | BPF_JEQ | BPF_K, '|', 0, 4));
+      prog.push_back (bpf_insn (BPF_MISC | BPF_TXA, 0));
+      prog.push_back (bpf_insn (BPF_ALU | BPF_ADD | BPF_K, i + 1));
+      prog.push_back (bpf_insn (BPF_MISC | BPF_TAX, 0));
+      prog.push_back (bpf_insn (BPF_JMP | BPF_JA, end - (prog.size () + 1)));
+    }
+    prog.push_back (bpf_insn (BPF_RET | BPF_K, 0));
+  }
+}
+
+// a classic BPF program that accepts only the trade msgs of the symbols,
+// offset is where the msg text starts - 16 on a UDP socket. The symbol
+// and its '|' are compared 4 bytes at a time with every symbol.
+// Returns false if it is too long for the kernel
+static bool build_symbol_bpf (
+  const std::vector<std::string>&   symbols,
+  const uint32_t                    offset,
+  std::vector<struct sock_filter>&  prog)
+{
+  prog.clear ();
+  bpf_find_symbol (offset, prog);
+
+  for (size_t s = 0; s < symbols.size (); ++s)
+  {
+    const std::string text   = symbols[s] + "|";
+    const int         len    = text.length ();
+    const int         chunks = (len + 3) / 4 + (((len % 4) == 3) ? 1 : 0);
+
+    int pos   = 0;
+    int chunk = 0;
+    while (pos < len)
+    {
+      const int left = len - pos;
+      const int size = (left >= 4) ? 4 : ((left >= 2) ? 2 : 1);
+
+      uint32_t value = 0;
+      for (int b = 0; b < size; ++b)
+      {
+        value = (value << 8) | (uint8_t) text[pos + b];
+      }
+
+      const uint16_t code = (size == 4) ? BPF_W : ((size == 2) ? BPF_H : BPF_B);
+      prog.push_back (bpf_insn (BPF_LD | code | BPF_IND, offset + pos));
+      prog.push_back (bpf_insn (BPF_JMP | BPF_JEQ | BPF_K, value, 0, 2 * (chunks - chunk) - 1));
+
+      pos += size;
+      ++chunk;
+    }
+    prog.push_back (bpf_insn (BPF_RET | BPF_K, 0xFFFFFFFF));
+  }
+  prog.push_back (bpf_insn (BPF_RET | BPF_K, 0));
+
+  return prog.size () <= BPF_MAXINSNS;
+}
+
+// the program of a SO_REUSEPORT group, it returns the index of the
+// socket from a hash of the symbol, so that a symbol always lands on the
+// same socket and thread. It sees the UDP payload, offset is 8
+static void build_steering_bpf (
+  const uint32_t                    num_sockets,
+  const uint32_t                    offset,
+  std::vector<struct sock_filter>&  prog)
+{
+  prog.clear ();
+  bpf_find_symbol (offset, prog);
+
+  // M[0] the hash, M[1] where the symbol starts
+  prog.push_back (bpf_insn (BPF_LD | BPF_IMM, 0));
+  prog.push_back (bpf_insn (BPF_ST, 0));
+  prog.push_back (bpf_insn (BPF_STX, 1));
+
+  const int steps = ORDER_SYMBOL_LEN - 1;
+  const int done  = prog.size () + steps * 9;
+  for (int i = 0; i < steps; ++i)
+  {
+    prog.push_back (bpf_insn (BPF_LDX | BPF_MEM, 1));
+    prog.push_back (bpf_insn (BPF_LD | BPF_B | BPF_IND, offset + i));
+    prog.push_back (bpf_insn (BPF_JMP | BPF_JEQ | BPF_K, '|', 0, 1));
+    prog.push_back (bpf_insn (BPF_JMP | BPF_JA, done - (prog.size () + 1)));
+    prog.push_back (bpf_insn (BPF_MISC | BPF_TAX, 0));
+    prog.push_back (bpf_insn (BPF_LD | BPF_MEM, 0));
+    prog.push_back (bpf_insn (BPF_ALU | BPF_MUL | BPF_K, 31));
+    prog.push_back (bpf_insn (BPF_ALU | BPF_ADD | BPF_X, 0));
+    prog.push_back (bpf_insn (BPF_ST, 0));
+  }
+  prog.push_back (bpf_insn (BPF_LD | BPF_MEM, 0));
+  prog.push_back (bpf_insn (BPF_ALU | BPF_MOD | BPF_K, num_sockets));
+  prog.push_back (bpf_insn (BPF_RET | BPF_A, 0));
+}
+
+// returns the errno, 0 if attached. SO_ATTACH_FILTER or
+// SO_ATTACH_REUSEPORT_CBPF
+static int attach_symbol_bpf (
+  const int                         fd,
+  std::vector<struct sock_filter>&  prog,
+  const int                         option = SO_ATTACH_FILTER)
+{
+  struct sock_fprog fprog;
+  fprog.len     = prog.size ();
+  fprog.filter  = &prog[0];
+  if (setsockopt (fd, SOL_SOCKET, option, &fprog, sizeof (fprog)) < 0)
+  {
+    return errno;
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,89 @@
+// Copyright QUB 2019
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "indicator_lib.hpp"
+#include "trix.h"
+#include "dmi.h"
+#include "vortex.h"
+
+/*
+  Feeds the same bars to the hand-wired indicators and to their
+  compile-time counterparts and checks that all the values are the same.
+*/
+
+using namespace SynapseHC;
+
+static const int s_periods  = 13;
+static const int s_num_bars = 5000;
+
+static int s_mismatches = 0;
+
+static void compare (const char* name, const int i, const FixedPt& expected, const FixedPt& actual)
+{
+  if (expected.getC () != actual.getC ())
+  {
+    printf ("%s: bar %d expected %s, got %s\n", name, i, expected.c_str (), actual.c_str ());
+    ++s_mismatches;
+  }
+}
+
+static Bar next_bar (Bar& prev)
+{
+  Bar bar;
+  bar._open   = prev._close;
+  bar._close  = prev._close + FixedPt::fromInt (rand () % 7 - 3) / FixedPt::fromInt (4);
+  bar._high   = max (bar._open, bar._close) + FixedPt::fromInt (rand () % 3) / FixedPt::fromInt (8);
+  bar._low    = bar._open;
+  if (bar._close < bar._low)
+  {
+    bar._low = bar._close;
+  }
+  bar._low    = bar._low - FixedPt::fromInt (rand () % 3) / FixedPt::fromInt (8);
+
+  return bar;
+}
+
+int main (int argc, char** argv)
+{
+  srand (42);
+
+  Trix    trix    (s_periods, false);
+  Dmi     dmi     (s_periods, false);
+  Vortex  vortex  (s_periods, false);
+
+  IndicatorSet<TrixT, IndicatorSet<DmiT, VortexT> > set (s_periods);
+
+  Bar bar;
+  bar._close  = FixedPt::fromInt (100);
+  bar = next_bar (bar);
+
+  trix  .initialize (bar._close);
+  dmi   .initialize (bar._close, bar._high, bar._low);
+  vortex.initialize (bar._close, bar._high, bar._low);
+  set   .initialize (bar);
+
+  FixedPt results[4];
+
+  for (int i = 0; i < s_num_bars; ++i)
+  {
+    // a few updates for every interval, the last one of which is the add
+    const UpdateType type = (rand () % 4 == 0) ? ADD : UPDATE;
+    bar = next_bar (bar);
+
+    FixedPt                     result_trix   = trix.calculate_value   (bar._close, type);
+    FixedPt                     result_dmi    = dmi.calculate_value    (bar._close, bar._high, bar._low, type);
+    std::pair<FixedPt, FixedPt> result_vortex = vortex.calculate_value (bar._close, bar._high, bar._low, type);
+
+    set.calculate_value (bar, type, results);
+
+    compare ("trix",       i, result_trix,          results[0]);
+    compare ("dmi",        i, result_dmi,           results[1]);
+    compare ("vortex viu", i, result_vortex.first,  results[2]);
+    compare ("vortex vid", i, result_vortex.second, results[3]);
+  }
+
+  printf ("%d bars, %d mismatches\n", s_num_bars, s_mismatches);
+
+  return (s_mismatches == 0) ? 0 : 1;
+}
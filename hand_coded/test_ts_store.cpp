@@ -0,0 +1,234 @@
+// Copyright QUB 2019
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "ts_store.h"
+#include "indicator_lib.hpp"
+
+/*
+  Writes a bar series, reads it back in full and in random ranges and
+  checks that the values are the same. Then reloads the bars into a
+  Trix and checks that it gives the same values as the one that was fed
+  the original bars.
+*/
+
+using namespace SynapseHC;
+
+static const int s_periods    = 13;
+static const int s_num_points = 1000000;
+static const int s_num_ranges = 200;
+
+static uint64_t now_usecs ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+
+  return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+struct Point
+{
+  uint64_t  _tstamp;
+  int64_t   _values[BAR_COLUMNS];
+};
+
+static Bar to_bar (const int64_t* row)
+{
+  Bar bar;
+  bar._open   = FixedPt::fromC (row[BAR_OPEN]);
+  bar._high   = FixedPt::fromC (row[BAR_HIGH]);
+  bar._low    = FixedPt::fromC (row[BAR_LOW]);
+  bar._close  = FixedPt::fromC (row[BAR_CLOSE]);
+
+  return bar;
+}
+
+// feeds the reloaded bars into a Trix and compares them with the expected values
+struct TrixReloader
+{
+  TrixReloader (const std::vector<fixedpt>& expected)
+    : _trix (s_periods), _expected (expected), _count (0), _mismatches (0) {}
+
+  void operator() (const uint64_t tstamp, const int64_t* row)
+  {
+    FixedPt value;
+    if (_count == 0)
+    {
+      _trix.initialize (to_bar (row));
+    }
+    else
+    {
+      _trix.calculate_value (to_bar (row), (UpdateType) row[BAR_TYPE], &value);
+      if (value.getC () != _expected[_count])
+      {
+        ++_mismatches;
+      }
+    }
+    ++_count;
+  }
+
+  TrixT                       _trix;
+  const std::vector<fixedpt>& _expected;
+  int                         _count;
+  int                         _mismatches;
+};
+
+int main (int argc, char** argv)
+{
+  srand (42);
+
+  char path[] = "/tmp/test_ts_store_XXXXXX";
+  const int fd = mkstemp (path);
+  if (fd < 0)
+  {
+    printf ("Could not create a temporary file\n");
+    return 1;
+  }
+  close (fd);
+
+  // random walk bars, a few updates per interval
+  std::vector<Point>    points (s_num_points);
+  std::vector<fixedpt>  expected (s_num_points);
+  const int64_t         tick      = fixedpt_rconst (0.25);
+  int64_t               close     = fixedpt_fromint (100);
+  uint64_t              tstamp    = 1000000;
+  TrixT                 trix (s_periods);
+
+  for (int i = 0; i < s_num_points; ++i)
+  {
+    Point& p = points[i];
+    const bool add = (rand () % 4 == 0);
+
+    tstamp += add ? 10000000 : (rand () % 1000000);
+    close  += (rand () % 5 - 2) * tick;
+
+    p._tstamp             = tstamp;
+    p._values[BAR_TYPE]   = add ? ADD : UPDATE;
+    p._values[BAR_OPEN]   = close - tick;
+    p._values[BAR_HIGH]   = close + (rand () % 3) * tick;
+    p._values[BAR_LOW]    = close - (rand () % 3 + 1) * tick;
+    p._values[BAR_CLOSE]  = close;
+    p._values[BAR_VOLUME] = 100 * (rand () % 50);
+
+    FixedPt value;
+    if (i == 0)
+    {
+      trix.initialize (to_bar (p._values));
+    }
+    else
+    {
+      trix.calculate_value (to_bar (p._values), (UpdateType) p._values[BAR_TYPE], &value);
+    }
+    expected[i] = value.getC ();
+  }
+
+  // 1. write
+  uint64_t start = now_usecs ();
+
+  TsWriter writer;
+  if (!writer.open (path, BAR_COLUMNS))
+  {
+    return 1;
+  }
+  for (int i = 0; i < s_num_points; ++i)
+  {
+    writer.append (points[i]._tstamp, points[i]._values);
+  }
+  writer.close ();
+
+  double secs = (now_usecs () - start) / 1e6;
+  printf ("Wrote %d points in %.3f secs, %.1f M points/sec, %.2f bytes/point (raw %zu)\n",
+          s_num_points, secs, s_num_points / secs / 1e6,
+          (double) writer.bytes_written () / s_num_points, sizeof (Point));
+
+  // 2. read everything back
+  int mismatches = 0;
+
+  TsReader reader;
+  if (!reader.open (path))
+  {
+    return 1;
+  }
+
+  start = now_usecs ();
+
+  std::vector<uint64_t> tstamps;
+  std::vector<int64_t>  rows;
+  reader.read_range (0, UINT64_MAX, tstamps, rows);
+
+  secs = (now_usecs () - start) / 1e6;
+  printf ("Read %zu points in %.3f secs, %.1f M points/sec\n",
+          tstamps.size (), secs, tstamps.size () / secs / 1e6);
+
+  if (tstamps.size () != (size_t) s_num_points)
+  {
+    printf ("Expected %d points, got %zu\n", s_num_points, tstamps.size ());
+    ++mismatches;
+  }
+  for (size_t i = 0; (i < tstamps.size ()) && (i < (size_t) s_num_points); ++i)
+  {
+    if (tstamps[i] != points[i]._tstamp)
+    {
+      ++mismatches;
+    }
+    for (int c = 0; c < BAR_COLUMNS; ++c)
+    {
+      if (rows[i * BAR_COLUMNS + c] != points[i]._values[c])
+      {
+        ++mismatches;
+      }
+    }
+  }
+
+  // 3. random ranges against a linear search
+  for (int r = 0; r < s_num_ranges; ++r)
+  {
+    const uint64_t from = points[rand () % s_num_points]._tstamp + (rand () % 2);
+    const uint64_t to   = from + (uint64_t) (rand () % 1000) * 10000000;
+
+    size_t first = 0;
+    while ((first < (size_t) s_num_points) && (points[first]._tstamp < from))
+    {
+      ++first;
+    }
+    size_t last = first;
+    while ((last < (size_t) s_num_points) && (points[last]._tstamp <= to))
+    {
+      ++last;
+    }
+
+    tstamps.clear ();
+    rows.clear ();
+    reader.read_range (from, to, tstamps, rows);
+
+    if (tstamps.size () != last - first)
+    {
+      printf ("Range %lu-%lu: expected %zu points, got %zu\n", from, to, last - first, tstamps.size ());
+      ++mismatches;
+      continue;
+    }
+    for (size_t i = 0; i < tstamps.size (); ++i)
+    {
+      if ((tstamps[i] != points[first + i]._tstamp) ||
+          (rows[i * BAR_COLUMNS + BAR_CLOSE] != points[first + i]._values[BAR_CLOSE]))
+      {
+        ++mismatches;
+      }
+    }
+  }
+
+  // 4. reload the history into an indicator
+  TrixReloader reloader (expected);
+  reader.scan (0, UINT64_MAX, reloader);
+  mismatches += reloader._mismatches;
+
+  reader.close ();
+  unlink (path);
+
+  printf ("%d points, %d blocks, %d mismatches\n", s_num_points,
+          (int) ((s_num_points + TS_DEFAULT_BLOCK - 1) / TS_DEFAULT_BLOCK), mismatches);
+
+  return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,641 @@
+// Copyright QUB 2019
+
+#include "ts_store.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace SynapseHC
+{
+
+static const size_t TS_WRITE_BUF_LEN = 1 << 20;
+
+std::string ts_series_path (const char* dir, const char* symbol, const char* series)
+{
+  std::string path (dir);
+  path += "/";
+  path += symbol;
+  path += ".";
+  path += series;
+  path += ".ts";
+
+  return path;
+}
+
+static inline uint64_t zigzag (const int64_t value)
+{
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static inline int64_t unzigzag (const uint64_t value)
+{
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+// ------------------------------------------------------------------------
+// bit streams, the first bit is the top bit of the first word
+
+class BitWriter
+{
+public:
+  BitWriter (std::vector<uint64_t>& words)
+    : _words  (words)
+    , _cur    (0)
+    , _fill   (0)
+  {}
+
+  // 1 <= num_bits <= 64
+  inline void write (uint64_t value, const int num_bits)
+  {
+    if (num_bits < 64)
+    {
+      value &= (1ULL << num_bits) - 1;
+    }
+
+    const int space = 64 - _fill;
+    if (num_bits < space)
+    {
+      _cur  = (_cur << num_bits) | value;
+      _fill += num_bits;
+      return;
+    }
+
+    // the word is full, the remaining bits start the next one
+    const int rest = num_bits - space;
+    _words.push_back ((_fill == 0) ? value : ((_cur << space) | (value >> rest)));
+    _cur  = (rest == 0) ? 0 : (value & ((1ULL << rest) - 1));
+    _fill = rest;
+  }
+
+  // pads the last word with zeros
+  void finish ()
+  {
+    if (_fill > 0)
+    {
+      _words.push_back (_cur << (64 - _fill));
+      _cur  = 0;
+      _fill = 0;
+    }
+  }
+
+private:
+  std::vector<uint64_t>&  _words;
+  uint64_t                _cur;
+  int                     _fill;
+}; // class BitWriter
+
+class BitReader
+{
+public:
+  BitReader (const uint64_t* words)
+    : _words  (words)
+    , _pos    (0)
+  {}
+
+  // 1 <= num_bits <= 64
+  inline uint64_t read (const int num_bits)
+  {
+    const int       avail = 64 - _pos;
+    const uint64_t  word  = *_words;
+
+    if (num_bits <= avail)
+    {
+      const uint64_t value = (word << _pos) >> (64 - num_bits);
+      _pos += num_bits;
+      if (_pos == 64)
+      {
+        ++_words;
+        _pos = 0;
+      }
+      return value;
+    }
+
+    const int       rest  = num_bits - avail;
+    const uint64_t  high  = (word << _pos) >> _pos;
+    ++_words;
+    _pos = rest;
+
+    return (high << rest) | (*_words >> (64 - rest));
+  }
+
+  inline bool read_bit ()
+  {
+    return read (1) != 0;
+  }
+
+private:
+  const uint64_t* _words;
+  int             _pos;
+}; // class BitReader
+
+// ------------------------------------------------------------------------
+// encodings
+
+static void encode_tstamps (
+  const uint64_t* tstamps,
+  const uint32_t  num_points,
+  BitWriter&      writer)
+{
+  writer.write (tstamps[0], 64);
+
+  int64_t prev_delta = 0;
+  for (uint32_t i = 1; i < num_points; ++i)
+  {
+    const int64_t   delta = tstamps[i] - tstamps[i - 1];
+    const uint64_t  dod   = zigzag (delta - prev_delta);
+    prev_delta = delta;
+
+    if (dod == 0)
+    {
+      writer.write (0, 1);
+    }
+    else if (dod < (1ULL << 7))
+    {
+      writer.write (0x2, 2);
+      writer.write (dod, 7);
+    }
+    else if (dod < (1ULL << 12))
+    {
+      writer.write (0x6, 3);
+      writer.write (dod, 12);
+    }
+    else if (dod < (1ULL << 20))
+    {
+      writer.write (0xe, 4);
+      writer.write (dod, 20);
+    }
+    else
+    {
+      writer.write (0xf, 4);
+      writer.write (dod, 64);
+    }
+  }
+}
+
+static void decode_tstamps (
+  uint64_t*       tstamps,
+  const uint32_t  num_points,
+  BitReader&      reader)
+{
+  tstamps[0] = reader.read (64);
+
+  int64_t prev_delta = 0;
+  for (uint32_t i = 1; i < num_points; ++i)
+  {
+    uint64_t dod = 0;
+    if (reader.read_bit ())
+    {
+      if (!reader.read_bit ())
+      {
+        dod = reader.read (7);
+      }
+      else if (!reader.read_bit ())
+      {
+        dod = reader.read (12);
+      }
+      else if (!reader.read_bit ())
+      {
+        dod = reader.read (20);
+      }
+      else
+      {
+        dod = reader.read (64);
+      }
+    }
+
+    prev_delta += unzigzag (dod);
+    tstamps[i] = tstamps[i - 1] + prev_delta;
+  }
+}
+
+static void encode_values (
+  const int64_t*  values,
+  const uint32_t  num_points,
+  BitWriter&      writer)
+{
+  writer.write (values[0], 64);
+
+  // the meaningful bits of the last value stored with '11'
+  int lead  = -1;
+  int trail = 0;
+
+  for (uint32_t i = 1; i < num_points; ++i)
+  {
+    const uint64_t delta = zigzag (values[i] - values[i - 1]);
+
+    if (delta == 0)
+    {
+      writer.write (0, 1);
+      continue;
+    }
+
+    const int new_lead  = __builtin_clzll (delta);
+    const int new_trail = __builtin_ctzll (delta);
+
+    if ((lead >= 0) && (new_lead >= lead) && (new_trail >= trail))
+    {
+      // fits into the previous window
+      writer.write (0x2, 2);
+      writer.write (delta >> trail, 64 - lead - trail);
+    }
+    else
+    {
+      lead  = new_lead;
+      trail = new_trail;
+      const int len = 64 - lead - trail;
+
+      writer.write (0x3,      2);
+      writer.write (lead,     6);
+      writer.write (len - 1,  6);
+      writer.write (delta >> trail, len);
+    }
+  }
+}
+
+static void decode_values (
+  int64_t*        values,
+  const uint32_t  num_points,
+  BitReader&      reader)
+{
+  values[0] = reader.read (64);
+
+  int lead  = 0;
+  int trail = 0;
+
+  for (uint32_t i = 1; i < num_points; ++i)
+  {
+    if (!reader.read_bit ())
+    {
+      values[i] = values[i - 1];
+      continue;
+    }
+
+    if (reader.read_bit ())
+    {
+      lead  = reader.read (6);
+      trail = 64 - lead - (reader.read (6) + 1);
+    }
+
+    const uint64_t delta = reader.read (64 - lead - trail) << trail;
+    values[i] = values[i - 1] + unzigzag (delta);
+  }
+}
+
+// ------------------------------------------------------------------------
+
+TsWriter::TsWriter ()
+  : _file   (NULL)
+  , _offset (0)
+  , _failed (false)
+{
+  memset (&_header, '\0', sizeof (_header));
+}
+
+TsWriter::~TsWriter ()
+{
+  close ();
+}
+
+bool TsWriter::open (
+  const char*    path,
+  const uint32_t num_columns,
+  const uint32_t block_points)
+{
+  _file = fopen (path, "w");
+  if (_file == NULL)
+  {
+    printf ("TsWriter: could not open %s, error is %s\n", path, strerror (errno));
+    return false;
+  }
+  setvbuf (_file, NULL, _IOFBF, TS_WRITE_BUF_LEN);
+
+  memset (&_header, '\0', sizeof (_header));
+  memcpy (_header._magic, TS_MAGIC, sizeof (TS_MAGIC));
+  _header._num_columns  = num_columns;
+  _header._block_points = (block_points > 0) ? block_points : TS_DEFAULT_BLOCK;
+
+  _offset = 0;
+  _failed = false;
+  _tstamps.clear ();
+  _tstamps.reserve (_header._block_points);
+  _columns.assign ((size_t) num_columns * _header._block_points, 0);
+  _index.clear ();
+  _minmax.clear ();
+
+  // the real header goes in on close
+  return write (&_header, sizeof (_header));
+}
+
+bool TsWriter::write (const void* data, const size_t len)
+{
+  if (_failed)
+  {
+    return false;
+  }
+  if (fwrite (data, 1, len, _file) != len)
+  {
+    printf ("TsWriter: write failed, error is %s\n", strerror (errno));
+    _failed = true;
+    return false;
+  }
+  _offset += len;
+
+  return true;
+}
+
+bool TsWriter::append (
+  const uint64_t tstamp,
+  const int64_t* values)
+{
+  if ((_file == NULL) || _failed)
+  {
+    return false;
+  }
+
+  if (!_tstamps.empty () && (tstamp < _tstamps.back ()))
+  {
+    return false;
+  }
+  if (_tstamps.empty () && !_index.empty () && (tstamp < _index.back ()._last_tstamp))
+  {
+    return false;
+  }
+
+  const uint32_t i = _tstamps.size ();
+  _tstamps.push_back (tstamp);
+  for (uint32_t c = 0; c < _header._num_columns; ++c)
+  {
+    _columns[c * _header._block_points + i] = values[c];
+  }
+
+  ++_header._num_points;
+
+  if (_tstamps.size () == _header._block_points)
+  {
+    return flush_block ();
+  }
+
+  return true;
+}
+
+bool TsWriter::flush_block ()
+{
+  const uint32_t num_points = _tstamps.size ();
+  const uint32_t num_cols   = _header._num_columns;
+
+  if (num_points == 0)
+  {
+    return true;
+  }
+
+  // one stream after another, remembering where each one ends
+  std::vector<uint32_t> stream_words (1 + num_cols);
+  _words.clear ();
+
+  {
+    BitWriter writer (_words);
+    encode_tstamps (&_tstamps[0], num_points, writer);
+    writer.finish ();
+    stream_words[0] = _words.size ();
+  }
+
+  for (uint32_t c = 0; c < num_cols; ++c)
+  {
+    const int64_t* values = &_columns[c * _header._block_points];
+    const size_t   start  = _words.size ();
+
+    BitWriter writer (_words);
+    encode_values (values, num_points, writer);
+    writer.finish ();
+    stream_words[1 + c] = _words.size () - start;
+
+    int64_t min = values[0];
+    int64_t max = values[0];
+    for (uint32_t i = 1; i < num_points; ++i)
+    {
+      if (values[i] < min) { min = values[i]; }
+      if (values[i] > max) { max = values[i]; }
+    }
+    _minmax.push_back (min);
+    _minmax.push_back (max);
+  }
+
+  TsBlockIndex index;
+  index._offset       = _offset;
+  index._first_tstamp = _tstamps.front ();
+  index._last_tstamp  = _tstamps.back ();
+  index._num_points   = num_points;
+  index._num_words    = _words.size ();
+  _index.push_back (index);
+
+  const size_t  lens_len  = stream_words.size () * sizeof (uint32_t);
+  const uint8_t padding[8] = { 0 };
+
+  write (&stream_words[0], lens_len);
+  write (padding, (8 - lens_len % 8) % 8);
+  write (&_words[0], _words.size () * sizeof (uint64_t));
+
+  _tstamps.clear ();
+
+  return !_failed;
+}
+
+bool TsWriter::close ()
+{
+  if (_file == NULL)
+  {
+    return false;
+  }
+
+  flush_block ();
+
+  _header._num_blocks   = _index.size ();
+  _header._index_offset = _offset;
+
+  if (!_index.empty ())
+  {
+    write (&_index[0],  _index.size ()  * sizeof (TsBlockIndex));
+    write (&_minmax[0], _minmax.size () * sizeof (int64_t));
+  }
+
+  if (!_failed)
+  {
+    if ((fseek (_file, 0, SEEK_SET) != 0) ||
+        (fwrite (&_header, sizeof (_header), 1, _file) != 1))
+    {
+      printf ("TsWriter: could not write the header, error is %s\n", strerror (errno));
+      _failed = true;
+    }
+  }
+
+  if (fclose (_file) != 0)
+  {
+    _failed = true;
+  }
+  _file = NULL;
+
+  return !_failed;
+}
+
+// ------------------------------------------------------------------------
+
+TsReader::TsReader ()
+  : _data   (NULL)
+  , _size   (0)
+  , _header (NULL)
+  , _index  (NULL)
+  , _minmax (NULL)
+{
+}
+
+TsReader::~TsReader ()
+{
+  close ();
+}
+
+bool TsReader::open (const char* path)
+{
+  close ();
+
+  const int fd = ::open (path, O_RDONLY);
+  if (fd < 0)
+  {
+    printf ("TsReader: could not open %s, error is %s\n", path, strerror (errno));
+    return false;
+  }
+
+  struct stat st;
+  if ((fstat (fd, &st) != 0) || ((size_t) st.st_size < sizeof (TsFileHeader)))
+  {
+    printf ("TsReader: %s is too short\n", path);
+    ::close (fd);
+    return false;
+  }
+
+  void* data = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close (fd);
+  if (data == MAP_FAILED)
+  {
+    printf ("TsReader: could not map %s, error is %s\n", path, strerror (errno));
+    return false;
+  }
+
+  _data   = static_cast<const char*> (data);
+  _size   = st.st_size;
+  _header = reinterpret_cast<const TsFileHeader*> (_data);
+
+  const uint64_t index_len = _header->_num_blocks *
+                               (sizeof (TsBlockIndex) + _header->_num_columns * 2 * sizeof (int64_t));
+
+  if ((memcmp (_header->_magic, TS_MAGIC, sizeof (TS_MAGIC)) != 0) ||
+      (_header->_index_offset + index_len > _size))
+  {
+    printf ("TsReader: %s is not a complete series file\n", path);
+    close ();
+    return false;
+  }
+
+  _index  = reinterpret_cast<const TsBlockIndex*> (_data + _header->_index_offset);
+  _minmax = reinterpret_cast<const int64_t*>      (_index + _header->_num_blocks);
+
+  madvise (data, _size, MADV_SEQUENTIAL);
+
+  return true;
+}
+
+void TsReader::close ()
+{
+  if (_data != NULL)
+  {
+    munmap (const_cast<char*> (_data), _size);
+  }
+  _data   = NULL;
+  _size   = 0;
+  _header = NULL;
+  _index  = NULL;
+  _minmax = NULL;
+}
+
+uint64_t TsReader::find_block (const uint64_t tstamp) const
+{
+  // the first block whose last point is not before tstamp
+  uint64_t low  = 0;
+  uint64_t high = _header->_num_blocks;
+
+  while (low < high)
+  {
+    const uint64_t mid = (low + high) / 2;
+    if (_index[mid]._last_tstamp < tstamp)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+void TsReader::decode_block (
+  const uint64_t i,
+  uint64_t*      tstamps,
+  int64_t*       columns) const
+{
+  const TsBlockIndex& index     = _index[i];
+  const uint32_t      num_cols  = _header->_num_columns;
+  const uint32_t*     lens      = reinterpret_cast<const uint32_t*> (_data + index._offset);
+  const size_t        lens_len  = (1 + num_cols) * sizeof (uint32_t);
+  const uint64_t*     words     = reinterpret_cast<const uint64_t*> (
+                                    _data + index._offset + lens_len + (8 - lens_len % 8) % 8);
+
+  {
+    BitReader reader (words);
+    decode_tstamps (tstamps, index._num_points, reader);
+    words += lens[0];
+  }
+
+  for (uint32_t c = 0; c < num_cols; ++c)
+  {
+    BitReader reader (words);
+    decode_values (columns + c * _header->_block_points, index._num_points, reader);
+    words += lens[1 + c];
+  }
+}
+
+namespace
+{
+struct RangeCollector
+{
+  RangeCollector (std::vector<uint64_t>& tstamps, std::vector<int64_t>& rows, const uint32_t num_cols)
+    : _tstamps (tstamps), _rows (rows), _num_cols (num_cols) {}
+
+  void operator() (const uint64_t tstamp, const int64_t* row)
+  {
+    _tstamps.push_back (tstamp);
+    _rows.insert (_rows.end (), row, row + _num_cols);
+  }
+
+  std::vector<uint64_t>&  _tstamps;
+  std::vector<int64_t>&   _rows;
+  const uint32_t          _num_cols;
+};
+} // namespace
+
+uint64_t TsReader::read_range (
+  const uint64_t         from,
+  const uint64_t         to,
+  std::vector<uint64_t>& tstamps,
+  std::vector<int64_t>&  rows) const
+{
+  RangeCollector collector (tstamps, rows, _header->_num_columns);
+
+  return scan (from, to, collector);
+}
+
+} // namespace SynapseHC
@@ -0,0 +1,226 @@
+// Copyright QUB 2019
+
+#ifndef ts_store_H
+#define ts_store_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*
+  Columnar time series files, one file per symbol and series (an
+  indicator's outputs, the bars of an interval length, ...). Every point
+  is a timestamp plus a fixed number of int64 columns, which is what a
+  fixedpt is.
+
+  The points are grouped into blocks. Within a block every column is a
+  bit stream of its own:
+    - timestamps: the first one raw, then delta-of-delta in 1-68 bits
+    - columns:    the first value raw, then the zigzag delta from the
+                  previous value, stored with its leading and trailing
+                  zero bits cut off the way Gorilla does it with XORs.
+                  An unchanged value takes 1 bit, a price that moves by
+                  a few ticks about 10-20 bits
+
+  Layout of the file:
+    TsFileHeader                      - rewritten by close ()
+    blocks, 8 byte aligned, each one
+      uint32_t  stream_words [1 + num_columns]
+      (padding to 8 bytes)
+      uint64_t  words [...]           - timestamps, column 0, column 1, ...
+    TsBlockIndex  index  [num_blocks]
+    int64_t       minmax [num_blocks][num_columns][2]
+
+  The reader mmaps the file, finds the first block of a range with a
+  binary search over the index and decodes the blocks one by one, so a
+  range scan only touches the blocks of the range.
+*/
+
+namespace SynapseHC
+{
+
+static const char     TS_MAGIC[8]         = { 'S', 'Y', 'N', 'T', 'S', '0', '1', '\0' };
+static const uint32_t TS_DEFAULT_BLOCK    = 1024;
+
+// the columns of a bar series
+enum BarColumn
+{
+  BAR_TYPE,     // ADD or UPDATE
+  BAR_OPEN,
+  BAR_HIGH,
+  BAR_LOW,
+  BAR_CLOSE,
+  BAR_VOLUME,
+  BAR_COLUMNS
+};
+
+struct TsFileHeader
+{
+  char      _magic[8];
+  uint32_t  _num_columns;
+  uint32_t  _block_points;
+  uint64_t  _num_points;
+  uint64_t  _num_blocks;
+  uint64_t  _index_offset;
+  uint8_t   _reserved[24];
+}; // struct TsFileHeader
+
+struct TsBlockIndex
+{
+  uint64_t  _offset;
+  uint64_t  _first_tstamp;
+  uint64_t  _last_tstamp;
+  uint32_t  _num_points;
+  uint32_t  _num_words;
+}; // struct TsBlockIndex
+
+// "<dir>/<symbol>.<series>.ts"
+std::string ts_series_path (const char* dir, const char* symbol, const char* series);
+
+// ------------------------------------------------------------------------
+
+class TsWriter
+{
+public:
+  TsWriter  ();
+  ~TsWriter ();
+
+  bool open   (const char*    path,
+               const uint32_t num_columns,
+               const uint32_t block_points = TS_DEFAULT_BLOCK);
+
+  // the timestamps must not go backwards
+  bool append (const uint64_t tstamp,
+               const int64_t* values);
+
+  // writes the last block, the index and the header
+  bool close  ();
+
+  uint64_t  num_points    () const { return _header._num_points; }
+  uint64_t  bytes_written () const { return _offset; }
+
+private:
+  TsWriter (const TsWriter&);
+  TsWriter& operator= (const TsWriter&);
+
+  bool  flush_block ();
+  bool  write       (const void* data, const size_t len);
+
+private:
+  FILE*                     _file;
+  TsFileHeader              _header;
+  uint64_t                  _offset;
+  bool                      _failed;
+
+  // the points of the current block, column by column
+  std::vector<uint64_t>     _tstamps;
+  std::vector<int64_t>      _columns;     // [num_columns][block_points]
+
+  std::vector<TsBlockIndex> _index;
+  std::vector<int64_t>      _minmax;
+  std::vector<uint64_t>     _words;
+}; // class TsWriter
+
+// ------------------------------------------------------------------------
+
+class TsReader
+{
+public:
+  TsReader  ();
+  ~TsReader ();
+
+  bool open   (const char* path);
+  void close  ();
+
+  uint32_t  num_columns   () const { return _header->_num_columns; }
+  uint64_t  num_points    () const { return _header->_num_points; }
+  uint64_t  num_blocks    () const { return _header->_num_blocks; }
+
+  const TsBlockIndex& block       (const uint64_t i) const { return _index[i]; }
+  int64_t             block_min   (const uint64_t i, const uint32_t col) const
+  {
+    return _minmax[(i * _header->_num_columns + col) * 2];
+  }
+  int64_t             block_max   (const uint64_t i, const uint32_t col) const
+  {
+    return _minmax[(i * _header->_num_columns + col) * 2 + 1];
+  }
+
+  // the first block that may hold a point at or after tstamp
+  uint64_t  find_block    (const uint64_t tstamp) const;
+
+  // decodes block i into tstamps [num_points] and
+  // columns [num_columns][block_points]
+  void      decode_block  (const uint64_t i,
+                           uint64_t*      tstamps,
+                           int64_t*       columns) const;
+
+  // calls f (tstamp, row) for every point with from <= tstamp <= to,
+  // row holds the num_columns values of the point. Returns the count
+  template <typename F>
+  uint64_t  scan          (const uint64_t from,
+                           const uint64_t to,
+                           F&             f) const;
+
+  uint64_t  read_range    (const uint64_t         from,
+                           const uint64_t         to,
+                           std::vector<uint64_t>& tstamps,
+                           std::vector<int64_t>&  rows) const;
+
+private:
+  TsReader (const TsReader&);
+  TsReader& operator= (const TsReader&);
+
+private:
+  const char*         _data;
+  size_t              _size;
+  const TsFileHeader* _header;
+  const TsBlockIndex* _index;
+  const int64_t*      _minmax;
+}; // class TsReader
+
+template <typename F>
+uint64_t TsReader::scan (
+  const uint64_t from,
+  const uint64_t to,
+  F&             f) const
+{
+  const uint32_t        num_cols     = _header->_num_columns;
+  const uint32_t        block_points = _header->_block_points;
+  std::vector<uint64_t> tstamps (block_points);
+  std::vector<int64_t>  columns (num_cols * block_points);
+  std::vector<int64_t>  row     (num_cols + 1);
+  uint64_t              count = 0;
+
+  for (uint64_t b = find_block (from); b < _header->_num_blocks; ++b)
+  {
+    const TsBlockIndex& index = _index[b];
+    if (index._first_tstamp > to)
+    {
+      break;
+    }
+
+    decode_block (b, &tstamps[0], &columns[0]);
+
+    for (uint32_t i = 0; i < index._num_points; ++i)
+    {
+      if ((tstamps[i] < from) || (tstamps[i] > to))
+      {
+        continue;
+      }
+      for (uint32_t c = 0; c < num_cols; ++c)
+      {
+        row[c] = columns[c * block_points + i];
+      }
+      f (tstamps[i], &row[0]);
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+} // namespace SynapseHC
+
+#endif
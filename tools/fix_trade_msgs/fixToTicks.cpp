@@ -0,0 +1,287 @@
+// Copyright QUB 2019
+
+// fixToTicks [-t threads] fix.log ticks.bin
+//
+// The trades of a FIX log as a binary tick file (see fix_ticks.hpp) for
+// the msgSender. The log is mapped and cut into a chunk per thread at
+// line ends, the threads decode their chunks with FixTrades and sort
+// their ticks by SendingTime, and the chunks are then merged into the
+// output in one pass, with the delta of every tick filled in on the way.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+#include "fix_trades.hpp"
+#include "fix_ticks.hpp"
+
+using FixTicks::Tick;
+
+// not worth a thread for less
+static const size_t s_min_chunk_len = 1 << 20;
+static const size_t s_out_buf_len   = 8 << 20;
+
+struct Chunk
+{
+  Chunk () : _begin (NULL), _end (NULL), _long_symbols (0) {}
+
+  const char*             _begin;
+  const char*             _end;
+  std::vector<Tick>       _ticks;
+  FixTrades::DecodeStats  _stats;
+  uint64_t                _long_symbols;
+  pthread_t               _thread;
+}; // struct Chunk
+
+struct TickSink
+{
+  TickSink (Chunk& chunk) : _chunk (chunk) {}
+
+  void operator() (const FixTrades::Trade& trade)
+  {
+    if (trade._symbol_len > FixTicks::SYMBOL_LEN - 1)
+    {
+      ++_chunk._long_symbols;
+      return;
+    }
+
+    Tick tick;
+    memset (&tick, '\0', sizeof (tick));
+    tick._sending_time_us = trade._sending_time_us;
+    tick._seq_num         = trade._seq_num;
+    tick._price_mantissa  = trade._price_mantissa;
+    tick._price_exponent  = static_cast<int32_t>(trade._price_exponent);
+    tick._size            = trade._size;
+    memcpy (tick._symbol, trade._symbol, trade._symbol_len);
+
+    _chunk._ticks.push_back (tick);
+  }
+
+  Chunk& _chunk;
+}; // struct TickSink
+
+static bool tick_before (const Tick& a, const Tick& b)
+{
+  return a._sending_time_us < b._sending_time_us;
+}
+
+static void* decode_chunk (void* arg)
+{
+  Chunk& chunk = *static_cast<Chunk*>(arg);
+
+  // a trade takes a few hundred bytes of the log
+  chunk._ticks.reserve ((chunk._end - chunk._begin) / 256);
+
+  TickSink sink (chunk);
+  FixTrades::decode_md_trades (chunk._begin, chunk._end, sink, chunk._stats);
+
+  // a log is mostly in order already, and the ticks of one time keep the
+  // order they were logged in
+  if (!std::is_sorted (chunk._ticks.begin (), chunk._ticks.end (), tick_before))
+  {
+    std::stable_sort (chunk._ticks.begin (), chunk._ticks.end (), tick_before);
+  }
+  return NULL;
+}
+
+// the next tick of a chunk in the merge, the earlier chunk first for the
+// ticks of one time
+struct Cursor
+{
+  const Tick* _next;
+  const Tick* _end;
+  size_t      _chunk;
+}; // struct Cursor
+
+static bool cursor_after (const Cursor& a, const Cursor& b)
+{
+  if (a._next->_sending_time_us != b._next->_sending_time_us)
+  {
+    return a._next->_sending_time_us > b._next->_sending_time_us;
+  }
+  return a._chunk > b._chunk;
+}
+
+static double now_sec ()
+{
+  timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char** argv)
+{
+  long threads = sysconf (_SC_NPROCESSORS_ONLN);
+  int  c;
+  while ((c = getopt (argc, argv, "t:")) != -1)
+  {
+    switch (c)
+    {
+      case 't':
+        threads = atol (optarg);
+        break;
+      default:
+        threads = 0;
+        break;
+    }
+  }
+  if ((argc - optind != 2) || (threads < 1))
+  {
+    fprintf (stderr, "usage: %s [-t threads] fix.log ticks.bin\n", argv[0]);
+    return 1;
+  }
+  const char* in_name   = argv[optind];
+  const char* out_name  = argv[optind + 1];
+
+  const double start = now_sec ();
+
+  const int fd = open (in_name, O_RDONLY);
+  struct stat st;
+  if ((fd < 0) || (fstat (fd, &st) != 0))
+  {
+    fprintf (stderr, "%s: %s\n", in_name, strerror (errno));
+    return 1;
+  }
+  const size_t in_len = st.st_size;
+
+  const char* data = NULL;
+  if (in_len > 0)
+  {
+    void* map = mmap (NULL, in_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      fprintf (stderr, "mmap %s: %s\n", in_name, strerror (errno));
+      return 1;
+    }
+    madvise (map, in_len, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(map);
+  }
+
+  // a chunk per thread, each one ending after a newline
+  if (in_len / threads < s_min_chunk_len)
+  {
+    threads = std::max<long>(1, in_len / s_min_chunk_len);
+  }
+  std::vector<Chunk> chunks (threads);
+  const char* end   = data + in_len;
+  const char* begin = data;
+  for (long i = 0; i < threads; ++i)
+  {
+    const char* split = (i == threads - 1) ? end : data + in_len / threads * (i + 1);
+    if (split < begin)
+    {
+      split = begin;
+    }
+    if (split < end)
+    {
+      const char* nl = static_cast<const char*>(memchr (split, '\n', end - split));
+      split = nl ? nl + 1 : end;
+    }
+    chunks[i]._begin  = begin;
+    chunks[i]._end    = split;
+    begin             = split;
+  }
+
+  for (long i = 1; i < threads; ++i)
+  {
+    if (pthread_create (&chunks[i]._thread, NULL, decode_chunk, &chunks[i]) != 0)
+    {
+      fprintf (stderr, "pthread_create failed\n");
+      return 1;
+    }
+  }
+  decode_chunk (&chunks[0]);
+  for (long i = 1; i < threads; ++i)
+  {
+    pthread_join (chunks[i]._thread, NULL);
+  }
+
+  const double decoded = now_sec ();
+
+  FILE* out = fopen (out_name, "wb");
+  if (!out)
+  {
+    fprintf (stderr, "%s: %s\n", out_name, strerror (errno));
+    return 1;
+  }
+  setvbuf (out, NULL, _IOFBF, s_out_buf_len);
+
+  FixTicks::FileHeader header;
+  memset (&header, '\0', sizeof (header));
+  memcpy (header._magic, FixTicks::MAGIC, sizeof (header._magic));
+  header._record_size = sizeof (Tick);
+  fwrite (&header, sizeof (header), 1, out);
+
+  std::vector<Cursor> heap;
+  FixTrades::DecodeStats  stats;
+  uint64_t                long_symbols = 0;
+  for (size_t i = 0; i < chunks.size (); ++i)
+  {
+    const Chunk& chunk = chunks[i];
+    stats._msgs     += chunk._stats._msgs;
+    stats._md_msgs  += chunk._stats._md_msgs;
+    stats._trades   += chunk._stats._trades;
+    stats._invalid  += chunk._stats._invalid;
+    long_symbols    += chunk._long_symbols;
+    if (!chunk._ticks.empty ())
+    {
+      Cursor cursor = { &chunk._ticks.front (), &chunk._ticks.front () + chunk._ticks.size (), i };
+      heap.push_back (cursor);
+    }
+  }
+  std::make_heap (heap.begin (), heap.end (), cursor_after);
+
+  uint64_t prev_time = 0;
+  while (!heap.empty ())
+  {
+    std::pop_heap (heap.begin (), heap.end (), cursor_after);
+    Cursor& cursor = heap.back ();
+
+    Tick tick       = *cursor._next;
+    tick._delta_us  = header._records ? tick._sending_time_us - prev_time : 0;
+    prev_time       = tick._sending_time_us;
+    fwrite (&tick, sizeof (tick), 1, out);
+    ++header._records;
+
+    if (++cursor._next == cursor._end)
+    {
+      heap.pop_back ();
+    }
+    else
+    {
+      std::push_heap (heap.begin (), heap.end (), cursor_after);
+    }
+  }
+
+  // the count goes in last
+  if (ferror (out) || (fseek (out, 0, SEEK_SET) != 0) || (fwrite (&header, sizeof (header), 1, out) != 1) ||
+        (fclose (out) != 0))
+  {
+    fprintf (stderr, "%s: %s\n", out_name, strerror (errno));
+    return 1;
+  }
+
+  const double done = now_sec ();
+  printf ("%llu msgs, %llu market data, %llu trades, %llu invalid, %llu long symbols\n",
+          (unsigned long long) stats._msgs, (unsigned long long) stats._md_msgs,
+          (unsigned long long) stats._trades, (unsigned long long) stats._invalid,
+          (unsigned long long) long_symbols);
+  printf ("%zu bytes on %ld threads: decoded in %.3fs (%.0f MB/s), written in %.3fs\n",
+          in_len, threads, decoded - start, in_len / 1e6 / (decoded - start), done - decoded);
+
+  if (data)
+  {
+    munmap (const_cast<char*>(data), in_len);
+  }
+  close (fd);
+  return 0;
+}
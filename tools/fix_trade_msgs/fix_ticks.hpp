@@ -0,0 +1,74 @@
+// Copyright QUB 2019
+
+#ifndef FixTicksH
+#define FixTicksH
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+  The binary tick file fixToTicks makes out of a FIX log: a header, then
+  the trades in SendingTime order as fixed 64 byte records, each with the
+  microseconds since the one before it - what the msgSender waits before
+  sending it (-a T).
+*/
+namespace FixTicks
+{
+
+static const char     MAGIC[8]    = { 'F', 'I', 'X', 'T', 'I', 'C', 'K', '1' };
+static const size_t   SYMBOL_LEN  = 16;
+
+struct FileHeader
+{
+  char      _magic[8];
+  uint32_t  _record_size;
+  uint32_t  _reserved;
+  uint64_t  _records;
+}; // struct FileHeader
+
+struct Tick
+{
+  uint64_t  _sending_time_us;
+  uint64_t  _delta_us;        // since the tick before, 0 for the first one
+  uint64_t  _seq_num;         // MsgSeqNum of the msg it came in
+  int64_t   _price_mantissa;  // the price is mantissa * 10^exponent
+  int64_t   _size;
+  int32_t   _price_exponent;
+  uint32_t  _reserved;
+  char      _symbol[SYMBOL_LEN];  // null terminated
+}; // struct Tick
+
+// the msgSender line of a tick, "R|delta|SYMBOL|price|size"
+inline int format_tick (const Tick& tick, char* line, const size_t line_len)
+{
+  int64_t mantissa = tick._price_mantissa;
+  int32_t exponent = tick._price_exponent;
+  for (; exponent > 0; --exponent)
+  {
+    mantissa *= 10;
+  }
+
+  if (exponent == 0)
+  {
+    return snprintf (line, line_len, "R|%llu|%s|%lld|%lld", (unsigned long long) tick._delta_us,
+                     tick._symbol, (long long) mantissa, (long long) tick._size);
+  }
+
+  int64_t divisor = 1;
+  for (int32_t i = exponent; i < 0; ++i)
+  {
+    divisor *= 10;
+  }
+  const bool    negative  = mantissa < 0;
+  const int64_t whole     = (negative ? -mantissa : mantissa) / divisor;
+  const int64_t fraction  = (negative ? -mantissa : mantissa) % divisor;
+
+  return snprintf (line, line_len, "R|%llu|%s|%s%lld.%0*lld|%lld", (unsigned long long) tick._delta_us,
+                   tick._symbol, negative ? "-" : "", (long long) whole, -exponent, (long long) fraction,
+                   (long long) tick._size);
+}
+
+} // namespace FixTicks
+
+#endif
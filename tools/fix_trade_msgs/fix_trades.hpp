@@ -0,0 +1,246 @@
+// Copyright QUB 2019
+
+#ifndef FixTradesH
+#define FixTradesH
+
+#include "hffix.hpp"
+#include <stdint.h>
+#include <string.h>
+
+/*
+  The trades of the MarketDataIncrementalRefresh (35=X) msgs of a FIX feed
+  or log, decoded straight from the buffer with the hffix reader: one pass
+  over the fields of a msg, dispatched on the tag, and no strings made on
+  the way. A trade is an entry with MDUpdateAction new (279=0) and
+  MDEntryType trade (269=2), as extractConvertFixTrades took them.
+*/
+namespace FixTrades
+{
+
+struct Trade
+{
+  uint64_t      _sending_time_us; // SendingTime, microseconds since the epoch
+  uint64_t      _seq_num;         // MsgSeqNum, the same for all the entries of a msg
+  const char*   _symbol;          // in the buffer, not terminated
+  size_t        _symbol_len;
+  int64_t       _price_mantissa;  // the price is mantissa * 10^exponent
+  int64_t       _price_exponent;
+  int64_t       _size;
+}; // struct Trade
+
+struct DecodeStats
+{
+  DecodeStats () : _msgs (0), _md_msgs (0), _trades (0), _invalid (0) {}
+
+  uint64_t  _msgs;
+  uint64_t  _md_msgs;
+  uint64_t  _trades;
+  uint64_t  _invalid;
+}; // struct DecodeStats
+
+// days since 1970-01-01 of a civil date, for any year after 0
+inline int64_t days_from_civil (int64_t y, const unsigned m, const unsigned d)
+{
+  y -= m <= 2;
+  const int64_t   era = y / 400;
+  const unsigned  yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned  doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// "YYYYMMDD-HH:MM:SS[.fff[fff]]", or the same without the separators the
+// way the old logs have it, to microseconds since the epoch. 0 if it is
+// not a timestamp
+inline uint64_t sending_time_us (const char* begin, const char* end)
+{
+  // the 14 digits of the date and time, then the fraction
+  unsigned  digits[14];
+  int       n = 0;
+  for (; (begin < end) && (n < 14); ++begin)
+  {
+    if ((*begin >= '0') && (*begin <= '9'))
+    {
+      digits[n++] = *begin - '0';
+    }
+    else if ((*begin != '-') && (*begin != ':'))
+    {
+      return 0;
+    }
+  }
+  if (n < 14)
+  {
+    return 0;
+  }
+
+  const int64_t   year  = digits[0] * 1000 + digits[1] * 100 + digits[2] * 10 + digits[3];
+  const unsigned  month = digits[4] * 10 + digits[5];
+  const unsigned  day   = digits[6] * 10 + digits[7];
+  const unsigned  secs  = (digits[8] * 10 + digits[9]) * 3600 +
+                          (digits[10] * 10 + digits[11]) * 60 +
+                          (digits[12] * 10 + digits[13]);
+
+  uint64_t  micros  = 0;
+  int       places  = 0;
+  if ((begin < end) && (*begin == '.'))
+  {
+    ++begin;
+  }
+  for (; (begin < end) && (places < 6) && (*begin >= '0') && (*begin <= '9'); ++begin, ++places)
+  {
+    micros = micros * 10 + (*begin - '0');
+  }
+  for (; places < 6; ++places)
+  {
+    micros *= 10;
+  }
+
+  return static_cast<uint64_t>(days_from_civil (year, month, day) * 86400 + secs) * 1000000 + micros;
+}
+
+// where the next msg starts, a log line may have something in front of it
+inline const char* find_msg_start (const char* begin, const char* end)
+{
+  while (end - begin >= 5)
+  {
+    const char* eight = static_cast<const char*>(memchr (begin, '8', end - begin - 4));
+    if (!eight)
+    {
+      break;
+    }
+    if (memcmp (eight, "8=FIX", 5) == 0)
+    {
+      return eight;
+    }
+    begin = eight + 1;
+  }
+  // the start of a msg may still be coming
+  return (end - begin > 4) ? end - 4 : begin;
+}
+
+// a trade of a msg whose SendingTime did not parse has no time to be
+// put in order by, so it is counted as invalid instead
+template <typename Sink>
+inline void emit_trade (const Trade& trade, Sink& sink, DecodeStats& stats)
+{
+  if (trade._sending_time_us == 0)
+  {
+    ++stats._invalid;
+    return;
+  }
+  ++stats._trades;
+  sink (trade);
+}
+
+/*
+  Decodes the whole msgs in [begin, end) and calls sink (const Trade&) for
+  every trade in them, in order. Returns where the rest of the buffer
+  starts, a msg that is not whole yet, for the caller to keep until more
+  of it has come.
+*/
+template <typename Sink>
+const char* decode_md_trades (const char*   begin,
+                              const char*   end,
+                              Sink&         sink,
+                              DecodeStats&  stats)
+{
+  for (begin = find_msg_start (begin, end); begin < end; begin = find_msg_start (begin, end))
+  {
+    hffix::message_reader reader (begin, end);
+    if (!reader.is_complete ())
+    {
+      break;
+    }
+    if (!reader.is_valid ())
+    {
+      ++stats._invalid;
+      begin += 5;
+      continue;
+    }
+    ++stats._msgs;
+    begin = reader.message_end ();
+
+    hffix::message_reader::const_iterator i = reader.begin ();
+    if ((i->value ().size () != 1) || (*i->value ().begin () != 'X'))
+    {
+      continue;
+    }
+    ++stats._md_msgs;
+
+    // the fields of the header come before the first entry, every entry
+    // starts with its MDUpdateAction
+    uint64_t  sending_time  = 0;
+    uint64_t  seq_num       = 0;
+    bool      in_entry      = false;
+    bool      is_trade      = false;
+    Trade     trade = Trade ();
+    for (++i; i != reader.end (); ++i)
+    {
+      switch (i->tag ())
+      {
+        case hffix::tag::MsgSeqNum:
+          seq_num = i->value ().as_int<uint64_t> ();
+          break;
+
+        case hffix::tag::SendingTime:
+          sending_time = sending_time_us (i->value ().begin (), i->value ().end ());
+          break;
+
+        case hffix::tag::MDUpdateAction:
+          if (in_entry && is_trade && trade._symbol_len && trade._size)
+          {
+            emit_trade (trade, sink, stats);
+          }
+          in_entry                = true;
+          is_trade                = (i->value ().size () == 1) && (*i->value ().begin () == '0');
+          trade._sending_time_us  = sending_time;
+          trade._seq_num          = seq_num;
+          trade._symbol           = NULL;
+          trade._symbol_len       = 0;
+          trade._price_mantissa   = 0;
+          trade._price_exponent   = 0;
+          trade._size             = 0;
+          break;
+
+        case hffix::tag::MDEntryType:
+          is_trade = is_trade && (i->value ().size () == 1) && (*i->value ().begin () == '2');
+          break;
+
+        case hffix::tag::Symbol:
+          if (in_entry)
+          {
+            trade._symbol     = i->value ().begin ();
+            trade._symbol_len = i->value ().size ();
+          }
+          break;
+
+        case hffix::tag::MDEntryPx:
+          if (in_entry)
+          {
+            i->value ().as_decimal (trade._price_mantissa, trade._price_exponent);
+          }
+          break;
+
+        case hffix::tag::MDEntrySize:
+          if (in_entry)
+          {
+            trade._size = i->value ().as_int<int64_t> ();
+          }
+          break;
+
+        default:
+          break;
+      }
+    }
+    if (in_entry && is_trade && trade._symbol_len && trade._size)
+    {
+      emit_trade (trade, sink, stats);
+    }
+  }
+
+  return begin;
+}
+
+} // namespace FixTrades
+
+#endif
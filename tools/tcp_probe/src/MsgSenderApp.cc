@@ -35,9 +35,14 @@ inline static timespec advance_time_by_period (
   return time;
 }
 
+// with sequenced set, every msg gets its number appended, "...|size|seq",
+// and a b_line gets the same msgs as the connection - a redundant feed
 static bool
 timeout_cb (
     Connection*     connection,
+    Connection*     b_line,
+    const bool      sequenced,
+    uint64_t&       seq,
     PbFileReader&   file_reader)
 {
   timespec now_time;
@@ -54,6 +59,19 @@ timeout_cb (
     return false;
   }
 
+  char seq_line [LINE_MAX_LEN + 24];
+  if (sequenced)
+  {
+    linelen = snprintf (seq_line, sizeof (seq_line), "%.*s|%llu", (int) linelen, line,
+                        (unsigned long long) ++seq);
+    line    = seq_line;
+  }
+
+  if (b_line)
+  {
+    b_line->send_msg (line, linelen);
+  }
+
   // even if status == false, we'll still send it as it is the
   // last line
   const int bytes_written = connection->send_msg (line, linelen);
@@ -101,6 +119,8 @@ int main (int argc, char** argv)
 
   char*         ipAddress   = NULL;
   int           port        = 0;
+  int           b_port      = 0;
+  bool          sequenced   = false;
   char*         msgFileName = NULL;
   int           msg_rate    = 1;
   Transport     tport       = None;
@@ -109,7 +129,7 @@ int main (int argc, char** argv)
   int           c           = 0; 
   bool          wrong_arg   = false;
 
-  while (((c = getopt(argc, argv, "r:f:p:i:t:a:")) != -1) && (!wrong_arg))
+  while (((c = getopt(argc, argv, "r:f:p:i:t:a:b:s")) != -1) && (!wrong_arg))
     switch (c) {
     case 'r':
       msg_rate = atoi(optarg);
@@ -131,6 +151,12 @@ int main (int argc, char** argv)
     case 'p':
       port = atoi (optarg);
       break;
+    case 'b':
+      b_port = atoi (optarg);
+      break;
+    case 's':
+      sequenced = true;
+      break;
     case 'f':
       msgFileName = optarg;
       break;
@@ -146,6 +172,10 @@ int main (int argc, char** argv)
       {
         pb_mode = CHIX;
       }
+      else if (optarg[0] == 'T')
+      {
+        pb_mode = TICKS;
+      }
       break;
     case '?':
       wrong_arg = true;
@@ -163,6 +193,7 @@ int main (int argc, char** argv)
   PbFileReader file_reader (msgFileName, false, pb_mode);
 
   Connection* connection = NULL;
+  Connection* b_line     = NULL;
   if (tport == TcpTport)
   {
     connection = new TcpConnection (ipAddress, port);
@@ -170,6 +201,10 @@ int main (int argc, char** argv)
   else if (tport == UdpTport)
   {
     connection = new UdpConnection (ipAddress, port);
+    if (b_port)
+    {
+      b_line = new UdpConnection (ipAddress, b_port);
+    }
   }
   else
   {
@@ -196,6 +231,7 @@ int main (int argc, char** argv)
 
   // make sure that trigger time is less than now_time
   timespec trigger_time = now_time;
+  uint64_t seq          = 0;
   
   while(1)
   {
@@ -204,7 +240,7 @@ int main (int argc, char** argv)
 
     if (compare_timespec (trigger_time, now_time) > 0)
     {
-      if (!timeout_cb (connection, file_reader))
+      if (!timeout_cb (connection, b_line, sequenced, seq, file_reader))
       {
         break;
       }
@@ -218,6 +254,7 @@ int main (int argc, char** argv)
   }
 
   delete connection;
+  delete b_line;
 
   return 0;
 }
@@ -4,6 +4,12 @@
 #define PbFileReaderH
 
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fix_ticks.hpp"
 
 static const int LINE_MAX_LEN = 200;
 
@@ -12,7 +18,8 @@ static const int LINE_MAX_LEN = 200;
 enum PbMode
 {
   CHIX,
-  KB
+  KB,
+  TICKS   // the binary ticks of fixToTicks
 };
 
 class PbFileReader
@@ -26,7 +33,12 @@ public:
     , _next_line          (NULL)
     , _next_line_size     (0)
     , _interval           (0)
+    , _file_stream        (NULL)
     , _mode               (mode)
+    , _ticks_map          (NULL)
+    , _ticks_map_len      (0)
+    , _tick               (NULL)
+    , _ticks_end          (NULL)
 
 #if 0
     , _last_line_ptr  (NULL)
@@ -36,6 +48,12 @@ public:
     , _lines_in_file  (0)
 #endif
   {
+    if (_mode == TICKS)
+    {
+      open_ticks (file_name);
+      return;
+    }
+
     _file_stream = fopen(file_name, "r");
 
     if (!_file_stream)
@@ -86,7 +104,14 @@ public:
 
   ~PbFileReader ()
   {
-    fclose (_file_stream);
+    if (_file_stream)
+    {
+      fclose (_file_stream);
+    }
+    if (_ticks_map)
+    {
+      munmap (_ticks_map, _ticks_map_len);
+    }
   }
 
 #if 0   
@@ -111,6 +136,11 @@ public:
   bool read_line (char*&    line,
                   ssize_t&  line_len)
   {
+    if (_mode == TICKS)
+    {
+      return read_tick (line, line_len);
+    }
+
     bool status = false;
 
     if ((_current_line[0] != '\0') && (_next_line[0] != '\0'))
@@ -150,6 +180,16 @@ public:
 
   void advance ()
   {
+    if (_mode == TICKS)
+    {
+      if (_tick < _ticks_end)
+      {
+        ++_tick;
+      }
+      _interval = ((_tick < _ticks_end) && (_tick + 1 < _ticks_end)) ? (_tick + 1)->_delta_us : 0;
+      return;
+    }
+
     // 1. if current_line and next_line are empty, then fill them all
     if ((_current_line[0] == '\0') && (_next_line[0] == '\0'))
     {
@@ -208,6 +248,64 @@ public:
   }
 
 private:
+  void open_ticks (const char* file_name)
+  {
+    const int fd = open (file_name, O_RDONLY);
+    struct stat st;
+    if ((fd < 0) || (fstat (fd, &st) != 0))
+    {
+      throw std::runtime_error ("PbFileReader: Could not open file specified");
+    }
+
+    FixTicks::FileHeader header;
+    if ((st.st_size < (off_t) sizeof (header)) ||
+          (pread (fd, &header, sizeof (header), 0) != sizeof (header)) ||
+          memcmp (header._magic, FixTicks::MAGIC, sizeof (header._magic)) ||
+          (header._record_size != sizeof (FixTicks::Tick)) ||
+          (sizeof (header) + header._records * sizeof (FixTicks::Tick) > (uint64_t) st.st_size))
+    {
+      close (fd);
+      throw std::runtime_error ("PbFileReader: not a tick file");
+    }
+
+    _ticks_map_len  = st.st_size;
+    _ticks_map      = mmap (NULL, _ticks_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (_ticks_map == MAP_FAILED)
+    {
+      _ticks_map = NULL;
+      throw std::runtime_error ("PbFileReader: could not map the tick file");
+    }
+    madvise (_ticks_map, _ticks_map_len, MADV_SEQUENTIAL);
+
+    _tick       = reinterpret_cast<const FixTicks::Tick*>(static_cast<char*>(_ticks_map) + sizeof (header));
+    _ticks_end  = _tick + header._records;
+    _interval   = (_tick + 1 < _ticks_end) ? (_tick + 1)->_delta_us : 0;
+
+    _current_line       = static_cast<char*>(malloc (LINE_MAX_LEN));
+    _current_line_size  = LINE_MAX_LEN;
+    if (_current_line == NULL)
+    {
+      throw std::runtime_error ("PbFileReader: could not malloc memory");
+    }
+  }
+
+  // the current tick as a line, the same as read_line
+  bool read_tick (char*&    line,
+                  ssize_t&  line_len)
+  {
+    if (_tick >= _ticks_end)
+    {
+      line      = NULL;
+      line_len  = 0;
+      return false;
+    }
+
+    line_len  = FixTicks::format_tick (*_tick, _current_line, _current_line_size);
+    line      = _current_line;
+    return _tick + 1 < _ticks_end;
+  }
+
   uint64_t get_interval (char* next_line, char* current_line)
   {
     if (_mode == CHIX)
@@ -320,6 +418,12 @@ private:
   FILE*     _file_stream;
   PbMode    _mode;
 
+  // TICKS
+  void*                 _ticks_map;
+  size_t                _ticks_map_len;
+  const FixTicks::Tick* _tick;
+  const FixTicks::Tick* _ticks_end;
+
 #if 0
   char**  _lines_in_memory;
   int     _lines_in_file;